@@ -0,0 +1,110 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "../src/perf_counters.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <utility>
+
+namespace hyni::bench {
+
+/**
+ * @brief Prevents the optimizer from discarding a benchmarked value
+ */
+template<typename T>
+inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+/**
+ * @brief Result of a single microbenchmark run
+ */
+struct bench_result {
+    std::string name;
+    size_t iterations = 0;
+    double ns_per_op = 0.0;
+    perf_sample counters;
+
+    [[nodiscard]] double per_op(perf_sample::counter c) const noexcept {
+        return iterations && counters.has(c)
+                   ? static_cast<double>(counters.values[c]) / iterations : 0.0;
+    }
+};
+
+/**
+ * @brief Runs fn() iterations times after a short warm-up and measures it
+ *
+ * Timing and counters cover the whole loop, so per-op values are averages.
+ */
+template<typename Fn>
+bench_result run(const std::string& name, size_t iterations, Fn&& fn) {
+    const size_t warmup = std::max<size_t>(1, iterations / 10);
+    for (size_t i = 0; i < warmup; ++i) {
+        fn();
+    }
+
+    auto& counters = perf_counters::thread_instance();
+
+    counters.start();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    perf_sample sample = counters.stop();
+
+    bench_result result;
+    result.name = name;
+    result.iterations = iterations;
+    result.ns_per_op = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / iterations;
+    result.counters = sample;
+    return result;
+}
+
+inline void print_header() {
+    const auto& counters = perf_counters::thread_instance();
+    if (!counters.available()) {
+        std::printf("# hardware counters unavailable: %s\n", counters.unavailable_reason().c_str());
+    }
+    std::printf("%-44s %10s %14s %8s %16s %16s\n",
+                "benchmark", "iters", "ns/op", "IPC", "cache-miss/op", "branch-miss/op");
+}
+
+inline void print_result(const bench_result& r) {
+    std::printf("%-44s %10zu %14.1f ", r.name.c_str(), r.iterations, r.ns_per_op);
+
+    if (r.counters.has(perf_sample::CYCLES) && r.counters.has(perf_sample::INSTRUCTIONS)) {
+        std::printf("%8.2f ", r.counters.ipc());
+    } else {
+        std::printf("%8s ", "n/a");
+    }
+
+    for (auto c : {perf_sample::CACHE_MISSES, perf_sample::BRANCH_MISSES}) {
+        if (r.counters.has(c)) {
+            std::printf("%16.2f ", r.per_op(c));
+        } else {
+            std::printf("%16s ", "n/a");
+        }
+    }
+    std::printf("\n");
+}
+
+} // hyni::bench
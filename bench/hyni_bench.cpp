@@ -0,0 +1,177 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "bench_harness.h"
+#include "../src/durable_outbox.h"
+#include "../src/general_context.h"
+#include "../src/response_utils.h"
+#include <filesystem>
+#include <iostream>
+
+using namespace hyni;
+
+namespace {
+
+std::string make_sentence(size_t words, size_t seed) {
+    static const char* vocabulary[] = {
+        "so", "can", "you", "give", "me", "a", "time", "when", "have", "to",
+        "handle", "very", "difficult", "customer", "or", "let's", "see", "boss"
+    };
+    constexpr size_t vocabulary_size = sizeof(vocabulary) / sizeof(vocabulary[0]);
+
+    std::string text;
+    for (size_t i = 0; i < words; ++i) {
+        if (i) text += ' ';
+        text += vocabulary[(seed + i * 7) % vocabulary_size];
+    }
+    return text;
+}
+
+void bench_build_request(const std::string& schema_dir) {
+    for (const char* provider : {"openai", "claude"}) {
+        for (size_t turns : {1, 20, 100}) {
+            general_context context(schema_dir + "/" + provider + ".json");
+            context.set_system_message("You are a helpful assistant");
+            for (size_t i = 0; i < turns; ++i) {
+                context.add_user_message(make_sentence(40, i));
+                context.add_assistant_message(make_sentence(80, i + 1));
+            }
+            context.add_user_message("And now?");
+
+            size_t iterations = turns >= 100 ? 500 : 5000;
+            bench::print_result(bench::run(
+                std::string("build_request/") + provider + "/" + std::to_string(turns) + "_turns",
+                iterations, [&] {
+                    auto request = context.build_request();
+                    bench::do_not_optimize(request);
+                }));
+
+            auto request = context.build_request();
+            bench::print_result(bench::run(
+                std::string("request_dump/") + provider + "/" + std::to_string(turns) + "_turns",
+                iterations, [&] {
+                    auto body = request.dump();
+                    bench::do_not_optimize(body);
+                }));
+        }
+    }
+}
+
+void bench_merge_strings() {
+    const std::string base = make_sentence(60, 3);
+    // Tail overlapping the last words of base
+    const std::string tail = make_sentence(6, 3 + 54 * 7) + " " + make_sentence(20, 11);
+    const std::string unrelated = "completely different words without any overlap at all";
+
+    bench::print_result(bench::run("merge_strings/overlap", 200000, [&] {
+        int best = -1;
+        auto merged = response_utils::merge_strings(base, tail, best);
+        bench::do_not_optimize(merged);
+    }));
+
+    bench::print_result(bench::run("merge_strings/no_overlap", 200000, [&] {
+        int best = -1;
+        auto merged = response_utils::merge_strings(base, unrelated, best);
+        bench::do_not_optimize(merged);
+    }));
+
+    bench::print_result(bench::run("merge_strings_trigram/overlap", 200000, [&] {
+        int best = -1;
+        auto merged = response_utils::merge_strings_trigram(base, tail, best);
+        bench::do_not_optimize(merged);
+    }));
+
+    bench::print_result(bench::run("merge_strings_fuzzy/overlap", 200000, [&] {
+        int best = -1;
+        auto merged = response_utils::merge_strings_fuzzy(base, tail, best);
+        bench::do_not_optimize(merged);
+    }));
+
+    // ASR revised a word of the overlap; merge_strings finds no bigram here
+    const std::string revised = "uh" + tail.substr(tail.find(' '));
+    bench::print_result(bench::run("merge_strings_fuzzy/revised", 200000, [&] {
+        int best = -1;
+        auto merged = response_utils::merge_strings_fuzzy(base, revised, best, 32);
+        bench::do_not_optimize(merged);
+    }));
+
+    bench::print_result(bench::run("merge_strings_fuzzy/no_overlap", 200000, [&] {
+        int best = -1;
+        auto merged = response_utils::merge_strings_fuzzy(base, unrelated, best);
+        bench::do_not_optimize(merged);
+    }));
+
+    bench::print_result(bench::run("split_and_normalize/60_words", 200000, [&] {
+        auto words = response_utils::split_and_normalize(base);
+        bench::do_not_optimize(words);
+    }));
+}
+
+void bench_base64() {
+    std::string payload(256 * 1024, '\0');
+    for (size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<char>(i * 31);
+    }
+
+    bench::print_result(bench::run("base64_encode/256KiB", 500, [&] {
+        auto encoded = response_utils::base64_encode(payload);
+        bench::do_not_optimize(encoded);
+    }));
+}
+
+void bench_outbox_enqueue() {
+    const auto directory = std::filesystem::temp_directory_path() / "hyni_bench_outbox";
+    std::filesystem::remove_all(directory);
+    {
+        // No workers: measures the caller's side, group commits run behind it
+        outbox_options options;
+        options.workers = 0;
+        durable_outbox outbox(directory, nullptr, options);
+
+        outbox_request request;
+        request.messages.push_back({"user", make_sentence(60, 3)});
+        size_t next_id = 0;
+        bench::print_result(bench::run("durable_outbox/enqueue", 20000, [&] {
+            request.id = std::to_string(next_id++);
+            bench::do_not_optimize(outbox.enqueue(request));
+        }));
+        outbox.commit();
+        std::printf("durable_outbox: %llu requests in %llu group commits\n",
+                    static_cast<unsigned long long>(outbox.get_stats().enqueued),
+                    static_cast<unsigned long long>(outbox.get_stats().commits));
+    }
+    std::filesystem::remove_all(directory);
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    const std::string schema_dir = argc > 1 ? argv[1] : "../schemas";
+    if (!std::filesystem::exists(schema_dir)) {
+        std::cerr << "Schema directory not found: " << schema_dir << "\n"
+                  << "Usage: " << argv[0] << " [schema_dir]" << std::endl;
+        return 1;
+    }
+
+    bench::print_header();
+    bench_build_request(schema_dir);
+    bench_merge_strings();
+    bench_base64();
+    bench_outbox_enqueue();
+
+    // Scoped probes inside the library only record when built with HYNI_ENABLE_PERF_PROBES
+    auto probes = perf_probe_registry::instance().snapshot();
+    if (!probes.empty()) {
+        std::cout << "\n" << perf_probe_registry::instance().report();
+    }
+
+    return 0;
+}
@@ -0,0 +1,261 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "../src/context_factory.h"
+#include "../src/websocket_client.h"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#include <unistd.h>
+
+using namespace hyni;
+
+namespace {
+
+/**
+ * @brief Heap and resident set sizes at one point in time
+ */
+struct memory_snapshot {
+    long long heap_bytes = -1;  ///< Bytes in use according to the allocator, -1 if unknown
+    long long rss_bytes = -1;   ///< Resident set size, -1 if unknown
+
+    static memory_snapshot take() {
+        memory_snapshot s;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+        struct mallinfo2 mi = mallinfo2();
+        s.heap_bytes = static_cast<long long>(mi.uordblks + mi.hblkhd);
+#endif
+        std::ifstream statm("/proc/self/statm");
+        long long size_pages = 0, resident_pages = 0;
+        if (statm >> size_pages >> resident_pages) {
+            s.rss_bytes = resident_pages * sysconf(_SC_PAGESIZE);
+        }
+        return s;
+    }
+};
+
+long long available_memory_bytes() {
+    std::ifstream meminfo("/proc/meminfo");
+    std::string key;
+    long long value = 0;
+    std::string unit;
+    while (meminfo >> key >> value >> unit) {
+        if (key == "MemAvailable:") {
+            return value * 1024;
+        }
+    }
+    return -1;
+}
+
+void trim_heap() {
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+}
+
+void print_header() {
+    std::printf("%-48s %10s %16s %16s\n", "population", "objects", "heap bytes/obj", "rss bytes/obj");
+}
+
+void print_row(const std::string& name, size_t count,
+               const memory_snapshot& before, const memory_snapshot& after) {
+    std::printf("%-48s %10zu ", name.c_str(), count);
+    if (before.heap_bytes >= 0 && after.heap_bytes >= 0) {
+        std::printf("%16.1f ", static_cast<double>(after.heap_bytes - before.heap_bytes) / count);
+    } else {
+        std::printf("%16s ", "n/a");
+    }
+    if (before.rss_bytes >= 0 && after.rss_bytes >= 0) {
+        std::printf("%16.1f\n", static_cast<double>(after.rss_bytes - before.rss_bytes) / count);
+    } else {
+        std::printf("%16s\n", "n/a");
+    }
+    std::fflush(stdout);
+}
+
+std::string make_text(size_t words, size_t seed) {
+    static const char* vocabulary[] = {
+        "the", "quarterly", "report", "shows", "revenue", "growth", "across", "all",
+        "regions", "while", "costs", "remained", "flat", "compared", "to", "last", "year"
+    };
+    constexpr size_t vocabulary_size = sizeof(vocabulary) / sizeof(vocabulary[0]);
+
+    std::string text;
+    for (size_t i = 0; i < words; ++i) {
+        if (i) text += ' ';
+        text += vocabulary[(seed * 13 + i * 7) % vocabulary_size];
+    }
+    return text;
+}
+
+void fill_history(general_context& context, size_t turns, size_t seed) {
+    context.set_system_message("You are a helpful assistant");
+    for (size_t t = 0; t < turns; ++t) {
+        context.add_user_message(make_text(30, seed + t));
+        context.add_assistant_message(make_text(90, seed + t + 1));
+    }
+}
+
+/**
+ * @brief Measures a population of contexts, skipping it if it would not fit in memory
+ * @param per_object_hint Bytes per object from a smaller population, 0 if unknown
+ * @return Measured heap bytes per object, or per_object_hint if skipped
+ */
+double measure_contexts(context_factory& factory, const std::string& provider,
+                        size_t count, size_t turns, double per_object_hint) {
+    std::string name = "general_context/" + provider + "/" + std::to_string(turns) + "_turns";
+
+    long long available = available_memory_bytes();
+    if (per_object_hint > 0 && available > 0 &&
+        per_object_hint * count > static_cast<double>(available) * 0.8) {
+        std::printf("%-48s %10zu %16s (projected %.1f MiB exceeds available memory)\n",
+                    name.c_str(), count, "skipped", per_object_hint * count / (1024.0 * 1024.0));
+        return per_object_hint;
+    }
+
+    trim_heap();
+    auto before = memory_snapshot::take();
+
+    std::vector<std::unique_ptr<general_context>> contexts;
+    contexts.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        auto context = factory.create_context(provider);
+        if (turns > 0) {
+            fill_history(*context, turns, i);
+        }
+        contexts.push_back(std::move(context));
+    }
+
+    auto after = memory_snapshot::take();
+    print_row(name, count, before, after);
+
+    double per_object = after.heap_bytes >= 0
+                            ? static_cast<double>(after.heap_bytes - before.heap_bytes) / count
+                            : static_cast<double>(after.rss_bytes - before.rss_bytes) / count;
+
+    contexts.clear();
+    trim_heap();
+    return per_object;
+}
+
+void measure_schema_cache(const std::string& schema_dir, const std::vector<std::string>& providers) {
+    for (const auto& provider : providers) {
+        auto registry = schema_registry::create().set_schema_directory(schema_dir).build();
+        context_factory factory(registry);
+
+        // A warm context keeps the measured delta limited to the cache entry itself
+        auto warm = std::make_unique<general_context>(schema_dir + "/" + provider + ".json");
+
+        trim_heap();
+        auto before = memory_snapshot::take();
+        auto context = factory.create_context(provider);
+        auto with_context = memory_snapshot::take();
+        auto second = factory.create_context(provider);
+        auto after = memory_snapshot::take();
+
+        // First create = cache entry + context, second create = context only
+        memory_snapshot cache_only_before = before;
+        memory_snapshot cache_only_after = with_context;
+        if (before.heap_bytes >= 0) {
+            cache_only_after.heap_bytes -= (after.heap_bytes - with_context.heap_bytes);
+        }
+        if (before.rss_bytes >= 0) {
+            cache_only_after.rss_bytes -= (after.rss_bytes - with_context.rss_bytes);
+        }
+        print_row("context_factory/schema_cache_entry/" + provider, 1,
+                  cache_only_before, cache_only_after);
+    }
+}
+
+void measure_websocket_sessions(size_t count) {
+    asio::io_context io_context;
+
+    trim_heap();
+    auto before = memory_snapshot::take();
+
+    std::vector<std::shared_ptr<hyni_websocket_client>> sessions;
+    sessions.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        sessions.push_back(std::make_shared<hyni_websocket_client>(io_context, "localhost", "8765"));
+    }
+
+    auto after = memory_snapshot::take();
+    print_row("websocket_client/unconnected_session", count, before, after);
+}
+
+std::vector<size_t> parse_sizes(const std::string& list) {
+    std::vector<size_t> sizes;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) sizes.push_back(std::stoul(item));
+    }
+    return sizes;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    std::string schema_dir = "../schemas";
+    std::vector<size_t> populations = {1000, 10000, 100000};
+    size_t turns = 100;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--schemas" && i + 1 < argc) {
+            schema_dir = argv[++i];
+        } else if (arg == "--populations" && i + 1 < argc) {
+            populations = parse_sizes(argv[++i]);
+        } else if (arg == "--turns" && i + 1 < argc) {
+            turns = std::stoul(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--schemas dir] [--populations 1000,10000,100000] [--turns 100]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    if (!std::filesystem::exists(schema_dir)) {
+        std::cerr << "Schema directory not found: " << schema_dir << std::endl;
+        return 1;
+    }
+
+    const std::vector<std::string> providers = {"openai", "claude", "deepseek", "mistral"};
+
+    print_header();
+    measure_schema_cache(schema_dir, providers);
+
+    auto registry = schema_registry::create().set_schema_directory(schema_dir).build();
+    context_factory factory(registry);
+
+    for (const auto& provider : {std::string("openai"), std::string("claude")}) {
+        for (size_t history : {size_t{0}, turns}) {
+            double hint = 0.0;
+            for (size_t count : populations) {
+                hint = measure_contexts(factory, provider, count, history, hint);
+            }
+        }
+    }
+
+    measure_websocket_sessions(populations.empty() ? 1000 : populations.front());
+
+    return 0;
+}
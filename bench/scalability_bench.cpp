@@ -0,0 +1,297 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "bench_harness.h"
+#include "../src/context_factory.h"
+#include "../src/logger.h"
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace hyni;
+
+namespace {
+
+/**
+ * @brief Throughput and counters of one operation at one thread count
+ */
+struct scaling_point {
+    size_t threads = 0;
+    uint64_t ops = 0;
+    double seconds = 0.0;
+    perf_sample counters;
+    lock_contention_stats::snapshot contention;
+
+    [[nodiscard]] double ops_per_sec() const noexcept { return seconds > 0 ? ops / seconds : 0.0; }
+    [[nodiscard]] double per_op(perf_sample::counter c) const noexcept {
+        return ops && counters.has(c) ? static_cast<double>(counters.values[c]) / ops : 0.0;
+    }
+};
+
+/**
+ * @brief Operation under test; returns per-thread state via the factory function
+ *
+ * make_worker() is called once on each thread so thread-local setup stays out of
+ * the measured loop.
+ */
+struct scaling_case {
+    std::string name;
+    std::function<std::function<void()>()> make_worker;
+    std::function<lock_contention_stats::snapshot()> contention;
+};
+
+scaling_point run_point(const scaling_case& c, size_t threads, std::chrono::milliseconds duration) {
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::atomic<bool> stop{false};
+    std::vector<uint64_t> ops(threads, 0);
+    std::vector<perf_sample> samples(threads);
+    std::vector<std::thread> workers;
+
+    auto contention_before = c.contention ? c.contention() : lock_contention_stats::snapshot{};
+
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            auto op = c.make_worker();
+            auto& counters = perf_counters::thread_instance();
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+
+            uint64_t local_ops = 0;
+            counters.start();
+            while (!stop.load(std::memory_order_relaxed)) {
+                op();
+                ++local_ops;
+            }
+            samples[t] = counters.stop();
+            ops[t] = local_ops;
+        });
+    }
+
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (auto& w : workers) {
+        w.join();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    scaling_point point;
+    point.threads = threads;
+    point.seconds = std::chrono::duration<double>(elapsed).count();
+    for (size_t t = 0; t < threads; ++t) {
+        point.ops += ops[t];
+        point.counters += samples[t];
+    }
+
+    if (c.contention) {
+        auto after = c.contention();
+        point.contention.contended = after.contended - contention_before.contended;
+        point.contention.wait_ns = after.wait_ns - contention_before.wait_ns;
+    }
+    return point;
+}
+
+void report(const scaling_case& c, const std::vector<scaling_point>& points, std::ostream* csv) {
+    if (points.empty()) return;
+    const double base = points.front().ops_per_sec();
+
+    std::printf("\n== %s ==\n", c.name.c_str());
+    std::printf("%8s %14s %10s %16s %14s %14s  %s\n",
+                "threads", "ops/s", "speedup", "efficiency", "cache-miss/op", "lock-wait/op", "throughput");
+
+    const double peak = std::max_element(points.begin(), points.end(),
+                                         [](const auto& a, const auto& b) {
+                                             return a.ops_per_sec() < b.ops_per_sec();
+                                         })->ops_per_sec();
+
+    for (const auto& p : points) {
+        double speedup = base > 0 ? p.ops_per_sec() / base : 0.0;
+        double efficiency = speedup / p.threads;
+        double wait_per_op = p.ops ? static_cast<double>(p.contention.wait_ns) / p.ops : 0.0;
+
+        std::printf("%8zu %14.0f %9.2fx %15.0f%% ", p.threads, p.ops_per_sec(), speedup, efficiency * 100);
+        if (p.counters.has(perf_sample::CACHE_MISSES)) {
+            std::printf("%14.2f ", p.per_op(perf_sample::CACHE_MISSES));
+        } else {
+            std::printf("%14s ", "n/a");
+        }
+        std::printf("%12.1fns  ", wait_per_op);
+
+        int bar = peak > 0 ? static_cast<int>(40.0 * p.ops_per_sec() / peak) : 0;
+        std::printf("%s\n", std::string(bar, '#').c_str());
+
+        if (csv) {
+            *csv << c.name << ',' << p.threads << ',' << p.ops_per_sec() << ',' << speedup << ','
+                 << efficiency << ',' << p.per_op(perf_sample::CACHE_MISSES) << ','
+                 << p.contention.contended << ',' << p.contention.wait_ns << '\n';
+        }
+    }
+
+    // Flag contention points: poor efficiency, lock waits, or cache misses growing with threads
+    const auto& first = points.front();
+    const auto& last = points.back();
+    double last_efficiency = base > 0 ? last.ops_per_sec() / base / last.threads : 0.0;
+
+    if (last.threads > 1 && last_efficiency < 0.5) {
+        std::printf("  ! scaling efficiency %.0f%% at %zu threads\n", last_efficiency * 100, last.threads);
+    }
+    if (last.contention.contended > 0) {
+        std::printf("  ! lock contention: %llu contended acquisitions, %.1f%% of thread time waiting\n",
+                    static_cast<unsigned long long>(last.contention.contended),
+                    100.0 * last.contention.wait_ns / (last.seconds * 1e9 * last.threads));
+    }
+    if (first.counters.has(perf_sample::CACHE_MISSES) && last.threads > 1 &&
+        last.per_op(perf_sample::CACHE_MISSES) > 2.0 * first.per_op(perf_sample::CACHE_MISSES) + 1.0) {
+        std::printf("  ! cache misses per op grow %.1f -> %.1f: shared cache lines (true or false sharing)\n",
+                    first.per_op(perf_sample::CACHE_MISSES), last.per_op(perf_sample::CACHE_MISSES));
+    }
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    std::string schema_dir = "../schemas";
+    size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::chrono::milliseconds duration{300};
+    std::string csv_path;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--schemas" && i + 1 < argc) {
+            schema_dir = argv[++i];
+        } else if (arg == "--max-threads" && i + 1 < argc) {
+            max_threads = std::stoul(argv[++i]);
+        } else if (arg == "--duration-ms" && i + 1 < argc) {
+            duration = std::chrono::milliseconds(std::stol(argv[++i]));
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--schemas dir] [--max-threads N] [--duration-ms 300] [--csv out.csv]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    if (!std::filesystem::exists(schema_dir)) {
+        std::cerr << "Schema directory not found: " << schema_dir << std::endl;
+        return 1;
+    }
+
+    std::vector<size_t> thread_counts;
+    for (size_t t = 1; t < max_threads; t *= 2) {
+        thread_counts.push_back(t);
+    }
+    thread_counts.push_back(max_threads);
+
+    auto registry = schema_registry::create().set_schema_directory(schema_dir).build();
+    auto factory = std::make_shared<context_factory>(registry);
+    factory->create_context("claude"); // warm the schema cache
+
+    // File-only logging so the console does not dominate the measurement
+    logger::instance().init(true, false);
+    logger::instance().set_min_level(logger::Level::INFO);
+
+    auto factory_contention = [factory] {
+        auto stats = factory->get_cache_stats();
+        return lock_contention_stats::snapshot{stats.lock_contentions, stats.lock_wait_ns};
+    };
+
+    std::vector<scaling_case> cases = {
+        {"context_factory::create_context",
+         [factory] {
+             return [factory] {
+                 auto context = factory->create_context("claude");
+                 bench::do_not_optimize(context);
+             };
+         },
+         factory_contention},
+        {"context_factory::get_cache_stats (shared lock)",
+         [factory] {
+             return [factory] {
+                 auto stats = factory->get_cache_stats();
+                 bench::do_not_optimize(stats);
+             };
+         },
+         factory_contention},
+        {"context_factory::get_thread_local_context",
+         [factory] {
+             return [factory] {
+                 auto& context = factory->get_thread_local_context("claude");
+                 bench::do_not_optimize(context);
+             };
+         },
+         factory_contention},
+        {"general_context::build_request",
+         [factory] {
+             auto context = std::shared_ptr<general_context>(factory->create_context("claude"));
+             context->set_system_message("You are a helpful assistant");
+             for (int i = 0; i < 10; ++i) {
+                 context->add_user_message("What is the capital of France?");
+                 context->add_assistant_message("The capital of France is Paris.");
+             }
+             context->add_user_message("And of Germany?");
+             return [context] {
+                 auto request = context->build_request();
+                 bench::do_not_optimize(request);
+             };
+         },
+         nullptr},
+        {"logger::log (file sink)",
+         [] {
+             return [] {
+                 LOG_INFO("scalability benchmark log line");
+             };
+         },
+         [] { return logger::instance().get_lock_stats(); }},
+    };
+
+    std::ofstream csv;
+    if (!csv_path.empty()) {
+        csv.open(csv_path);
+        csv << "operation,threads,ops_per_sec,speedup,efficiency,cache_misses_per_op,"
+               "lock_contentions,lock_wait_ns\n";
+    }
+
+    const auto& counters = perf_counters::thread_instance();
+    if (!counters.available()) {
+        std::printf("# hardware counters unavailable: %s\n", counters.unavailable_reason().c_str());
+    }
+
+    for (const auto& c : cases) {
+        std::vector<scaling_point> points;
+        for (size_t threads : thread_counts) {
+            points.push_back(run_point(c, threads, duration));
+        }
+        report(c, points, csv.is_open() ? &csv : nullptr);
+    }
+
+    std::string log_file = logger::instance().get_log_file_name();
+    logger::instance().shutdown();
+    if (!log_file.empty()) {
+        std::filesystem::remove(log_file);
+    }
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "bench_harness.h"
+#include "../src/json_serializer.h"
+#include "../src/text_attachment.h"
+#include "../src/utf8.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace hyni;
+
+namespace {
+
+/**
+ * @brief Chat request of about target_bytes, built from realistic message text
+ *
+ * Prose with a newline every ~80 bytes and occasional quotes, backslashes and
+ * tabs like pasted documents, optionally with some non-ASCII words, split into
+ * turns of a few KB.
+ */
+nlohmann::json make_conversation(size_t target_bytes, bool non_ascii) {
+    static const std::vector<std::string> words = {
+        "the", "model", "request", "latency", "context", "window", "token", "transcript",
+        "summary", "meeting", "budget", "response", "of", "and", "to", "a",
+    };
+    static const std::vector<std::string> escaped_words = {"\"quoted\"", "C:\\path\\file", "value:\t42"};
+    static const std::vector<std::string> unicode_words = {"caf\xC3\xA9", "na\xC3\xAFve", "\xE6\x97\xA5\xE6\x9C\xAC",
+                                                           "\xF0\x9F\x98\x80"};
+    std::mt19937 rng(7);
+
+    nlohmann::json messages = nlohmann::json::array();
+    size_t total = 0;
+    bool user = true;
+    while (total < target_bytes) {
+        std::string content;
+        while (content.size() < 4096) {
+            const auto& pool = non_ascii && rng() % 8 == 0 ? unicode_words
+                               : rng() % 30 == 0                 ? escaped_words
+                                                                 : words;
+            content += pool[rng() % pool.size()];
+            content += rng() % 12 == 0 ? '\n' : ' ';
+        }
+        total += content.size();
+        messages.push_back({{"role", user ? "user" : "assistant"}, {"content", std::move(content)}});
+        user = !user;
+    }
+    return {{"model", "gpt-4o"}, {"max_tokens", 1024}, {"temperature", 0.7}, {"messages", std::move(messages)}};
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = 200;
+    size_t size_kb = 1024;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::stoul(argv[++i]);
+        } else if (arg == "--size-kb" && i + 1 < argc) {
+            size_kb = std::stoul(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--iterations 200] [--size-kb 1024]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::printf("# json_serializer escaping: %s, UTF-8 validation: %s\n", json_serializer::simd_level(),
+                utf8::simd_level());
+    bench::print_header();
+
+    for (bool non_ascii : {false, true}) {
+        const auto payload = make_conversation(size_kb * 1024, non_ascii);
+        const std::string label = std::to_string(size_kb) + "KB " + (non_ascii ? "mixed UTF-8" : "ASCII");
+
+        // Same bytes either way; the comparison is meaningless otherwise
+        if (json_serializer::dump(payload) != payload.dump()) {
+            std::fprintf(stderr, "json_serializer output differs from nlohmann::json::dump()\n");
+            return 1;
+        }
+        const double mb = static_cast<double>(payload.dump().size()) / (1024.0 * 1024.0);
+
+        auto baseline = bench::run("nlohmann dump " + label, iterations, [&] {
+            auto text = payload.dump();
+            bench::do_not_optimize(text);
+        });
+        bench::print_result(baseline);
+
+        auto simd = bench::run("json_serializer " + label, iterations, [&] {
+            auto text = json_serializer::dump(payload);
+            bench::do_not_optimize(text);
+        });
+        bench::print_result(simd);
+
+        auto trusted = bench::run("json_serializer trusted " + label, iterations, [&] {
+            auto text = json_serializer::dump(payload, json_serializer::utf8_mode::trusted);
+            bench::do_not_optimize(text);
+        });
+        bench::print_result(trusted);
+
+        std::printf("%-44s %9.0f MB/s -> %.0f MB/s (%.1fx)\n", label.c_str(),
+                    mb * 1e9 / baseline.ns_per_op, mb * 1e9 / simd.ns_per_op,
+                    baseline.ns_per_op / simd.ns_per_op);
+    }
+
+    // One large document: read into a string and copied into the message and the
+    // request, versus mapped and escaped from the file at serialization
+    std::string document;
+    const auto conversation = make_conversation(size_kb * 1024, false);
+    for (const auto& message : conversation["messages"]) {
+        document += message["content"].get<std::string>();
+    }
+    const auto path = std::filesystem::temp_directory_path() / "hyni_serialization_bench.txt";
+    std::ofstream(path, std::ios::binary) << document;
+    const nlohmann::json request_template = {{"model", "gpt-4o"}, {"max_tokens", 1024}};
+    const std::string label = std::to_string(size_kb) + "KB document";
+
+    auto copied = bench::run("copied " + label, iterations, [&] {
+        std::ifstream file(path, std::ios::binary);
+        std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::vector<nlohmann::json> messages{{{"role", "user"}, {"content", text}}};
+        nlohmann::json request = request_template;
+        request["messages"] = messages;
+        auto body = json_serializer::dump(request, json_serializer::utf8_mode::trusted);
+        bench::do_not_optimize(body);
+    });
+    bench::print_result(copied);
+
+    auto attached = bench::run("attached " + label, iterations, [&] {
+        auto attachment = text_attachment::map_file(path);
+        const text_attachment_map attachments{{attachment->placeholder(), attachment}};
+        std::vector<nlohmann::json> messages{{{"role", "user"}, {"content", attachment->placeholder()}}};
+        nlohmann::json request = request_template;
+        request["messages"] = messages;
+        auto body = json_serializer::dump(request, json_serializer::utf8_mode::trusted, &attachments);
+        bench::do_not_optimize(body);
+    });
+    bench::print_result(attached);
+    std::printf("%-44s %.1fx\n", label.c_str(), copied.ns_per_op / attached.ns_per_op);
+    std::filesystem::remove(path);
+    return 0;
+}
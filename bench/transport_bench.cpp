@@ -0,0 +1,145 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "bench_harness.h"
+#include "../src/http_client.h"
+#include "../tests/mock_http_server.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+using namespace hyni;
+using hyni::testing::mock_http_server;
+using hyni::testing::mock_request;
+using hyni::testing::mock_response;
+
+namespace {
+
+/**
+ * @brief Round-trip latency distribution of one transport and payload size
+ */
+struct latency_result {
+    std::vector<double> samples_us;
+    bench::bench_result totals;
+
+    [[nodiscard]] double percentile(double p) const {
+        if (samples_us.empty()) {
+            return 0.0;
+        }
+        auto sorted = samples_us;
+        std::sort(sorted.begin(), sorted.end());
+        size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()));
+        return sorted[index];
+    }
+};
+
+latency_result measure(const std::string& name, http_client& client, const std::string& url,
+                       const nlohmann::json& payload, size_t iterations, bool reconnect) {
+    latency_result result;
+    result.samples_us.reserve(iterations);
+
+    result.totals = bench::run(name, iterations, [&] {
+        if (reconnect) {
+            // A fresh handle has no pooled connection, so every request pays connect()
+            http_client fresh;
+            fresh.set_unix_socket_path(client.get_unix_socket_path());
+            auto start = std::chrono::steady_clock::now();
+            auto response = fresh.post(url, payload);
+            result.samples_us.push_back(std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start).count());
+            bench::do_not_optimize(response);
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        auto response = client.post(url, payload);
+        result.samples_us.push_back(std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count());
+        bench::do_not_optimize(response);
+    });
+
+    // Drop the warm-up samples recorded by bench::run
+    result.samples_us.erase(result.samples_us.begin(),
+                            result.samples_us.end() - static_cast<long>(iterations));
+    return result;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = 5000;
+    std::string socket_path = (std::filesystem::temp_directory_path() / "hyni_transport_bench.sock").string();
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::stoul(argv[++i]);
+        } else if (arg == "--socket" && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--iterations 5000] [--socket path]" << std::endl;
+            return 1;
+        }
+    }
+
+    // Same canned chat completion on both transports
+    auto reply = [](const mock_request&) {
+        return mock_response{200, "application/json",
+            R"({"choices":[{"message":{"role":"assistant","content":"The capital of France is Paris."}}]})"};
+    };
+    mock_http_server tcp_server(reply);
+    mock_http_server uds_server(socket_path, reply);
+
+    http_client tcp_client;
+    http_client uds_client;
+    uds_client.set_unix_socket_path(socket_path);
+
+    const std::string tcp_url = tcp_server.url() + "/v1/chat/completions";
+    const std::string uds_url = uds_server.url() + "/v1/chat/completions";
+
+    std::vector<std::pair<std::string, nlohmann::json>> payloads = {
+        {"small", {{"model", "gpt-4o"}, {"messages", {{{"role", "user"}, {"content", "Hello"}}}}}},
+        {"64KB", {{"model", "gpt-4o"}, {"messages", {{{"role", "user"}, {"content", std::string(64 * 1024, 'x')}}}}}},
+    };
+
+    bench::print_header();
+    std::vector<std::pair<std::string, latency_result>> results;
+    for (const auto& [size, payload] : payloads) {
+        for (bool reconnect : {false, true}) {
+            size_t n = reconnect ? std::max<size_t>(1, iterations / 5) : iterations;
+            std::string suffix = std::string(reconnect ? " connect+post " : " keep-alive post ") + size;
+
+            results.emplace_back("tcp loopback" + suffix,
+                                 measure("tcp loopback" + suffix, tcp_client, tcp_url, payload, n, reconnect));
+            bench::print_result(results.back().second.totals);
+            results.emplace_back("unix socket" + suffix,
+                                 measure("unix socket" + suffix, uds_client, uds_url, payload, n, reconnect));
+            bench::print_result(results.back().second.totals);
+        }
+    }
+
+    std::printf("\n%-44s %10s %10s %10s\n", "round trip (us)", "p50", "p90", "p99");
+    for (const auto& [name, r] : results) {
+        std::printf("%-44s %10.1f %10.1f %10.1f\n", name.c_str(),
+                    r.percentile(0.50), r.percentile(0.90), r.percentile(0.99));
+    }
+
+    // TCP and UDS rows alternate, so each pair compares the same workload
+    std::printf("\n");
+    for (size_t i = 0; i + 1 < results.size(); i += 2) {
+        double tcp = results[i].second.percentile(0.50);
+        double uds = results[i + 1].second.percentile(0.50);
+        std::printf("%-44s %9.1f%% lower p50 over the unix socket\n",
+                    results[i + 1].first.c_str(), tcp > 0 ? (tcp - uds) / tcp * 100 : 0.0);
+    }
+
+    return 0;
+}
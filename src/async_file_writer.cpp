@@ -0,0 +1,681 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "async_file_writer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define HYNI_HAVE_IO_URING
+#endif
+#endif
+
+namespace hyni {
+
+struct async_io_service::io_buffer {
+    char* data = nullptr;
+    size_t size = 0;
+    size_t capacity = 0;
+    int fixed_index = -1;            // slot in the registered pool, -1 for a heap buffer
+    std::unique_ptr<char[]> heap;
+};
+
+struct async_io_service::io_op {
+    enum kind_t { WRITE, FSYNC } kind = WRITE;
+    std::shared_ptr<file_state> file;
+    io_buffer buffer;
+    uint64_t offset = 0;
+    size_t done = 0;                 // bytes written so far; short writes are resubmitted
+    int error = 0;
+};
+
+struct async_io_service::file_state {
+    int fd = -1;
+    async_file_options options;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    io_buffer current;               // buffer being filled, data == nullptr if none
+    uint64_t offset = 0;             // file offset of current.data[0]
+    uint64_t queued = 0;             // operations handed to the service
+    uint64_t completed = 0;          // operations finished
+    bool dirty = false;              // written since the last fsync
+    bool sync_queued = false;
+    std::chrono::steady_clock::time_point last_sync = std::chrono::steady_clock::now();
+    int error = 0;
+};
+
+// ===== io_uring =====
+
+#ifdef HYNI_HAVE_IO_URING
+
+namespace {
+
+int sys_io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int sys_io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+} // anonymous namespace
+
+/**
+ * @brief Minimal io_uring ring driven directly through the syscalls
+ *
+ * Only the I/O thread touches the ring, so the submission side needs no locking;
+ * acquire/release ordering on the shared head and tail indices is all the kernel
+ * protocol requires.
+ */
+struct async_io_service::uring {
+    int fd = -1;
+    unsigned entries = 0;
+
+    void* sq_ptr = nullptr;
+    size_t sq_size = 0;
+    void* cq_ptr = nullptr;
+    size_t cq_size = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqes_size = 0;
+
+    unsigned local_tail = 0;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    ~uring() {
+        if (sqes) ::munmap(sqes, sqes_size);
+        if (cq_ptr && cq_ptr != sq_ptr) ::munmap(cq_ptr, cq_size);
+        if (sq_ptr) ::munmap(sq_ptr, sq_size);
+        if (fd >= 0) ::close(fd);
+    }
+
+    static std::unique_ptr<uring> create(unsigned entries) {
+        io_uring_params params{};
+        int fd = sys_io_uring_setup(entries, &params);
+        if (fd < 0) {
+            return nullptr;
+        }
+
+        auto ring = std::make_unique<uring>();
+        ring->fd = fd;
+        ring->entries = params.sq_entries;
+
+        ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            ring->sq_size = ring->cq_size = std::max(ring->sq_size, ring->cq_size);
+        }
+
+        ring->sq_ptr = ::mmap(nullptr, ring->sq_size, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (ring->sq_ptr == MAP_FAILED) {
+            ring->sq_ptr = nullptr;
+            return nullptr;
+        }
+        if (single_mmap) {
+            ring->cq_ptr = ring->sq_ptr;
+        } else {
+            ring->cq_ptr = ::mmap(nullptr, ring->cq_size, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (ring->cq_ptr == MAP_FAILED) {
+                ring->cq_ptr = nullptr;
+                return nullptr;
+            }
+        }
+        ring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return nullptr;
+        }
+        ring->sqes = static_cast<io_uring_sqe*>(sqes);
+
+        auto* sq = static_cast<char*>(ring->sq_ptr);
+        auto* cq = static_cast<char*>(ring->cq_ptr);
+        ring->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        ring->sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        ring->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        ring->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        ring->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        ring->cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        ring->local_tail = *ring->sq_tail;
+
+        if (!ring->supports({IORING_OP_WRITE, IORING_OP_WRITE_FIXED, IORING_OP_FSYNC})) {
+            return nullptr;
+        }
+        return ring;
+    }
+
+    bool supports(std::initializer_list<int> opcodes) const {
+        constexpr unsigned max_ops = 64;
+        std::vector<char> storage(sizeof(io_uring_probe) + max_ops * sizeof(io_uring_probe_op), 0);
+        auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+        if (sys_io_uring_register(fd, IORING_REGISTER_PROBE, probe, max_ops) < 0) {
+            return false;  // Kernels before 5.6 have no probe and no IORING_OP_WRITE either
+        }
+        return std::all_of(opcodes.begin(), opcodes.end(), [probe](int op) {
+            return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+        });
+    }
+
+    // Entries are published to the kernel in submit_and_wait()
+    io_uring_sqe* next_sqe() {
+        unsigned index = local_tail++ & *sq_mask;
+        io_uring_sqe* sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array[index] = index;
+        return sqe;
+    }
+
+    // Submits `count` prepared entries and waits for as many completions
+    int submit_and_wait(unsigned count) {
+        __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+        int ret;
+        do {
+            ret = sys_io_uring_enter(fd, count, count, IORING_ENTER_GETEVENTS);
+        } while (ret < 0 && errno == EINTR);
+        return ret;
+    }
+
+    int wait(unsigned count) {
+        int ret;
+        do {
+            ret = sys_io_uring_enter(fd, 0, count, IORING_ENTER_GETEVENTS);
+        } while (ret < 0 && errno == EINTR);
+        return ret;
+    }
+
+    template<typename Fn>
+    unsigned reap(Fn&& on_completion) {
+        unsigned head = *cq_head;
+        unsigned seen = 0;
+        while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+            const io_uring_cqe& cqe = cqes[head & *cq_mask];
+            on_completion(cqe.user_data, cqe.res);
+            ++head;
+            ++seen;
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+        return seen;
+    }
+};
+
+#else
+
+struct async_io_service::uring {};
+
+#endif
+
+// ===== async_io_service =====
+
+async_io_service::async_io_service(backend preferred, size_t buffer_size, size_t buffer_count,
+                                   size_t max_queued_bytes)
+    : m_buffer_size(std::max<size_t>(buffer_size, 4096))
+    , m_max_queued_bytes(max_queued_bytes) {
+    m_arena = std::make_unique<char[]>(m_buffer_size * buffer_count);
+    m_free_slots.reserve(buffer_count);
+    for (size_t i = buffer_count; i-- > 0; ) {
+        m_free_slots.push_back(static_cast<int>(i));
+    }
+    // Only accounted: queued data is freed by the disk catching up, not on request
+    m_memory = memory_governor::instance().register_component("async_io_service.queue", 0.0, nullptr);
+
+#ifdef HYNI_HAVE_IO_URING
+    if (preferred != backend::thread) {
+        m_ring = uring::create(64);
+    }
+    if (m_ring && buffer_count > 0) {
+        std::vector<iovec> iovecs(buffer_count);
+        for (size_t i = 0; i < buffer_count; ++i) {
+            iovecs[i] = {m_arena.get() + i * m_buffer_size, m_buffer_size};
+        }
+        // Fails under a small RLIMIT_MEMLOCK; plain writes still work then
+        m_registered = sys_io_uring_register(m_ring->fd, IORING_REGISTER_BUFFERS, iovecs.data(),
+                                             static_cast<unsigned>(buffer_count)) == 0;
+    }
+#else
+    (void)preferred;
+#endif
+
+    m_thread = std::thread(&async_io_service::io_loop, this);
+}
+
+async_io_service::~async_io_service() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+async_io_service& async_io_service::instance() {
+    static async_io_service service;
+    return service;
+}
+
+bool async_io_service::io_uring_supported() noexcept {
+#ifdef HYNI_HAVE_IO_URING
+    static const bool supported = [] {
+        try {
+            return uring::create(4) != nullptr;
+        } catch (...) {
+            return false;
+        }
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+async_io_service::stats async_io_service::get_stats() const {
+    stats s;
+    s.batches = m_stats.batches.load(std::memory_order_relaxed);
+    s.submit_calls = m_stats.submit_calls.load(std::memory_order_relaxed);
+    s.writes = m_stats.writes.load(std::memory_order_relaxed);
+    s.registered_writes = m_stats.registered_writes.load(std::memory_order_relaxed);
+    s.fsyncs = m_stats.fsyncs.load(std::memory_order_relaxed);
+    s.bytes = m_stats.bytes.load(std::memory_order_relaxed);
+    s.errors = m_stats.errors.load(std::memory_order_relaxed);
+    return s;
+}
+
+async_io_service::io_buffer async_io_service::acquire_buffer() {
+    io_buffer buffer;
+    buffer.capacity = m_buffer_size;
+    {
+        std::lock_guard lock(m_pool_mutex);
+        if (!m_free_slots.empty()) {
+            buffer.fixed_index = m_free_slots.back();
+            m_free_slots.pop_back();
+            buffer.data = m_arena.get() + static_cast<size_t>(buffer.fixed_index) * m_buffer_size;
+            return buffer;
+        }
+    }
+    buffer.heap = std::make_unique<char[]>(m_buffer_size);
+    buffer.data = buffer.heap.get();
+    return buffer;
+}
+
+void async_io_service::release_buffer(io_buffer& buffer) {
+    if (buffer.fixed_index >= 0) {
+        std::lock_guard lock(m_pool_mutex);
+        m_free_slots.push_back(buffer.fixed_index);
+    }
+    buffer = io_buffer{};
+}
+
+void async_io_service::append(const std::shared_ptr<file_state>& file, std::string_view data) {
+    bool queued = false;
+    {
+        std::lock_guard lock(file->mutex);
+        while (!data.empty()) {
+            if (!file->current.data) {
+                file->current = acquire_buffer();
+            }
+            size_t n = std::min(data.size(), file->current.capacity - file->current.size);
+            std::memcpy(file->current.data + file->current.size, data.data(), n);
+            file->current.size += n;
+            data.remove_prefix(n);
+
+            if (file->current.size == file->current.capacity) {
+                enqueue_write_locked(file);
+                queued = true;
+            }
+        }
+    }
+    if (queued) {
+        wait_for_queue_space();
+    }
+}
+
+void async_io_service::submit(const std::shared_ptr<file_state>& file) {
+    {
+        std::lock_guard lock(file->mutex);
+        if (file->current.size == 0) {
+            return;
+        }
+        enqueue_write_locked(file);
+    }
+    wait_for_queue_space();
+}
+
+void async_io_service::wait(const std::shared_ptr<file_state>& file, bool datasync) {
+    std::unique_lock lock(file->mutex);
+    if (file->current.size > 0) {
+        enqueue_write_locked(file);
+    }
+    if (datasync && (file->dirty || file->queued != file->completed)) {
+        enqueue_fsync_locked(file);
+    }
+    const uint64_t target = file->queued;
+    file->cv.wait(lock, [&] { return file->completed >= target; });
+}
+
+void async_io_service::enqueue_write_locked(const std::shared_ptr<file_state>& file) {
+    io_op op;
+    op.kind = io_op::WRITE;
+    op.file = file;
+    op.offset = file->offset;
+    file->offset += file->current.size;
+    op.buffer = std::move(file->current);
+    file->current = io_buffer{};
+    ++file->queued;
+    enqueue(std::move(op));
+}
+
+void async_io_service::enqueue_fsync_locked(const std::shared_ptr<file_state>& file) {
+    io_op op;
+    op.kind = io_op::FSYNC;
+    op.file = file;
+    file->sync_queued = true;
+    ++file->queued;
+    enqueue(std::move(op));
+}
+
+// Never blocks: callers hold the file's lock, which the I/O thread needs to
+// complete ops, and the I/O thread itself queues policy fsyncs from here
+void async_io_service::enqueue(io_op op) {
+    const size_t bytes = op.buffer.size;
+    {
+        std::lock_guard lock(m_mutex);
+        m_queued_bytes += bytes;
+        m_memory.account(static_cast<std::ptrdiff_t>(bytes));
+        m_queue.push_back(std::move(op));
+    }
+    m_cv.notify_one();
+}
+
+// Back-pressure only when the disk has fallen far behind. Writers call this
+// after releasing the file's lock, so the queue can overshoot the limit by
+// the data of one write per thread.
+void async_io_service::wait_for_queue_space() {
+    std::unique_lock lock(m_mutex);
+    m_space_cv.wait(lock, [this] { return m_queued_bytes < m_max_queued_bytes || m_stop; });
+}
+
+void async_io_service::io_loop() {
+    std::vector<io_op> batch;
+    while (true) {
+        {
+            std::unique_lock lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return;  // stop requested and everything written
+            }
+            batch.swap(m_queue);
+        }
+
+        m_stats.batches.fetch_add(1, std::memory_order_relaxed);
+        if (m_ring) {
+            execute_uring(batch);
+        } else {
+            execute_blocking(batch);
+        }
+        complete(batch);
+        batch.clear();
+    }
+}
+
+void async_io_service::execute_blocking(std::vector<io_op>& batch) {
+    for (auto& op : batch) {
+        if (op.kind == io_op::FSYNC) {
+            if (::fdatasync(op.file->fd) != 0) {
+                op.error = errno;
+            }
+            continue;
+        }
+        while (op.done < op.buffer.size) {
+            ssize_t n = ::pwrite(op.file->fd, op.buffer.data + op.done, op.buffer.size - op.done,
+                                 static_cast<off_t>(op.offset + op.done));
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                op.error = errno;
+                break;
+            }
+            op.done += static_cast<size_t>(n);
+        }
+    }
+}
+
+void async_io_service::execute_uring(std::vector<io_op>& batch) {
+#ifdef HYNI_HAVE_IO_URING
+    std::vector<size_t> pending(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        pending[i] = i;
+    }
+
+    while (!pending.empty()) {
+        const size_t count = std::min<size_t>(pending.size(), m_ring->entries);
+        for (size_t i = 0; i < count; ++i) {
+            io_op& op = batch[pending[i]];
+            io_uring_sqe* sqe = m_ring->next_sqe();
+            sqe->fd = op.file->fd;
+            sqe->user_data = pending[i];
+
+            if (op.kind == io_op::FSYNC) {
+                // Drain: starts only after every write submitted before it has completed
+                sqe->opcode = IORING_OP_FSYNC;
+                sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+                sqe->flags = IOSQE_IO_DRAIN;
+                continue;
+            }
+
+            sqe->addr = reinterpret_cast<uint64_t>(op.buffer.data + op.done);
+            sqe->len = static_cast<uint32_t>(op.buffer.size - op.done);
+            sqe->off = op.offset + op.done;
+            if (m_registered && op.buffer.fixed_index >= 0) {
+                sqe->opcode = IORING_OP_WRITE_FIXED;
+                sqe->buf_index = static_cast<uint16_t>(op.buffer.fixed_index);
+                m_stats.registered_writes.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                sqe->opcode = IORING_OP_WRITE;
+            }
+        }
+
+        m_stats.submit_calls.fetch_add(1, std::memory_order_relaxed);
+        int submitted = m_ring->submit_and_wait(static_cast<unsigned>(count));
+        if (submitted < 0) {
+            // The ring itself failed; finish this batch with blocking calls
+            std::vector<io_op> rest;
+            for (size_t index : pending) {
+                rest.push_back(std::move(batch[index]));
+            }
+            execute_blocking(rest);
+            for (size_t i = 0; i < pending.size(); ++i) {
+                batch[pending[i]] = std::move(rest[i]);
+            }
+            return;
+        }
+
+        std::vector<size_t> retry;
+        unsigned reaped = 0;
+        while (reaped < count) {
+            reaped += m_ring->reap([&](uint64_t index, int res) {
+                io_op& op = batch[index];
+                if (res == -EINTR || res == -EAGAIN) {
+                    retry.push_back(index);
+                } else if (res < 0) {
+                    op.error = -res;
+                } else if (op.kind == io_op::WRITE) {
+                    op.done += static_cast<size_t>(res);
+                    if (res == 0) {
+                        op.error = EIO;
+                    } else if (op.done < op.buffer.size) {
+                        retry.push_back(index);  // short write
+                    }
+                }
+            });
+            if (reaped < count && m_ring->wait(count - reaped) < 0) {
+                break;
+            }
+        }
+        pending.erase(pending.begin(), pending.begin() + static_cast<long>(count));
+        pending.insert(pending.end(), retry.begin(), retry.end());
+    }
+#else
+    execute_blocking(batch);
+#endif
+}
+
+void async_io_service::complete(std::vector<io_op>& batch) {
+    size_t bytes = 0;
+    std::vector<std::shared_ptr<file_state>> follow_up;
+
+    for (auto& op : batch) {
+        if (op.error) {
+            m_stats.errors.fetch_add(1, std::memory_order_relaxed);
+        } else if (op.kind == io_op::FSYNC) {
+            m_stats.fsyncs.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            m_stats.writes.fetch_add(1, std::memory_order_relaxed);
+            m_stats.bytes.fetch_add(op.done, std::memory_order_relaxed);
+        }
+        bytes += op.buffer.size;
+        release_buffer(op.buffer);
+
+        auto& file = *op.file;
+        {
+            std::lock_guard lock(file.mutex);
+            if (op.error && !file.error) {
+                file.error = op.error;
+            }
+            if (op.kind == io_op::FSYNC) {
+                file.sync_queued = false;
+                file.last_sync = std::chrono::steady_clock::now();
+                file.dirty = file.dirty && op.error != 0;
+            } else {
+                file.dirty = true;
+            }
+            ++file.completed;
+            if (std::find(follow_up.begin(), follow_up.end(), op.file) == follow_up.end()) {
+                follow_up.push_back(op.file);
+            }
+        }
+        file.cv.notify_all();
+    }
+
+    {
+        std::lock_guard lock(m_mutex);
+        const size_t done = std::min(m_queued_bytes, bytes);
+        m_queued_bytes -= done;
+        m_memory.account(-static_cast<std::ptrdiff_t>(done));
+    }
+    m_space_cv.notify_all();
+
+    // Schedule policy-driven syncs for the files this batch wrote to
+    const auto now = std::chrono::steady_clock::now();
+    for (const auto& file : follow_up) {
+        std::lock_guard lock(file->mutex);
+        if (!file->dirty || file->sync_queued || file->fd < 0) {
+            continue;
+        }
+        const auto& options = file->options;
+        if (options.sync == fsync_policy::always ||
+            (options.sync == fsync_policy::interval && now - file->last_sync >= options.sync_interval)) {
+            enqueue_fsync_locked(file);
+        }
+    }
+}
+
+// ===== async_file_writer =====
+
+async_file_writer::async_file_writer(const std::filesystem::path& path,
+                                     async_file_options options,
+                                     async_io_service& service)
+    : m_service(service)
+    , m_path(path) {
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (options.truncate ? O_TRUNC : 0) |
+                (options.exclusive ? O_EXCL : 0);
+    int fd = ::open(path.c_str(), flags, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open " + path.string() + ": " + std::strerror(errno));
+    }
+
+    m_file = std::make_shared<async_io_service::file_state>();
+    m_file->fd = fd;
+    m_file->options = options;
+    // Writes carry explicit offsets, so appending starts at the current end
+    off_t end = ::lseek(fd, 0, SEEK_END);
+    m_file->offset = end > 0 ? static_cast<uint64_t>(end) : 0;
+}
+
+async_file_writer::~async_file_writer() {
+    close();
+}
+
+void async_file_writer::write(std::string_view data) {
+    if (!m_file || data.empty()) return;
+    m_service.append(m_file, data);
+    m_bytes.fetch_add(data.size(), std::memory_order_relaxed);
+}
+
+void async_file_writer::submit() {
+    if (m_file) m_service.submit(m_file);
+}
+
+void async_file_writer::flush() {
+    if (m_file) m_service.wait(m_file, false);
+}
+
+void async_file_writer::sync() {
+    if (m_file) m_service.wait(m_file, true);
+}
+
+bool async_file_writer::close() {
+    if (!m_file) return true;
+
+    m_service.wait(m_file, m_file->options.sync != fsync_policy::never);
+
+    int error;
+    {
+        // A policy sync may have been queued by the last completion
+        std::unique_lock lock(m_file->mutex);
+        m_file->cv.wait(lock, [this] { return m_file->completed >= m_file->queued; });
+        ::close(m_file->fd);
+        m_file->fd = -1;
+        error = m_file->error;
+    }
+    m_file.reset();
+    return error == 0;
+}
+
+int async_file_writer::last_error() const {
+    if (!m_file) return 0;
+    std::lock_guard lock(m_file->mutex);
+    return m_file->error;
+}
+
+} // hyni
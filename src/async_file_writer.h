@@ -0,0 +1,240 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "memory_governor.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @brief When an async_file_writer makes its data durable
+ */
+enum class fsync_policy {
+    never,      ///< Leave it to the kernel
+    on_close,   ///< fdatasync once when the file is closed
+    interval,   ///< At most once per sync_interval while writing, and on close
+    always      ///< After every batch of writes that touched the file
+};
+
+/**
+ * @brief Per-file options for async_file_writer
+ */
+struct async_file_options {
+    fsync_policy sync = fsync_policy::on_close;
+    std::chrono::milliseconds sync_interval{1000};  ///< Used by fsync_policy::interval
+    bool truncate = false;                          ///< Truncate instead of appending to an existing file
+    bool exclusive = false;                         ///< Fail if the file already exists
+};
+
+/**
+ * @class async_io_service
+ * @brief Shared I/O thread that performs all disk writes of async_file_writer instances
+ *
+ * Writers only copy into fixed-size buffers; full buffers are queued and one I/O
+ * thread writes everything queued since its last pass as a single batch. On Linux
+ * the batch goes through io_uring: one io_uring_enter() submits all writes and
+ * fsyncs, and the buffer pool is registered with the kernel so writes from it
+ * skip the per-call page pinning. Where io_uring is unavailable (old kernels,
+ * seccomp, containers with it disabled) the same thread falls back to pwrite()
+ * and fdatasync().
+ *
+ * Writes to one file are issued at explicit offsets, so completion order inside a
+ * batch does not matter; fsyncs are drained behind the writes queued before them.
+ *
+ * @note Thread-safe. Writers block only when more than max_queued_bytes() are
+ *       waiting for the disk, and never while holding a file's lock; the I/O
+ *       thread's own fsyncs are queued without waiting.
+ */
+class async_io_service {
+public:
+    enum class backend {
+        automatic,  ///< io_uring if the kernel allows it, otherwise thread
+        io_uring,   ///< io_uring, falling back to thread if setup fails
+        thread      ///< pwrite()/fdatasync() on the I/O thread
+    };
+
+    /**
+     * @param preferred Backend to use
+     * @param buffer_size Size of each write buffer
+     * @param buffer_count Buffers in the registered pool; writers use heap buffers when it runs dry
+     * @param max_queued_bytes Queued bytes above which writers wait for the disk
+     */
+    explicit async_io_service(backend preferred = backend::automatic,
+                              size_t buffer_size = 64 * 1024,
+                              size_t buffer_count = 32,
+                              size_t max_queued_bytes = default_max_queued_bytes);
+    ~async_io_service();
+
+    async_io_service(const async_io_service&) = delete;
+    async_io_service& operator=(const async_io_service&) = delete;
+
+    /**
+     * @brief Service shared by the logger and other library file output
+     */
+    static async_io_service& instance();
+
+    /**
+     * @brief True if this kernel lets the process create an io_uring
+     */
+    [[nodiscard]] static bool io_uring_supported() noexcept;
+
+    [[nodiscard]] bool uses_io_uring() const noexcept { return m_ring != nullptr; }
+    [[nodiscard]] bool uses_registered_buffers() const noexcept { return m_registered; }
+    [[nodiscard]] size_t buffer_size() const noexcept { return m_buffer_size; }
+    [[nodiscard]] size_t max_queued_bytes() const noexcept { return m_max_queued_bytes; }
+
+    struct stats {
+        uint64_t batches = 0;           ///< Passes of the I/O thread
+        uint64_t submit_calls = 0;      ///< io_uring_enter() calls, 0 for the thread backend
+        uint64_t writes = 0;            ///< Write operations completed
+        uint64_t registered_writes = 0; ///< Writes served from registered buffers
+        uint64_t fsyncs = 0;            ///< fdatasync operations completed
+        uint64_t bytes = 0;             ///< Bytes written
+        uint64_t errors = 0;            ///< Failed operations
+    };
+
+    [[nodiscard]] stats get_stats() const;
+
+    static constexpr size_t default_max_queued_bytes = 64 * 1024 * 1024;
+
+private:
+    friend class async_file_writer;
+
+    struct io_buffer;
+    struct io_op;
+    struct file_state;
+    struct uring;
+
+    const size_t m_buffer_size;
+    const size_t m_max_queued_bytes;
+    std::unique_ptr<char[]> m_arena;  // buffer_count * buffer_size, registered with the ring
+    std::vector<int> m_free_slots;
+    std::mutex m_pool_mutex;
+    bool m_registered = false;
+
+    std::unique_ptr<uring> m_ring;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::condition_variable m_space_cv;
+    std::vector<io_op> m_queue;
+    size_t m_queued_bytes = 0;
+    memory_governor::registration m_memory;   // m_queued_bytes, reported without reclaiming as writers hold file locks
+    bool m_stop = false;
+    std::thread m_thread;
+
+    struct atomic_stats {
+        std::atomic<uint64_t> batches{0}, submit_calls{0}, writes{0}, registered_writes{0},
+            fsyncs{0}, bytes{0}, errors{0};
+    } m_stats;
+
+    io_buffer acquire_buffer();
+    void release_buffer(io_buffer& buffer);
+
+    void append(const std::shared_ptr<file_state>& file, std::string_view data);
+    void submit(const std::shared_ptr<file_state>& file);
+    void wait(const std::shared_ptr<file_state>& file, bool datasync);
+    void enqueue_write_locked(const std::shared_ptr<file_state>& file);
+    void enqueue_fsync_locked(const std::shared_ptr<file_state>& file);
+    void enqueue(io_op op);
+    void wait_for_queue_space();
+
+    void io_loop();
+    void execute_uring(std::vector<io_op>& batch);
+    void execute_blocking(std::vector<io_op>& batch);
+    void complete(std::vector<io_op>& batch);
+};
+
+/**
+ * @class async_file_writer
+ * @brief File output that never performs disk I/O on the calling thread
+ *
+ * write() copies into a buffer owned by the file; full buffers are written by the
+ * async_io_service thread. Data still in the current buffer reaches the disk on
+ * submit(), flush(), sync() or close().
+ *
+ * @note A writer may be shared between threads.
+ */
+class async_file_writer {
+public:
+    /**
+     * @throws std::runtime_error if the file cannot be opened
+     */
+    explicit async_file_writer(const std::filesystem::path& path,
+                               async_file_options options = {},
+                               async_io_service& service = async_io_service::instance());
+
+    /**
+     * @brief Closes the file, waiting for queued writes
+     */
+    ~async_file_writer();
+
+    async_file_writer(const async_file_writer&) = delete;
+    async_file_writer& operator=(const async_file_writer&) = delete;
+
+    /**
+     * @brief Appends data; returns once it is copied into the write buffer
+     */
+    void write(std::string_view data);
+
+    /**
+     * @brief Queues the partially filled buffer without waiting for the disk
+     */
+    void submit();
+
+    /**
+     * @brief Queues buffered data and waits until the kernel has it
+     */
+    void flush();
+
+    /**
+     * @brief Queues buffered data and waits until it is on stable storage
+     */
+    void sync();
+
+    /**
+     * @brief Flushes, syncs according to the fsync policy and closes the file
+     * @return False if any write or sync of this file failed
+     */
+    bool close();
+
+    [[nodiscard]] bool is_open() const noexcept { return m_file != nullptr; }
+    [[nodiscard]] const std::filesystem::path& path() const noexcept { return m_path; }
+
+    /**
+     * @brief Bytes accepted by write() since the file was opened
+     */
+    [[nodiscard]] uint64_t bytes_written() const noexcept { return m_bytes.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief errno of the first failed write or sync, 0 if none
+     */
+    [[nodiscard]] int last_error() const;
+
+private:
+    async_io_service& m_service;
+    std::filesystem::path m_path;
+    std::shared_ptr<async_io_service::file_state> m_file;
+    std::atomic<uint64_t> m_bytes{0};
+};
+
+} // hyni
@@ -13,16 +13,74 @@
 #include "http_client.h"
 #include "http_client_factory.h"
 #include "logger.h"
+#include <cctype>
 
 namespace hyni {
 
+namespace {
+
+// Joins a resumed response onto the text the consumer already has. Leading
+// whitespace is dropped after text that ends in whitespace. A prompted
+// continuation may also restate the end of the text; it is held back until it
+// is as long as the compared tail, and the longest repeated stretch is cut.
+class continuation_stitcher {
+public:
+    continuation_stitcher(std::string_view emitted, bool may_repeat)
+        : m_tail(emitted.substr(emitted.size() - std::min(emitted.size(), MAX_OVERLAP)))
+        , m_may_repeat(may_repeat)
+        , m_skip_space(!emitted.empty() && std::isspace(static_cast<unsigned char>(emitted.back()))) {}
+
+    std::string feed(const std::string& delta) {
+        if (m_passing) {
+            return delta;
+        }
+        m_pending += delta;
+        if (m_skip_space) {
+            const size_t start = m_pending.find_first_not_of(" \t\r\n");
+            m_pending.erase(0, start == std::string::npos ? m_pending.size() : start);
+            m_skip_space = m_pending.empty();
+        }
+        if (m_pending.empty() || (m_may_repeat && m_pending.size() < m_tail.size())) {
+            return {};
+        }
+        return release();
+    }
+
+    std::string finish() { return m_passing ? std::string() : release(); }
+
+private:
+    static constexpr size_t MAX_OVERLAP = 160;
+    static constexpr size_t MIN_OVERLAP = 8;   // shorter matches are likely coincidence
+
+    std::string release() {
+        m_passing = true;
+        if (m_may_repeat) {
+            for (size_t length = std::min(m_tail.size(), m_pending.size()); length >= MIN_OVERLAP; --length) {
+                if (std::string_view(m_tail).ends_with(std::string_view(m_pending).substr(0, length))) {
+                    m_pending.erase(0, length);
+                    break;
+                }
+            }
+        }
+        return std::move(m_pending);
+    }
+
+    std::string m_tail;
+    bool m_may_repeat;
+    bool m_skip_space;
+    bool m_passing = false;
+    std::string m_pending;
+};
+
+} // anonymous namespace
+
 chat_api::chat_api(std::unique_ptr<general_context> context)
     : m_context(std::move(context)) {
     ensure_http_client();
 }
 
 std::string chat_api::send_message(const std::string& message, progress_callback cancel_check) {
-    LOG_INFO("chat_api::send_message()");
+    LOG_INFO_SAMPLED("chat_api::send_message()");
 
     ensure_http_client();
 
@@ -31,10 +89,10 @@ std::string chat_api::send_message(const std::string& message, progress_callback
 
     auto request = m_context->build_request();
     m_http_client->set_headers(m_context->get_headers());
-    auto response = m_http_client->post(m_context->get_endpoint(), request, cancel_check);
+    auto response = m_http_client->post(m_context->get_endpoint(), request, cancel_check, m_context->get_attachments());
 
     if (!response.success) {
-        LOG_ERROR("API request failed: " + response.error_message);
+        LOG_ERROR_SAMPLED("API request failed: " + response.error_message);
         throw std::runtime_error("API request failed: " + response.error_message);
     }
 
@@ -42,7 +100,7 @@ std::string chat_api::send_message(const std::string& message, progress_callback
         auto json_response = nlohmann::json::parse(response.body);
         return m_context->extract_text_response(json_response);
     } catch (const std::exception& e) {
-        LOG_ERROR("Extract response failed: " + *e.what());
+        LOG_ERROR_SAMPLED("Extract response failed: " + std::string(e.what()));
         throw failed_api_response(std::string(e.what()));
     }
 }
@@ -65,18 +123,25 @@ void chat_api::send_message_stream(const std::string& message,
     request["stream"] = true;
 
     m_http_client->set_headers(m_context->get_headers());
-    m_http_client->post_stream(
-        m_context->get_endpoint(),
-        request,
-        [on_chunk, this](const std::string& chunk) {
-            parse_stream_chunk(chunk, on_chunk);
-        },
-        on_complete,
-        cancel_check
-    );
+    stream_request(std::move(request), std::move(on_chunk), std::move(on_complete), std::move(cancel_check));
 }
 
-void chat_api::parse_stream_chunk(const std::string& chunk, const stream_callback& on_chunk) {
+stream_callback chat_api::stream_parser(stream_callback on_chunk, general_context& context) {
+    if (!context.validates_utf8()) {
+        return [on_chunk, &context, this](const std::string& chunk) {
+            parse_stream_chunk(chunk, on_chunk, context);
+        };
+    }
+    // Providers occasionally send broken sequences, and network chunks can split
+    // a character; either would make the delta's JSON fail to parse
+    auto repairer = std::make_shared<utf8_stream_repairer>();
+    return [on_chunk, repairer, &context, this](const std::string& chunk) {
+        parse_stream_chunk(repairer->feed(chunk), on_chunk, context);
+    };
+}
+
+void chat_api::parse_stream_chunk(const std::string& chunk, const stream_callback& on_chunk,
+                                  general_context& context) {
     try {
         std::istringstream stream(chunk);
         std::string line;
@@ -99,7 +164,7 @@ void chat_api::parse_stream_chunk(const std::string& chunk, const stream_callbac
 
                 try {
                     auto json_chunk = nlohmann::json::parse(json_str);
-                    std::string content = m_context->extract_text_response(json_chunk);
+                    std::string content = context.extract_text_response(json_chunk);
                     if (!content.empty()) {
                         on_chunk(content);
                     }
@@ -139,10 +204,12 @@ std::string chat_api::send_message(progress_callback cancel_check) {
 
     auto request = m_context->build_request();
     m_http_client->set_headers(m_context->get_headers());
-    auto response = m_http_client->post(m_context->get_endpoint(), request, cancel_check);
+    auto response = m_http_client->post(m_context->get_endpoint(), request, cancel_check, m_context->get_attachments());
 
     if (!response.success) {
-        throw failed_api_response(response.error_message);
+        throw failed_api_request(response.status_code, response.error_message.empty()
+            ? "HTTP " + std::to_string(response.status_code) + ": " + logger::truncate_text(response.body, 200)
+            : response.error_message);
     }
 
     try {
@@ -178,16 +245,85 @@ void chat_api::send_message_stream(stream_callback on_chunk,
     // Build request with streaming enabled
     auto request = m_context->build_request(true);
     m_http_client->set_headers(m_context->get_headers());
+    stream_request(std::move(request), std::move(on_chunk), std::move(on_complete), std::move(cancel_check));
+}
+
+chat_api& chat_api::set_stream_resume(stream_resume_options options) {
+    m_stream_resume = std::move(options);
+    return *this;
+}
+
+// State of one resumable response across its attempts, which run one after another.
+// Continuations are sent from the stream's thread, so everything they need is
+// taken when the stream starts rather than read from the caller's context.
+struct chat_api::stream_session {
+    stream_callback on_chunk;
+    completion_callback on_complete;
+    progress_callback cancel_check;
+    nlohmann::json request;                         // the original request
+    std::string endpoint;
+    text_attachment_map attachments;
+    stream_resume_options resume;
+    std::unique_ptr<general_context> turns;         // parses and continues the response; shares the schema
+    std::string text;                               // everything passed to on_chunk
+    size_t resumes = 0;
+    std::unique_ptr<continuation_stitcher> stitcher;  // set while resuming
+
+    void emit(const std::string& delta) {
+        if (!delta.empty()) {
+            text += delta;
+            on_chunk(delta);
+        }
+    }
+};
+
+void chat_api::stream_request(nlohmann::json request, stream_callback on_chunk, completion_callback on_complete,
+                              progress_callback cancel_check) {
+    if (m_stream_resume.max_resumes == 0) {
+        m_http_client->post_stream(m_context->get_endpoint(), request, stream_parser(std::move(on_chunk), *m_context),
+                                   std::move(on_complete), std::move(cancel_check), m_context->get_attachments());
+        return;
+    }
+    auto session = std::make_shared<stream_session>();
+    session->on_chunk = std::move(on_chunk);
+    session->on_complete = std::move(on_complete);
+    session->cancel_check = std::move(cancel_check);
+    session->request = std::move(request);
+    session->endpoint = m_context->get_endpoint();
+    session->attachments = m_context->get_attachments();
+    session->resume = m_stream_resume;
+    session->turns = std::make_unique<general_context>(m_context->get_shared_schema(), m_context->get_config());
+    post_resumable(session, session->request);
+}
 
-    m_http_client->post_stream(
-        m_context->get_endpoint(),
-        request,
-        [on_chunk, this](const std::string& chunk) {
-            parse_stream_chunk(chunk, on_chunk);
-        },
-        on_complete,
-        cancel_check
-        );
+void chat_api::post_resumable(std::shared_ptr<stream_session> session, const nlohmann::json& request) {
+    auto on_delta = [session](const std::string& delta) {
+        session->emit(session->stitcher ? session->stitcher->feed(delta) : delta);
+    };
+    // Runs on the stream's thread once the transfer is over and the handle is free again
+    auto on_done = [this, session](const http_response& response) {
+        if (session->stitcher) {
+            session->emit(session->stitcher->finish());
+        }
+        // Transport failures leave no status; HTTP errors are not worth repeating
+        const bool broke_off = !response.success && response.status_code == 0;
+        const bool cancelled = session->cancel_check && session->cancel_check();
+        if (broke_off && !cancelled && !session->text.empty() && session->resumes < session->resume.max_resumes) {
+            ++session->resumes;
+            LOG_WARNING_SAMPLED("Stream broke off after " + std::to_string(session->text.size()) +
+                                " bytes (" + response.error_message + "), resuming");
+            const bool prefill = session->turns->supports_assistant_prefill();
+            session->stitcher = std::make_unique<continuation_stitcher>(session->text, !prefill);
+            post_resumable(session, session->turns->build_continuation_request(session->request, session->text,
+                                                                               session->resume.continuation_prompt));
+            return;
+        }
+        if (session->on_complete) {
+            session->on_complete(response);
+        }
+    };
+    m_http_client->post_stream(session->endpoint, request, stream_parser(on_delta, *session->turns), on_done,
+                               session->cancel_check, session->attachments);
 }
 
 std::future<std::string> chat_api::send_message_async() {
@@ -203,7 +339,7 @@ void chat_api::ensure_http_client() {
 }
 
 http_response chat_api::send_request(const nlohmann::json& request, progress_callback cancel_check) {
-    return m_http_client->post(m_context->get_endpoint(), request, cancel_check);
+    return m_http_client->post(m_context->get_endpoint(), request, cancel_check, m_context->get_attachments());
 }
 
 } // namespace hyni
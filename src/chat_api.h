@@ -41,6 +41,35 @@ public:
         : chat_api_error("Failed to parse API response: " + message) {}
 };
 
+// The request itself failed: status_code is the HTTP status, or 0 if no response arrived
+class failed_api_request : public failed_api_response {
+public:
+    failed_api_request(long status_code, const std::string& message)
+        : failed_api_response(message), m_status_code(status_code) {}
+
+    long status_code() const noexcept { return m_status_code; }
+
+    // Worth another attempt: no response, a timeout, rate limiting or a server error
+    bool is_transient() const noexcept {
+        return m_status_code == 0 || m_status_code == 408 || m_status_code == 425 ||
+               m_status_code == 429 || m_status_code >= 500;
+    }
+
+private:
+    long m_status_code;
+};
+
+/**
+ * @brief How send_message_stream() recovers from a response that breaks off mid-stream
+ */
+struct stream_resume_options {
+    size_t max_resumes = 0;   ///< Continuation requests per response; 0 disables resuming
+    /// User turn asking for the rest, for providers without assistant prefill
+    std::string continuation_prompt =
+        "Your previous reply was cut off. Continue it from exactly where it stopped, "
+        "without repeating anything or adding any preamble.";
+};
+
 /**
  * @brief Main class for interacting with LLM chat APIs
  *
@@ -124,6 +153,18 @@ public:
      */
     [[nodiscard]] std::future<std::string> send_message_async();
 
+    /**
+     * @brief Enables resuming streams that fail after part of the response arrived
+     *
+     * When the connection drops or stalls mid-response, the text received so far
+     * is sent back with general_context::build_continuation_request() and the
+     * new deltas are passed to the same on_chunk, so the consumer sees one
+     * response. Overlap a continuation repeats from the partial text is
+     * dropped. on_complete is called once, with the last attempt's response.
+     */
+    chat_api& set_stream_resume(stream_resume_options options);
+    [[nodiscard]] const stream_resume_options& get_stream_resume() const noexcept { return m_stream_resume; }
+
     /**
      * @brief Gets the underlying context for advanced usage
      * @return Reference to the general context
@@ -146,10 +187,37 @@ private:
      *
      * @param chunk Raw chunk received from the HTTP stream
      * @param on_chunk Callback to invoke with extracted content
+     * @param context Context whose schema describes the response
      *
      * @note Exceptions are caught and suppressed to prevent callback interruption
      */
-    void parse_stream_chunk(const std::string& chunk, const stream_callback& on_chunk);
+    void parse_stream_chunk(const std::string& chunk, const stream_callback& on_chunk, general_context& context);
+
+    /**
+     * @brief Creates the raw chunk callback for one streamed response
+     *
+     * When the context validates UTF-8, chunks are repaired with a
+     * utf8_stream_repairer before parsing, so a character split across chunks
+     * is joined and invalid bytes become U+FFFD instead of dropping the delta.
+     *
+     * @param on_chunk Callback to invoke with extracted content
+     * @param context Context parsing the response; must outlive the stream
+     * @return Callback for http_client::post_stream
+     */
+    [[nodiscard]] stream_callback stream_parser(stream_callback on_chunk, general_context& context);
+
+    /**
+     * @brief Streams request, resuming it per m_stream_resume if it breaks off
+     */
+    void stream_request(nlohmann::json request, stream_callback on_chunk, completion_callback on_complete,
+                        progress_callback cancel_check);
+
+    struct stream_session;
+
+    /**
+     * @brief Sends one attempt of a resumable stream; its completion sends the next if needed
+     */
+    void post_resumable(std::shared_ptr<stream_session> session, const nlohmann::json& request);
 
     /**
      * @brief Ensures that the HTTP client is initialized
@@ -176,6 +244,7 @@ private:
 private:
     std::unique_ptr<general_context> m_context;
     std::unique_ptr<http_client> m_http_client;  
+    stream_resume_options m_stream_resume;
 };
 
 struct needs_schema {};
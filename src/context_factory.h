@@ -12,12 +12,57 @@
 #pragma once
 
 #include "schema_registry.h"
+#include "lock_stats.h"
+#include "memory_governor.h"
 #include <mutex>
 #include <atomic>
 #include <fstream>
+#include <list>
+#include <algorithm>
+#include <utility>
 
 namespace hyni {
 
+/**
+ * @brief Per-thread limits for context_factory::get_thread_local_context()
+ */
+struct thread_cache_options {
+    size_t capacity = 8;          ///< Contexts one thread keeps for a factory; least recently used are evicted
+    bool reset_on_reuse = true;   ///< Reset conversation state when a cached context is handed out again
+};
+
+namespace detail {
+
+/**
+ * @brief One cached context in a thread's context cache
+ *
+ * Entries are owned by the thread that created them and destroyed with it.
+ * `factory_alive` expires when the owning factory is destroyed, so entries of
+ * dead factories are dropped on the thread's next lookup instead of leaking.
+ */
+struct thread_context_entry {
+    uint64_t factory_id = 0;
+    std::weak_ptr<const void> factory_alive;
+    std::string provider_name;
+    size_t config_hash = 0;
+    context_config config;
+    std::shared_ptr<general_context> context;   // callers may hold it past eviction
+    memory_governor::charge memory;   ///< Estimated size, held until the entry is destroyed
+};
+
+// Most recently used first
+inline std::list<thread_context_entry>& thread_context_cache() {
+    thread_local std::list<thread_context_entry> cache;
+    return cache;
+}
+
+inline uint64_t next_factory_id() {
+    static std::atomic<uint64_t> id{0};
+    return id.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+} // detail
+
 /**
  * @class context_factory
  * @brief Factory for creating general_context instances with schema caching
@@ -25,11 +70,23 @@ namespace hyni {
  */
 class context_factory {
 public:
-    explicit context_factory(std::shared_ptr<schema_registry> registry)
-        : m_registry(std::move(registry)) {
+    explicit context_factory(std::shared_ptr<schema_registry> registry,
+                             thread_cache_options thread_cache = {})
+        : m_registry(std::move(registry))
+        , m_thread_cache(thread_cache) {
         if (!m_registry) {
             throw std::invalid_argument("Registry cannot be null");
         }
+        // Parsed schemas are cheap to read again; contexts keep the ones they use alive,
+        // so each schema reports its bytes when the last holder releases it
+        m_memory = memory_governor::instance().register_component(
+            "context_factory.schemas", SCHEMA_RECLAIM_COST, [this](size_t) {
+                clear_cache();
+                return size_t{0};
+            });
+        // Other threads' caches cannot be trimmed from the reclaiming thread
+        m_thread_memory = memory_governor::instance().register_component(
+            "context_factory.thread_contexts", THREAD_CONTEXT_RECLAIM_COST, nullptr);
     }
 
     /**
@@ -48,27 +105,44 @@ public:
         // Use cached schema if available
         auto cached_schema = get_cached_schema(schema_path);
         if (cached_schema) {
-            return std::make_unique<general_context>(*cached_schema, config);
+            return std::make_unique<general_context>(std::move(cached_schema), config);
         }
 
         // Load and cache new schema
         auto schema = load_and_cache_schema(schema_path);
-        return std::make_unique<general_context>(*schema, config);
+        return std::make_unique<general_context>(std::move(schema), config);
     }
 
     /**
      * @brief Gets or creates a thread-local context
-     * @note The context is created on first access per thread
+     * @note The context is created on first access per thread, provider and config.
+     *       Each thread keeps at most thread_cache_options::capacity contexts for this
+     *       factory; a cached context is reset before it is handed out again unless
+     *       thread_cache_options::reset_on_reuse is false. An evicted context lives
+     *       on while the caller holds it, but is no longer handed out.
      */
-    general_context& get_thread_local_context(const std::string& provider_name,
-                                              const context_config& config = {}) const {
-        thread_local std::unordered_map<std::string, std::unique_ptr<general_context>> tl_contexts;
+    std::shared_ptr<general_context> get_thread_local_context(const std::string& provider_name,
+                                                              const context_config& config = {}) const {
+        return thread_local_context(provider_name, config, m_thread_cache.reset_on_reuse);
+    }
 
-        auto& context = tl_contexts[provider_name];
-        if (!context) {
-            context = create_context(provider_name, config);
-        }
-        return *context;
+    /**
+     * @brief Number of contexts the calling thread holds for this factory
+     */
+    size_t thread_local_context_count() const {
+        const auto& cache = detail::thread_context_cache();
+        return std::count_if(cache.begin(), cache.end(), [this](const auto& entry) {
+            return entry.factory_id == m_id;
+        });
+    }
+
+    /**
+     * @brief Destroys the calling thread's contexts for this factory
+     */
+    void release_thread_local_contexts() const {
+        detail::thread_context_cache().remove_if([this](const auto& entry) {
+            return entry.factory_id == m_id || entry.factory_alive.expired();
+        });
     }
 
     /**
@@ -76,8 +150,12 @@ public:
      * @note Useful for development/testing when schemas change
      */
     void clear_cache() const {
-        std::unique_lock lock(m_cache_mutex);
-        m_schema_cache.clear();
+        decltype(m_schema_cache) dropped;
+        {
+            std::unique_lock lock(m_cache_mutex);
+            dropped.swap(m_schema_cache);
+        }
+        // Released outside the lock; schemas still used by contexts stay accounted
     }
 
     /**
@@ -87,6 +165,11 @@ public:
         size_t cache_size;
         size_t hit_count;
         size_t miss_count;
+        uint64_t lock_contentions = 0;  ///< Cache lock acquisitions that had to wait
+        uint64_t lock_wait_ns = 0;      ///< Total time spent waiting for the cache lock
+        size_t thread_context_hits = 0;       ///< get_thread_local_context() served from a thread cache
+        size_t thread_context_misses = 0;     ///< get_thread_local_context() that created a context
+        size_t thread_context_evictions = 0;  ///< Thread-local contexts evicted by the capacity limit
         double hit_rate() const {
             auto total = hit_count + miss_count;
             return total > 0 ? static_cast<double>(hit_count) / total : 0.0;
@@ -95,24 +178,103 @@ public:
 
     cache_stats get_cache_stats() const {
         std::shared_lock lock(m_cache_mutex);
+        auto contention = m_lock_stats.load();
         return {
             m_schema_cache.size(),
             m_cache_hits.load(),
             m_cache_misses.load(),
+            contention.contended,
+            contention.wait_ns,
+            m_thread_context_hits.load(),
+            m_thread_context_misses.load(),
+            m_thread_context_evictions.load(),
         };
     }
 
 private:
+    friend class provider_context;
+
     std::shared_ptr<schema_registry> m_registry;
+    thread_cache_options m_thread_cache;
+
+    // Identity of this factory in thread caches; the token expires with the factory
+    const uint64_t m_id = detail::next_factory_id();
+    const std::shared_ptr<const void> m_alive = std::make_shared<int>(0);
+    mutable std::atomic<size_t> m_thread_context_hits{0};
+    mutable std::atomic<size_t> m_thread_context_misses{0};
+    mutable std::atomic<size_t> m_thread_context_evictions{0};
 
-    // Schema cache - shared across all threads
-    mutable std::unordered_map<std::string, std::shared_ptr<nlohmann::json>> m_schema_cache;
+    // Schema cache - shared across all threads; contexts hold the same immutable instances
+    mutable std::unordered_map<std::string, std::shared_ptr<const nlohmann::json>> m_schema_cache;
     mutable std::shared_mutex m_cache_mutex;
     mutable std::atomic<size_t> m_cache_hits{0};
     mutable std::atomic<size_t> m_cache_misses{0};
+    mutable lock_contention_stats m_lock_stats;
 
-    std::shared_ptr<nlohmann::json> get_cached_schema(const std::filesystem::path& path) const {
-        std::shared_lock lock(m_cache_mutex);
+    // Last, so the governor stops shedding the cache before it is destroyed
+    mutable memory_governor::registration m_thread_memory;
+    mutable memory_governor::registration m_memory;
+
+    std::shared_ptr<general_context> thread_local_context(const std::string& provider_name,
+                                                          const context_config& config,
+                                                          bool reset_on_reuse) const {
+        auto& cache = detail::thread_context_cache();
+        const size_t config_hash = context_config_hash{}(config);
+
+        size_t own_entries = 0;
+        for (auto it = cache.begin(); it != cache.end(); ) {
+            if (it->factory_alive.expired()) {
+                it = cache.erase(it);
+                continue;
+            }
+            if (it->factory_id == m_id) {
+                if (it->config_hash == config_hash && it->provider_name == provider_name &&
+                    it->config == config) {
+                    cache.splice(cache.begin(), cache, it);
+                    m_thread_context_hits.fetch_add(1, std::memory_order_relaxed);
+                    if (reset_on_reuse) {
+                        it->context->reset();
+                    }
+                    it->memory.resize(estimate_entry_bytes(*it));
+                    return it->context;
+                }
+                ++own_entries;
+            }
+            ++it;
+        }
+
+        m_thread_context_misses.fetch_add(1, std::memory_order_relaxed);
+        std::shared_ptr<general_context> context = create_context(provider_name, config);
+
+        // Evict this factory's least recently used contexts to stay within capacity
+        const size_t capacity = std::max<size_t>(m_thread_cache.capacity, 1);
+        for (auto it = cache.end(); own_entries >= capacity && it != cache.begin(); ) {
+            --it;
+            if (it->factory_id == m_id) {
+                it = cache.erase(it);
+                --own_entries;
+                m_thread_context_evictions.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        cache.push_front({m_id, m_alive, provider_name, config_hash, config, std::move(context), {}});
+        auto& entry = cache.front();
+        entry.memory = m_thread_memory.hold(estimate_entry_bytes(entry));
+        return entry.context;
+    }
+
+    // The schema is shared with the factory's cache and accounted there
+    static size_t estimate_entry_bytes(const detail::thread_context_entry& entry) {
+        size_t bytes = sizeof(detail::thread_context_entry) + sizeof(general_context) + entry.provider_name.capacity();
+        for (const auto& message : entry.context->get_messages()) {
+            bytes += memory_governor::estimate_json_bytes(message);
+        }
+        return bytes;
+    }
+
+    std::shared_ptr<const nlohmann::json> get_cached_schema(const std::filesystem::path& path) const {
+        std::shared_lock lock(m_cache_mutex, std::defer_lock);
+        lock_with_stats(lock, m_lock_stats);
         auto it = m_schema_cache.find(path.string());
         if (it != m_schema_cache.end()) {
             m_cache_hits.fetch_add(1, std::memory_order_relaxed);
@@ -122,25 +284,44 @@ private:
         return nullptr;
     }
 
-    std::shared_ptr<nlohmann::json> load_and_cache_schema(const std::filesystem::path& path) const {
-        auto schema = std::make_shared<nlohmann::json>();
-        std::ifstream file(path);
-        if (!file.is_open()) {
-            throw schema_exception("Failed to open schema file: " + path.string());
-        }
+    std::shared_ptr<const nlohmann::json> load_and_cache_schema(const std::filesystem::path& path) const {
+        // Bases go through the cache too, so a base is parsed once however many schemas extend it
+        auto schema = general_context::load_schema_file(
+            path, m_registry.get(),
+            [this](const std::filesystem::path& base_path, const std::function<nlohmann::json()>& load) {
+                if (auto cached = get_cached_schema(base_path)) {
+                    return cached;
+                }
+                return cache_schema(base_path, load());
+            });
+        return cache_schema(path, std::move(schema));
+    }
 
-        try {
-            file >> *schema;
-        } catch (const nlohmann::json::parse_error& e) {
-            throw schema_exception("Failed to parse schema JSON at " + path.string() +
-                                   ": " + e.what());
-        }
+    std::shared_ptr<const nlohmann::json> cache_schema(const std::filesystem::path& path,
+                                                       nlohmann::json schema) const {
+        // The charge is released with the schema itself, whoever holds it last
+        struct accounted_schema {
+            memory_governor::charge memory;
+            nlohmann::json value;
+        };
+        auto holder = std::make_shared<accounted_schema>();
+        holder->value = std::move(schema);
+        // Outside the cache lock, which shedding the cache takes
+        holder->memory = m_memory.hold(memory_governor::estimate_json_bytes(holder->value));
+        std::shared_ptr<const nlohmann::json> shared(holder, &holder->value);
 
         // Cache it
-        std::unique_lock lock(m_cache_mutex);
-        m_schema_cache[path.string()] = schema;
-        return schema;
+        std::shared_ptr<const nlohmann::json> replaced;
+        {
+            std::unique_lock lock(m_cache_mutex, std::defer_lock);
+            lock_with_stats(lock, m_lock_stats);
+            replaced = std::exchange(m_schema_cache[path.string()], shared);
+        }
+        return shared;
     }
+
+    static constexpr double SCHEMA_RECLAIM_COST = 10.0;
+    static constexpr double THREAD_CONTEXT_RECLAIM_COST = 20.0;
 };
 
 /**
@@ -156,22 +337,17 @@ public:
         , m_provider_name(provider_name)
         , m_config(config) {}
 
-    general_context& get() {
-        struct thread_cache {
-            std::string provider_name;
-            std::unique_ptr<general_context> context;
-        };
-        thread_local thread_cache cache;
-
-        if (!cache.context || cache.provider_name != m_provider_name) {
-            cache.provider_name = m_provider_name;
-            cache.context = m_factory->create_context(m_provider_name, m_config);
-        }
-        return *cache.context;
+    /**
+     * @brief The calling thread's context for this provider and config
+     * @note Unlike context_factory::get_thread_local_context() the context keeps its
+     *       state between calls; use reset() to start over.
+     */
+    std::shared_ptr<general_context> get() {
+        return m_factory->thread_local_context(m_provider_name, m_config, false);
     }
 
     void reset() {
-        get().reset();
+        get()->reset();
     }
 
 private:
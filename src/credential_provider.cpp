@@ -0,0 +1,236 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "credential_provider.h"
+#include "logger.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+
+namespace hyni {
+
+namespace {
+
+// Names used before schemas carried `authentication.env_var`
+const std::unordered_map<std::string, std::string>& legacy_env_vars() {
+    static const std::unordered_map<std::string, std::string> names = {
+        {"openai", "OA_API_KEY"},
+        {"deepseek", "DS_API_KEY"},
+        {"claude", "CL_API_KEY"},
+        {"mistral", "MS_API_KEY"},
+    };
+    return names;
+}
+
+std::filesystem::path default_rc_path() {
+    const char* home = std::getenv("HOME");
+    return std::filesystem::path(home ? home : ".") / ".hynirc";
+}
+
+} // anonymous namespace
+
+credential_provider::credential_provider(std::filesystem::path rc_path,
+                                         std::chrono::milliseconds poll_interval)
+    : m_rc_path(std::move(rc_path))
+    , m_poll_interval(poll_interval) {
+    start_watching();
+}
+
+credential_provider::~credential_provider() {
+    {
+        std::lock_guard lock(m_watch_mutex);
+        m_stop = true;
+    }
+    m_watch_cv.notify_all();
+    if (m_watcher.joinable()) {
+        m_watcher.join();
+    }
+}
+
+credential_provider& credential_provider::instance() {
+    static credential_provider provider(default_rc_path());
+    return provider;
+}
+
+std::string credential_provider::get_api_key(const std::string& provider) const {
+    {
+        std::shared_lock lock(m_mutex);
+        auto it = m_keys.find(provider);
+        if (it != m_keys.end()) {
+            return it->second;
+        }
+    }
+
+    const std::string env_var = get_env_var(provider);
+
+    std::unique_lock lock(m_mutex);
+    auto [it, inserted] = m_keys.try_emplace(provider);
+    if (inserted) {
+        it->second = resolve_locked(env_var);
+    }
+    return it->second;
+}
+
+std::string credential_provider::resolve_locked(const std::string& env_var) const {
+    auto env_it = m_environment.find(env_var);
+    if (env_it == m_environment.end()) {
+        const char* value = std::getenv(env_var.c_str());
+        env_it = m_environment.emplace(env_var, value ? std::optional<std::string>(value)
+                                                      : std::nullopt).first;
+    }
+    if (env_it->second) {
+        return *env_it->second;
+    }
+
+    if (!m_rc_values) {
+        m_rc_values = parse_rc_file(m_rc_path);
+        m_reload_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    auto rc_it = m_rc_values->find(env_var);
+    return rc_it != m_rc_values->end() ? rc_it->second : "";
+}
+
+void credential_provider::register_env_var(const std::string& provider, const std::string& env_var) {
+    if (provider.empty() || env_var.empty()) {
+        return;
+    }
+
+    {
+        std::shared_lock lock(m_mutex);
+        auto it = m_env_vars.find(provider);
+        if (it != m_env_vars.end() && it->second == env_var) {
+            return;
+        }
+    }
+
+    std::unique_lock lock(m_mutex);
+    m_env_vars[provider] = env_var;
+    m_keys.erase(provider);
+}
+
+void credential_provider::register_schema(const nlohmann::json& schema) {
+    if (!schema.contains("provider") || !schema["provider"].contains("name") ||
+        !schema.contains("authentication") || !schema["authentication"].contains("env_var")) {
+        return;
+    }
+
+    register_env_var(schema["provider"]["name"].get<std::string>(),
+                     schema["authentication"]["env_var"].get<std::string>());
+}
+
+std::string credential_provider::get_env_var(const std::string& provider) const {
+    {
+        std::shared_lock lock(m_mutex);
+        auto it = m_env_vars.find(provider);
+        if (it != m_env_vars.end()) {
+            return it->second;
+        }
+    }
+
+    auto legacy = legacy_env_vars().find(provider);
+    if (legacy != legacy_env_vars().end()) {
+        return legacy->second;
+    }
+
+    std::string env_var = provider + "_API_KEY";
+    std::transform(env_var.begin(), env_var.end(), env_var.begin(),
+                   [](unsigned char c) { return std::isalnum(c) ? std::toupper(c) : '_'; });
+    return env_var;
+}
+
+void credential_provider::refresh() {
+    {
+        std::unique_lock lock(m_mutex);
+        m_keys.clear();
+        m_environment.clear();
+        m_rc_values.reset();
+    }
+    start_watching();
+}
+
+bool credential_provider::is_watching() const {
+    std::lock_guard lock(m_watch_mutex);
+    return m_watcher.joinable();
+}
+
+std::unordered_map<std::string, std::string> credential_provider::parse_rc_file(
+    const std::filesystem::path& path) {
+    std::unordered_map<std::string, std::string> config;
+    std::ifstream file(path);
+    std::string line;
+
+    while (std::getline(file, line)) {
+        size_t delimiter_pos = line.find('=');
+        if (delimiter_pos != std::string::npos) {
+            std::string key = line.substr(0, delimiter_pos);
+            std::string value = line.substr(delimiter_pos + 1);
+            // Trim whitespace
+            key.erase(0, key.find_first_not_of(" \t"));
+            key.erase(key.find_last_not_of(" \t") + 1);
+            value.erase(0, value.find_first_not_of(" \t\r"));
+            value.erase(value.find_last_not_of(" \t\r") + 1);
+            config[key] = value;
+        }
+    }
+
+    return config;
+}
+
+credential_provider::file_stamp credential_provider::stat_rc_file() const {
+    file_stamp stamp;
+    std::error_code ec;
+    auto status = std::filesystem::status(m_rc_path, ec);
+    if (ec || !std::filesystem::is_regular_file(status)) {
+        return stamp;
+    }
+
+    stamp.exists = true;
+    stamp.mtime = std::filesystem::last_write_time(m_rc_path, ec);
+    stamp.size = std::filesystem::file_size(m_rc_path, ec);
+    return stamp;
+}
+
+void credential_provider::start_watching() {
+    std::lock_guard lock(m_watch_mutex);
+    if (m_poll_interval.count() <= 0 || m_watcher.joinable() || m_stop) {
+        return;
+    }
+
+    // Nothing to poll until the file exists; an idle thread per provider adds up
+    m_stamp = stat_rc_file();
+    if (!m_stamp.exists) {
+        return;
+    }
+    m_watcher = std::thread(&credential_provider::watch, this);
+}
+
+void credential_provider::watch() {
+    std::unique_lock lock(m_watch_mutex);
+    while (!m_watch_cv.wait_for(lock, m_poll_interval, [this] { return m_stop; })) {
+        // Compare size as well: mtime granularity can hide a quick rewrite
+        file_stamp stamp = stat_rc_file();
+        if (stamp == m_stamp) {
+            continue;
+        }
+        m_stamp = stamp;
+
+        {
+            std::unique_lock state_lock(m_mutex);
+            // Keys that came from the environment stay valid; only rc values are re-read
+            m_rc_values.reset();
+            m_keys.clear();
+        }
+        LOG_INFO("Credential file changed, reloading: " + m_rc_path.string());
+    }
+}
+
+} // hyni
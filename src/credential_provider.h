@@ -0,0 +1,141 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace hyni {
+
+/**
+ * @class credential_provider
+ * @brief Resolves provider API keys from the environment and an rc file, with caching
+ *
+ * The env var holding a provider's key comes from the schema's
+ * `authentication.env_var` field (registered when a context loads the schema).
+ * Resolved keys are cached, so repeated lookups are a shared-lock map read.
+ * A watcher thread polls the rc file and drops the cache when it changes, so
+ * rotated keys are picked up without a restart. The thread only runs while
+ * there is an rc file to watch; one created later is picked up by refresh(). Environment variables take
+ * precedence over the rc file and are read once until refresh() is called.
+ *
+ * @note Thread-safe.
+ */
+class credential_provider {
+public:
+    /**
+     * @param rc_path Key file with `NAME=value` lines; may not exist yet
+     * @param poll_interval How often the rc file is checked for changes, 0 disables watching
+     */
+    explicit credential_provider(std::filesystem::path rc_path,
+                                 std::chrono::milliseconds poll_interval = std::chrono::seconds(1));
+    ~credential_provider();
+
+    credential_provider(const credential_provider&) = delete;
+    credential_provider& operator=(const credential_provider&) = delete;
+
+    /**
+     * @brief Process-wide provider reading ~/.hynirc
+     */
+    static credential_provider& instance();
+
+    /**
+     * @brief Returns the API key for a provider, or an empty string if none is configured
+     */
+    [[nodiscard]] std::string get_api_key(const std::string& provider) const;
+
+    /**
+     * @brief Maps a provider to the env var (and rc file key) holding its API key
+     */
+    void register_env_var(const std::string& provider, const std::string& env_var);
+
+    /**
+     * @brief Registers the mapping from a schema's `authentication.env_var`, if present
+     */
+    void register_schema(const nlohmann::json& schema);
+
+    /**
+     * @brief Env var name used for a provider
+     *
+     * Falls back to the historical short names for the bundled providers and to
+     * `<PROVIDER>_API_KEY` for anything else.
+     */
+    [[nodiscard]] std::string get_env_var(const std::string& provider) const;
+
+    /**
+     * @brief Re-reads the environment and the rc file on the next lookup
+     *
+     * Also starts watching the rc file if it did not exist until now.
+     */
+    void refresh();
+
+    /**
+     * @brief True if a watcher thread is polling the rc file
+     */
+    [[nodiscard]] bool is_watching() const;
+
+    /**
+     * @brief Number of times the rc file has been (re)loaded
+     */
+    [[nodiscard]] uint64_t get_reload_count() const noexcept {
+        return m_reload_count.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] const std::filesystem::path& get_rc_path() const noexcept { return m_rc_path; }
+
+    /**
+     * @brief Parses `NAME=value` lines, trimming whitespace around names and values
+     */
+    static std::unordered_map<std::string, std::string> parse_rc_file(const std::filesystem::path& path);
+
+private:
+    // Identity of the rc file as last seen by the watcher
+    struct file_stamp {
+        bool exists = false;
+        std::filesystem::file_time_type mtime{};
+        uintmax_t size = 0;
+
+        bool operator==(const file_stamp&) const = default;
+    };
+
+    const std::filesystem::path m_rc_path;
+    const std::chrono::milliseconds m_poll_interval;
+
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<std::string, std::string> m_env_vars;            // provider -> env var name
+    mutable std::unordered_map<std::string, std::string> m_keys;        // provider -> resolved key
+    mutable std::unordered_map<std::string, std::optional<std::string>> m_environment;
+    mutable std::optional<std::unordered_map<std::string, std::string>> m_rc_values;
+    mutable std::atomic<uint64_t> m_reload_count{0};
+
+    mutable std::mutex m_watch_mutex;
+    std::condition_variable m_watch_cv;
+    bool m_stop = false;
+    file_stamp m_stamp;
+    std::thread m_watcher;
+
+    std::string resolve_locked(const std::string& env_var) const;
+    file_stamp stat_rc_file() const;
+    void start_watching();
+    void watch();
+};
+
+} // hyni
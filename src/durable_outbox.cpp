@@ -0,0 +1,491 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "durable_outbox.h"
+#include "chat_api.h"
+#include "json_serializer.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace hyni {
+
+namespace {
+
+constexpr const char* REQUESTS_FILE = "requests.log";
+constexpr const char* RESULTS_FILE = "results.log";
+
+// One JSON document per line. Strings are repaired rather than rejected so a
+// request with broken UTF-8 is still queued; the context would repair it anyway.
+std::string to_line(const nlohmann::json& record) {
+    std::string line = json_serializer::dump(record, json_serializer::utf8_mode::repair);
+    line += '\n';
+    return line;
+}
+
+nlohmann::json to_json(const outbox_request& request) {
+    nlohmann::json messages = nlohmann::json::array();
+    for (const auto& message : request.messages) {
+        messages.push_back({{"role", message.role}, {"content", message.content}});
+    }
+    nlohmann::json record = {{"id", request.id}, {"messages", std::move(messages)},
+                             {"parameters", request.parameters}};
+    if (request.system_message) {
+        record["system"] = *request.system_message;
+    }
+    return record;
+}
+
+std::optional<outbox_request> request_from_json(const nlohmann::json& record) {
+    try {
+        outbox_request request;
+        request.id = record.at("id").get<std::string>();
+        for (const auto& message : record.at("messages")) {
+            request.messages.push_back({message.at("role").get<std::string>(),
+                                        message.at("content").get<std::string>()});
+        }
+        request.parameters = record.value("parameters", nlohmann::json::object());
+        if (record.contains("system")) {
+            request.system_message = record["system"].get<std::string>();
+        }
+        return request;
+    } catch (const nlohmann::json::exception&) {
+        return std::nullopt;
+    }
+}
+
+nlohmann::json to_json(const outbox_result& result) {
+    return {{"id", result.id}, {"success", result.success}, {"response", result.response},
+            {"error", result.error}, {"attempts", result.attempts}};
+}
+
+std::optional<outbox_result> result_from_json(const nlohmann::json& record) {
+    try {
+        outbox_result result;
+        result.id = record.at("id").get<std::string>();
+        result.success = record.at("success").get<bool>();
+        result.response = record.value("response", "");
+        result.error = record.value("error", "");
+        result.attempts = record.value("attempts", size_t{0});
+        return result;
+    } catch (const nlohmann::json::exception&) {
+        return std::nullopt;
+    }
+}
+
+// Complete lines of a journal that parse as JSON; a line torn by a crash does not
+std::vector<std::pair<nlohmann::json, std::string>> read_records(const std::filesystem::path& path) {
+    std::vector<std::pair<nlohmann::json, std::string>> records;
+    std::ifstream file(path, std::ios::binary);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (file.eof()) {
+            break;  // no trailing newline: the write was cut short
+        }
+        auto record = nlohmann::json::parse(line, nullptr, false);
+        if (!record.is_discarded() && record.is_object()) {
+            records.emplace_back(std::move(record), std::move(line));
+        }
+    }
+    return records;
+}
+
+void sync_directory(const std::filesystem::path& directory) {
+    const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+// Replaces path with lines atomically: a crash leaves either the old or the new file
+void rewrite(const std::filesystem::path& path, const std::vector<std::string>& lines) {
+    auto temporary = path;
+    temporary += ".tmp";
+    async_file_options options;
+    options.truncate = true;
+    async_file_writer writer(temporary, options);
+    for (const auto& line : lines) {
+        writer.write(line);
+        writer.write("\n");
+    }
+    if (!writer.close()) {
+        throw std::runtime_error("Cannot write " + temporary.string());
+    }
+    std::filesystem::rename(temporary, path);
+    sync_directory(path.parent_path());
+}
+
+// Validation errors and most 4xx responses would fail the same way again
+bool is_transient(const std::exception& e) {
+    if (const auto* request = dynamic_cast<const failed_api_request*>(&e)) {
+        return request->is_transient();
+    }
+    return !dynamic_cast<const chat_api_error*>(&e) &&
+           !dynamic_cast<const validation_exception*>(&e) &&
+           !dynamic_cast<const schema_exception*>(&e) &&
+           !dynamic_cast<const nlohmann::json::exception*>(&e) &&
+           !dynamic_cast<const std::logic_error*>(&e);
+}
+
+// Map node, order entry and the strings they own
+size_t result_bytes(const outbox_result& result) {
+    constexpr size_t NODE_OVERHEAD = 32;
+    return NODE_OVERHEAD + sizeof(std::string) + sizeof(outbox_result) + 2 * result.id.capacity() +
+           result.response.capacity() + result.error.capacity();
+}
+
+} // anonymous namespace
+
+durable_outbox::durable_outbox(const std::filesystem::path& directory, api_factory make_api,
+                               outbox_options options, result_callback on_result)
+    : m_directory(directory)
+    , m_make_api(std::move(make_api))
+    , m_options(options)
+    , m_on_result(std::move(on_result))
+    , m_memory(memory_governor::instance().register_component("durable_outbox.results", 0.0, nullptr)) {
+    recover();
+    m_committer = std::thread([this] { commit_loop(); });
+    for (size_t i = 0; i < m_options.workers; ++i) {
+        m_workers.emplace_back([this] { work_loop(); });
+    }
+}
+
+durable_outbox::~durable_outbox() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_commit_cv.notify_all();
+    m_ready_cv.notify_all();
+    m_committer.join();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+    m_requests->close();
+    m_results->close();
+}
+
+void durable_outbox::recover() {
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    if (ec) {
+        throw std::runtime_error("Cannot create outbox directory " + m_directory.string() + ": " + ec.message());
+    }
+    const auto requests_path = m_directory / REQUESTS_FILE;
+    const auto results_path = m_directory / RESULTS_FILE;
+
+    std::vector<std::pair<outbox_result, std::string>> results;
+    std::unordered_set<std::string> finished;
+    for (auto& [record, line] : read_records(results_path)) {
+        if (auto result = result_from_json(record)) {
+            finished.insert(result->id);
+            results.emplace_back(std::move(*result), std::move(line));
+        }
+    }
+
+    // Requests whose result was journaled are done, even if the crash came before compaction
+    std::vector<std::string> request_lines;
+    for (auto& [record, line] : read_records(requests_path)) {
+        auto request = request_from_json(record);
+        if (request && !finished.count(request->id) && m_pending_ids.insert(request->id).second) {
+            m_ready.push_back(std::move(*request));
+            request_lines.push_back(std::move(line));
+        }
+    }
+    m_stats.recovered = m_ready.size();
+
+    // Only the newest results are kept. The request log goes first: a crash in between
+    // must not leave a finished request in it whose result was already dropped.
+    const size_t keep = m_options.max_results == 0 ? results.size() : std::min(results.size(), m_options.max_results);
+    std::vector<std::string> result_lines;
+    for (size_t i = results.size() - keep; i < results.size(); ++i) {
+        remember_locked(results[i].first);
+        result_lines.push_back(std::move(results[i].second));
+    }
+
+    rewrite(requests_path, request_lines);
+    rewrite(results_path, result_lines);
+
+    // Synced explicitly: by the commit thread and after each result
+    async_file_options options;
+    options.sync = fsync_policy::on_close;
+    m_requests = std::make_unique<async_file_writer>(requests_path, options);
+    m_results = std::make_unique<async_file_writer>(results_path, options);
+
+    if (!m_ready.empty()) {
+        LOG_INFO("durable_outbox: resuming " + std::to_string(m_ready.size()) + " pending requests from " +
+                 m_directory.string());
+    }
+}
+
+bool durable_outbox::enqueue(const outbox_request& request) {
+    if (request.id.empty()) {
+        throw std::invalid_argument("Outbox request id cannot be empty");
+    }
+    const std::string line = to_line(to_json(request));
+    bool first = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_error.empty()) {
+            throw std::runtime_error(m_error);
+        }
+        if (m_pending_ids.count(request.id) || m_finished.count(request.id)) {
+            ++m_stats.duplicates;
+            return false;
+        }
+        // Written under the lock so log order matches the sequence numbers
+        m_requests->write(line);
+        m_pending_ids.insert(request.id);
+        m_uncommitted.push_back(request);
+        ++m_written_seq;
+        ++m_stats.enqueued;
+        first = m_uncommitted.size() == 1;
+    }
+    // Later requests join the commit that is already scheduled; no wakeup needed
+    if (first) {
+        m_commit_cv.notify_one();
+    }
+    return true;
+}
+
+void durable_outbox::commit() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const uint64_t target = m_written_seq;
+    m_done_cv.wait(lock, [&] { return m_committed_seq >= target || !m_error.empty(); });
+    if (m_committed_seq < target) {
+        throw std::runtime_error(m_error);
+    }
+}
+
+bool durable_outbox::wait_idle(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_cv.wait_for(lock, timeout, [&] { return m_pending_ids.empty() || !m_error.empty(); });
+    return m_pending_ids.empty();
+}
+
+std::optional<outbox_result> durable_outbox::get_result(const std::string& id) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_finished.find(id);
+    if (it == m_finished.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+size_t durable_outbox::pending() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending_ids.size();
+}
+
+std::string durable_outbox::last_error() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_error;
+}
+
+durable_outbox::stats durable_outbox::get_stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void durable_outbox::commit_loop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_commit_cv.wait(lock, [&] { return m_stop || m_written_seq > m_committed_seq; });
+        if (m_written_seq == m_committed_seq) {
+            return;  // stopping with everything committed
+        }
+        // Let concurrent producers join this commit
+        if (!m_stop && m_options.commit_delay.count() > 0) {
+            m_commit_cv.wait_for(lock, m_options.commit_delay, [&] { return m_stop.load(); });
+        }
+
+        const uint64_t seq = m_written_seq;
+        auto batch = std::move(m_uncommitted);
+        m_uncommitted.clear();
+        lock.unlock();
+
+        m_requests->sync();
+        const int error = m_requests->last_error();
+
+        lock.lock();
+        if (error != 0) {
+            // The batch may not be on disk: it is neither acknowledged nor sent
+            fail_locked(*m_requests, error);
+            return;
+        }
+        m_committed_seq = seq;
+        ++m_stats.commits;
+        for (auto& request : batch) {
+            m_ready.push_back(std::move(request));
+        }
+        // Workers sleeping between retries share the condition variable
+        m_ready_cv.notify_all();
+        m_done_cv.notify_all();
+    }
+}
+
+void durable_outbox::work_loop() {
+    std::shared_ptr<chat_api> api;
+    std::unordered_map<std::string, nlohmann::json> default_parameters;
+    std::optional<std::string> default_system_message;
+    // A factory failure counts as a failed attempt of the request at hand, so
+    // requests still finish (as failures) if no chat_api can be created at all
+    auto ensure_api = [&] {
+        if (api) return;
+        auto created = m_make_api();
+        if (!created) {
+            throw std::runtime_error("durable_outbox: chat_api factory returned null");
+        }
+        // What the factory configured applies to every request
+        default_parameters = created->get_context().get_parameters();
+        default_system_message = created->get_context().get_system_message();
+        api = std::move(created);
+    };
+    try {
+        ensure_api();
+    } catch (const std::exception& e) {
+        LOG_ERROR("durable_outbox: cannot create chat_api: " + std::string(e.what()));
+    }
+
+    while (true) {
+        outbox_request request;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_ready_cv.wait(lock, [&] { return m_stop || !m_error.empty() || !m_ready.empty(); });
+            if (m_stop || !m_error.empty()) {
+                return;
+            }
+            request = std::move(m_ready.front());
+            m_ready.pop_front();
+        }
+
+        outbox_result result;
+        result.id = request.id;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                ++m_stats.attempts;
+            }
+            ++result.attempts;
+            bool transient = true;
+            try {
+                ensure_api();
+                result.response = send(*api, request, default_parameters, default_system_message);
+                result.success = true;
+                result.error.clear();
+                break;
+            } catch (const std::exception& e) {
+                result.error = e.what();
+                transient = is_transient(e);
+            }
+            if (!transient || result.attempts >= m_options.max_attempts || m_stop) {
+                break;
+            }
+
+            const auto delay = m_options.retry_delay * (1u << std::min<size_t>(result.attempts - 1, 16));
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_ready_cv.wait_for(lock, delay, [&] { return m_stop.load(); })) {
+                break;
+            }
+        }
+
+        if (!result.success && m_stop) {
+            return;  // still in the log, sent again next time
+        }
+        record(result);
+    }
+}
+
+std::string durable_outbox::send(chat_api& api, const outbox_request& request,
+                                 const std::unordered_map<std::string, nlohmann::json>& default_parameters,
+                                 const std::optional<std::string>& default_system_message) {
+    general_context& context = api.get_context();
+    context.clear_user_messages();
+    context.clear_parameters();
+    context.set_parameters(default_parameters);
+    for (const auto& [key, value] : request.parameters.items()) {
+        context.set_parameter(key, value);
+    }
+
+    const auto& system_message = request.system_message ? request.system_message : default_system_message;
+    if (system_message) {
+        context.set_system_message(*system_message);
+    } else {
+        context.clear_system_message();
+    }
+
+    for (const auto& message : request.messages) {
+        context.add_message(message.role, message.content);
+    }
+    return api.send_message([this] { return m_stop.load(); });
+}
+
+void durable_outbox::record(const outbox_result& result) {
+    // Durable before the request counts as done; a crash before this resends it
+    m_results->write(to_line(to_json(result)));
+    m_results->sync();
+    const int error = m_results->last_error();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (error != 0) {
+            // Stays pending and in the request log, so it is sent again on reopen
+            fail_locked(*m_results, error);
+            return;
+        }
+        remember_locked(result);
+        m_pending_ids.erase(result.id);
+        ++(result.success ? m_stats.succeeded : m_stats.failed);
+    }
+    m_done_cv.notify_all();
+
+    if (!result.success) {
+        LOG_WARNING("durable_outbox: request " + result.id + " failed after " +
+                    std::to_string(result.attempts) + " attempts: " + result.error);
+    }
+    if (m_on_result) {
+        m_on_result(result);
+    }
+}
+
+void durable_outbox::remember_locked(const outbox_result& result) {
+    std::ptrdiff_t delta = static_cast<std::ptrdiff_t>(result_bytes(result));
+    auto [it, inserted] = m_finished.try_emplace(result.id);
+    if (inserted) {
+        m_finished_order.push_back(result.id);
+    } else {
+        delta -= static_cast<std::ptrdiff_t>(result_bytes(it->second));
+    }
+    it->second = result;
+    while (m_options.max_results > 0 && m_finished_order.size() > m_options.max_results) {
+        auto oldest = m_finished.find(m_finished_order.front());
+        delta -= static_cast<std::ptrdiff_t>(result_bytes(oldest->second));
+        m_finished.erase(oldest);
+        m_finished_order.pop_front();
+    }
+    m_memory.account(delta);
+}
+
+void durable_outbox::fail_locked(const async_file_writer& journal, int error) {
+    if (m_error.empty()) {
+        m_error = "durable_outbox: cannot sync " + journal.path().string() + ": " + std::strerror(error);
+        LOG_ERROR(m_error);
+    }
+    m_ready_cv.notify_all();
+    m_done_cv.notify_all();
+}
+
+} // hyni
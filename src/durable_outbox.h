@@ -0,0 +1,214 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "async_file_writer.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace hyni {
+
+class chat_api;
+
+/**
+ * @brief One message of an outbox request
+ */
+struct outbox_message {
+    std::string role;
+    std::string content;
+};
+
+/**
+ * @brief Request queued in a durable_outbox
+ */
+struct outbox_request {
+    std::string id;                             ///< Chosen by the caller; a repeated id is ignored
+    std::vector<outbox_message> messages;
+    std::optional<std::string> system_message;  ///< Replaces the context's system message for this request
+    nlohmann::json parameters = nlohmann::json::object();  ///< Added to the context's parameters for this request
+};
+
+/**
+ * @brief Outcome of an outbox request, as recorded in the results journal
+ */
+struct outbox_result {
+    std::string id;
+    bool success = false;
+    std::string response;   ///< Response text if successful
+    std::string error;      ///< Error of the last attempt otherwise
+    size_t attempts = 0;
+};
+
+/**
+ * @brief Options for durable_outbox
+ */
+struct outbox_options {
+    size_t workers = 2;                             ///< Threads sending requests, 0 to only queue them
+    std::chrono::microseconds commit_delay{500};    ///< How long a group commit waits for more requests
+    size_t max_attempts = 5;                        ///< Attempts before a request is recorded as failed
+    std::chrono::milliseconds retry_delay{1000};    ///< Before the second attempt, doubled for each further one
+    size_t max_results = 10000;                     ///< Finished results remembered, oldest dropped first; 0 = all
+};
+
+/**
+ * @class durable_outbox
+ * @brief Crash-safe queue of LLM requests, sent in the background through chat_api
+ *
+ * enqueue() appends the request to an append-only log in the outbox directory
+ * and returns; it only copies into an async_file_writer buffer, so it takes
+ * microseconds. A commit thread makes the log durable with one fdatasync per
+ * group of requests (group commit) and then hands the group to the workers.
+ * Each worker owns a chat_api from the factory and records every outcome in a
+ * results journal, synced before the request counts as done.
+ *
+ * Delivery is at least once: a request whose result was not journaled before a
+ * crash is sent again when the outbox is reopened. Ids of pending requests and of
+ * the last max_results finished ones are remembered across restarts, so
+ * enqueueing such an id again is a no-op. Both files are compacted when the
+ * outbox is opened, dropping finished requests, older results and a record torn
+ * by the crash.
+ *
+ * Transport errors, timeouts, 429 and 5xx responses are retried with backoff;
+ * validation errors and other 4xx responses fail the request right away. If a
+ * journal cannot be synced (ENOSPC, EIO), nothing after the failure counts as
+ * committed or done: commit() and enqueue() throw and the affected requests stay
+ * in the log, to be sent when the outbox is opened again.
+ *
+ * @note Thread-safe. The factory is called once per worker, on that worker's thread.
+ */
+class durable_outbox {
+public:
+    using api_factory = std::function<std::shared_ptr<chat_api>()>;
+    using result_callback = std::function<void(const outbox_result&)>;
+
+    /**
+     * @brief Opens or creates the outbox in directory and resumes its pending requests
+     * @param on_result Called on a worker thread after a result has been journaled
+     * @throws std::runtime_error If the directory or its files cannot be opened
+     */
+    durable_outbox(const std::filesystem::path& directory, api_factory make_api,
+                   outbox_options options = {}, result_callback on_result = nullptr);
+
+    /**
+     * @brief Commits queued requests and stops the workers
+     *
+     * Requests in flight are cancelled; they and the ones not yet sent stay in the
+     * log and are sent when the outbox is opened again.
+     */
+    ~durable_outbox();
+
+    durable_outbox(const durable_outbox&) = delete;
+    durable_outbox& operator=(const durable_outbox&) = delete;
+
+    /**
+     * @brief Queues a request without waiting for the disk
+     * @return False if a request with this id was queued before
+     * @throws std::invalid_argument If the id is empty
+     * @throws std::runtime_error If a journal could not be synced
+     */
+    bool enqueue(const outbox_request& request);
+
+    /**
+     * @brief Waits until every request queued so far is on stable storage
+     * @throws std::runtime_error If the request log could not be synced
+     */
+    void commit();
+
+    /**
+     * @brief Waits until no request is pending
+     * @return False on timeout
+     */
+    bool wait_idle(std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Result of a finished request, empty while it is pending or if the id is unknown
+     */
+    [[nodiscard]] std::optional<outbox_result> get_result(const std::string& id) const;
+
+    /**
+     * @brief Requests queued or in flight
+     */
+    [[nodiscard]] size_t pending() const;
+
+    /**
+     * @brief Why the journals stopped accepting requests, empty while they are healthy
+     */
+    [[nodiscard]] std::string last_error() const;
+
+    struct stats {
+        uint64_t enqueued = 0;      ///< Requests accepted by enqueue()
+        uint64_t duplicates = 0;    ///< Requests ignored because their id was known
+        uint64_t recovered = 0;     ///< Pending requests found when the outbox was opened
+        uint64_t commits = 0;       ///< Group commits of the request log
+        uint64_t attempts = 0;      ///< Sends, including retries
+        uint64_t succeeded = 0;
+        uint64_t failed = 0;        ///< Requests that ran out of attempts
+    };
+
+    [[nodiscard]] stats get_stats() const;
+
+    [[nodiscard]] const std::filesystem::path& directory() const noexcept { return m_directory; }
+
+private:
+    const std::filesystem::path m_directory;
+    const api_factory m_make_api;
+    const outbox_options m_options;
+    const result_callback m_on_result;
+
+    std::unique_ptr<async_file_writer> m_requests;
+    std::unique_ptr<async_file_writer> m_results;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_commit_cv;    // commit thread: requests written, or stop
+    std::condition_variable m_ready_cv;     // workers: requests committed, or stop
+    std::condition_variable m_done_cv;      // commit() and wait_idle() callers
+    std::vector<outbox_request> m_uncommitted;
+    std::deque<outbox_request> m_ready;
+    uint64_t m_written_seq = 0;
+    uint64_t m_committed_seq = 0;
+    std::unordered_set<std::string> m_pending_ids;
+    std::unordered_map<std::string, outbox_result> m_finished;
+    std::deque<std::string> m_finished_order;   // oldest first, for max_results
+    // Only accounted: dropping results early would let their ids be sent again
+    memory_governor::registration m_memory;
+    std::string m_error;                        // set once a journal sync failed
+    stats m_stats;
+    std::atomic<bool> m_stop{false};
+
+    std::thread m_committer;
+    std::vector<std::thread> m_workers;
+
+    void recover();
+    void commit_loop();
+    void work_loop();
+    std::string send(chat_api& api, const outbox_request& request,
+                     const std::unordered_map<std::string, nlohmann::json>& default_parameters,
+                     const std::optional<std::string>& default_system_message);
+    void record(const outbox_result& result);
+    void remember_locked(const outbox_result& result);
+    void fail_locked(const async_file_writer& journal, int error);
+};
+
+} // hyni
@@ -0,0 +1,310 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "endpoint_selector.h"
+#include "http_client.h"
+#include "logger.h"
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <numeric>
+
+namespace hyni {
+
+std::vector<endpoint_config> endpoint_config::from_schema(const nlohmann::json& schema) {
+    std::vector<endpoint_config> endpoints;
+    if (!schema.contains("api")) {
+        return endpoints;
+    }
+    const auto& api = schema.at("api");
+    if (api.contains("endpoints")) {
+        for (const auto& entry : api.at("endpoints")) {
+            endpoints.push_back({entry.at("url").get<std::string>(), entry.value("weight", 1.0)});
+        }
+    } else if (api.contains("endpoint")) {
+        endpoints.push_back({api.at("endpoint").get<std::string>(), 1.0});
+    }
+    return endpoints;
+}
+
+endpoint_selector::endpoint_selector(std::vector<endpoint_config> endpoints,
+                                     endpoint_selector_options options)
+    : m_options(options)
+    , m_rng(options.seed ? *options.seed : std::random_device{}()) {
+    if (endpoints.empty()) {
+        throw std::invalid_argument("endpoint_selector needs at least one endpoint");
+    }
+    for (auto& config : endpoints) {
+        if (config.weight <= 0) {
+            throw std::invalid_argument("Endpoint weight must be positive: " + config.url);
+        }
+        m_endpoints.push_back({std::move(config)});
+    }
+}
+
+endpoint_selector::~endpoint_selector() {
+    m_stop = true;
+    if (m_race_thread.joinable()) {
+        m_race_thread.join();
+    }
+}
+
+std::shared_ptr<endpoint_selector> endpoint_selector::shared(const std::vector<endpoint_config>& endpoints) {
+    static std::mutex mutex;
+    static std::map<std::string, std::weak_ptr<endpoint_selector>> selectors;
+
+    std::string key;
+    for (const auto& endpoint : endpoints) {
+        key += endpoint.url + '\n' + std::to_string(endpoint.weight) + '\n';
+    }
+
+    std::lock_guard lock(mutex);
+    auto selector = selectors[key].lock();
+    if (!selector) {
+        selector = std::make_shared<endpoint_selector>(endpoints);
+        selectors[key] = selector;
+    }
+    return selector;
+}
+
+std::optional<size_t> endpoint_selector::find(const std::string& url) const {
+    for (size_t i = 0; i < m_endpoints.size(); ++i) {
+        if (m_endpoints[i].config.url == url) {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+double endpoint_selector::score_locked(const endpoint_state& endpoint) const {
+    // Unmeasured endpoints score 0 and get the next request, which measures them,
+    // unless they have only failed so far
+    double latency = endpoint.ttfb_samples > 0 ? endpoint.ttfb_ms : endpoint.rtt_ms;
+    if (latency == 0.0) {
+        return endpoint.error_rate > 0 ? std::numeric_limits<double>::max() : 0.0;
+    }
+    return latency / endpoint.config.weight * (1.0 + 4.0 * endpoint.error_rate);
+}
+
+bool endpoint_selector::is_drained_locked(const endpoint_state& endpoint,
+                                          std::chrono::steady_clock::time_point now) const {
+    return endpoint.drained_until > now;
+}
+
+size_t endpoint_selector::select(std::optional<size_t> exclude) {
+    if (m_endpoints.size() == 1) {
+        return 0;
+    }
+    // Measured in the background; the first requests go out meanwhile
+    if (!m_race_started.exchange(true)) {
+        m_race_thread = std::thread([this] { race(); });
+    }
+
+    std::lock_guard lock(m_mutex);
+    const auto now = std::chrono::steady_clock::now();
+
+    std::vector<size_t> candidates;
+    for (size_t i = 0; i < m_endpoints.size(); ++i) {
+        auto& endpoint = m_endpoints[i];
+        if (endpoint.drained_until != std::chrono::steady_clock::time_point{} && endpoint.drained_until <= now) {
+            // Drain over: forget the stale latency so the next request re-measures it
+            endpoint.drained_until = {};
+            endpoint.ttfb_samples = 0;
+            endpoint.error_rate = std::min(endpoint.error_rate, m_options.drain_error_rate / 2);
+        }
+        if (i != exclude && !is_drained_locked(endpoint, now)) {
+            candidates.push_back(i);
+        }
+    }
+    if (candidates.empty()) {
+        // Everything else is drained or failed; take the least bad rather than nothing
+        for (size_t i = 0; i < m_endpoints.size(); ++i) {
+            if (i != exclude) candidates.push_back(i);
+        }
+        if (candidates.empty()) {
+            return *exclude;
+        }
+    }
+
+    // Equal scores, e.g. before anything was measured, go to the heaviest endpoint
+    size_t best = *std::min_element(candidates.begin(), candidates.end(), [this](size_t a, size_t b) {
+        const double score_a = score_locked(m_endpoints[a]);
+        const double score_b = score_locked(m_endpoints[b]);
+        return score_a != score_b ? score_a < score_b : m_endpoints[a].config.weight > m_endpoints[b].config.weight;
+    });
+
+    if (candidates.size() > 1 && std::uniform_real_distribution<>(0.0, 1.0)(m_rng) < m_options.explore_probability) {
+        std::vector<double> weights;
+        for (size_t i : candidates) {
+            weights.push_back(i == best ? 0.0 : m_endpoints[i].config.weight);
+        }
+        std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+        return candidates[pick(m_rng)];
+    }
+    return best;
+}
+
+void endpoint_selector::report(size_t index, const http_timings& timings, bool success) {
+    std::lock_guard lock(m_mutex);
+    auto& endpoint = m_endpoints.at(index);
+    const double alpha = m_options.ewma_alpha;
+    auto ewma = [alpha](double current, double sample, bool first) {
+        return first ? sample : current + alpha * (sample - current);
+    };
+
+    ++endpoint.requests;
+    endpoint.error_rate = ewma(endpoint.error_rate, success ? 0.0 : 1.0, false);
+    if (timings.connect_ms > 0) {
+        endpoint.rtt_ms = ewma(endpoint.rtt_ms, timings.connect_ms + timings.tls_ms, endpoint.rtt_ms == 0);
+    }
+    if (success && timings.ttfb_ms > 0) {
+        endpoint.ttfb_ms = ewma(endpoint.ttfb_ms, timings.ttfb_ms, endpoint.ttfb_samples == 0);
+        ++endpoint.ttfb_samples;
+    }
+    update_drain_locked(index, std::chrono::steady_clock::now());
+}
+
+void endpoint_selector::update_drain_locked(size_t index, std::chrono::steady_clock::time_point now) {
+    auto& endpoint = m_endpoints[index];
+    if (m_endpoints.size() < 2 || endpoint.requests < m_options.min_samples ||
+        is_drained_locked(endpoint, now)) {
+        return;
+    }
+
+    double best_score = std::numeric_limits<double>::max();
+    double best_ttfb = 0.0;
+    for (size_t i = 0; i < m_endpoints.size(); ++i) {
+        const auto& other = m_endpoints[i];
+        if (i == index || is_drained_locked(other, now)) {
+            continue;
+        }
+        best_score = std::min(best_score, score_locked(other));
+        if (other.ttfb_samples > 0 && (best_ttfb == 0.0 || other.ttfb_ms < best_ttfb)) {
+            best_ttfb = other.ttfb_ms;
+        }
+    }
+    if (best_score == std::numeric_limits<double>::max() || score_locked(endpoint) <= best_score) {
+        return;  // the only or the best endpoint keeps its traffic
+    }
+
+    const bool erroring = endpoint.error_rate > m_options.drain_error_rate;
+    const bool slow = endpoint.ttfb_samples > 0 && best_ttfb > 0 &&
+                      endpoint.ttfb_ms > m_options.drain_latency_factor * best_ttfb;
+    if (erroring || slow) {
+        endpoint.drained_until = now + m_options.drain_duration;
+        ++endpoint.drains;
+        LOG_WARNING_SAMPLED("Draining endpoint " + endpoint.config.url +
+                            (erroring ? ": error rate " + std::to_string(endpoint.error_rate)
+                                      : ": TTFB " + std::to_string(endpoint.ttfb_ms) + "ms"));
+    }
+}
+
+size_t endpoint_selector::race() {
+    std::vector<size_t> order(m_endpoints.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return m_endpoints[a].config.weight > m_endpoints[b].config.weight;
+    });
+
+    CURLM* multi = curl_multi_init();
+    if (!multi) {
+        return order.front();
+    }
+
+    std::vector<CURL*> handles(m_endpoints.size(), nullptr);
+    std::optional<size_t> winner;
+    size_t next = 0;
+    int active = 0;
+    const auto start = std::chrono::steady_clock::now();
+    auto last_start = start;
+
+    while (!winner) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now - start >= m_options.race_timeout || m_stop) {
+            break;
+        }
+
+        // Start the next contender after its head start, or at once if nothing is left running
+        if (next < order.size() && (active == 0 || next == 0 || now - last_start >= m_options.race_delay)) {
+            size_t index = order[next++];
+            CURL* handle = curl_easy_init();
+            if (handle) {
+                curl_easy_setopt(handle, CURLOPT_URL, m_endpoints[index].config.url.c_str());
+                curl_easy_setopt(handle, CURLOPT_CONNECT_ONLY, 1L);
+                curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+                curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT_MS,
+                                 static_cast<long>(m_options.race_timeout.count()));
+                curl_easy_setopt(handle, CURLOPT_PRIVATE, reinterpret_cast<void*>(index));
+                curl_multi_add_handle(multi, handle);
+                handles[index] = handle;
+                ++active;
+            }
+            last_start = now;
+        }
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            void* priv = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &priv);
+            size_t index = reinterpret_cast<size_t>(priv);
+            --active;
+
+            std::lock_guard lock(m_mutex);
+            auto& endpoint = m_endpoints[index];
+            if (msg->data.result == CURLE_OK) {
+                curl_off_t connect = 0, app_connect = 0;
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_CONNECT_TIME_T, &connect);
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_APPCONNECT_TIME_T, &app_connect);
+                endpoint.rtt_ms = std::max(connect, app_connect) / 1000.0;
+                if (!winner) {
+                    winner = index;
+                }
+            } else {
+                endpoint.error_rate = 1.0;
+            }
+        }
+
+        if (!winner && next >= order.size() && active == 0) {
+            break;
+        }
+        if (!winner) {
+            curl_multi_poll(multi, nullptr, 0, 10, nullptr);
+        }
+    }
+
+    for (CURL* handle : handles) {
+        if (handle) {
+            curl_multi_remove_handle(multi, handle);
+            curl_easy_cleanup(handle);
+        }
+    }
+    curl_multi_cleanup(multi);
+
+    return winner ? *winner : order.front();
+}
+
+std::vector<endpoint_selector::endpoint_stats> endpoint_selector::get_stats() const {
+    std::lock_guard lock(m_mutex);
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<endpoint_stats> stats;
+    for (const auto& endpoint : m_endpoints) {
+        stats.push_back({endpoint.config.url, endpoint.config.weight, endpoint.rtt_ms,
+                         endpoint.ttfb_samples > 0 ? endpoint.ttfb_ms : 0.0, endpoint.error_rate,
+                         endpoint.requests, endpoint.drains, is_drained_locked(endpoint, now)});
+    }
+    return stats;
+}
+
+} // hyni
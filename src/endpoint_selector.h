@@ -0,0 +1,163 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hyni {
+
+struct http_timings;
+
+/**
+ * @brief One host a provider can be reached at, from the schema's `api.endpoints`
+ */
+struct endpoint_config {
+    std::string url;
+    double weight = 1.0;   ///< Relative share of traffic among equally fast endpoints
+
+    bool operator==(const endpoint_config&) const = default;
+
+    /**
+     * @brief Reads `api.endpoints`, or the single `api.endpoint` if there is no list
+     */
+    static std::vector<endpoint_config> from_schema(const nlohmann::json& schema);
+};
+
+/**
+ * @brief Tuning for endpoint_selector
+ */
+struct endpoint_selector_options {
+    double ewma_alpha = 0.3;                               ///< Weight of the newest latency/error sample
+    double explore_probability = 0.05;                     ///< Share of requests sent to a non-best endpoint
+    double drain_latency_factor = 3.0;                     ///< Drain when TTFB exceeds this multiple of the best
+    double drain_error_rate = 0.5;                         ///< Drain when the error rate exceeds this
+    size_t min_samples = 3;                                ///< Requests before an endpoint can be drained
+    std::chrono::milliseconds drain_duration{30000};       ///< How long a drained endpoint gets no traffic
+    std::chrono::milliseconds race_delay{250};             ///< Head start of each endpoint in the connect race
+    std::chrono::milliseconds race_timeout{5000};          ///< Give up on the connect race after this
+    std::optional<uint32_t> seed;                          ///< Fixed seed for exploration, for tests
+};
+
+/**
+ * @class endpoint_selector
+ * @brief Picks one of a provider's endpoints from live latency and error measurements
+ *
+ * The first selection starts a connection race on a background thread,
+ * happy-eyeballs style: endpoints are tried in weight order, each starting
+ * race_delay after the previous one, until one finishes its TCP/TLS handshake.
+ * The handshake times seed the latency estimates; select() does not wait for
+ * them and until then prefers the heaviest endpoint. Every request reports its
+ * time to first byte and outcome. The endpoint with the lowest
+ * weighted TTFB (penalized by its error rate) gets the traffic, with a small
+ * exploration share keeping the other measurements fresh.
+ *
+ * An endpoint whose TTFB grows past drain_latency_factor times the best, or
+ * whose error rate passes drain_error_rate, is drained: it gets no new requests
+ * for drain_duration, while requests already in flight finish normally. The
+ * best endpoint is never drained.
+ *
+ * @note Thread-safe. Instances for the same endpoint list are shared through
+ *       shared(), so all clients of a provider pool their measurements.
+ */
+class endpoint_selector {
+public:
+    explicit endpoint_selector(std::vector<endpoint_config> endpoints,
+                               endpoint_selector_options options = {});
+
+    /**
+     * @brief Stops a connection race still running in the background
+     */
+    ~endpoint_selector();
+
+    endpoint_selector(const endpoint_selector&) = delete;
+    endpoint_selector& operator=(const endpoint_selector&) = delete;
+
+    /**
+     * @brief Process-wide selector for an endpoint list, created on first use
+     */
+    static std::shared_ptr<endpoint_selector> shared(const std::vector<endpoint_config>& endpoints);
+
+    /**
+     * @brief Index of the endpoint to use for the next request
+     * @param exclude Endpoint to avoid, e.g. one that just failed
+     */
+    [[nodiscard]] size_t select(std::optional<size_t> exclude = std::nullopt);
+
+    /**
+     * @brief Records the outcome of a request sent to an endpoint
+     */
+    void report(size_t index, const http_timings& timings, bool success);
+
+    /**
+     * @brief Races connections to all endpoints and returns the first to connect
+     * @note Blocks for up to race_timeout; select() runs it in the background
+     */
+    size_t race();
+
+    [[nodiscard]] size_t size() const noexcept { return m_endpoints.size(); }
+    [[nodiscard]] const endpoint_config& endpoint(size_t index) const { return m_endpoints.at(index).config; }
+
+    /**
+     * @brief Index of an endpoint URL, or nullopt if it is not one of ours
+     */
+    [[nodiscard]] std::optional<size_t> find(const std::string& url) const;
+
+    struct endpoint_stats {
+        std::string url;
+        double weight = 1.0;
+        double rtt_ms = 0.0;       ///< Connect (plus TLS) time, 0 if never measured
+        double ttfb_ms = 0.0;      ///< Smoothed time to first byte, 0 if never measured
+        double error_rate = 0.0;   ///< Smoothed share of failed requests
+        uint64_t requests = 0;
+        uint64_t drains = 0;       ///< Times the endpoint was drained
+        bool drained = false;
+    };
+
+    [[nodiscard]] std::vector<endpoint_stats> get_stats() const;
+
+private:
+    struct endpoint_state {
+        endpoint_config config;
+        double rtt_ms = 0.0;
+        double ttfb_ms = 0.0;
+        double error_rate = 0.0;
+        uint64_t requests = 0;
+        uint64_t ttfb_samples = 0;
+        uint64_t drains = 0;
+        std::chrono::steady_clock::time_point drained_until{};
+    };
+
+    std::vector<endpoint_state> m_endpoints;
+    endpoint_selector_options m_options;
+
+    mutable std::mutex m_mutex;
+    std::mt19937 m_rng;
+    std::atomic<bool> m_race_started{false};
+    std::atomic<bool> m_stop{false};
+    std::thread m_race_thread;
+
+    [[nodiscard]] double score_locked(const endpoint_state& endpoint) const;
+    [[nodiscard]] bool is_drained_locked(const endpoint_state& endpoint,
+                                         std::chrono::steady_clock::time_point now) const;
+    void update_drain_locked(size_t index, std::chrono::steady_clock::time_point now);
+};
+
+} // hyni
@@ -11,12 +11,45 @@
 
 #include "general_context.h"
 #include "response_utils.h"
+#include "perf_counters.h"
+#include "credential_provider.h"
+#include "schema_registry.h"
 #include <fstream>
 #include <filesystem>
 #include <algorithm>
 #include <sstream>
 
 namespace {
+size_t estimate_json_tokens(const nlohmann::json& value, const hyni::text_attachment_map& attachments) {
+    switch (value.type()) {
+    case nlohmann::json::value_t::object: {
+        size_t tokens = 0;
+        for (auto it = value.begin(); it != value.end(); ++it) {
+            tokens += hyni::prompt_minifier::estimate_tokens(it.key()) + estimate_json_tokens(it.value(), attachments);
+        }
+        return tokens;
+    }
+    case nlohmann::json::value_t::array: {
+        size_t tokens = 0;
+        for (const auto& element : value) {
+            tokens += estimate_json_tokens(element, attachments);
+        }
+        return tokens;
+    }
+    case nlohmann::json::value_t::string: {
+        const auto& text = value.get_ref<const std::string&>();
+        if (hyni::text_attachment::is_placeholder(text)) {
+            if (auto it = attachments.find(text); it != attachments.end()) {
+                return it->second->estimated_tokens();
+            }
+        }
+        return hyni::prompt_minifier::estimate_tokens(text);
+    }
+    default:
+        return 1;
+    }
+}
+
 void remove_nulls_recursive(nlohmann::json& j) {
     if (j.is_object()) {
         for (auto it = j.begin(); it != j.end(); ) {
@@ -47,91 +80,201 @@ general_context::general_context(const std::string& schema_path, const context_c
 }
 
 void general_context::load_schema(const std::string& schema_path) {
+    m_schema = std::make_shared<const nlohmann::json>(load_schema_file(schema_path));
+}
+
+namespace {
+
+nlohmann::json read_schema_json(const std::filesystem::path& schema_path) {
     std::ifstream file(schema_path);
     if (!file.is_open()) {
-        throw schema_exception("Failed to open schema file: " + schema_path);
+        throw schema_exception("Failed to open schema file: " + schema_path.string());
     }
 
     try {
-        file >> m_schema;
+        return nlohmann::json::parse(file);
     } catch (const nlohmann::json::parse_error& e) {
-        throw schema_exception("Failed to parse schema JSON: " + std::string(e.what()));
+        throw schema_exception("Failed to parse schema JSON at " + schema_path.string() + ": " + e.what());
+    }
+}
+
+// chain holds the files being resolved, derived first, for cycle detection
+nlohmann::json load_schema_chain(const std::filesystem::path& schema_path, const schema_registry* registry,
+                                 const general_context::schema_base_loader& base_loader,
+                                 std::vector<std::filesystem::path>& chain) {
+    auto canonical = std::filesystem::weakly_canonical(schema_path);
+    if (std::find(chain.begin(), chain.end(), canonical) != chain.end() ||
+        chain.size() >= general_context::MAX_SCHEMA_EXTENDS_DEPTH) {
+        throw schema_exception("Cyclic or too deep schema 'extends' chain at: " + schema_path.string());
+    }
+    chain.push_back(canonical);
+
+    nlohmann::json schema = read_schema_json(schema_path);
+    if (schema.is_object() && schema.contains("extends")) {
+        auto base_path = general_context::resolve_base_schema_path(
+            schema["extends"].get<std::string>(), schema_path, registry);
+        auto load = [&] { return load_schema_chain(base_path, registry, base_loader, chain); };
+        if (base_loader) {
+            schema = general_context::extend_schema(*base_loader(base_path, load), std::move(schema));
+        } else {
+            schema = general_context::extend_schema(load(), std::move(schema));
+        }
+    }
+
+    chain.pop_back();
+    return schema;
+}
+
+} // anonymous namespace
+
+nlohmann::json general_context::load_schema_file(const std::filesystem::path& schema_path,
+                                                 const schema_registry* registry,
+                                                 const schema_base_loader& base_loader) {
+    std::vector<std::filesystem::path> chain;
+    return load_schema_chain(schema_path, registry, base_loader, chain);
+}
+
+nlohmann::json general_context::extend_schema(const nlohmann::json& base, nlohmann::json derived) {
+    nlohmann::json merged = base;
+    derived.erase("extends");
+    merged.merge_patch(derived);
+    return merged;
+}
+
+std::filesystem::path general_context::resolve_base_schema_path(
+    const std::string& base, const std::filesystem::path& derived_path, const schema_registry* registry) {
+    if (base.empty()) {
+        throw schema_exception("Empty 'extends' in schema: " + derived_path.string());
+    }
+
+    std::filesystem::path path(base);
+    if (registry && base.find('/') == std::string::npos && !path.has_extension()) {
+        auto registered = registry->resolve_schema_path(base);
+        if (std::filesystem::exists(registered)) {
+            return registered;
+        }
     }
+    if (!path.has_extension()) {
+        path += ".json";
+    }
+    return std::filesystem::absolute(path.is_absolute() ? path : derived_path.parent_path() / path);
 }
 
 void general_context::validate_schema() {
+    if (!m_schema->is_object()) {
+        throw schema_exception("Schema must be a JSON object");
+    }
+
     // Check required top-level fields
     std::vector<std::string> required_fields = {"provider", "api", "request_template",
                                                 "message_format", "response_format"};
 
     for (const auto& field : required_fields) {
-        if (!m_schema.contains(field)) {
+        if (!m_schema->contains(field)) {
             throw schema_exception("Missing required schema field: " + field);
         }
     }
 
     // Validate API configuration
-    if (!m_schema["api"].contains("endpoint")) {
+    const auto& api = m_schema->at("api");
+    if (api.contains("endpoints")) {
+        const auto& endpoints = api.at("endpoints");
+        if (!endpoints.is_array() || endpoints.empty()) {
+            throw schema_exception("API endpoints must be a non-empty array");
+        }
+        for (const auto& endpoint : endpoints) {
+            if (!endpoint.is_object() || !endpoint.contains("url") || !endpoint.at("url").is_string()) {
+                throw schema_exception("Each API endpoint needs a url");
+            }
+            if (endpoint.contains("weight") &&
+                (!endpoint.at("weight").is_number() || endpoint.at("weight").get<double>() <= 0)) {
+                throw schema_exception("API endpoint weight must be a positive number");
+            }
+        }
+    } else if (!api.contains("endpoint")) {
         throw schema_exception("Missing API endpoint in schema");
     }
+    if (m_schema->at("api").contains("unix_socket") && !m_schema->at("api").at("unix_socket").is_string()) {
+        throw schema_exception("API unix_socket must be a path string");
+    }
+    if (m_schema->at("api").contains("http_version")) {
+        static const std::unordered_set<std::string> versions = {"auto", "1.1", "2", "3"};
+        const auto& version = m_schema->at("api").at("http_version");
+        if (!version.is_string() || !versions.contains(version.get<std::string>())) {
+            throw schema_exception("API http_version must be one of \"auto\", \"1.1\", \"2\" or \"3\"");
+        }
+    }
+    if (m_schema->at("api").contains("stream_timeouts")) {
+        const auto& timeouts = m_schema->at("api").at("stream_timeouts");
+        if (!timeouts.is_object() ||
+            !std::all_of(timeouts.begin(), timeouts.end(), [](const auto& value) { return value.is_number_integer() && value >= 0; })) {
+            throw schema_exception("API stream_timeouts must be an object of non-negative integers");
+        }
+    }
 
     // Validate message format
-    if (!m_schema["message_format"].contains("structure") ||
-        !m_schema["message_format"].contains("content_types")) {
+    if (!m_schema->at("message_format").contains("structure") ||
+        !m_schema->at("message_format").contains("content_types")) {
         throw schema_exception("Invalid message format in schema");
     }
 
     // Validate response format
-    if (!m_schema["response_format"].contains("success") ||
-        !m_schema["response_format"]["success"].contains("text_path")) {
+    if (!m_schema->at("response_format").contains("success") ||
+        !m_schema->at("response_format").at("success").contains("text_path")) {
         throw schema_exception("Invalid response format in schema");
     }
 }
 
 void general_context::cache_schema_elements() {
     // Cache provider info
-    m_provider_name = m_schema["provider"]["name"].get<std::string>();
-    m_endpoint = m_schema["api"]["endpoint"].get<std::string>();
-
-    if (m_schema.contains("message_roles")) {
-        for (const auto& role : m_schema["message_roles"]) {
+    m_provider_name = m_schema->at("provider").at("name").get<std::string>();
+    m_endpoints = endpoint_config::from_schema(*m_schema);
+    // With a list, requests are addressed to the first entry and the selector spreads them
+    m_endpoint = m_endpoints.front().url;
+    m_unix_socket_path = m_schema->at("api").value("unix_socket", "");
+    m_http_version = m_schema->at("api").value("http_version", "auto");
+    credential_provider::instance().register_schema(*m_schema);
+
+    if (m_schema->contains("message_roles")) {
+        for (const auto& role : m_schema->at("message_roles")) {
             m_valid_roles.insert(role.get<std::string>());
         }
     }
 
     // Cache request template
-    m_request_template = m_schema["request_template"];
+    m_request_template = m_schema->at("request_template");
 
     // Cache response paths
-    m_text_path = parse_json_path(m_schema["response_format"]["success"]["text_path"]);
-    if (m_schema["response_format"].contains("error") &&
-        m_schema["response_format"]["error"].contains("error_path")) {
-        m_error_path = parse_json_path(m_schema["response_format"]["error"]["error_path"]);
+    m_text_path = parse_json_path(m_schema->at("response_format").at("success").at("text_path"));
+    if (m_schema->at("response_format").contains("error") &&
+        m_schema->at("response_format").at("error").contains("error_path")) {
+        m_error_path = parse_json_path(m_schema->at("response_format").at("error").at("error_path"));
     }
 
     // Cache message formats
-    m_message_structure = m_schema["message_format"]["structure"];
-    if (m_schema["message_format"]["content_types"].contains("text")) {
-        m_text_content_format = m_schema["message_format"]["content_types"]["text"];
+    m_message_structure = m_schema->at("message_format").at("structure");
+    if (m_schema->at("message_format").at("content_types").contains("text")) {
+        m_text_content_format = m_schema->at("message_format").at("content_types").at("text");
     }
-    if (m_schema["message_format"]["content_types"].contains("image")) {
-        m_image_content_format = m_schema["message_format"]["content_types"]["image"];
+    if (m_schema->at("message_format").at("content_types").contains("image")) {
+        m_image_content_format = m_schema->at("message_format").at("content_types").at("image");
     }
+    m_image_limits = image_limits::from_schema(*m_schema);
 }
 
 void general_context::build_headers() {
     m_headers.clear();
 
     // 1. Process required headers
-    if (m_schema.contains("headers") && m_schema["headers"].contains("required")) {
-        for (const auto& [key, value] : m_schema["headers"]["required"].items()) {
+    if (m_schema->contains("headers") && m_schema->at("headers").contains("required")) {
+        for (const auto& [key, value] : m_schema->at("headers").at("required").items()) {
             std::string header_value = value.get<std::string>();
 
-            if (m_schema.contains("authentication") &&
-                m_schema["authentication"].contains("key_placeholder")) {
+            if (m_schema->contains("authentication") &&
+                m_schema->at("authentication").contains("key_placeholder")) {
 
                 const std::string placeholder =
-                    m_schema["authentication"]["key_placeholder"].get<std::string>();
+                    m_schema->at("authentication").at("key_placeholder").get<std::string>();
 
                 // Just replace the placeholder with the API key
                 // The schema should already have the correct format with prefix
@@ -147,8 +290,8 @@ void general_context::build_headers() {
     }
 
     // 2. Process optional headers (only if values are provided)
-    if (m_schema.contains("headers") && m_schema["headers"].contains("optional")) {
-        for (const auto& [key, value] : m_schema["headers"]["optional"].items()) {
+    if (m_schema->contains("headers") && m_schema->at("headers").contains("optional")) {
+        for (const auto& [key, value] : m_schema->at("headers").at("optional").items()) {
             if (!value.is_null() && value.is_string() && !value.get<std::string>().empty()) {
                 m_headers[key] = value.get<std::string>();
             }
@@ -157,15 +300,18 @@ void general_context::build_headers() {
 }
 
 void general_context::apply_defaults() {
-    if (m_schema.contains("models") && m_schema["models"].contains("default")) {
-        m_model_name = m_schema["models"]["default"].get<std::string>();
+    if (m_schema->contains("models") && m_schema->at("models").contains("default")) {
+        m_model_name = m_schema->at("models").at("default").get<std::string>();
     }
 }
 
-general_context& general_context::set_model(const std::string& model) {
+general_context& general_context::set_model(const std::string& model_name) {
+    std::string repaired;
+    const std::string& model = ingest_utf8(model_name, repaired, "Model name");
+
     // Validate model if available models are specified
-    if (m_schema.contains("models") && m_schema["models"].contains("available")) {
-        auto available_models = m_schema["models"]["available"];
+    if (m_schema->contains("models") && m_schema->at("models").contains("available")) {
+        auto available_models = m_schema->at("models").at("available");
         bool found = false;
         for (const auto& available_model : available_models) {
             if (available_model.get<std::string>() == model) {
@@ -187,7 +333,8 @@ general_context& general_context::set_system_message(const std::string& system_t
         throw validation_exception("Provider '" + m_provider_name +
                                    "' does not support system messages");
     }
-    m_system_message = system_text;
+    std::string repaired;
+    m_system_message = ingest_utf8(system_text, repaired, "System message");
     return *this;
 }
 
@@ -196,7 +343,11 @@ general_context& general_context::set_parameter(const std::string& key,
     if (m_config.enable_validation) {
         validate_parameter(key, value);
     }
-    m_parameters[key] = value;
+    std::string repaired;
+    const std::string& name = ingest_utf8(key, repaired, "Parameter name");
+    nlohmann::json checked = value;
+    ingest_utf8(checked, "Parameter value");
+    m_parameters[name] = std::move(checked);
     return *this;
 }
 
@@ -231,14 +382,97 @@ general_context &general_context::add_assistant_message(const std::string& conte
 general_context &general_context::add_message(const std::string& role, const std::string& content,
                                  const std::optional<std::string>& media_type,
                                  const std::optional<std::string>& media_data) {
-    auto message = create_message(role, content, media_type, media_data);
+    std::string repaired;
+    const std::string* text = &ingest_utf8(content, repaired, "Message content");
+
+    std::optional<minify_result> minified;
+    if (m_config.enable_prompt_minification && !text->empty()) {
+        minified = m_minifier.minify_tentative(*text, m_config.minification);
+        text = &minified->text;
+    }
+
+    auto message = create_message(role, *text, media_type, media_data);
     if (m_config.enable_validation) {
         validate_message(message);
     }
     m_messages.push_back(message);
+
+    // Only blocks of messages actually added count as sent
+    if (minified) {
+        m_minifier.commit(*minified);
+        m_minification_stats.messages++;
+        m_minification_stats.tokens_before += minified->tokens_before;
+        m_minification_stats.tokens_after += minified->tokens_after;
+        m_minification_stats.last_tokens_before = minified->tokens_before;
+        m_minification_stats.last_tokens_after = minified->tokens_after;
+    }
+    return *this;
+}
+
+general_context& general_context::add_attachment(const std::string& role,
+                                                 std::shared_ptr<const text_attachment> attachment) {
+    if (!attachment) {
+        throw validation_exception("Attachment cannot be null");
+    }
+    if (m_config.utf8_handling == utf8_policy::validate && !attachment->is_valid_utf8()) {
+        throw validation_exception("Attachment " + attachment->name() + " is not valid UTF-8 at byte " +
+                                   std::to_string(utf8::find_invalid(attachment->view())));
+    }
+
+    auto message = create_message(role, attachment->placeholder());
+    if (m_config.enable_validation) {
+        validate_message(message);
+    }
+    m_messages.push_back(std::move(message));
+    m_attachments.emplace(attachment->placeholder(), attachment);
     return *this;
 }
 
+// Text with invalid UTF-8 would make serialization throw deep inside request
+// building; it is repaired or rejected here instead. Returns text itself when
+// it is fine, else the repaired copy stored in repaired.
+const std::string& general_context::ingest_utf8(const std::string& text, std::string& repaired,
+                                                const char* what) const {
+    if (m_config.utf8_handling == utf8_policy::none || utf8::is_valid(text)) {
+        return text;
+    }
+    if (m_config.utf8_handling == utf8_policy::validate) {
+        throw validation_exception(std::string(what) + " is not valid UTF-8 at byte " +
+                                   std::to_string(utf8::find_invalid(text)));
+    }
+    repaired = utf8::repair(text);
+    return repaired;
+}
+
+void general_context::ingest_utf8(nlohmann::json& value, const char* what) const {
+    if (value.is_string()) {
+        std::string repaired;
+        const auto& text = value.get_ref<const std::string&>();
+        if (&ingest_utf8(text, repaired, what) == &repaired) {
+            value = std::move(repaired);
+        }
+    } else if (value.is_array()) {
+        for (auto& element : value) {
+            ingest_utf8(element, what);
+        }
+    } else if (value.is_object()) {
+        // Keys cannot be changed in place; rebuild the object only if one needs repair
+        bool keys_valid = true;
+        for (auto it = value.begin(); it != value.end(); ++it) {
+            std::string repaired;
+            keys_valid = keys_valid && &ingest_utf8(it.key(), repaired, what) == &it.key();
+            ingest_utf8(it.value(), what);
+        }
+        if (!keys_valid) {
+            nlohmann::json rebuilt = nlohmann::json::object();
+            for (auto& [key, element] : value.items()) {
+                rebuilt[utf8::repair(key)] = std::move(element);
+            }
+            value = std::move(rebuilt);
+        }
+    }
+}
+
 nlohmann::json general_context::create_message(const std::string& role, const std::string& content,
                                               const std::optional<std::string>& media_type,
                                               const std::optional<std::string>& media_data) {
@@ -246,10 +480,10 @@ nlohmann::json general_context::create_message(const std::string& role, const st
 
     // Check if there's a specific structure for this role
     std::string structure_key = role + "_structure";
-    if (m_schema.contains("message_format") &&
-        m_schema["message_format"].contains(structure_key)) {
+    if (m_schema->contains("message_format") &&
+        m_schema->at("message_format").contains(structure_key)) {
         // Use role-specific structure (e.g., system_structure for OpenAI)
-        message = m_schema["message_format"][structure_key];
+        message = m_schema->at("message_format").at(structure_key);
 
         // Replace placeholders
         if (message.contains("role") && message["role"].is_string() &&
@@ -320,6 +554,7 @@ nlohmann::json general_context::create_image_content(const std::string& media_ty
 
     // Get base64 data
     std::string base64_data;
+    std::string effective_media_type = media_type;
     if (is_base64_encoded(data)) {
         // Already base64 encoded
         if (data.starts_with("data:")) {
@@ -327,12 +562,26 @@ nlohmann::json general_context::create_image_content(const std::string& media_ty
             size_t comma_pos = data.find(',');
             if (comma_pos != std::string::npos) {
                 base64_data = data.substr(comma_pos + 1);
+                // A preprocessed image may have changed format; trust the URI
+                size_t semicolon_pos = data.find(';');
+                if (semicolon_pos != std::string::npos && semicolon_pos < comma_pos) {
+                    effective_media_type = data.substr(5, semicolon_pos - 5);
+                }
             } else {
                 base64_data = data;
             }
         } else {
             base64_data = data;
         }
+    } else if (m_config.enable_image_preprocessing) {
+        // Assume it's a file path; downscale and recompress before encoding
+        auto image = media_preprocessor::instance().process_file(data, media_type, m_image_limits);
+        if (m_image_limits.max_bytes > 0 && image.data.size() > m_image_limits.max_bytes) {
+            throw std::runtime_error("Image file too large: " + std::to_string(image.data.size()) +
+                                     " bytes after preprocessing");
+        }
+        base64_data = response_utils::base64_encode(image.data);
+        effective_media_type = image.media_type;
     } else {
         // Assume it's a file path and encode it
         base64_data = encode_image_to_base64(data);
@@ -340,15 +589,17 @@ nlohmann::json general_context::create_image_content(const std::string& media_ty
 
     // Now apply the format based on the schema template
     apply_template_values(content, {
-        {"<IMAGE_URL>", "data:" + media_type + ";base64," + base64_data},
+        {"<IMAGE_URL>", "data:" + effective_media_type + ";base64," + base64_data},
         {"<BASE64_DATA>", base64_data},
-        {"<MEDIA_TYPE>", media_type}
+        {"<MEDIA_TYPE>", effective_media_type}
     });
 
     return content;
 }
 
 nlohmann::json general_context::build_request(bool streaming) {
+    HYNI_PERF_PROBE("general_context::build_request");
+
     nlohmann::json request = m_request_template;
     nlohmann::json messages_array = nlohmann::json::array();
     for (const auto& msg : m_messages) {
@@ -393,7 +644,7 @@ nlohmann::json general_context::build_request(bool streaming) {
     // Set streaming: user parameter takes precedence over function parameter
     if (m_parameters.find("stream") == m_parameters.end()) {
         // User hasn't explicitly set stream parameter, use function parameter
-        if (streaming && m_schema["features"]["streaming"].get<bool>()) {
+        if (streaming && m_schema->at("features").at("streaming").get<bool>()) {
             request["stream"] = true;
         } else {
             request["stream"] = false;
@@ -405,6 +656,24 @@ nlohmann::json general_context::build_request(bool streaming) {
     return request;
 }
 
+nlohmann::json general_context::build_continuation_request(nlohmann::json request, const std::string& partial,
+                                                          const std::string& continuation_prompt) {
+    if (supports_assistant_prefill()) {
+        // The model continues the final assistant turn; providers reject trailing whitespace there
+        const size_t end = partial.find_last_not_of(" \t\r\n");
+        const std::string prefill = partial.substr(0, end == std::string::npos ? 0 : end + 1);
+        request["messages"].push_back(create_message("assistant", prefill));
+    } else {
+        request["messages"].push_back(create_message("assistant", partial));
+        request["messages"].push_back(create_message("user", continuation_prompt));
+    }
+    return request;
+}
+
+size_t general_context::estimate_request_tokens() {
+    return estimate_json_tokens(build_request(), m_attachments);
+}
+
 std::string general_context::extract_text_response(const nlohmann::json& response) {
     try {
         nlohmann::json text_node = resolve_path(response, m_text_path);
@@ -417,7 +686,7 @@ std::string general_context::extract_text_response(const nlohmann::json& respons
 nlohmann::json general_context::extract_full_response(const nlohmann::json& response) {
     try {
         std::vector<std::string> content_path = parse_json_path(
-            m_schema["response_format"]["success"]["content_path"]);
+            m_schema->at("response_format").at("success").at("content_path"));
         return resolve_path(response, content_path);
     } catch (const std::exception& e) {
         throw std::runtime_error("Failed to extract full response: " + std::string(e.what()));
@@ -475,8 +744,8 @@ std::vector<std::string> general_context::parse_json_path(const nlohmann::json&
 
 std::vector<std::string> general_context::get_supported_models() const {
     std::vector<std::string> models;
-    if (m_schema.contains("models") && m_schema["models"].contains("available")) {
-        for (const auto& model : m_schema["models"]["available"]) {
+    if (m_schema->contains("models") && m_schema->at("models").contains("available")) {
+        for (const auto& model : m_schema->at("models").at("available")) {
             models.push_back(model.get<std::string>());
         }
     }
@@ -484,8 +753,8 @@ std::vector<std::string> general_context::get_supported_models() const {
 }
 
 bool general_context::supports_multimodal() const noexcept {
-    auto multimodal_it = m_schema.find("multimodal");
-    if (multimodal_it != m_schema.end() && multimodal_it->is_object()) {
+    auto multimodal_it = m_schema->find("multimodal");
+    if (multimodal_it != m_schema->end() && multimodal_it->is_object()) {
         auto supported_it = multimodal_it->find("supported");
         if (supported_it != multimodal_it->end() && supported_it->is_boolean()) {
             return supported_it->get<bool>();
@@ -495,8 +764,8 @@ bool general_context::supports_multimodal() const noexcept {
 }
 
 bool general_context::supports_streaming() const noexcept {
-    auto features_it = m_schema.find("features");
-    if (features_it != m_schema.end() && features_it->is_object()) {
+    auto features_it = m_schema->find("features");
+    if (features_it != m_schema->end() && features_it->is_object()) {
         auto streaming_it = features_it->find("streaming");
         if (streaming_it != features_it->end() && streaming_it->is_boolean()) {
             return streaming_it->get<bool>();
@@ -505,9 +774,20 @@ bool general_context::supports_streaming() const noexcept {
     return false;
 }
 
+bool general_context::supports_assistant_prefill() const noexcept {
+    auto features_it = m_schema->find("features");
+    if (features_it != m_schema->end() && features_it->is_object()) {
+        auto prefill_it = features_it->find("assistant_prefill");
+        if (prefill_it != features_it->end() && prefill_it->is_boolean()) {
+            return prefill_it->get<bool>();
+        }
+    }
+    return false;
+}
+
 bool general_context::supports_system_messages() const noexcept {
-    auto system_it = m_schema.find("system_message");
-    if (system_it != m_schema.end() && system_it->is_object()) {
+    auto system_it = m_schema->find("system_message");
+    if (system_it != m_schema->end() && system_it->is_object()) {
         auto supported_it = system_it->find("supported");
         if (supported_it != system_it->end() && supported_it->is_boolean()) {
             return supported_it->get<bool>();
@@ -533,8 +813,8 @@ std::vector<std::string> general_context::get_validation_errors() const {
     }
 
     // Validate message roles
-    if (m_schema.contains("validation") && m_schema["validation"].contains("message_validation")) {
-        auto validation = m_schema["validation"]["message_validation"];
+    if (m_schema->contains("validation") && m_schema->at("validation").contains("message_validation")) {
+        auto validation = m_schema->at("validation").at("message_validation");
 
         if (validation.contains("last_message_role")) {
             std::string required_role = validation["last_message_role"].get<std::string>();
@@ -577,20 +857,20 @@ void general_context::validate_parameter(const std::string& key,
                                          const nlohmann::json& value) const {
     if (value.is_null()) {
         // Some parameters allow null
-        if (m_schema.contains("parameters") &&
-            m_schema["parameters"].contains(key) &&
-            m_schema["parameters"][key].contains("default") &&
-            m_schema["parameters"][key]["default"].is_null()) {
+        if (m_schema->contains("parameters") &&
+            m_schema->at("parameters").contains(key) &&
+            m_schema->at("parameters").at(key).contains("default") &&
+            m_schema->at("parameters").at(key).at("default").is_null()) {
             return; // null is allowed for this parameter
         }
         throw validation_exception("Parameter '" + key + "' cannot be null");
     }
 
-    if (!m_schema.contains("parameters") || !m_schema["parameters"].contains(key)) {
+    if (!m_schema->contains("parameters") || !m_schema->at("parameters").contains(key)) {
         return; // Parameter not defined in schema
     }
 
-    auto param_def = m_schema["parameters"][key];
+    auto param_def = m_schema->at("parameters").at(key);
 
     if (param_def.contains("type") && param_def["type"].is_array()) {
         // Multiple types allowed
@@ -804,6 +1084,10 @@ void general_context::reset() {
 
 void general_context::clear_user_messages() noexcept {
     m_messages.clear();
+    m_attachments.clear();
+    // Blocks of the cleared messages are no longer sent, so they are not duplicates
+    m_minifier.reset();
+    m_minification_stats = {};
 }
 
 void general_context::clear_system_message() noexcept {
@@ -12,6 +12,11 @@
 #pragma once
 
 #include <nlohmann/json.hpp>
+#include "endpoint_selector.h"
+#include "media_preprocessor.h"
+#include "prompt_minifier.h"
+#include "text_attachment.h"
+#include "utf8.h"
 #include <string>
 #include <vector>
 #include <optional>
@@ -19,9 +24,13 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <stdexcept>
+#include <filesystem>
+#include <functional>
 
 namespace hyni {
 
+class schema_registry;
+
 /**
  * @brief Custom exception for schema-related errors
  */
@@ -53,9 +62,61 @@ struct context_config {
     bool enable_streaming_support = false;  ///< Whether to enable streaming support
     bool enable_validation = true;          ///< Whether to enable validation
     bool enable_caching = true;             ///< Whether to enable caching
+    bool enable_image_preprocessing = false; ///< Downscale/recompress images to the schema's multimodal limits
+    bool enable_prompt_minification = false; ///< Minify message text in add_message, see prompt_minifier
+    minify_options minification;             ///< Passes run when prompt minification is enabled
+    utf8_policy utf8_handling = utf8_policy::repair; ///< Invalid UTF-8 in messages, system text, model and parameters
     std::optional<int> default_max_tokens;  ///< Default maximum tokens for responses
     std::optional<double> default_temperature; ///< Default temperature for responses
     std::unordered_map<std::string, nlohmann::json> custom_parameters; ///< Custom parameters
+
+    bool operator==(const context_config&) const = default;
+};
+
+/**
+ * @brief Hash of all context_config fields, consistent with operator==
+ */
+struct context_config_hash {
+    size_t operator()(const context_config& config) const noexcept {
+        auto combine = [](size_t seed, size_t value) {
+            return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+        };
+
+        size_t seed = (config.enable_streaming_support ? 1u : 0u) |
+                      (config.enable_validation ? 2u : 0u) |
+                      (config.enable_caching ? 4u : 0u) |
+                      (config.enable_image_preprocessing ? 8u : 0u) |
+                      (config.enable_prompt_minification ? 16u : 0u);
+        seed = combine(seed, static_cast<size_t>(config.utf8_handling));
+        seed = combine(seed, config.default_max_tokens ? std::hash<int>{}(*config.default_max_tokens) : 0);
+        seed = combine(seed, config.default_temperature ? std::hash<double>{}(*config.default_temperature) : 0);
+
+        const auto& minify = config.minification;
+        seed = combine(seed, (minify.normalize_whitespace ? 1u : 0u) | (minify.collapse_repeated_lines ? 2u : 0u) |
+                             (minify.remove_fillers ? 4u : 0u) | (minify.dedup_blocks ? 8u : 0u));
+        seed = combine(seed, minify.min_block_chars);
+        for (const auto& word : minify.filler_words) {
+            seed = combine(seed, std::hash<std::string>{}(word));
+        }
+
+        // Unordered map: combine entries order-independently
+        size_t parameters = 0;
+        for (const auto& [key, value] : config.custom_parameters) {
+            parameters += combine(std::hash<std::string>{}(key), std::hash<nlohmann::json>{}(value));
+        }
+        return combine(seed, parameters);
+    }
+};
+
+/**
+ * @brief Token savings of prompt minification, estimated with prompt_minifier::estimate_tokens
+ */
+struct minification_stats {
+    size_t messages = 0;        ///< Messages minified since the last reset
+    size_t tokens_before = 0;   ///< Estimated tokens of those messages as given
+    size_t tokens_after = 0;    ///< Estimated tokens actually added
+    size_t last_tokens_before = 0;
+    size_t last_tokens_after = 0;
 };
 
 /**
@@ -98,18 +159,85 @@ public:
      */
     explicit general_context(const nlohmann::json& schema,
                              const context_config& config = {})
-        : m_schema(schema), m_config(config) {
+        : general_context(std::make_shared<const nlohmann::json>(schema), config) {}
+
+    /**
+     * @brief Constructs a general context sharing an immutable, pre-loaded schema
+     * @param schema Schema shared with other contexts (e.g. from context_factory's cache)
+     * @param config Configuration options
+     * @throws schema_exception If the schema is invalid
+     */
+    explicit general_context(std::shared_ptr<const nlohmann::json> schema,
+                             const context_config& config = {})
+        : m_schema(std::move(schema)), m_config(config) {
+        if (!m_schema) {
+            throw schema_exception("Schema cannot be null");
+        }
         validate_schema();
         cache_schema_elements();
         apply_defaults();
         build_headers();
     }
 
+    /**
+     * @brief Supplies the resolved schema of a base, e.g. from a cache
+     *
+     * Called with the base's path and a function that resolves it, including
+     * its own bases, from disk. Returns that function's result or an equivalent
+     * cached schema.
+     */
+    using schema_base_loader = std::function<std::shared_ptr<const nlohmann::json>(
+        const std::filesystem::path& base_path, const std::function<nlohmann::json()>& load)>;
+
+    /**
+     * @brief Loads a schema file, resolving its `extends` chain
+     *
+     * A schema with `"extends": "<name>"` is applied on top of its base, see
+     * resolve_base_schema_path(), as a JSON merge patch (RFC 7386): objects merge
+     * recursively, arrays and scalars replace, and `null` removes a key from the base.
+     * context_factory loads through here too, so a provider resolves to the same
+     * schema either way.
+     *
+     * @param schema_path The schema file
+     * @param registry Optional registry for bases named by provider
+     * @param base_loader Optional hook for each base, used by context_factory to cache them
+     * @throws schema_exception If a file cannot be read or parsed, or the chain is cyclic
+     *         or deeper than MAX_SCHEMA_EXTENDS_DEPTH
+     */
+    [[nodiscard]] static nlohmann::json load_schema_file(const std::filesystem::path& schema_path,
+                                                         const schema_registry* registry = nullptr,
+                                                         const schema_base_loader& base_loader = {});
+
+    /**
+     * @brief Applies a derived schema on top of its base
+     *
+     * The result is a full copy: general_context reads its schema as one JSON
+     * document, so the base is not shared with the derived schema. Schemas are a
+     * few KB, and context_factory parses each file once.
+     * @return The merged schema, without the `extends` key
+     */
+    [[nodiscard]] static nlohmann::json extend_schema(const nlohmann::json& base, nlohmann::json derived);
+
+    /**
+     * @brief Resolves a schema's `extends` value to an absolute path
+     *
+     * A bare provider name is looked up in registry when one is given and it has
+     * that provider; otherwise the value names a file relative to the derived
+     * schema, with `.json` added when it has no extension.
+     */
+    [[nodiscard]] static std::filesystem::path resolve_base_schema_path(
+        const std::string& base, const std::filesystem::path& derived_path,
+        const schema_registry* registry = nullptr);
+
+    // Guards against runaway `extends` chains; real hierarchies are one or two levels deep
+    static constexpr size_t MAX_SCHEMA_EXTENDS_DEPTH = 8;
+
     /**
      * @brief Sets the model to use for requests
      * @param model The model name
      * @return Reference to this context for method chaining
-     * @throws validation_exception If the model is not supported and validation is enabled
+     * @throws validation_exception If the model is not supported and validation is enabled,
+     *         or is not valid UTF-8 with utf8_policy::validate
      */
     general_context& set_model(const std::string& model);
 
@@ -117,7 +245,8 @@ public:
      * @brief Sets the system message for the conversation
      * @param system_text The system message text
      * @return Reference to this context for method chaining
-     * @throws validation_exception If system messages are not supported and validation is enabled
+     * @throws validation_exception If system messages are not supported and validation is enabled,
+     *         or the text is not valid UTF-8 with utf8_policy::validate
      */
     general_context& set_system_message(const std::string& system_text);
 
@@ -126,7 +255,8 @@ public:
      * @param key The parameter key
      * @param value The parameter value
      * @return Reference to this context for method chaining
-     * @throws validation_exception If the parameter is invalid and validation is enabled
+     * @throws validation_exception If the parameter is invalid and validation is enabled,
+     *         or a string in it is not valid UTF-8 with utf8_policy::validate
      */
     general_context& set_parameter(const std::string& key, const nlohmann::json& value);
 
@@ -168,24 +298,87 @@ public:
 
     /**
      * @brief Adds a message with the specified role to the conversation
+     *
+     * The text is checked against context_config::utf8_handling first, so that
+     * build_request() never carries invalid UTF-8. With
+     * context_config::enable_prompt_minification it is then minified;
+     * get_minification_stats() reports the token counts before and after.
+     *
      * @param role The message role (e.g., "user", "assistant", "system")
      * @param content The message content
      * @param media_type Optional media type for multimodal content
      * @param media_data Optional media data for multimodal content
      * @return Reference to this context for method chaining
-     * @throws validation_exception If the message is invalid and validation is enabled
+     * @throws validation_exception If the message is invalid and validation is enabled,
+     *         or the text is not valid UTF-8 with utf8_policy::validate
      */
     general_context& add_message(const std::string& role, const std::string& content,
                     const std::optional<std::string>& media_type = {},
                     const std::optional<std::string>& media_data = {});
 
+    /**
+     * @brief Adds a message whose text is a file- or buffer-backed attachment
+     *
+     * The message holds the attachment's placeholder instead of its text, so
+     * build_request() stays cheap however large the attachment is; the text is
+     * escaped into the body when the request is serialized with
+     * json_serializer::dump() and get_attachments(), as chat_api does.
+     * The context keeps the attachment alive until the messages are cleared.
+     * Attachments are neither minified nor repaired here; invalid UTF-8 is
+     * replaced with U+FFFD when serialized, except with utf8_policy::validate.
+     *
+     * @param role The message role
+     * @param attachment The message text, see text_attachment::map_file()
+     * @return Reference to this context for method chaining
+     * @throws validation_exception If attachment is null, the message is invalid and validation
+     *         is enabled, or the text is not valid UTF-8 with utf8_policy::validate
+     */
+    general_context& add_attachment(const std::string& role, std::shared_ptr<const text_attachment> attachment);
+
+    /**
+     * @brief Adds a user message whose text is an attachment, see add_attachment()
+     */
+    general_context& add_user_attachment(std::shared_ptr<const text_attachment> attachment)
+    { return add_attachment("user", std::move(attachment)); }
+
     /**
      * @brief Builds a request object based on the current context
+     *
+     * Attachment messages hold only their placeholder. Serialize the request
+     * with json_serializer::dump(request, mode, &get_attachments()); with
+     * nlohmann::json::dump() the placeholders would be sent instead of the text.
+     *
      * @param streaming Whether to enable streaming for this request
      * @return JSON object representing the request
      */
     [[nodiscard]] nlohmann::json build_request(bool streaming = false);
 
+    /**
+     * @brief Builds the request that continues a response cut off after partial
+     *
+     * With assistant prefill (`features.assistant_prefill`, e.g. Claude) partial
+     * becomes the final assistant turn, without trailing whitespace, and the
+     * model carries on from its last word. Otherwise partial is sent as an
+     * assistant turn followed by continuation_prompt as a user turn, and the
+     * reply may repeat the end of partial.
+     *
+     * @param request The request that was cut off, from build_request()
+     * @param partial The text received before the response broke off
+     * @param continuation_prompt User turn asking to continue, without prefill
+     * @return request with the continuation turns appended to its messages
+     */
+    [[nodiscard]] nlohmann::json build_continuation_request(nlohmann::json request, const std::string& partial,
+                                                            const std::string& continuation_prompt);
+
+    /**
+     * @brief Estimates the prompt tokens of build_request()
+     *
+     * Sums prompt_minifier::estimate_tokens over the request's keys and strings;
+     * attachments are counted through text_attachment::estimated_tokens()
+     * without being copied.
+     */
+    [[nodiscard]] size_t estimate_request_tokens();
+
     /**
      * @brief Extracts the text response from a JSON response
      * @param response The JSON response from the API
@@ -240,7 +433,17 @@ public:
      * @brief Gets the schema used by this context
      * @return The schema as JSON
      */
-    [[nodiscard]] const nlohmann::json& get_schema() const noexcept { return m_schema; }
+    [[nodiscard]] const nlohmann::json& get_schema() const noexcept { return *m_schema; }
+
+    /**
+     * @brief Gets the schema instance, for building another context that shares it
+     */
+    [[nodiscard]] const std::shared_ptr<const nlohmann::json>& get_shared_schema() const noexcept { return m_schema; }
+
+    /**
+     * @brief Gets the configuration the context was created with
+     */
+    [[nodiscard]] const context_config& get_config() const noexcept { return m_config; }
 
     /**
      * @brief Gets the provider name
@@ -248,12 +451,36 @@ public:
      */
     [[nodiscard]] const std::string& get_provider_name() const noexcept { return m_provider_name; }
 
+    /**
+     * @brief Gets the model used for requests
+     * @return The model name, empty if the schema has no default and none was set
+     */
+    [[nodiscard]] const std::string& get_model() const noexcept { return m_model_name; }
+
     /**
      * @brief Gets the API endpoint
      * @return The API endpoint URL
      */
     [[nodiscard]] const std::string& get_endpoint() const noexcept { return m_endpoint; }
 
+    /**
+     * @brief Gets every endpoint the provider can be reached at
+     * @return The `api.endpoints` list, or just `api.endpoint` with weight 1
+     */
+    [[nodiscard]] const std::vector<endpoint_config>& get_endpoints() const noexcept { return m_endpoints; }
+
+    /**
+     * @brief Gets the Unix domain socket the endpoint is reached through
+     * @return The `api.unix_socket` path, or an empty string to connect over TCP
+     */
+    [[nodiscard]] const std::string& get_unix_socket_path() const noexcept { return m_unix_socket_path; }
+
+    /**
+     * @brief Gets the HTTP version requested by the schema
+     * @return The `api.http_version` value ("auto", "1.1", "2" or "3"), "auto" if not set
+     */
+    [[nodiscard]] const std::string& get_http_version() const noexcept { return m_http_version; }
+
     /**
      * @brief Gets the HTTP headers for API requests
      * @return Map of header names to values
@@ -279,6 +506,12 @@ public:
      */
     [[nodiscard]] bool supports_streaming() const noexcept;
 
+    /**
+     * @brief Checks if the provider continues a final assistant message (prefill)
+     * @return True if `features.assistant_prefill` is set, false otherwise
+     */
+    [[nodiscard]] bool supports_assistant_prefill() const noexcept;
+
     /**
      * @brief Checks if the provider supports system messages
      * @return True if system messages are supported, false otherwise
@@ -304,6 +537,13 @@ public:
     [[nodiscard]] const std::unordered_map<std::string, nlohmann::json>&
     get_parameters() const noexcept { return m_parameters; }
 
+    /**
+     * @brief Gets the system message
+     * @return The system message, empty if none is set
+     */
+    [[nodiscard]] const std::optional<std::string>& get_system_message() const noexcept
+    { return m_system_message; }
+
     /**
      * @brief Gets a parameter value by key
      * @param key The parameter key
@@ -360,6 +600,28 @@ public:
     [[nodiscard]] const std::vector<nlohmann::json>& get_messages() const noexcept
     { return m_messages; }
 
+    /**
+     * @brief Gets the attachments referenced by the messages
+     * @return Map to pass to json_serializer::dump() along with build_request()
+     */
+    [[nodiscard]] const text_attachment_map& get_attachments() const noexcept
+    { return m_attachments; }
+
+    /**
+     * @brief Gets the token savings of prompt minification
+     * @return Totals since the messages were last cleared, and the last message's counts
+     */
+    [[nodiscard]] const minification_stats& get_minification_stats() const noexcept
+    { return m_minification_stats; }
+
+    /**
+     * @brief Checks whether all text entering the context is valid UTF-8
+     * @return True unless context_config::utf8_handling is utf8_policy::none; requests
+     *         built by this context can then be serialized without validation
+     */
+    [[nodiscard]] bool validates_utf8() const noexcept
+    { return m_config.utf8_handling != utf8_policy::none; }
+
 private:
     void load_schema(const std::string& schema_path);
     void validate_schema();
@@ -378,6 +640,9 @@ private:
     [[nodiscard]] std::vector<std::string> parse_json_path(const nlohmann::json& path_array) const;
 
     void validate_message(const nlohmann::json& message) const;
+    [[nodiscard]] const std::string& ingest_utf8(const std::string& text, std::string& repaired,
+                                                 const char* what) const;
+    void ingest_utf8(nlohmann::json& value, const char* what) const;
     void validate_parameter(const std::string& key, const nlohmann::json& value) const;
 
     [[nodiscard]] std::string encode_image_to_base64(const std::string& image_path) const;
@@ -386,16 +651,20 @@ private:
                                const std::unordered_map<std::string, std::string>& replacements);
 
 private:
-    nlohmann::json m_schema;
+    std::shared_ptr<const nlohmann::json> m_schema;  // immutable, may be shared between contexts
     nlohmann::json m_request_template;
     context_config m_config;
 
     std::string m_provider_name;
     std::string m_endpoint;
+    std::vector<endpoint_config> m_endpoints;
+    std::string m_unix_socket_path;
+    std::string m_http_version;
     std::unordered_map<std::string, std::string> m_headers;
     std::string m_model_name;
     std::optional<std::string> m_system_message;
     std::vector<nlohmann::json> m_messages;
+    text_attachment_map m_attachments;  // referenced by m_messages
     std::unordered_map<std::string, nlohmann::json> m_parameters;
     std::string m_api_key;
     std::unordered_set<std::string> m_valid_roles;
@@ -405,6 +674,9 @@ private:
     nlohmann::json m_message_structure;
     nlohmann::json m_text_content_format;
     nlohmann::json m_image_content_format;
+    image_limits m_image_limits;
+    prompt_minifier m_minifier;
+    minification_stats m_minification_stats;
 };
 
 } // hyni
@@ -1,9 +1,40 @@
 #include "http_client.h"
 #include "logger.h"
+#include "perf_counters.h"
+#include <chrono>
 #include <sstream>
+#include <thread>
 
 namespace hyni {
 
+namespace {
+
+// State shared by post_stream's libcurl callbacks for one transfer
+struct stream_watch {
+    const stream_callback* on_chunk = nullptr;
+    std::unordered_map<std::string, std::string>* headers = nullptr;
+    const progress_callback* cancel_check = nullptr;
+    stream_timeouts timeouts;
+    std::chrono::steady_clock::time_point started;
+    std::chrono::steady_clock::time_point last_byte;
+    bool started_response = false;  // any header or body byte of the current attempt
+    bool delivered = false;         // any body byte passed to on_chunk, in any attempt
+    std::string stall;              // why the watchdog aborted the transfer
+};
+
+} // anonymous namespace
+
+stream_timeouts stream_timeouts::from_json(const nlohmann::json& config) {
+    stream_timeouts timeouts;
+    timeouts.connect_ms = config.value("connect_ms", timeouts.connect_ms);
+    timeouts.first_byte_ms = config.value("first_byte_ms", timeouts.first_byte_ms);
+    timeouts.idle_ms = config.value("idle_ms", timeouts.idle_ms);
+    timeouts.total_ms = config.value("total_ms", timeouts.total_ms);
+    timeouts.max_retries = config.value("max_retries", timeouts.max_retries);
+    timeouts.retry_delay_ms = config.value("retry_delay_ms", timeouts.retry_delay_ms);
+    return timeouts;
+}
+
 http_client::http_client() {
     m_curl.reset(curl_easy_init());
     if (!m_curl) {
@@ -60,12 +91,181 @@ http_client& http_client::set_proxy(const std::string& proxy) {
     return *this;
 }
 
+http_client& http_client::set_unix_socket_path(const std::string& socket_path) {
+    m_unix_socket_path = socket_path;
+    curl_easy_setopt(m_curl.get(), CURLOPT_UNIX_SOCKET_PATH,
+                     m_unix_socket_path.empty() ? nullptr : m_unix_socket_path.c_str());
+    return *this;
+}
+
+http_client& http_client::set_http_version(http_version version) {
+    m_http_version = version;
+    return *this;
+}
+
+http_client& http_client::set_utf8_mode(json_serializer::utf8_mode mode) {
+    m_utf8_mode = mode;
+    return *this;
+}
+
+http_client& http_client::set_stream_timeouts(const stream_timeouts& timeouts) {
+    m_stream_timeouts = timeouts;
+    return *this;
+}
+
+bool http_client::http3_available() noexcept {
+    static const bool available = [] {
+        const curl_version_info_data* info = curl_version_info(CURLVERSION_NOW);
+        return info && (info->features & CURL_VERSION_HTTP3);
+    }();
+    return available;
+}
+
+http_version http_client::parse_http_version(const std::string& value) {
+    if (value.empty() || value == "auto") return http_version::automatic;
+    if (value == "1.1") return http_version::http1_1;
+    if (value == "2") return http_version::http2;
+    if (value == "3") return http_version::http3;
+    throw std::invalid_argument("Unknown HTTP version: " + value);
+}
+
+void http_client::apply_http_version(const std::string& url, bool allow_http3) {
+    long version = CURL_HTTP_VERSION_NONE;
+    switch (m_http_version) {
+    case http_version::automatic:
+        break;
+    case http_version::http1_1:
+        version = CURL_HTTP_VERSION_1_1;
+        break;
+    case http_version::http2:
+        version = CURL_HTTP_VERSION_2TLS;
+        break;
+    case http_version::http3:
+        // QUIC needs TLS; plain http:// and Unix sockets stay on TCP
+        if (allow_http3 && http3_available() && url.starts_with("https://") && m_unix_socket_path.empty()) {
+            version = CURL_HTTP_VERSION_3;
+        } else {
+            version = CURL_HTTP_VERSION_2TLS;
+        }
+        break;
+    }
+    curl_easy_setopt(m_curl.get(), CURLOPT_HTTP_VERSION, version);
+}
+
+http_client& http_client::set_endpoint_selector(std::shared_ptr<endpoint_selector> selector) {
+    m_selector = std::move(selector);
+    return *this;
+}
+
+CURLcode http_client::perform(const std::string& url, http_response& response,
+                               const std::function<bool()>& replayable) {
+    auto requested = m_selector ? m_selector->find(url) : std::nullopt;
+    if (!requested) {
+        return perform_on(url, response, replayable);
+    }
+
+    size_t index = m_selector->select();
+    const std::string& target = m_selector->endpoint(index).url;
+    curl_easy_setopt(m_curl.get(), CURLOPT_URL, target.c_str());
+    CURLcode res = perform_on(target, response, replayable);
+    // Server errors count against the endpoint as much as transport errors
+    auto succeeded = [this](CURLcode code) {
+        long status = 0;
+        curl_easy_getinfo(m_curl.get(), CURLINFO_RESPONSE_CODE, &status);
+        return code == CURLE_OK && status < 500;
+    };
+    const bool connect_failed = res == CURLE_COULDNT_CONNECT || res == CURLE_COULDNT_RESOLVE_HOST ||
+                                res == CURLE_SSL_CONNECT_ERROR;
+    m_selector->report(index, response.timings, succeeded(res));
+
+    // Nothing was sent, so another endpoint can take the request transparently
+    if (connect_failed && m_selector->size() > 1) {
+        size_t fallback = m_selector->select(index);
+        if (fallback != index) {
+            const std::string& other = m_selector->endpoint(fallback).url;
+            LOG_WARNING_SAMPLED("Cannot connect to " + target + ", retrying on " + other);
+            curl_easy_setopt(m_curl.get(), CURLOPT_URL, other.c_str());
+            response.body.clear();
+            response.headers.clear();
+            res = perform_on(other, response, replayable);
+            m_selector->report(fallback, response.timings, succeeded(res));
+        }
+    }
+    return res;
+}
+
+CURLcode http_client::perform_on(const std::string& url, http_response& response,
+                                  const std::function<bool()>& replayable) {
+    apply_http_version(url, true);
+    CURLcode res = curl_easy_perform(m_curl.get());
+
+    // libcurl already races HTTP/3 against TCP where it can; this covers backends
+    // that report QUIC failures instead of falling back themselves. CURLE_HTTP3 can
+    // also end a transfer midway, so only a failure before any request or response
+    // byte moved is replayed over TCP.
+    if (m_http_version == http_version::http3 &&
+        (res == CURLE_HTTP3 || res == CURLE_QUIC_CONNECT_ERROR) &&
+        nothing_exchanged() && (!replayable || replayable())) {
+        LOG_WARNING_SAMPLED("HTTP/3 to " + url + " failed (" + curl_easy_strerror(res) +
+                            "), retrying over TCP");
+        response.body.clear();
+        response.headers.clear();
+        apply_http_version(url, false);
+        res = curl_easy_perform(m_curl.get());
+    }
+
+    fill_timings(response);
+    return res;
+}
+
+bool http_client::nothing_exchanged() const {
+    long header_bytes = 0;
+    curl_off_t uploaded = 0, downloaded = 0;
+    curl_easy_getinfo(m_curl.get(), CURLINFO_HEADER_SIZE, &header_bytes);
+    curl_easy_getinfo(m_curl.get(), CURLINFO_SIZE_UPLOAD_T, &uploaded);
+    curl_easy_getinfo(m_curl.get(), CURLINFO_SIZE_DOWNLOAD_T, &downloaded);
+    return header_bytes == 0 && uploaded == 0 && downloaded == 0;
+}
+
+void http_client::fill_timings(http_response& response) const {
+    char* effective_url = nullptr;
+    curl_easy_getinfo(m_curl.get(), CURLINFO_EFFECTIVE_URL, &effective_url);
+    response.timings.endpoint = effective_url ? effective_url : "";
+
+    long version = 0;
+    curl_easy_getinfo(m_curl.get(), CURLINFO_HTTP_VERSION, &version);
+    switch (version) {
+    case CURL_HTTP_VERSION_1_0: response.timings.protocol = "HTTP/1.0"; break;
+    case CURL_HTTP_VERSION_1_1: response.timings.protocol = "HTTP/1.1"; break;
+    case CURL_HTTP_VERSION_2_0: response.timings.protocol = "HTTP/2"; break;
+    case CURL_HTTP_VERSION_3:   response.timings.protocol = "HTTP/3"; break;
+    default:                    response.timings.protocol.clear(); break;
+    }
+    response.timings.fell_back = m_http_version == http_version::http3 &&
+                                 version != CURL_HTTP_VERSION_3;
+
+    // Cumulative microsecond timestamps from the start of the transfer
+    curl_off_t connect = 0, app_connect = 0, start_transfer = 0, total = 0;
+    curl_easy_getinfo(m_curl.get(), CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(m_curl.get(), CURLINFO_APPCONNECT_TIME_T, &app_connect);
+    curl_easy_getinfo(m_curl.get(), CURLINFO_STARTTRANSFER_TIME_T, &start_transfer);
+    curl_easy_getinfo(m_curl.get(), CURLINFO_TOTAL_TIME_T, &total);
+    response.timings.connect_ms = connect / 1000.0;
+    response.timings.tls_ms = app_connect > connect ? (app_connect - connect) / 1000.0 : 0.0;
+    response.timings.ttfb_ms = start_transfer / 1000.0;
+    response.timings.total_ms = total / 1000.0;
+}
+
 http_response http_client::post(const std::string& url, const nlohmann::json& payload,
-                                progress_callback cancel_check) {
-    LOG_INFO("http_client::post()");
+                                progress_callback cancel_check, const text_attachment_map& attachments) {
+    LOG_INFO_SAMPLED("http_client::post()");
     http_response response;
 
-    std::string payload_str = payload.dump();
+    std::string payload_str;
+    {
+        HYNI_PERF_PROBE("http_client::post/serialize");
+        payload_str = json_serializer::dump(payload, m_utf8_mode, &attachments);
+    }
     curl_easy_setopt(m_curl.get(), CURLOPT_URL, url.c_str());
     curl_easy_setopt(m_curl.get(), CURLOPT_POST, 1L);
     curl_easy_setopt(m_curl.get(), CURLOPT_POSTFIELDS, payload_str.c_str());
@@ -80,12 +280,11 @@ http_response http_client::post(const std::string& url, const nlohmann::json& pa
     curl_easy_setopt(m_curl.get(), CURLOPT_XFERINFODATA, &cancel_check);
     curl_easy_setopt(m_curl.get(), CURLOPT_NOPROGRESS, 0L);
 
-    CURLcode res = curl_easy_perform(m_curl.get());
+    CURLcode res = perform(url, response);
 
     if (res != CURLE_OK) {
-        LOG_ERROR("cURL error: " + std::to_string((int)res));
         response.error_message = curl_easy_strerror(res);
-        LOG_ERROR("cURL error: " + *curl_easy_strerror(res));
+        LOG_ERROR_SAMPLED("cURL error " + std::to_string((int)res) + ": " + response.error_message);
         response.success = false;
     } else {
         curl_easy_getinfo(m_curl.get(), CURLINFO_RESPONSE_CODE, &response.status_code);
@@ -109,7 +308,7 @@ http_response http_client::get(const std::string& url, progress_callback cancel_
     curl_easy_setopt(m_curl.get(), CURLOPT_XFERINFODATA, &cancel_check);
     curl_easy_setopt(m_curl.get(), CURLOPT_NOPROGRESS, 0L);
 
-    CURLcode res = curl_easy_perform(m_curl.get());
+    CURLcode res = perform(url, response);
 
     if (res != CURLE_OK) {
         response.error_message = curl_easy_strerror(res);
@@ -125,36 +324,110 @@ http_response http_client::get(const std::string& url, progress_callback cancel_
 void http_client::post_stream(const std::string& url, const nlohmann::json& payload,
                               stream_callback on_chunk,
                               completion_callback on_complete,
-                              progress_callback cancel_check) {
+                              progress_callback cancel_check,
+                              const text_attachment_map& attachments) {
     // This would typically run in a separate thread
     auto task = [=, this]() {
         http_response response;
+        const stream_timeouts timeouts = m_stream_timeouts;
 
-        std::string payload_str = payload.dump();
+        std::string payload_str = json_serializer::dump(payload, m_utf8_mode, &attachments);
         curl_easy_setopt(m_curl.get(), CURLOPT_URL, url.c_str());
         curl_easy_setopt(m_curl.get(), CURLOPT_POST, 1L);
         curl_easy_setopt(m_curl.get(), CURLOPT_POSTFIELDS, payload_str.c_str());
         curl_easy_setopt(m_curl.get(), CURLOPT_POSTFIELDSIZE, payload_str.size());
 
         // Custom write function for streaming
-        auto stream_writer = [](void* contents, size_t size, size_t nmemb, void* userp) -> size_t {
-            auto callback = static_cast<stream_callback*>(userp);
-            std::string chunk(static_cast<char*>(contents), size * nmemb);
-            (*callback)(chunk);
+        auto stream_writer = [](char* contents, size_t size, size_t nmemb, void* userp) -> size_t {
+            auto* watch = static_cast<stream_watch*>(userp);
+            watch->last_byte = std::chrono::steady_clock::now();
+            watch->started_response = true;
+            watch->delivered = true;
+            std::string chunk(contents, size * nmemb);
+            (*watch->on_chunk)(chunk);
             return size * nmemb;
         };
+        auto stream_header = [](char* contents, size_t size, size_t nmemb, void* userp) -> size_t {
+            auto* watch = static_cast<stream_watch*>(userp);
+            watch->last_byte = std::chrono::steady_clock::now();
+            watch->started_response = true;
+            return header_callback(contents, size, nmemb, watch->headers);
+        };
+        // Called about once a second even while no data arrives
+        auto stream_progress = [](void* clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t) -> int {
+            auto* watch = static_cast<stream_watch*>(clientp);
+            if (*watch->cancel_check && (*watch->cancel_check)()) {
+                return 1;
+            }
+            const auto now = std::chrono::steady_clock::now();
+            const auto since = [&](std::chrono::steady_clock::time_point from) {
+                return std::chrono::duration_cast<std::chrono::milliseconds>(now - from).count();
+            };
+            const auto& limits = watch->timeouts;
+            if (!watch->started_response && limits.first_byte_ms > 0 && since(watch->started) > limits.first_byte_ms) {
+                watch->stall = "no response within " + std::to_string(limits.first_byte_ms) + " ms";
+                return 1;
+            }
+            if (watch->started_response && limits.idle_ms > 0 && since(watch->last_byte) > limits.idle_ms) {
+                watch->stall = "stream idle for " + std::to_string(limits.idle_ms) + " ms";
+                return 1;
+            }
+            return 0;
+        };
 
-        curl_easy_setopt(m_curl.get(), CURLOPT_WRITEFUNCTION, stream_writer);
-        curl_easy_setopt(m_curl.get(), CURLOPT_WRITEDATA, &on_chunk);
-        curl_easy_setopt(m_curl.get(), CURLOPT_HEADERFUNCTION, header_callback);
-        curl_easy_setopt(m_curl.get(), CURLOPT_HEADERDATA, &response.headers);
-        curl_easy_setopt(m_curl.get(), CURLOPT_XFERINFODATA, &cancel_check);
+        stream_watch watch;
+        watch.on_chunk = &on_chunk;
+        watch.headers = &response.headers;
+        watch.cancel_check = &cancel_check;
+        watch.timeouts = timeouts;
+
+        curl_easy_setopt(m_curl.get(), CURLOPT_WRITEFUNCTION, static_cast<curl_write_callback>(stream_writer));
+        curl_easy_setopt(m_curl.get(), CURLOPT_WRITEDATA, &watch);
+        curl_easy_setopt(m_curl.get(), CURLOPT_HEADERFUNCTION, static_cast<curl_write_callback>(stream_header));
+        curl_easy_setopt(m_curl.get(), CURLOPT_HEADERDATA, &watch);
+        curl_easy_setopt(m_curl.get(), CURLOPT_XFERINFOFUNCTION, static_cast<curl_xferinfo_callback>(stream_progress));
+        curl_easy_setopt(m_curl.get(), CURLOPT_XFERINFODATA, &watch);
         curl_easy_setopt(m_curl.get(), CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(m_curl.get(), CURLOPT_CONNECTTIMEOUT_MS, timeouts.connect_ms);
+        curl_easy_setopt(m_curl.get(), CURLOPT_TIMEOUT_MS, timeouts.total_ms);
+
+        CURLcode res = CURLE_OK;
+        for (size_t attempt = 0;; ++attempt) {
+            watch.started = watch.last_byte = std::chrono::steady_clock::now();
+            watch.started_response = false;
+            watch.stall.clear();
+            response.headers.clear();
+            response.attempts = attempt + 1;
+
+            // Same condition as the stall retry below: nothing of this attempt reached anyone
+            res = perform(url, response, [&watch] { return !watch.started_response && !watch.delivered; });
+
+            response.stalled = !watch.stall.empty() || (res == CURLE_OPERATION_TIMEDOUT && !watch.started_response);
+            if (res == CURLE_OK || !response.stalled || watch.delivered || attempt >= timeouts.max_retries) {
+                break;
+            }
+            // Nothing reached the caller yet, so the request can be replayed as if it never happened
+            LOG_WARNING_SAMPLED("Stream from " + url + " stalled (" +
+                                (watch.stall.empty() ? std::string(curl_easy_strerror(res)) : watch.stall) +
+                                "), retrying");
+            const auto resume_at = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeouts.retry_delay_ms);
+            bool cancelled = false;
+            while (!cancelled && std::chrono::steady_clock::now() < resume_at) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(std::min<long>(timeouts.retry_delay_ms, 20)));
+                cancelled = cancel_check && cancel_check();
+            }
+            if (cancelled) {
+                break;
+            }
+        }
 
-        CURLcode res = curl_easy_perform(m_curl.get());
+        // Restore what post() and get() expect
+        curl_easy_setopt(m_curl.get(), CURLOPT_XFERINFOFUNCTION, progress_callback_wrapper);
+        curl_easy_setopt(m_curl.get(), CURLOPT_CONNECTTIMEOUT_MS, 0L);
+        curl_easy_setopt(m_curl.get(), CURLOPT_TIMEOUT_MS, m_timeout_ms);
 
         if (res != CURLE_OK) {
-            response.error_message = curl_easy_strerror(res);
+            response.error_message = watch.stall.empty() ? curl_easy_strerror(res) : "Stream stalled: " + watch.stall;
             response.success = false;
         } else {
             curl_easy_getinfo(m_curl.get(), CURLINFO_RESPONSE_CODE, &response.status_code);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "endpoint_selector.h"
+#include "json_serializer.h"
 #include <curl/curl.h>
 #include <nlohmann/json.hpp>
 #include <functional>
@@ -8,6 +10,25 @@
 
 namespace hyni {
 
+// HTTP protocol version requested from libcurl
+enum class http_version {
+    automatic,  // libcurl default: HTTP/2 over TLS when the server offers it, else HTTP/1.1
+    http1_1,
+    http2,
+    http3       // QUIC; falls back to HTTP/2 or 1.1 when unavailable or unreachable
+};
+
+// Per-request connection details, filled in after every transfer
+struct http_timings {
+    std::string endpoint;      // URL the request was sent to; differs from the requested one with an endpoint_selector
+    std::string protocol;      // protocol actually used: "HTTP/1.1", "HTTP/2" or "HTTP/3"
+    bool fell_back = false;    // HTTP/3 was requested but another protocol carried the request
+    double connect_ms = 0.0;   // TCP/QUIC connect, 0 when a pooled connection was reused
+    double tls_ms = 0.0;       // TLS handshake after connect
+    double ttfb_ms = 0.0;      // request start to first response byte
+    double total_ms = 0.0;
+};
+
 // Response structure
 struct http_response {
     long status_code = 0;
@@ -15,6 +36,26 @@ struct http_response {
     std::unordered_map<std::string, std::string> headers;
     bool success = false;
     std::string error_message;
+    http_timings timings;
+    bool stalled = false;      // post_stream gave up on a connect, first-byte or idle timeout
+    size_t attempts = 1;       // post_stream attempts, more than 1 after retrying a stall
+};
+
+// Watchdog for post_stream. A healthy stream may run as long as it keeps
+// producing data; one that stops is aborted after idle_ms instead of waiting
+// out an overall timeout. The first-byte and idle limits are checked from
+// libcurl's progress callback, about once a second while the connection is
+// quiet. Zero disables a limit.
+struct stream_timeouts {
+    long connect_ms = 10000;      // TCP and TLS connect
+    long first_byte_ms = 60000;   // request start to the first response byte (headers included)
+    long idle_ms = 30000;         // longest gap between bytes once the response has started
+    long total_ms = 0;            // whole transfer; 0 lets healthy streams run as long as they need
+    size_t max_retries = 0;       // retries after a stall, only while nothing was passed to on_chunk
+    long retry_delay_ms = 500;    // before each retry
+
+    // Reads the schema's `api.stream_timeouts` object; missing keys keep their defaults
+    static stream_timeouts from_json(const nlohmann::json& config);
 };
 
 // Callback types for different scenarios
@@ -40,17 +81,54 @@ public:
     http_client& set_user_agent(const std::string& user_agent);
     http_client& set_proxy(const std::string& proxy);
 
-    // Synchronous requests
+    // Connect through a Unix domain socket instead of TCP; the URL still supplies
+    // the Host header and path. An empty path restores TCP.
+    http_client& set_unix_socket_path(const std::string& socket_path);
+    const std::string& get_unix_socket_path() const noexcept { return m_unix_socket_path; }
+
+    // Protocol to negotiate. HTTP/3 applies to https:// URLs only and falls back
+    // to HTTP/2 or 1.1 when libcurl lacks HTTP/3 or the QUIC handshake fails.
+    // A transfer that fails after request or response bytes moved is not replayed.
+    http_client& set_http_version(http_version version);
+    http_version get_http_version() const noexcept { return m_http_version; }
+
+    // Spread requests for the selector's endpoints over its alternates. A request
+    // for one of its URLs goes to the endpoint the selector picks, reports its
+    // timing back, and is retried once on another endpoint if it cannot connect.
+    http_client& set_endpoint_selector(std::shared_ptr<endpoint_selector> selector);
+    const std::shared_ptr<endpoint_selector>& get_endpoint_selector() const noexcept { return m_selector; }
+
+    // How payload strings that are not valid UTF-8 are serialized. Strict (the
+    // default) throws like nlohmann::json::dump(); trusted skips the check for
+    // payloads whose strings were validated when they entered the context.
+    http_client& set_utf8_mode(json_serializer::utf8_mode mode);
+    json_serializer::utf8_mode get_utf8_mode() const noexcept { return m_utf8_mode; }
+
+    // Timeouts and stall retries for post_stream, which ignores set_timeout()
+    http_client& set_stream_timeouts(const stream_timeouts& timeouts);
+    const stream_timeouts& get_stream_timeouts() const noexcept { return m_stream_timeouts; }
+
+    // True if the linked libcurl was built with an HTTP/3 backend
+    static bool http3_available() noexcept;
+
+    // Parses a schema `api.http_version` value: "auto", "1.1", "2" or "3"
+    static http_version parse_http_version(const std::string& value);
+
+    // Synchronous requests. Placeholders in payload are expanded from attachments
+    // only, see json_serializer::dump().
     http_response post(const std::string& url, const nlohmann::json& payload,
-                       progress_callback cancel_check = nullptr);
+                       progress_callback cancel_check = nullptr,
+                       const text_attachment_map& attachments = {});
 
     http_response get(const std::string& url, progress_callback cancel_check = nullptr);
 
-    // Streaming request (for real-time responses)
+    // Streaming request (for real-time responses); keeps the attachments alive
+    // until the transfer ends
     void post_stream(const std::string& url, const nlohmann::json& payload,
                      stream_callback on_chunk,
                      completion_callback on_complete = nullptr,
-                     progress_callback cancel_check = nullptr);
+                     progress_callback cancel_check = nullptr,
+                     const text_attachment_map& attachments = {});
 
     // Async requests returning futures
     std::future<http_response> post_async(const std::string& url, const nlohmann::json& payload);
@@ -63,6 +141,22 @@ private:
     std::unique_ptr<CURL, curl_deleter> m_curl;
     struct curl_slist* m_headers = nullptr;
     long m_timeout_ms = 60000;
+    std::string m_unix_socket_path;
+    http_version m_http_version = http_version::automatic;
+    json_serializer::utf8_mode m_utf8_mode = json_serializer::utf8_mode::strict;
+    stream_timeouts m_stream_timeouts;
+
+    std::shared_ptr<endpoint_selector> m_selector;
+
+    // `replayable` reports whether the caller has seen nothing of the response
+    // yet; without it only libcurl's byte counters decide
+    CURLcode perform(const std::string& url, http_response& response,
+                     const std::function<bool()>& replayable = nullptr);
+    CURLcode perform_on(const std::string& url, http_response& response,
+                        const std::function<bool()>& replayable);
+    bool nothing_exchanged() const;
+    void apply_http_version(const std::string& url, bool allow_http3);
+    void fill_timings(http_response& response) const;
 
     void setup_common_options();
     static size_t write_callback(void* contents, size_t size, size_t nmemb, void* userp);
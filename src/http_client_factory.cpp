@@ -8,6 +8,23 @@ std::unique_ptr<http_client> http_client_factory::create_http_client(
     auto client = std::make_unique<http_client>();
     // Set headers from context
     client->set_headers(context.get_headers());
+    // Local sidecars are reached over a Unix socket, bypassing the TCP stack
+    if (!context.get_unix_socket_path().empty()) {
+        client->set_unix_socket_path(context.get_unix_socket_path());
+    }
+    client->set_http_version(http_client::parse_http_version(context.get_http_version()));
+    if (const auto& api = context.get_schema().at("api"); api.contains("stream_timeouts")) {
+        client->set_stream_timeouts(stream_timeouts::from_json(api.at("stream_timeouts")));
+    }
+    // Requests built by a context that repairs or rejects invalid UTF-8 where text
+    // comes in need no second check when they are serialized
+    if (context.validates_utf8()) {
+        client->set_utf8_mode(json_serializer::utf8_mode::trusted);
+    }
+    // Clients of the same provider share one selector and its measurements
+    if (context.get_endpoints().size() > 1) {
+        client->set_endpoint_selector(endpoint_selector::shared(context.get_endpoints()));
+    }
     return client;
 }
 
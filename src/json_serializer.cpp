@@ -0,0 +1,371 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "json_serializer.h"
+#include "utf8.h"
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define HYNI_JSON_X86 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HYNI_JSON_NEON 1
+#endif
+
+namespace hyni {
+
+namespace {
+
+constexpr size_t BLOCK = 64;
+
+// Bit i set if byte i of a 64-byte block needs escaping
+using classify_fn = uint64_t (*)(const char*);
+
+[[maybe_unused]] uint64_t classify_scalar(const char* p) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < BLOCK; ++i) {
+        const auto c = static_cast<unsigned char>(p[i]);
+        if (c < 0x20 || c == '"' || c == '\\') mask |= uint64_t{1} << i;
+    }
+    return mask;
+}
+
+#ifdef HYNI_JSON_X86
+uint64_t classify_sse2(const char* p) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+
+    uint64_t mask = 0;
+    for (size_t i = 0; i < BLOCK / 16; ++i) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+        // max(v, 0x1F) == 0x1F  <=>  v <= 0x1F, unsigned
+        const __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+            _mm_cmpeq_epi8(_mm_max_epu8(v, control), control));
+        mask |= uint64_t{static_cast<uint16_t>(_mm_movemask_epi8(special))} << (16 * i);
+    }
+    return mask;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("avx2")))
+uint64_t classify_avx2(const char* p) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+
+    uint64_t mask = 0;
+    for (size_t i = 0; i < BLOCK / 32; ++i) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * i));
+        const __m256i special = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+            _mm256_cmpeq_epi8(_mm256_max_epu8(v, control), control));
+        mask |= uint64_t{static_cast<uint32_t>(_mm256_movemask_epi8(special))} << (32 * i);
+    }
+    return mask;
+}
+#define HYNI_JSON_AVX2 1
+#endif
+#endif // HYNI_JSON_X86
+
+#ifdef HYNI_JSON_NEON
+uint16_t neon_movemask(uint8x16_t v) {
+    static const uint8_t bits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t masked = vandq_u8(v, vld1q_u8(bits));
+    return static_cast<uint16_t>(vaddv_u8(vget_low_u8(masked)) | (vaddv_u8(vget_high_u8(masked)) << 8));
+}
+
+uint64_t classify_neon(const char* p) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < BLOCK / 16; ++i) {
+        const uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p + 16 * i));
+        const uint8x16_t special = vorrq_u8(vorrq_u8(vceqq_u8(v, vdupq_n_u8('"')), vceqq_u8(v, vdupq_n_u8('\\'))),
+                                            vcleq_u8(v, vdupq_n_u8(0x1F)));
+        mask |= uint64_t{neon_movemask(special)} << (16 * i);
+    }
+    return mask;
+}
+#endif
+
+struct simd_impl {
+    classify_fn classify;
+    const char* name;
+};
+
+const simd_impl& selected_impl() {
+    static const simd_impl impl = [] {
+#if defined(HYNI_JSON_AVX2)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return simd_impl{classify_avx2, "avx2"};
+        }
+#endif
+#if defined(HYNI_JSON_X86)
+        return simd_impl{classify_sse2, "sse2"};
+#elif defined(HYNI_JSON_NEON)
+        return simd_impl{classify_neon, "neon"};
+#else
+        return simd_impl{classify_scalar, "scalar"};
+#endif
+    }();
+    return impl;
+}
+
+std::string hex_byte(unsigned char c) {
+    static constexpr char digits[] = "0123456789ABCDEF";
+    return {digits[c >> 4], digits[c & 0x0F]};
+}
+
+// Same errors as nlohmann's serializer, so callers of dump() see no difference
+[[noreturn]] void throw_invalid_utf8(std::string_view text, size_t index) {
+    const auto c = static_cast<unsigned char>(text[index]);
+    throw nlohmann::json::type_error::create(
+        316, "invalid UTF-8 byte at index " + std::to_string(index) + ": 0x" + hex_byte(c),
+        static_cast<const nlohmann::json*>(nullptr));
+}
+
+[[noreturn]] void throw_incomplete_utf8(std::string_view text) {
+    throw nlohmann::json::type_error::create(
+        316, "incomplete UTF-8 string; last byte: 0x" + hex_byte(static_cast<unsigned char>(text.back())),
+        static_cast<const nlohmann::json*>(nullptr));
+}
+
+// Throws for the first invalid sequence in text, reporting the offending byte
+// the way nlohmann does (RFC 3629: no overlongs, surrogates or code points
+// above U+10FFFF)
+[[noreturn]] void throw_utf8_error(std::string_view text) {
+    const size_t i = utf8::find_invalid(text);
+    const auto* p = reinterpret_cast<const unsigned char*>(text.data());
+    const unsigned char lead = p[i];
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+    size_t length;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        if (lead == 0xE0) low = 0xA0;
+        if (lead == 0xED) high = 0x9F;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        if (lead == 0xF0) low = 0x90;
+        if (lead == 0xF4) high = 0x8F;
+    } else {
+        throw_invalid_utf8(text, i);
+    }
+
+    for (size_t k = 1; k < length; ++k) {
+        if (i + k >= text.size()) {
+            throw_incomplete_utf8(text);
+        }
+        const unsigned char c = p[i + k];
+        if (k == 1 ? (c < low || c > high) : (c & 0xC0) != 0x80) {
+            throw_invalid_utf8(text, i + k);
+        }
+    }
+    throw_invalid_utf8(text, i);   // not reached: find_invalid points at an invalid sequence
+}
+
+/**
+ * Escape sequence of every byte that needs one, indexed by the byte
+ */
+struct escape_table {
+    char text[256][6] = {};
+    uint8_t length[256] = {};
+
+    constexpr escape_table() {
+        constexpr char digits[] = "0123456789abcdef";
+        for (int c = 0; c < 0x20; ++c) {
+            const char escape[] = {'\\', 'u', '0', '0', digits[c >> 4], digits[c & 0x0F]};
+            for (int k = 0; k < 6; ++k) text[c][k] = escape[k];
+            length[c] = 6;
+        }
+        set('"', '"');
+        set('\\', '\\');
+        set('\b', 'b');
+        set('\t', 't');
+        set('\n', 'n');
+        set('\f', 'f');
+        set('\r', 'r');
+    }
+
+    constexpr void set(unsigned char c, char letter) {
+        text[c][0] = '\\';
+        text[c][1] = letter;
+        length[c] = 2;
+    }
+};
+
+constexpr escape_table ESCAPES;
+
+// Worst case output of one block: every byte a \u00XX escape
+constexpr size_t MAX_BLOCK_OUTPUT = BLOCK * 6;
+
+template <typename T>
+void append_integer(T value, std::string& out) {
+    char buffer[24];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, end);
+}
+
+} // anonymous namespace
+
+void json_serializer::escape_string(std::string_view text, std::string& out, utf8_mode mode) {
+    if (mode != utf8_mode::trusted && !utf8::is_valid(text)) {
+        if (mode == utf8_mode::strict) {
+            throw_utf8_error(text);
+        }
+        escape_string(utf8::repair(text), out, utf8_mode::trusted);
+        return;
+    }
+
+    const char* p = text.data();
+    const size_t n = text.size();
+    const classify_fn classify = selected_impl().classify;
+
+    // Output is written through a pointer into an oversized string and trimmed
+    // at the end. There is always room for one more block in the worst case
+    // (every byte a \u00XX escape); the string grows geometrically when there is not.
+    constexpr size_t slack = MAX_BLOCK_OUTPUT + 8;
+    size_t used = out.size();
+    out.resize(used + n + n / 8 + slack);
+    char* dst = out.data() + used;
+    char* limit = out.data() + out.size() - slack;
+    auto ensure_room = [&] {
+        if (dst > limit) {
+            used = static_cast<size_t>(dst - out.data());
+            out.resize(out.size() * 2);
+            dst = out.data() + used;
+            limit = out.data() + out.size() - slack;
+        }
+    };
+
+    *dst++ = '"';
+    size_t i = 0;
+    while (i + BLOCK <= n) {
+        ensure_room();
+        const char* src = p + i;
+        uint64_t pending = classify(src);
+        if (pending == 0) {
+            std::memcpy(dst, src, BLOCK);
+            dst += BLOCK;
+            i += BLOCK;
+            continue;
+        }
+
+        // Copy the clean runs between the bytes that need escaping
+        size_t done = 0;
+        while (pending != 0) {
+            const size_t k = static_cast<size_t>(std::countr_zero(pending));
+            std::memcpy(dst, src + done, k - done);
+            dst += k - done;
+            const auto c = static_cast<unsigned char>(src[k]);
+            std::memcpy(dst, ESCAPES.text[c], 6);
+            dst += ESCAPES.length[c];
+            done = k + 1;
+            pending &= pending - 1;
+        }
+        std::memcpy(dst, src + done, BLOCK - done);
+        dst += BLOCK - done;
+        i += BLOCK;
+    }
+
+    // Tail shorter than a block
+    ensure_room();
+    while (i < n) {
+        const auto c = static_cast<unsigned char>(p[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            *dst++ = static_cast<char>(c);
+        } else {
+            std::memcpy(dst, ESCAPES.text[c], 6);
+            dst += ESCAPES.length[c];
+        }
+        ++i;
+    }
+    *dst++ = '"';
+    out.resize(static_cast<size_t>(dst - out.data()));
+}
+
+void json_serializer::dump(const nlohmann::json& value, std::string& out, utf8_mode mode,
+                           const text_attachment_map* attachments) {
+    switch (value.type()) {
+    case nlohmann::json::value_t::object: {
+        out += '{';
+        bool first = true;
+        for (auto it = value.begin(); it != value.end(); ++it) {
+            if (!first) out += ',';
+            first = false;
+            escape_string(it.key(), out, mode);
+            out += ':';
+            dump(it.value(), out, mode, attachments);
+        }
+        out += '}';
+        break;
+    }
+    case nlohmann::json::value_t::array: {
+        out += '[';
+        bool first = true;
+        for (const auto& element : value) {
+            if (!first) out += ',';
+            first = false;
+            dump(element, out, mode, attachments);
+        }
+        out += ']';
+        break;
+    }
+    case nlohmann::json::value_t::string: {
+        const auto& text = value.get_ref<const std::string&>();
+        if (attachments && text_attachment::is_placeholder(text)) {
+            if (auto it = attachments->find(text); it != attachments->end()) {
+                const auto& attachment = *it->second;
+                // Owned text was validated when it was created; a mapping may
+                // have changed since, and invalid text needs the checked path
+                const bool trusted = attachment.is_valid_utf8() && !attachment.is_mapped();
+                escape_string(attachment.view(), out,
+                              trusted                     ? utf8_mode::trusted
+                              : mode == utf8_mode::strict ? utf8_mode::strict
+                                                          : utf8_mode::repair);
+                break;
+            }
+        }
+        escape_string(text, out, mode);
+        break;
+    }
+    case nlohmann::json::value_t::number_integer:
+        append_integer(value.get<nlohmann::json::number_integer_t>(), out);
+        break;
+    case nlohmann::json::value_t::number_unsigned:
+        append_integer(value.get<nlohmann::json::number_unsigned_t>(), out);
+        break;
+    default:
+        // Floats, booleans, null and binary: rare and short, keep nlohmann's formatting
+        out += value.dump();
+        break;
+    }
+}
+
+std::string json_serializer::dump(const nlohmann::json& value, utf8_mode mode,
+                                  const text_attachment_map* attachments) {
+    std::string out;
+    dump(value, out, mode, attachments);
+    return out;
+}
+
+const char* json_serializer::simd_level() noexcept {
+    return selected_impl().name;
+}
+
+} // hyni
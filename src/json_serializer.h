@@ -0,0 +1,82 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "text_attachment.h"
+#include <nlohmann/json.hpp>
+#include <string>
+#include <string_view>
+
+namespace hyni {
+
+/**
+ * @class json_serializer
+ * @brief Compact JSON serialization with vectorized string escaping
+ *
+ * Produces exactly what nlohmann::json::dump() produces with its defaults
+ * (no indentation, UTF-8 output, invalid UTF-8 rejected), but escapes strings
+ * a block at a time: 64 bytes are classified with SIMD compares for quotes,
+ * backslashes and control characters, and clean runs are appended with a
+ * single copy. Each string is validated up front with utf8::is_valid, unless
+ * the caller vouches for it. Long message strings, which dominate request
+ * payloads, serialize several times faster than with dump().
+ *
+ * String values that are a placeholder in the text_attachment_map passed to
+ * dump() are replaced by the attachment's text, escaped straight from its
+ * storage. Placeholders are never looked up anywhere else; without a map
+ * they serialize as the plain strings they are.
+ *
+ * Uses AVX2 when the CPU has it (checked at runtime), SSE2 on other x86-64,
+ * NEON on AArch64 and a scalar loop elsewhere.
+ *
+ * @note Thread-safe; all functions are stateless.
+ */
+class json_serializer final {
+public:
+    /**
+     * @brief Handling of strings that are not valid UTF-8
+     */
+    enum class utf8_mode {
+        strict,    ///< Throw like dump()
+        repair,    ///< Write U+FFFD for invalid sequences, never throw
+        trusted    ///< Skip validation; the strings were validated where they came in
+    };
+
+    /**
+     * @brief Serializes a JSON value like value.dump(), with text attachments expanded
+     * @param attachments Attachments whose placeholders are expanded, usually
+     *        general_context::get_attachments() of the context that built value
+     * @throws nlohmann::json::type_error (316) if a string is not valid UTF-8 in strict mode
+     */
+    [[nodiscard]] static std::string dump(const nlohmann::json& value, utf8_mode mode = utf8_mode::strict,
+                                          const text_attachment_map* attachments = nullptr);
+
+    /**
+     * @brief Appends a JSON value to out
+     * @throws nlohmann::json::type_error (316) if a string is not valid UTF-8 in strict mode
+     */
+    static void dump(const nlohmann::json& value, std::string& out, utf8_mode mode = utf8_mode::strict,
+                     const text_attachment_map* attachments = nullptr);
+
+    /**
+     * @brief Appends text as a quoted, escaped JSON string
+     * @throws nlohmann::json::type_error (316) if text is not valid UTF-8 in strict mode
+     */
+    static void escape_string(std::string_view text, std::string& out, utf8_mode mode = utf8_mode::strict);
+
+    /**
+     * @brief Instruction set used for escaping: "avx2", "sse2", "neon" or "scalar"
+     */
+    [[nodiscard]] static const char* simd_level() noexcept;
+};
+
+} // hyni
@@ -0,0 +1,66 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace hyni {
+
+/**
+ * @brief Counts how often and how long a lock had to be waited for
+ *
+ * Only contended acquisitions touch the counters, so the uncontended fast path
+ * costs a single try_lock and no shared writes.
+ */
+struct lock_contention_stats {
+    std::atomic<uint64_t> contended{0};
+    std::atomic<uint64_t> wait_ns{0};
+
+    struct snapshot {
+        uint64_t contended = 0;
+        uint64_t wait_ns = 0;
+    };
+
+    [[nodiscard]] snapshot load() const noexcept {
+        return {contended.load(std::memory_order_relaxed), wait_ns.load(std::memory_order_relaxed)};
+    }
+
+    void reset() noexcept {
+        contended.store(0, std::memory_order_relaxed);
+        wait_ns.store(0, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @brief Acquires a deferred lock (std::unique_lock / std::shared_lock), recording contention
+ * @param lock A lock object constructed with std::defer_lock
+ * @param stats Counters updated only when try_lock() fails
+ */
+template<typename Lock>
+void lock_with_stats(Lock& lock, lock_contention_stats& stats) {
+    if (lock.try_lock()) {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    lock.lock();
+    auto waited = std::chrono::steady_clock::now() - start;
+
+    stats.contended.fetch_add(1, std::memory_order_relaxed);
+    stats.wait_ns.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count(),
+        std::memory_order_relaxed);
+}
+
+} // hyni
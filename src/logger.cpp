@@ -6,8 +6,22 @@
 #include <ctime>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+
+#ifdef HYNI_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+// Appended to a rotated file that is kept uncompressed; compressed ones end in .gz
+constexpr const char* ROTATED_SUFFIX = ".old";
+
+} // anonymous namespace
 
 logger& logger::instance() {
+    // Constructed first so that it outlives the logger's final writes
+    hyni::async_io_service::instance();
     static logger instance;
     return instance;
 }
@@ -17,31 +31,359 @@ logger::~logger() {
 }
 
 void logger::init(bool enable_file_logging, bool enable_console_logging) {
+    init(enable_file_logging, enable_console_logging, rotation_config{});
+}
+
+void logger::init(bool enable_file_logging, bool enable_console_logging,
+                  const rotation_config& rotation) {
+    std::lock_guard lock(m_mutex);
     if (m_state) {
-        shutdown(); // Clean up if already initialized
+        shutdown_locked(); // Clean up if already initialized
+    }
+
+    {
+        // Files rotated by earlier runs count against max_files too
+        std::vector<std::string> previous;
+        const bool rotating = rotation.max_file_bytes > 0 || rotation.max_file_age.count() > 0;
+        if (enable_file_logging && rotating && rotation.max_files > 0) {
+            previous = find_rotated_files(rotation.directory);
+        }
+
+        std::vector<std::string> expired;
+        {
+            std::lock_guard rotation_lock(m_rotation_mutex);
+            m_rotated_files.assign(previous.begin(), previous.end());
+            while (rotation.max_files > 0 && m_rotated_files.size() > rotation.max_files) {
+                expired.push_back(std::move(m_rotated_files.front()));
+                m_rotated_files.pop_front();
+            }
+        }
+
+        std::error_code ec;
+        for (const auto& file : expired) {
+            std::filesystem::remove(file, ec);
+        }
     }
 
     m_state = std::make_unique<loggerState>();
     m_state->file_logging_enabled = enable_file_logging;
     m_state->console_logging_enabled = enable_console_logging;
+    m_state->rotation = rotation;
+
+    if (enable_file_logging && !open_log_file_locked()) {
+        std::cerr << "Failed to open log file: " << m_state->log_file_name << std::endl;
+        m_state->file_logging_enabled = false;
+    }
+
+    m_min_level.store(static_cast<int>(m_state->min_level), std::memory_order_relaxed);
+    m_active.store(m_state->file_logging_enabled || m_state->console_logging_enabled,
+                   std::memory_order_relaxed);
+}
+
+std::unique_ptr<hyni::async_file_writer> logger::open_log_file(const std::string& directory,
+                                                               std::string& path) {
+    namespace fs = std::filesystem;
+
+    const fs::path dir(directory);
+    if (!dir.empty()) {
+        std::error_code ec;
+        fs::create_directories(dir, ec);
+    }
+
+    // Rotations within the same second need a distinct name. The file is created
+    // exclusively, as the rotation worker may be opening the next one concurrently.
+    hyni::async_file_options options{hyni::fsync_policy::never};    // not fsynced, like a plain stream
+    options.exclusive = true;
+
+    const fs::path base = generate_log_filename();
+    std::unique_ptr<hyni::async_file_writer> file;
+    for (int seq = 0; !file; ++seq) {
+        const fs::path candidate = seq == 0 ? dir / base
+            : dir / (base.stem().string() + "_" + std::to_string(seq) + base.extension().string());
+        path = candidate.string();
+        try {
+            file = std::make_unique<hyni::async_file_writer>(candidate, options);
+        } catch (const std::exception&) {
+            if (!fs::exists(candidate)) {
+                return nullptr;
+            }
+            continue;
+        }
+
+        // A rotated file is only removed once its .gz is complete (or renamed),
+        // so checking after the create cannot miss one being rotated right now
+        if (fs::exists(path + ".gz") || fs::exists(path + ROTATED_SUFFIX)) {
+            file->close();
+            file.reset();
+            std::error_code ec;
+            fs::remove(candidate, ec);
+        }
+    }
+
+    // Write initial header
+    file->write("=== Logging started ===\n"
+                "Log file: " + path + "\n"
+                "====\n\n");
+    return file;
+}
+
+void logger::discard_standby(standby_file& standby) {
+    if (!standby.file) return;
+
+    // Never written to beyond its header
+    standby.file->close();
+    standby.file.reset();
+    std::error_code ec;
+    std::filesystem::remove(standby.path, ec);
+}
+
+bool logger::open_log_file_locked() {
+    m_state->log_file = open_log_file(m_state->rotation.directory, m_state->log_file_name);
+    if (!m_state->log_file) {
+        return false;
+    }
+
+    m_state->bytes_written = 0;
+    m_state->opened_at = std::chrono::steady_clock::now();
+
+    const auto& rotation = m_state->rotation;
+    if (rotation.max_file_bytes > 0 || rotation.max_file_age.count() > 0) {
+        {
+            std::lock_guard lock(m_rotation_mutex);
+            request_standby_locked(rotation.directory);
+        }
+        m_rotation_cv.notify_all();
+    }
+    return true;
+}
+
+void logger::rotate_locked() {
+    const auto& rotation = m_state->rotation;
+    standby_file next;
+    bool notify = false;
+    {
+        std::lock_guard lock(m_rotation_mutex);
+        if (m_standby.file && m_standby.directory == rotation.directory) {
+            next = std::move(m_standby);
+            m_standby = {};
+        }
+        if (!m_standby_wanted || m_standby_directory != rotation.directory) {
+            request_standby_locked(rotation.directory);
+            notify = true;
+        }
+    }
+    if (notify) {
+        m_rotation_cv.notify_all();
+    }
+
+    if (!next.file) {
+        // The worker has not caught up: keep writing to the current file and retry on
+        // the next line, unless it has grown well past its size limit
+        if (rotation.max_file_bytes == 0 || m_state->bytes_written < 2 * rotation.max_file_bytes) {
+            return;
+        }
+        next.file = open_log_file(rotation.directory, next.path);
+        if (!next.file) {
+            return; // keep writing to the old file rather than losing output
+        }
+    }
+
+    {
+        std::lock_guard lock(m_rotation_mutex);
+        m_rotation_queue.push_back(
+            rotated_file{std::move(m_state->log_file), m_state->log_file_name, rotation});
+        ++m_rotation_in_flight;
+    }
+    m_rotation_cv.notify_all();
+
+    m_state->log_file = std::move(next.file);
+    m_state->log_file_name = std::move(next.path);
+    m_state->bytes_written = 0;
+    m_state->opened_at = std::chrono::steady_clock::now();
+}
+
+void logger::request_standby_locked(const std::string& directory) {
+    start_rotation_worker_locked();
+    m_standby_directory = directory;
+    m_standby_wanted = true;
+}
+
+void logger::start_rotation_worker_locked() {
+    if (!m_rotation_thread.joinable()) {
+        m_rotation_stop = false;
+        m_rotation_thread = std::thread(&logger::rotation_worker, this);
+    }
+}
+
+void logger::rotation_worker() {
+    std::unique_lock lock(m_rotation_mutex);
+    while (true) {
+        m_rotation_cv.wait(lock, [this] {
+            return m_rotation_stop || m_standby_wanted || !m_rotation_queue.empty();
+        });
+
+        if (m_rotation_stop && m_rotation_queue.empty()) {
+            standby_file unused = std::move(m_standby);
+            m_standby = {};
+            m_standby_wanted = false;
+            lock.unlock();
+            discard_standby(unused);
+            return;
+        }
+
+        // The next file goes first, writers wait for it before they can rotate
+        if (m_standby_wanted && !m_rotation_stop) {
+            m_standby_wanted = false;
+            if (m_standby.file && m_standby.directory == m_standby_directory) {
+                continue;
+            }
+
+            standby_file stale = std::move(m_standby);
+            m_standby = {};
+            standby_file next;
+            next.directory = m_standby_directory;
+            lock.unlock();
+
+            discard_standby(stale);
+            next.file = open_log_file(next.directory, next.path);
+
+            lock.lock();
+            m_standby = std::move(next);    // only this thread sets the standby
+            continue;
+        }
+
+        if (m_rotation_queue.empty()) {
+            continue;
+        }
 
-    if (enable_file_logging) {
-        m_state->log_file_name = generate_log_filename();
-        m_state->log_file.open(m_state->log_file_name, std::ios::out | std::ios::app);
+        rotated_file job = std::move(m_rotation_queue.front());
+        m_rotation_queue.pop_front();
+        lock.unlock();
 
-        if (!m_state->log_file.is_open()) {
-            std::cerr << "Failed to open log file: " << m_state->log_file_name << std::endl;
-            m_state->file_logging_enabled = false;
+        job.file->write("\n=== Log rotated ===\n");
+        job.file->close();
+
+        std::string path = job.path;
+        std::error_code ec;
+        if (job.rotation.compress && compress_file(job.path)) {
+            std::filesystem::remove(job.path, ec);
+            path += ".gz";
         } else {
-            // Write initial header
-            m_state->log_file << "=== Logging started ===" << std::endl;
-            m_state->log_file << "Log file: " << m_state->log_file_name << std::endl;
-            m_state->log_file << "====" << std::endl << std::endl;
+            // Renamed so that a later run can tell it from a log still being written
+            std::filesystem::rename(job.path, job.path + ROTATED_SUFFIX, ec);
+            if (!ec) {
+                path += ROTATED_SUFFIX;
+            }
         }
+        prune_rotated_files(path, job.rotation.max_files);
+
+        lock.lock();
+        --m_rotation_in_flight;
+        m_rotation_cv.notify_all();
+    }
+}
+
+void logger::wait_for_rotation() {
+    std::unique_lock lock(m_rotation_mutex);
+    m_rotation_cv.wait(lock, [this] { return m_rotation_in_flight == 0; });
+}
+
+void logger::stop_rotation_worker() {
+    {
+        std::lock_guard lock(m_rotation_mutex);
+        m_rotation_stop = true;
+    }
+    m_rotation_cv.notify_all();
+    if (m_rotation_thread.joinable()) {
+        m_rotation_thread.join();
+    }
+}
+
+bool logger::compress_file(const std::string& path) {
+#ifdef HYNI_HAVE_ZLIB
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) return false;
+
+    const std::string gz_path = path + ".gz";
+    gzFile out = gzopen(gz_path.c_str(), "wb6");
+    if (!out) return false;
+
+    char buffer[64 * 1024];
+    bool ok = true;
+    while (in) {
+        in.read(buffer, sizeof(buffer));
+        std::streamsize n = in.gcount();
+        if (n > 0 && gzwrite(out, buffer, static_cast<unsigned>(n)) != n) {
+            ok = false;
+            break;
+        }
+    }
+
+    ok = (gzclose(out) == Z_OK) && ok;
+    if (!ok) {
+        std::error_code ec;
+        std::filesystem::remove(gz_path, ec);
+    }
+    return ok;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+std::vector<std::string> logger::find_rotated_files(const std::string& directory) {
+    namespace fs = std::filesystem;
+
+    // Same prefix and extension as generate_log_filename(), plus a rotation suffix
+    auto is_rotated = [](const std::string& name) {
+        return name.starts_with("hyni_log_") &&
+               (name.ends_with(".log.gz") || name.ends_with(std::string(".log") + ROTATED_SUFFIX));
+    };
+
+    std::vector<std::pair<fs::file_time_type, std::string>> found;
+    std::error_code ec;
+    for (fs::directory_iterator it(directory.empty() ? "." : directory, ec), end;
+         !ec && it != end; it.increment(ec)) {
+        std::error_code entry_ec;
+        if (!it->is_regular_file(entry_ec) || !is_rotated(it->path().filename().string())) {
+            continue;
+        }
+        auto mtime = it->last_write_time(entry_ec);
+        if (!entry_ec) {
+            // Named the way open_log_file() names them, so pruning matches
+            found.emplace_back(mtime, (fs::path(directory) / it->path().filename()).string());
+        }
+    }
+
+    // Oldest first, as m_rotated_files is kept
+    std::sort(found.begin(), found.end());
+    std::vector<std::string> files;
+    files.reserve(found.size());
+    for (auto& [mtime, path] : found) {
+        files.push_back(std::move(path));
+    }
+    return files;
+}
+
+void logger::prune_rotated_files(const std::string& path, size_t max_files) {
+    std::vector<std::string> expired;
+    {
+        std::lock_guard lock(m_rotation_mutex);
+        m_rotated_files.push_back(path);
+        while (max_files > 0 && m_rotated_files.size() > max_files) {
+            expired.push_back(std::move(m_rotated_files.front()));
+            m_rotated_files.pop_front();
+        }
+    }
+
+    std::error_code ec;
+    for (const auto& file : expired) {
+        std::filesystem::remove(file, ec);
     }
 }
 
 bool logger::is_enabled() const {
+    std::lock_guard lock(m_mutex);
     return m_state && (m_state->file_logging_enabled || m_state->console_logging_enabled);
 }
 
@@ -83,6 +425,8 @@ std::string logger::current_time() const {
 
 void logger::log(Level level, const std::string& message,
                  const std::string& file, int line) {
+    std::unique_lock lock(m_mutex, std::defer_lock);
+    hyni::lock_with_stats(lock, m_lock_stats);
     if (!m_state || level < m_state->min_level) return;
 
     std::stringstream log_entry;
@@ -102,15 +446,32 @@ void logger::log(Level level, const std::string& message,
         std::cerr << final_message << std::endl;
     }
 
-    if (m_state->file_logging_enabled && m_state->log_file.is_open()) {
-        m_state->log_file << final_message << std::endl;
+    if (m_state->file_logging_enabled && m_state->log_file) {
+        // Only copies into the write buffer; the disk write happens on the I/O thread.
+        // Warnings and errors are handed over right away, the rest in buffer-sized batches.
+        m_state->log_file->write(final_message);
+        m_state->log_file->write("\n");
+        if (level >= Level::WARNING) {
+            m_state->log_file->submit();
+        }
+        m_state->bytes_written += final_message.size() + 1;
+
+        const auto& rotation = m_state->rotation;
+        if ((rotation.max_file_bytes > 0 && m_state->bytes_written >= rotation.max_file_bytes) ||
+            (rotation.max_file_age.count() > 0 &&
+             std::chrono::steady_clock::now() - m_state->opened_at >= rotation.max_file_age)) {
+            rotate_locked();
+        }
     }
 }
 
 void logger::log_section(const std::string& title,
                          const std::vector<std::string>& messages,
                          Level level) {
-    if (!m_state || level < m_state->min_level) return;
+    {
+        std::lock_guard lock(m_mutex);
+        if (!m_state || level < m_state->min_level) return;
+    }
 
     log(level, "\n==== " + title + " ====");
     for (const auto& msg : messages) {
@@ -120,31 +481,124 @@ void logger::log_section(const std::string& title,
 }
 
 void logger::set_min_level(Level level) {
+    std::lock_guard lock(m_mutex);
     if (m_state) {
         m_state->min_level = level;
+        m_min_level.store(static_cast<int>(level), std::memory_order_relaxed);
     }
 }
 
 std::string logger::get_log_file_name() const {
+    std::lock_guard lock(m_mutex);
     return m_state ? m_state->log_file_name : "";
 }
 
 void logger::flush() {
-    if (m_state && m_state->file_logging_enabled && m_state->log_file.is_open()) {
-        m_state->log_file.flush();
+    std::lock_guard lock(m_mutex);
+    if (m_state && m_state->file_logging_enabled && m_state->log_file) {
+        m_state->log_file->flush();
     }
 }
 
 void logger::shutdown() {
+    log_suppressed_summary();
+
+    {
+        std::lock_guard lock(m_mutex);
+        shutdown_locked();
+    }
+    stop_rotation_worker();
+}
+
+void logger::shutdown_locked() {
+    m_active.store(false, std::memory_order_relaxed);
     if (m_state) {
-        if (m_state->file_logging_enabled && m_state->log_file.is_open()) {
-            m_state->log_file << std::endl << "=== Logging ended ===" << std::endl;
-            m_state->log_file.close();
+        if (m_state->file_logging_enabled && m_state->log_file) {
+            m_state->log_file->write("\n=== Logging ended ===\n");
+            m_state->log_file->close();
         }
         m_state.reset();
     }
 }
 
+hyni::lock_contention_stats::snapshot logger::get_lock_stats() const {
+    return m_lock_stats.load();
+}
+
+void logger::register_rate_limiter(log_rate_limiter* limiter) {
+    std::lock_guard lock(m_limiters_mutex);
+    m_limiters.push_back(limiter);
+}
+
+void logger::unregister_rate_limiter(log_rate_limiter* limiter) {
+    std::lock_guard lock(m_limiters_mutex);
+    m_limiters.erase(std::remove(m_limiters.begin(), m_limiters.end(), limiter), m_limiters.end());
+}
+
+void logger::log_suppressed_summary() {
+    if (!is_level_enabled(Level::INFO)) return;
+
+    std::vector<std::pair<std::string, uint64_t>> pending;
+    {
+        std::lock_guard lock(m_limiters_mutex);
+        for (auto* limiter : m_limiters) {
+            uint64_t suppressed = limiter->take_suppressed();
+            if (suppressed > 0) {
+                std::string site = std::filesystem::path(limiter->file()).filename().string() +
+                                   ":" + std::to_string(limiter->line());
+                pending.emplace_back(std::move(site), suppressed);
+            }
+        }
+    }
+
+    for (const auto& [site, suppressed] : pending) {
+        log(Level::INFO, "Suppressed " + std::to_string(suppressed) +
+                             " sampled messages from " + site);
+    }
+}
+
+log_rate_limiter::log_rate_limiter(uint32_t first_n, uint32_t every_n,
+                                   std::chrono::milliseconds window,
+                                   const char* file, int line)
+    : m_first_n(first_n)
+    , m_every_n(every_n)
+    , m_window_ns(std::chrono::duration_cast<std::chrono::nanoseconds>(window).count())
+    , m_file(file)
+    , m_line(line)
+    , m_window_start_ns(std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count()) {
+    logger::instance().register_rate_limiter(this);
+}
+
+log_rate_limiter::~log_rate_limiter() {
+    logger::instance().unregister_rate_limiter(this);
+}
+
+bool log_rate_limiter::should_log(uint64_t& suppressed) noexcept {
+    if (m_window_ns > 0) {
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t start = m_window_start_ns.load(std::memory_order_relaxed);
+        // One thread wins the window rollover; concurrent events may land in either window
+        if (now - start >= m_window_ns &&
+            m_window_start_ns.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+            m_count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t n = m_count.fetch_add(1, std::memory_order_relaxed);
+    bool emit = n < m_first_n ||
+                (m_every_n > 0 && (n - m_first_n + 1) % m_every_n == 0);
+
+    if (emit) {
+        suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+    m_suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
 std::string logger::truncate_text(const std::string& text, size_t max_length) {
     return text.length() > max_length ? text.substr(0, max_length) + "..." : text;
 }
@@ -6,6 +6,16 @@
 #include <vector>
 #include <memory>
 #include <fstream>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include "lock_stats.h"
+#include "async_file_writer.h"
+
+class log_rate_limiter;
 
 class logger {
 public:
@@ -26,12 +36,35 @@ public:
     // Singleton access
     static logger& instance();
 
+    // Log file rotation. The next file is opened ahead of time and rotated files
+    // are closed, compressed and pruned on a background thread, so that a
+    // rotation never waits for disk I/O. Rotated files are renamed to
+    // <name>.log.gz (or <name>.log.old when not compressed); init() picks up
+    // files of that form left by earlier runs, so max_files holds across
+    // restarts. Logs still being written, ours or another process's, are never
+    // pruned.
+    struct rotation_config {
+        size_t max_file_bytes = 0;              // rotate after this many bytes, 0 = never
+        std::chrono::seconds max_file_age{0};   // rotate after this long, 0 = never
+        size_t max_files = 10;                  // rotated files kept, 0 = unlimited
+        bool compress = true;                   // gzip rotated files (needs zlib)
+        std::string directory;                  // log directory, empty = working directory
+    };
+
     // Initialization
     void init(bool enable_file_logging = true, bool enable_console_logging = true);
+    void init(bool enable_file_logging, bool enable_console_logging,
+              const rotation_config& rotation);
 
     // Check if logging is enabled
     bool is_enabled() const;
 
+    // Lock-free check used by the LOG_* macros before the message is built
+    bool is_level_enabled(Level level) const noexcept {
+        return m_active.load(std::memory_order_relaxed) &&
+               static_cast<int>(level) >= m_min_level.load(std::memory_order_relaxed);
+    }
+
     // Core logging function
     void log(Level level, const std::string& message,
              const std::string& file = "", int line = -1);
@@ -50,6 +83,9 @@ public:
     // Flush the log file
     void flush();
 
+    // Wait until rotated files queued so far have been compressed and pruned
+    void wait_for_rotation();
+
     // Shutdown the logging system
     void shutdown();
 
@@ -57,6 +93,20 @@ public:
     static std::string truncate_text(const std::string& text, size_t max_length = 100);
     static std::string get_json_keys(const nlohmann::json& j);
 
+    // Contention on the logger's output lock
+    hyni::lock_contention_stats::snapshot get_lock_stats() const;
+
+    // Sampled call sites register themselves so pending suppressions can be summarized
+    void register_rate_limiter(log_rate_limiter* limiter);
+    void unregister_rate_limiter(log_rate_limiter* limiter);
+
+    // Log one line per sampled call site that suppressed messages since its last output
+    void log_suppressed_summary();
+
+    // Defaults for the LOG_*_SAMPLED macros
+    static constexpr uint32_t DEFAULT_SAMPLE_FIRST_N = 10;
+    static constexpr uint32_t DEFAULT_SAMPLE_EVERY_N = 100;
+
 private:
     logger() = default; // Private constructor
     ~logger(); // Private destructor
@@ -66,22 +116,146 @@ private:
         bool file_logging_enabled = false;
         bool console_logging_enabled = true;
         Level min_level = Level::DEBUG;
-        std::ofstream log_file;
+        std::unique_ptr<hyni::async_file_writer> log_file;  // written by the shared I/O thread
         std::string log_file_name;
+        rotation_config rotation;
+        size_t bytes_written = 0;
+        std::chrono::steady_clock::time_point opened_at;
+    };
+
+    // A file handed over to the rotation worker; closing it flushes pending output
+    struct rotated_file {
+        std::unique_ptr<hyni::async_file_writer> file;
+        std::string path;
+        rotation_config rotation;
+    };
+
+    // The next log file, opened by the rotation worker before it is needed
+    struct standby_file {
+        std::unique_ptr<hyni::async_file_writer> file;
+        std::string path;
+        std::string directory;
     };
 
     std::unique_ptr<loggerState> m_state;
 
+    // Serializes writers and init/shutdown of m_state
+    mutable std::mutex m_mutex;
+    mutable hyni::lock_contention_stats m_lock_stats;
+
+    // Mirrors of m_state for the lock-free level check
+    std::atomic<bool> m_active{false};
+    std::atomic<int> m_min_level{static_cast<int>(Level::DEBUG)};
+
+    std::mutex m_limiters_mutex;
+    std::vector<log_rate_limiter*> m_limiters;
+
+    std::mutex m_rotation_mutex;
+    std::condition_variable m_rotation_cv;
+    std::deque<rotated_file> m_rotation_queue;
+    std::thread m_rotation_thread;
+    size_t m_rotation_in_flight = 0;
+    bool m_rotation_stop = false;
+    standby_file m_standby;
+    std::string m_standby_directory;
+    bool m_standby_wanted = false;
+    std::deque<std::string> m_rotated_files;    // oldest first, final (compressed) names
+
     // Helper methods
-    std::string generate_log_filename();
+    static std::string generate_log_filename();
+    static std::unique_ptr<hyni::async_file_writer> open_log_file(const std::string& directory,
+                                                                  std::string& path);
+    static void discard_standby(standby_file& standby);
+    bool open_log_file_locked();
+    void rotate_locked();
+    void request_standby_locked(const std::string& directory);
+    void start_rotation_worker_locked();
+    void rotation_worker();
+    void stop_rotation_worker();
+    static bool compress_file(const std::string& path);
+    static std::vector<std::string> find_rotated_files(const std::string& directory);
+    void prune_rotated_files(const std::string& path, size_t max_files);
     std::string level_to_string(Level level) const;
     std::string current_time() const;
+    void shutdown_locked();
+};
+
+/**
+ * Per-call-site sampling: within each window the first `first_n` events are
+ * logged, after that only every `every_n`-th one (none if every_n is 0). The
+ * next emitted line carries the number of events suppressed before it.
+ *
+ * Cost on the suppressed path is one relaxed fetch_add (plus a clock read when
+ * a window is configured), so sampled hot paths can stay enabled in production.
+ */
+class log_rate_limiter {
+public:
+    log_rate_limiter(uint32_t first_n, uint32_t every_n,
+                     std::chrono::milliseconds window = std::chrono::seconds(60),
+                     const char* file = "", int line = -1);
+    ~log_rate_limiter();
+
+    log_rate_limiter(const log_rate_limiter&) = delete;
+    log_rate_limiter& operator=(const log_rate_limiter&) = delete;
+
+    // Returns true if this event should be logged; `suppressed` receives the
+    // number of events dropped since the previous logged one
+    bool should_log(uint64_t& suppressed) noexcept;
+
+    // Takes the pending suppressed count, leaving zero behind
+    uint64_t take_suppressed() noexcept { return m_suppressed.exchange(0, std::memory_order_relaxed); }
+
+    const char* file() const noexcept { return m_file; }
+    int line() const noexcept { return m_line; }
+
+private:
+    const uint32_t m_first_n;
+    const uint32_t m_every_n;
+    const int64_t m_window_ns;
+    const char* m_file;
+    const int m_line;
+
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_suppressed{0};
+    std::atomic<int64_t> m_window_start_ns;
 };
 
 // Convenience macros for easier logging
-#define LOG_DEBUG(msg) logger::instance().log(logger::Level::DEBUG, msg, __FILE__, __LINE__)
-#define LOG_INFO(msg) logger::instance().log(logger::Level::INFO, msg, __FILE__, __LINE__)
-#define LOG_WARNING(msg) logger::instance().log(logger::Level::WARNING, msg, __FILE__, __LINE__)
-#define LOG_ERROR(msg) logger::instance().log(logger::Level::ERROR, msg, __FILE__, __LINE__)
+#define LOG_AT_LEVEL(level, msg) \
+    do { \
+        if (logger::instance().is_level_enabled(level)) \
+            logger::instance().log(level, msg, __FILE__, __LINE__); \
+    } while (0)
+
+#define LOG_DEBUG(msg) LOG_AT_LEVEL(logger::Level::DEBUG, msg)
+#define LOG_INFO(msg) LOG_AT_LEVEL(logger::Level::INFO, msg)
+#define LOG_WARNING(msg) LOG_AT_LEVEL(logger::Level::WARNING, msg)
+#define LOG_ERROR(msg) LOG_AT_LEVEL(logger::Level::ERROR, msg)
+
+// Sampled logging: one rate limiter per call site, message built only when emitted
+#define LOG_SAMPLED(level, msg, first_n, every_n) \
+    do { \
+        static log_rate_limiter hyni_log_limiter_(first_n, every_n, std::chrono::seconds(60), \
+                                                  __FILE__, __LINE__); \
+        uint64_t hyni_log_suppressed_ = 0; \
+        if (logger::instance().is_level_enabled(level) && \
+            hyni_log_limiter_.should_log(hyni_log_suppressed_)) { \
+            std::string hyni_log_message_(msg); \
+            if (hyni_log_suppressed_ > 0) { \
+                hyni_log_message_ += " [" + std::to_string(hyni_log_suppressed_) + \
+                                     " similar messages suppressed]"; \
+            } \
+            logger::instance().log(level, hyni_log_message_, __FILE__, __LINE__); \
+        } \
+    } while (0)
+
+#define LOG_DEBUG_SAMPLED(msg) \
+    LOG_SAMPLED(logger::Level::DEBUG, msg, logger::DEFAULT_SAMPLE_FIRST_N, logger::DEFAULT_SAMPLE_EVERY_N)
+#define LOG_INFO_SAMPLED(msg) \
+    LOG_SAMPLED(logger::Level::INFO, msg, logger::DEFAULT_SAMPLE_FIRST_N, logger::DEFAULT_SAMPLE_EVERY_N)
+#define LOG_WARNING_SAMPLED(msg) \
+    LOG_SAMPLED(logger::Level::WARNING, msg, logger::DEFAULT_SAMPLE_FIRST_N, logger::DEFAULT_SAMPLE_EVERY_N)
+#define LOG_ERROR_SAMPLED(msg) \
+    LOG_SAMPLED(logger::Level::ERROR, msg, logger::DEFAULT_SAMPLE_FIRST_N, logger::DEFAULT_SAMPLE_EVERY_N)
 
 #endif // LOGGING_H
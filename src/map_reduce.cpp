@@ -0,0 +1,379 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "map_reduce.h"
+#include "chat_api.h"
+#include "logger.h"
+#include "prompt_minifier.h"
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+namespace hyni {
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+using milliseconds_d = std::chrono::duration<double, std::milli>;
+
+/**
+ * Request and token buckets refilled continuously at the per-minute rates, holding
+ * at most one second of quota so that calls are spread out instead of bursting.
+ * A reservation may take a bucket below zero; the caller then waits until it
+ * would have refilled.
+ */
+class rate_limiter {
+public:
+    rate_limiter(double requests_per_minute, double tokens_per_minute)
+        : m_requests(requests_per_minute)
+        , m_tokens(tokens_per_minute) {}
+
+    // Reserves one request of tokens; returns how long to wait before sending it
+    milliseconds_d reserve(size_t tokens) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto now = clock_type::now();
+        const double wait = std::max(m_requests.take(1.0, now), m_tokens.take(static_cast<double>(tokens), now));
+        return milliseconds_d(wait);
+    }
+
+private:
+    struct bucket {
+        explicit bucket(double per_minute)
+            : rate_per_ms(per_minute > 0.0 ? per_minute / 60000.0 : 0.0)
+            , capacity(std::max(1.0, rate_per_ms * 1000.0))
+            , level(capacity) {}
+
+        // Returns the wait in milliseconds until the bucket is no longer in debt
+        double take(double amount, clock_type::time_point now) {
+            if (rate_per_ms <= 0.0) {
+                return 0.0;   // unlimited
+            }
+            level = std::min(capacity, level + milliseconds_d(now - last).count() * rate_per_ms);
+            last = now;
+            level -= amount;
+            return level >= 0.0 ? 0.0 : -level / rate_per_ms;
+        }
+
+        double rate_per_ms;
+        double capacity;
+        double level;
+        clock_type::time_point last = clock_type::now();
+    };
+
+    std::mutex m_mutex;
+    bucket m_requests;
+    bucket m_tokens;
+};
+
+// Pieces of text ending after each separator; they concatenate back to text
+std::vector<std::string_view> split_after(std::string_view text, std::string_view separator) {
+    std::vector<std::string_view> pieces;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find(separator, start);
+        end = end == std::string_view::npos ? text.size() : end + separator.size();
+        // Runs of the separator stay with the piece before them
+        while (end < text.size() && text.substr(end, separator.size()) == separator) {
+            end += separator.size();
+        }
+        pieces.push_back(text.substr(start, end - start));
+        start = end;
+    }
+    return pieces;
+}
+
+constexpr std::array<std::string_view, 4> BOUNDARIES = {"\n\n", "\n", ". ", " "};
+
+void split_into(std::string_view text, size_t max_tokens, size_t boundary, std::vector<std::string_view>& chunks) {
+    if (text.empty()) {
+        return;
+    }
+    const size_t tokens = prompt_minifier::estimate_tokens(text);
+    if (tokens <= max_tokens) {
+        chunks.push_back(text);
+        return;
+    }
+
+    if (boundary == BOUNDARIES.size()) {
+        // A single word over budget: cut by bytes, backing off continuation bytes
+        const size_t step = std::max<size_t>(1, text.size() * max_tokens / tokens);
+        size_t start = 0;
+        while (start < text.size()) {
+            size_t end = std::min(text.size(), start + step);
+            while (end < text.size() && end > start + 1 && (static_cast<unsigned char>(text[end]) & 0xC0) == 0x80) {
+                --end;
+            }
+            chunks.push_back(text.substr(start, end - start));
+            start = end;
+        }
+        return;
+    }
+
+    // Greedily pack consecutive pieces; pieces over budget split at the next boundary
+    const char* chunk_start = nullptr;
+    size_t chunk_size = 0;
+    size_t chunk_tokens = 0;
+    auto flush = [&] {
+        if (chunk_size > 0) {
+            chunks.emplace_back(chunk_start, chunk_size);
+        }
+        chunk_size = 0;
+        chunk_tokens = 0;
+    };
+    for (std::string_view piece : split_after(text, BOUNDARIES[boundary])) {
+        const size_t piece_tokens = prompt_minifier::estimate_tokens(piece);
+        if (piece_tokens > max_tokens) {
+            flush();
+            split_into(piece, max_tokens, boundary + 1, chunks);
+            continue;
+        }
+        if (chunk_tokens + piece_tokens > max_tokens) {
+            flush();
+        }
+        if (chunk_size == 0) {
+            chunk_start = piece.data();
+        }
+        chunk_size += piece.size();
+        chunk_tokens += piece_tokens;
+    }
+    flush();
+}
+
+} // anonymous namespace
+
+map_reduce::map_reduce(api_factory factory, map_reduce_options options)
+    : m_factory(std::move(factory))
+    , m_options(std::move(options)) {
+    if (!m_factory) {
+        throw std::invalid_argument("map_reduce needs a chat_api factory");
+    }
+}
+
+std::vector<std::string_view> map_reduce::split(std::string_view text, size_t max_tokens) {
+    std::vector<std::string_view> chunks;
+    split_into(text, std::max<size_t>(1, max_tokens), 0, chunks);
+    return chunks;
+}
+
+map_reduce_result map_reduce::run(std::string_view document, const std::string& map_instruction,
+                                  const std::string& reduce_instruction, partial_callback on_partial,
+                                  progress_callback cancel_check) {
+    const auto start = clock_type::now();
+    map_reduce_result result;
+    if (document.empty()) {
+        return result;
+    }
+
+    auto first_api = m_factory();
+    if (!first_api) {
+        throw std::runtime_error("map_reduce: factory returned no chat_api");
+    }
+
+    // Fill in what the options leave to the schema
+    const auto& schema = first_api->get_context().get_schema();
+    const auto limits = schema.value("limits", nlohmann::json::object());
+    const auto rate_limits = limits.value("rate_limits", nlohmann::json::object());
+    const size_t context_tokens = limits.value("max_context_length", size_t{12000});
+    const size_t output_tokens = std::max<size_t>(1, limits.value("max_output_tokens", size_t{1024}));
+    const size_t chunk_tokens = m_options.chunk_tokens ? m_options.chunk_tokens : std::max<size_t>(1, context_tokens / 3);
+    const size_t fan_in = std::max<size_t>(
+        2, m_options.reduce_fan_in ? m_options.reduce_fan_in : std::min<size_t>(16, chunk_tokens / output_tokens));
+    auto rate = [&](double option, const char* key) {
+        return option != 0.0 ? option : rate_limits.value(key, -1.0);
+    };
+    rate_limiter limiter(rate(m_options.requests_per_minute, "requests_per_minute"),
+                         rate(m_options.tokens_per_minute, "tokens_per_minute"));
+
+    const auto chunks = split(document, chunk_tokens);
+
+    // Results per level; level L+1 item i reduces level L items [i * fan_in, (i + 1) * fan_in)
+    std::vector<std::vector<std::optional<std::string>>> levels(1);
+    levels[0].resize(chunks.size());
+    while (levels.back().size() > 1) {
+        levels.emplace_back((levels.back().size() + fan_in - 1) / fan_in);
+    }
+    const size_t top = levels.size() - 1;
+
+    struct task {
+        size_t level;
+        size_t index;
+        std::string prompt;
+    };
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<task> queue;
+    bool done = false;
+    std::string error;
+    std::mutex callback_mutex;
+    map_reduce_stats& stats = result.stats;
+    stats.chunks = chunks.size();
+    stats.levels = levels.size();
+
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        queue.push_back({0, i, map_instruction + "\n\n" + std::string(chunks[i])});
+    }
+
+    auto stopped = [&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        return done || !error.empty();
+    };
+    auto cancelled = [&] { return stopped() || (cancel_check && cancel_check()); };
+
+    // Sleeps up to duration, waking early when the run ends; false if it did
+    auto pause = [&](milliseconds_d duration) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait_for(lock, duration, [&] { return done || !error.empty() || (cancel_check && cancel_check()); });
+        return !done && error.empty() && !(cancel_check && cancel_check());
+    };
+
+    auto fail = [&](const std::string& message) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error.empty()) {
+            error = message;
+        }
+        cv.notify_all();
+    };
+
+    // Stores a result and queues the reduce it completes, ahead of waiting map calls
+    auto complete = [&](const task& finished, std::string text) {
+        map_reduce_partial partial{finished.level, finished.index, finished.level == top, text};
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto& level = levels[finished.level];
+            level[finished.index] = std::move(text);
+            if (finished.level == top) {
+                result.text = *level[finished.index];
+                done = true;
+            } else {
+                const size_t parent = finished.index / fan_in;
+                const size_t first = parent * fan_in;
+                const size_t last = std::min(level.size(), first + fan_in);
+                const bool ready = std::all_of(level.begin() + first, level.begin() + last,
+                                               [](const auto& item) { return item.has_value(); });
+                if (ready) {
+                    std::string prompt = reduce_instruction;
+                    for (size_t i = first; i < last; ++i) {
+                        prompt += "\n\n";
+                        prompt += *level[i];
+                    }
+                    queue.push_front({finished.level + 1, parent, std::move(prompt)});
+                }
+            }
+            cv.notify_all();
+        }
+        if (on_partial) {
+            std::lock_guard<std::mutex> lock(callback_mutex);
+            on_partial(partial);
+        }
+    };
+
+    auto worker = [&](std::shared_ptr<chat_api> api) {
+        try {
+            if (!api) {
+                api = m_factory();
+            }
+            const progress_callback abort_call = [&] { return cancelled(); };
+            while (true) {
+                task current;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait_for(lock, std::chrono::milliseconds(50), [&] {
+                        return done || !error.empty() || !queue.empty();
+                    });
+                    if (done || !error.empty()) {
+                        return;
+                    }
+                    if (queue.empty()) {
+                        if (cancel_check && cancel_check()) {
+                            error = "map_reduce cancelled";
+                            cv.notify_all();
+                            return;
+                        }
+                        continue;
+                    }
+                    current = std::move(queue.front());
+                    queue.pop_front();
+                    ++(current.level == 0 ? stats.map_calls : stats.reduce_calls);
+                }
+
+                std::string text;
+                for (size_t attempt = 1;; ++attempt) {
+                    const auto wait = limiter.reserve(prompt_minifier::estimate_tokens(current.prompt) +
+                                                      m_options.reserved_output_tokens);
+                    if (wait.count() > 0.0) {
+                        {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            stats.throttled_ms += wait.count();
+                        }
+                        if (!pause(wait)) {
+                            break;
+                        }
+                    }
+                    try {
+                        text = api->send_message(current.prompt, abort_call);
+                        break;
+                    } catch (const std::exception& e) {
+                        if (cancelled()) {
+                            break;
+                        }
+                        if (attempt >= m_options.max_attempts) {
+                            fail("map_reduce: level " + std::to_string(current.level) + " call " +
+                                 std::to_string(current.index) + " failed: " + e.what());
+                            return;
+                        }
+                        {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            ++stats.retries;
+                        }
+                        LOG_WARNING_SAMPLED(std::string("map_reduce: retrying failed call: ") + e.what());
+                        if (!pause(milliseconds_d(m_options.retry_delay * (1 << std::min<size_t>(attempt - 1, 16))))) {
+                            break;
+                        }
+                    }
+                }
+                if (cancelled()) {
+                    if (!stopped()) {
+                        fail("map_reduce cancelled");
+                    }
+                    return;
+                }
+                complete(current, std::move(text));
+            }
+        } catch (const std::exception& e) {
+            fail(std::string("map_reduce: ") + e.what());
+        }
+    };
+
+    const size_t workers = std::max<size_t>(1, std::min(m_options.concurrency, chunks.size()));
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    threads.emplace_back(worker, std::move(first_api));
+    for (size_t i = 1; i < workers; ++i) {
+        threads.emplace_back(worker, nullptr);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+    stats.elapsed_ms = milliseconds_d(clock_type::now() - start).count();
+    return result;
+}
+
+} // hyni
@@ -0,0 +1,125 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "http_client.h"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hyni {
+
+class chat_api;
+
+/**
+ * @brief Options for map_reduce; zero values are derived from the provider schema's limits
+ */
+struct map_reduce_options {
+    size_t chunk_tokens = 0;            ///< Estimated tokens per chunk; 0 for a third of max_context_length
+    size_t reduce_fan_in = 0;           ///< Partial results per reduce call; 0 to fill a chunk with max_output_tokens each
+    size_t concurrency = 4;             ///< Requests in flight, each on its own thread and chat_api
+    double requests_per_minute = 0.0;   ///< 0 for limits.rate_limits.requests_per_minute; negative for no limit
+    double tokens_per_minute = 0.0;     ///< 0 for limits.rate_limits.tokens_per_minute; negative for no limit
+    size_t reserved_output_tokens = 512;  ///< Counted against tokens_per_minute for each response
+    size_t max_attempts = 3;            ///< Attempts per call before the whole run fails
+    std::chrono::milliseconds retry_delay{1000};  ///< Before the second attempt, doubled for each further one
+};
+
+/**
+ * @brief Result of one call, reported as soon as it finishes
+ */
+struct map_reduce_partial {
+    size_t level = 0;       ///< 0 for a chunk's map result, then one more per reduce round
+    size_t index = 0;       ///< Position within the level
+    bool final = false;     ///< True for the single result of the last level
+    std::string text;
+};
+
+/**
+ * @brief Counters of a map_reduce run
+ */
+struct map_reduce_stats {
+    size_t chunks = 0;
+    size_t map_calls = 0;
+    size_t reduce_calls = 0;
+    size_t levels = 0;          ///< Map level plus reduce rounds
+    size_t retries = 0;         ///< Failed attempts that were retried
+    double throttled_ms = 0.0;  ///< Total time calls waited for the rate limits
+    double elapsed_ms = 0.0;
+};
+
+/**
+ * @brief Output of map_reduce::run()
+ */
+struct map_reduce_result {
+    std::string text;
+    map_reduce_stats stats;
+};
+
+/**
+ * @class map_reduce
+ * @brief Summarizes or queries documents larger than the context window
+ *
+ * run() splits the document into chunks on structural boundaries (paragraphs,
+ * then lines, sentences and words), sends every chunk with the map instruction,
+ * and combines the results reduce_fan_in at a time with the reduce instruction,
+ * level by level, until one remains. Calls run concurrently on their own
+ * chat_api, paced by request and token rate limits; a reduce starts as soon
+ * as its inputs are done, ahead of queued map calls, so the pipeline streams
+ * rather than waiting for every chunk. Turnaround depends on the quota and the
+ * tree depth, not on the document length.
+ *
+ * Each call sends one user message, "<instruction>\n\n<text>", like
+ * chat_api::send_message().
+ */
+class map_reduce {
+public:
+    using api_factory = std::function<std::shared_ptr<chat_api>()>;
+    using partial_callback = std::function<void(const map_reduce_partial&)>;
+
+    /**
+     * @param factory Makes the chat_api of each concurrent call; contexts must be configured
+     *        (API key, model, parameters) and independent
+     * @throws std::invalid_argument If factory is empty
+     */
+    explicit map_reduce(api_factory factory, map_reduce_options options = {});
+
+    /**
+     * @brief Runs the pipeline and returns the final result
+     * @param on_partial Called with every call's result, one at a time, from worker threads
+     * @param cancel_check Polled between and during calls; return true to cancel
+     * @throws std::runtime_error If a call fails max_attempts times, or the run is cancelled
+     */
+    map_reduce_result run(std::string_view document, const std::string& map_instruction,
+                          const std::string& reduce_instruction, partial_callback on_partial = nullptr,
+                          progress_callback cancel_check = nullptr);
+
+    /**
+     * @brief Splits text into consecutive chunks of at most max_tokens estimated tokens
+     *
+     * Prefers paragraph breaks, then line breaks, sentence ends and spaces, and
+     * only cuts inside a word (at a UTF-8 character boundary) when a word alone
+     * exceeds the budget. The chunks concatenate back to text.
+     */
+    [[nodiscard]] static std::vector<std::string_view> split(std::string_view text, size_t max_tokens);
+
+    [[nodiscard]] const map_reduce_options& get_options() const noexcept { return m_options; }
+
+private:
+    api_factory m_factory;
+    map_reduce_options m_options;
+};
+
+} // hyni
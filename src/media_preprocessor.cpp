@@ -0,0 +1,463 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "media_preprocessor.h"
+#include "response_utils.h"
+#include "perf_counters.h"
+#include <algorithm>
+#include <cmath>
+#include <csetjmp>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+#ifdef HYNI_HAVE_JPEG
+#include <jpeglib.h>
+#endif
+#ifdef HYNI_HAVE_PNG
+#include <png.h>
+#endif
+
+namespace hyni {
+
+namespace {
+
+// Interleaved 8-bit pixels, 3 (RGB) or 4 (RGBA) channels
+struct raster {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::vector<uint8_t> pixels;
+    int source_width = 0;   // size in the encoded image, before any decoder scaling
+    int source_height = 0;
+};
+
+bool within_pixel_limit(size_t width, size_t height, const image_limits& limits) {
+    return limits.max_pixels == 0 || (height == 0 || width <= limits.max_pixels / height);
+}
+
+bool has_transparency(const raster& image) {
+    if (image.channels != 4) return false;
+    for (size_t i = 3; i < image.pixels.size(); i += 4) {
+        if (image.pixels[i] != 0xFF) return true;
+    }
+    return false;
+}
+
+// Compacts RGBA to RGB in place
+void drop_alpha(raster& image) {
+    if (image.channels == 3) return;
+
+    size_t dst = 0;
+    for (size_t src = 0; src < image.pixels.size(); src += 4, dst += 3) {
+        image.pixels[dst] = image.pixels[src];
+        image.pixels[dst + 1] = image.pixels[src + 1];
+        image.pixels[dst + 2] = image.pixels[src + 2];
+    }
+    image.pixels.resize(dst);
+    image.pixels.shrink_to_fit();
+    image.channels = 3;
+}
+
+/**
+ * One-dimensional area average of a row: each output sample covers `scale`
+ * input samples, with partial coverage at both ends.
+ */
+void resample_row(const uint8_t* src, size_t src_len, float* dst, size_t dst_len, int channels) {
+    const double scale = static_cast<double>(src_len) / dst_len;
+    for (size_t o = 0; o < dst_len; ++o) {
+        const double begin = o * scale;
+        const double end = begin + scale;
+        float acc[4] = {0, 0, 0, 0};
+
+        for (size_t i = static_cast<size_t>(begin); i < src_len && i < end; ++i) {
+            const double weight = std::min<double>(end, i + 1) - std::max<double>(begin, i);
+            const uint8_t* px = src + i * channels;
+            for (int c = 0; c < channels; ++c) {
+                acc[c] += static_cast<float>(weight) * px[c];
+            }
+        }
+
+        float* out = dst + o * channels;
+        for (int c = 0; c < channels; ++c) {
+            out[c] = acc[c] / static_cast<float>(scale);
+        }
+    }
+}
+
+/**
+ * Area-averages rows, then blends the resampled rows that cover each output
+ * row. Works a row at a time, so besides the output only two rows of floats
+ * at the output width are allocated.
+ */
+raster downscale(const raster& image, int width, int height) {
+    const int ch = image.channels;
+    const size_t src_w = image.width, src_h = image.height;
+    const size_t row_len = static_cast<size_t>(width) * ch;
+    const double scale = static_cast<double>(src_h) / height;
+
+    raster result{width, height, ch, std::vector<uint8_t>(row_len * height), image.source_width,
+                  image.source_height};
+    std::vector<float> row(row_len);
+    std::vector<float> acc(row_len);
+    size_t row_index = SIZE_MAX;  // input row currently in row; boundary rows feed two outputs
+
+    for (int o = 0; o < height; ++o) {
+        const double begin = o * scale;
+        const double end = begin + scale;
+        std::fill(acc.begin(), acc.end(), 0.0f);
+
+        for (size_t i = static_cast<size_t>(begin); i < src_h && i < end; ++i) {
+            if (i != row_index) {
+                resample_row(&image.pixels[i * src_w * ch], src_w, row.data(), width, ch);
+                row_index = i;
+            }
+            const auto weight = static_cast<float>(std::min<double>(end, i + 1) - std::max<double>(begin, i));
+            for (size_t k = 0; k < row_len; ++k) {
+                acc[k] += weight * row[k];
+            }
+        }
+
+        uint8_t* out = &result.pixels[static_cast<size_t>(o) * row_len];
+        for (size_t k = 0; k < row_len; ++k) {
+            out[k] = static_cast<uint8_t>(std::clamp(std::lround(acc[k] / scale), 0L, 255L));
+        }
+    }
+    return result;
+}
+
+#ifdef HYNI_HAVE_JPEG
+// libjpeg reports fatal errors through error_exit, which must not return
+struct jpeg_error_handler {
+    jpeg_error_mgr mgr;
+    std::jmp_buf jump;
+};
+
+void jpeg_error_exit(j_common_ptr cinfo) {
+    auto* handler = reinterpret_cast<jpeg_error_handler*>(cinfo->err);
+    std::longjmp(handler->jump, 1);
+}
+
+// Output of jpeg_mem_dest. libjpeg sets it after setjmp, and locals changed
+// between setjmp and longjmp are indeterminate, so it lives on the heap.
+struct jpeg_memory_output {
+    unsigned char* buffer = nullptr;
+    unsigned long size = 0;
+
+    ~jpeg_memory_output() { std::free(buffer); }
+};
+
+bool decode_jpeg(const std::string& bytes, const image_limits& limits, raster& image) {
+    jpeg_decompress_struct cinfo;
+    jpeg_error_handler error;
+    cinfo.err = jpeg_std_error(&error.mgr);
+    error.mgr.error_exit = jpeg_error_exit;
+
+    if (setjmp(error.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, reinterpret_cast<const unsigned char*>(bytes.data()),
+                 static_cast<unsigned long>(bytes.size()));
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_RGB;
+
+    // Let the IDCT drop whole octaves the downscale would average away anyway,
+    // never going below the target size
+    if (limits.max_dimension > 0) {
+        const auto longest = std::max(cinfo.image_width, cinfo.image_height);
+        const auto target = static_cast<JDIMENSION>(limits.max_dimension);
+        unsigned int denom = 1;
+        while (denom < 8 && longest / (denom * 2) >= target) {
+            denom *= 2;
+        }
+        cinfo.scale_num = 1;
+        cinfo.scale_denom = denom;
+    }
+    jpeg_calc_output_dimensions(&cinfo);
+    if (!within_pixel_limit(cinfo.output_width, cinfo.output_height, limits)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    jpeg_start_decompress(&cinfo);
+
+    image.width = static_cast<int>(cinfo.output_width);
+    image.height = static_cast<int>(cinfo.output_height);
+    image.source_width = static_cast<int>(cinfo.image_width);
+    image.source_height = static_cast<int>(cinfo.image_height);
+    image.channels = 3;
+    image.pixels.resize(static_cast<size_t>(image.width) * image.height * 3);
+
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = &image.pixels[static_cast<size_t>(cinfo.output_scanline) * image.width * 3];
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+bool encode_jpeg(const raster& image, int quality, std::string& out) {
+    jpeg_compress_struct cinfo;
+    jpeg_error_handler error;
+    const auto output = std::make_unique<jpeg_memory_output>();
+    cinfo.err = jpeg_std_error(&error.mgr);
+    error.mgr.error_exit = jpeg_error_exit;
+
+    if (setjmp(error.jump)) {
+        jpeg_destroy_compress(&cinfo);
+        return false;
+    }
+
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &output->buffer, &output->size);
+    cinfo.image_width = static_cast<JDIMENSION>(image.width);
+    cinfo.image_height = static_cast<JDIMENSION>(image.height);
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, std::clamp(quality, 1, 100), TRUE);
+    cinfo.optimize_coding = TRUE;
+    jpeg_start_compress(&cinfo, TRUE);
+
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW row = const_cast<JSAMPROW>(
+            &image.pixels[static_cast<size_t>(cinfo.next_scanline) * image.width * 3]);
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+
+    out.assign(reinterpret_cast<const char*>(output->buffer), output->size);
+    return true;
+}
+#endif
+
+#ifdef HYNI_HAVE_PNG
+bool decode_png(const std::string& bytes, const image_limits& limits, raster& image) {
+    png_image png{};
+    png.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_memory(&png, bytes.data(), bytes.size())) {
+        return false;
+    }
+    if (!within_pixel_limit(png.width, png.height, limits)) {
+        png_image_free(&png);
+        return false;
+    }
+
+    png.format = PNG_FORMAT_RGBA;
+    image.width = static_cast<int>(png.width);
+    image.height = static_cast<int>(png.height);
+    image.source_width = image.width;
+    image.source_height = image.height;
+    image.channels = 4;
+    image.pixels.resize(PNG_IMAGE_SIZE(png));
+
+    if (!png_image_finish_read(&png, nullptr, image.pixels.data(), 0, nullptr)) {
+        png_image_free(&png);
+        return false;
+    }
+    return true;
+}
+#endif
+
+bool decode(const std::string& bytes, const std::string& media_type, const image_limits& limits, raster& image) {
+#ifdef HYNI_HAVE_JPEG
+    if (media_type == "image/jpeg" || media_type == "image/jpg") {
+        return decode_jpeg(bytes, limits, image);
+    }
+#endif
+#ifdef HYNI_HAVE_PNG
+    if (media_type == "image/png") {
+        return decode_png(bytes, limits, image);
+    }
+#endif
+    (void)bytes;
+    (void)media_type;
+    (void)limits;
+    (void)image;
+    return false;
+}
+
+} // anonymous namespace
+
+image_limits image_limits::from_schema(const nlohmann::json& schema) {
+    image_limits limits;
+    if (!schema.contains("multimodal")) {
+        return limits;
+    }
+
+    const auto& multimodal = schema["multimodal"];
+    limits.max_dimension = multimodal.value("max_image_dimension", limits.max_dimension);
+    limits.quality = multimodal.value("image_quality", limits.quality);
+    limits.max_bytes = multimodal.value("max_image_size", limits.max_bytes);
+    limits.max_pixels = multimodal.value("max_image_pixels", limits.max_pixels);
+    return limits;
+}
+
+std::string processed_image::to_data_uri() const {
+    return "data:" + media_type + ";base64," + response_utils::base64_encode(data);
+}
+
+media_preprocessor::media_preprocessor(size_t workers)
+    : m_memory(memory_governor::instance().register_component("media_preprocessor.queue", 0.0, nullptr)) {
+    if (workers == 0) {
+        workers = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 4);
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        m_workers.emplace_back(&media_preprocessor::worker_loop, this);
+    }
+}
+
+media_preprocessor::~media_preprocessor() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+media_preprocessor& media_preprocessor::instance() {
+    static media_preprocessor preprocessor;
+    return preprocessor;
+}
+
+bool media_preprocessor::available() noexcept {
+#ifdef HYNI_HAVE_JPEG
+    return true;
+#else
+    return false;
+#endif
+}
+
+processed_image media_preprocessor::process(std::string bytes, const std::string& media_type,
+                                            const image_limits& limits) const {
+    HYNI_PERF_PROBE("media_preprocessor::process");
+
+    processed_image result;
+    result.original_bytes = bytes.size();
+    result.media_type = media_type;
+
+    raster image;
+    if (!available() || !decode(bytes, media_type, limits, image) || has_transparency(image)) {
+        result.data = std::move(bytes);
+        return result;
+    }
+
+    result.width = image.source_width;
+    result.height = image.source_height;
+
+    // Sized from the source, as a JPEG may already have been decoded smaller
+    const int longest = std::max(image.source_width, image.source_height);
+    const bool resize = limits.max_dimension > 0 && longest > limits.max_dimension;
+    if (resize) {
+        const double scale = static_cast<double>(limits.max_dimension) / longest;
+        int width = std::max(1, static_cast<int>(std::lround(image.source_width * scale)));
+        int height = std::max(1, static_cast<int>(std::lround(image.source_height * scale)));
+        if (width != image.width || height != image.height) {
+            image = downscale(image, width, height);
+        }
+    }
+
+#ifdef HYNI_HAVE_JPEG
+    std::string encoded;
+    drop_alpha(image);
+    // A re-encode that is not smaller is only worth keeping if it also shrank the image
+    if (encode_jpeg(image, limits.quality, encoded) &&
+        (resize || encoded.size() < bytes.size())) {
+        result.data = std::move(encoded);
+        result.media_type = "image/jpeg";
+        result.width = image.width;
+        result.height = image.height;
+        result.recompressed = true;
+        return result;
+    }
+#endif
+
+    result.data = std::move(bytes);
+    return result;
+}
+
+processed_image media_preprocessor::process_file(const std::filesystem::path& path,
+                                                 const std::string& media_type,
+                                                 const image_limits& limits) const {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        throw std::runtime_error("Failed to open image file: " + path.string() + ": " + ec.message());
+    }
+    // Without codecs the file is sent as it is, so the upload limit applies already
+    size_t limit = limits.max_file_bytes;
+    if (!available() && limits.max_bytes > 0) {
+        limit = limit > 0 ? std::min(limit, limits.max_bytes) : limits.max_bytes;
+    }
+    if (limit > 0 && size > limit) {
+        throw std::runtime_error("Image file too large: " + path.string() + " has " + std::to_string(size) +
+                                 " bytes, the limit is " + std::to_string(limit));
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open image file: " + path.string());
+    }
+
+    std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return process(std::move(bytes), media_type, limits);
+}
+
+std::future<processed_image> media_preprocessor::submit(std::filesystem::path path,
+                                                        std::string media_type,
+                                                        image_limits limits) {
+    // The file's bytes are accounted from now until the job has processed them
+    std::error_code ec;
+    const auto file_bytes = std::filesystem::file_size(path, ec);
+    auto task = std::make_shared<std::packaged_task<processed_image()>>(
+        [this, path = std::move(path), media_type = std::move(media_type), limits,
+         memory = m_memory.hold(ec ? 0 : static_cast<size_t>(file_bytes))] {
+            return process_file(path, media_type, limits);
+        });
+    auto future = task->get_future();
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_queue.emplace_back([task] { (*task)(); });
+    }
+    m_cv.notify_one();
+    return future;
+}
+
+void media_preprocessor::worker_loop() {
+    std::unique_lock lock(m_mutex);
+    while (true) {
+        m_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+        if (m_queue.empty()) {
+            return;
+        }
+
+        auto job = std::move(m_queue.front());
+        m_queue.pop_front();
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
+
+} // hyni
@@ -0,0 +1,140 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "memory_governor.h"
+#include <nlohmann/json.hpp>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @brief Image limits taken from a schema's `multimodal` block
+ */
+struct image_limits {
+    int max_dimension = 0;   ///< Longest edge in pixels; larger images are downscaled, 0 = keep size
+    int quality = 85;        ///< JPEG quality (1-100) used when re-encoding
+    size_t max_bytes = 0;    ///< Provider upload limit for one image, 0 = unlimited
+    size_t max_pixels = 40'000'000;  ///< Largest image decoded, after JPEG scaling; bigger ones pass through
+    size_t max_file_bytes = 64 * 1024 * 1024;  ///< Largest file process_file() reads, 0 = unlimited
+
+    /**
+     * @brief Reads `max_image_dimension`, `image_quality`, `max_image_size` and `max_image_pixels`
+     */
+    static image_limits from_schema(const nlohmann::json& schema);
+};
+
+/**
+ * @brief Result of preprocessing one image
+ */
+struct processed_image {
+    std::string data;             ///< Encoded image bytes (not base64)
+    std::string media_type;       ///< Media type of data, may differ from the input
+    int width = 0;                ///< Output width, 0 if the image was not decoded
+    int height = 0;               ///< Output height, 0 if the image was not decoded
+    size_t original_bytes = 0;    ///< Size of the input
+    bool recompressed = false;    ///< True if data was re-encoded
+
+    /**
+     * @brief Formats the image as a `data:<type>;base64,...` URI
+     */
+    [[nodiscard]] std::string to_data_uri() const;
+};
+
+/**
+ * @class media_preprocessor
+ * @brief Downscales and recompresses images before upload
+ *
+ * Providers resize large images server-side, so pixels beyond the schema's
+ * `max_image_dimension` only cost upload time and base64 inflation. JPEG and
+ * PNG inputs are decoded, area-averaged down to the limit and re-encoded as
+ * JPEG. Large JPEGs are decoded at 1/2, 1/4 or 1/8 scale by libjpeg first.
+ * Images with transparency, unsupported formats, and re-encodes that
+ * would come out larger are passed through unchanged, as are images whose
+ * header claims more than image_limits::max_pixels: they are rejected before
+ * any pixel memory is allocated.
+ *
+ * Decoding and encoding need libjpeg (and libpng for PNG input) at build time;
+ * without them every image is passed through.
+ *
+ * @note process() is thread-safe. submit() runs it on the preprocessor's worker pool.
+ */
+class media_preprocessor {
+public:
+    /**
+     * @param workers Worker threads for submit(), 0 = min(4, hardware threads)
+     */
+    explicit media_preprocessor(size_t workers = 0);
+    ~media_preprocessor();
+
+    media_preprocessor(const media_preprocessor&) = delete;
+    media_preprocessor& operator=(const media_preprocessor&) = delete;
+
+    /**
+     * @brief Shared preprocessor used by general_context
+     */
+    static media_preprocessor& instance();
+
+    /**
+     * @brief True if images can be decoded and re-encoded in this build
+     */
+    [[nodiscard]] static bool available() noexcept;
+
+    /**
+     * @brief Preprocesses encoded image bytes in the calling thread
+     */
+    [[nodiscard]] processed_image process(std::string bytes, const std::string& media_type,
+                                          const image_limits& limits) const;
+
+    /**
+     * @brief Reads and preprocesses an image file in the calling thread
+     *
+     * The file's size is checked before it is read: files over max_file_bytes,
+     * and files over max_bytes that this build could not shrink, are rejected.
+     * @throws std::runtime_error if the file cannot be read or is too large
+     */
+    [[nodiscard]] processed_image process_file(const std::filesystem::path& path,
+                                               const std::string& media_type,
+                                               const image_limits& limits) const;
+
+    /**
+     * @brief Queues an image file for preprocessing on the worker pool
+     *
+     * Lets callers with several attachments decode and encode them in parallel,
+     * e.g. while a previous request is still in flight.
+     */
+    [[nodiscard]] std::future<processed_image> submit(std::filesystem::path path,
+                                                      std::string media_type,
+                                                      image_limits limits);
+
+    [[nodiscard]] size_t worker_count() const noexcept { return m_workers.size(); }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::function<void()>> m_queue;
+    std::vector<std::thread> m_workers;
+    bool m_stop = false;
+    memory_governor::registration m_memory;   // input of queued and running jobs, only accounted
+
+    void worker_loop();
+};
+
+} // hyni
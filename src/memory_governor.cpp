@@ -0,0 +1,384 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "memory_governor.h"
+#include "logger.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace hyni {
+
+// Counters are guarded by the governor's mutex, active by shrink_mutex
+struct memory_governor::component {
+    std::string name;
+    double reclaim_cost = 0.0;
+    shrink_callback shrink;
+    size_t bytes = 0;
+    size_t peak_bytes = 0;
+    size_t reclaimed_bytes = 0;
+    size_t shrink_calls = 0;
+    bool registered = true;
+
+    std::mutex shrink_mutex;
+    bool active = true;
+};
+
+namespace {
+
+// Heap behind a JSON value, not counting the value itself
+size_t json_heap_bytes(const nlohmann::json& value) {
+    // libstdc++ keeps strings of up to 15 bytes inline
+    constexpr size_t SSO_CAPACITY = 15;
+    constexpr size_t MAP_NODE_OVERHEAD = 32;
+    auto string_bytes = [&](const std::string& s) { return s.capacity() > SSO_CAPACITY ? s.capacity() + 1 : 0; };
+
+    switch (value.type()) {
+    case nlohmann::json::value_t::object: {
+        size_t bytes = sizeof(nlohmann::json::object_t);
+        for (const auto& [key, item] : value.get_ref<const nlohmann::json::object_t&>()) {
+            bytes += MAP_NODE_OVERHEAD + sizeof(std::string) + string_bytes(key) + sizeof(nlohmann::json) +
+                     json_heap_bytes(item);
+        }
+        return bytes;
+    }
+    case nlohmann::json::value_t::array: {
+        const auto& array = value.get_ref<const nlohmann::json::array_t&>();
+        size_t bytes = sizeof(nlohmann::json::array_t) + array.capacity() * sizeof(nlohmann::json);
+        for (const auto& item : array) {
+            bytes += json_heap_bytes(item);
+        }
+        return bytes;
+    }
+    case nlohmann::json::value_t::string:
+        return sizeof(std::string) + string_bytes(value.get_ref<const std::string&>());
+    case nlohmann::json::value_t::binary:
+        return sizeof(nlohmann::json::binary_t) + value.get_binary().capacity();
+    default:
+        return 0;
+    }
+}
+
+} // anonymous namespace
+
+memory_governor::registration::registration(memory_governor* governor, std::shared_ptr<component> entry)
+    : m_governor(governor)
+    , m_entry(std::move(entry)) {
+}
+
+memory_governor::registration::~registration() {
+    reset();
+}
+
+memory_governor::registration::registration(registration&& other) noexcept
+    : m_governor(std::exchange(other.m_governor, nullptr))
+    , m_entry(std::move(other.m_entry)) {
+}
+
+memory_governor::registration& memory_governor::registration::operator=(registration&& other) noexcept {
+    if (this != &other) {
+        reset();
+        m_governor = std::exchange(other.m_governor, nullptr);
+        m_entry = std::move(other.m_entry);
+    }
+    return *this;
+}
+
+void memory_governor::registration::update(size_t bytes) {
+    if (m_entry) {
+        m_governor->update(*m_entry, bytes);
+    }
+}
+
+void memory_governor::registration::add(std::ptrdiff_t delta) {
+    if (m_entry) {
+        m_governor->adjust(*m_entry, delta, true);
+    }
+}
+
+void memory_governor::registration::account(std::ptrdiff_t delta) {
+    if (m_entry) {
+        m_governor->adjust(*m_entry, delta, false);
+    }
+}
+
+memory_governor::charge memory_governor::registration::hold(size_t bytes) {
+    if (!m_entry) {
+        return {};
+    }
+    m_governor->adjust(*m_entry, static_cast<std::ptrdiff_t>(bytes), true);
+    return charge(m_governor, m_entry, bytes);
+}
+
+size_t memory_governor::registration::bytes() const {
+    if (!m_entry) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(m_governor->m_mutex);
+    return m_entry->bytes;
+}
+
+void memory_governor::registration::reset() {
+    if (m_entry) {
+        {
+            std::lock_guard<std::mutex> lock(m_entry->shrink_mutex);
+            m_entry->active = false;
+        }
+        m_governor->unregister(m_entry);
+        m_entry.reset();
+        m_governor = nullptr;
+    }
+}
+
+memory_governor::charge::charge(memory_governor* governor, std::shared_ptr<component> entry, size_t bytes)
+    : m_governor(governor)
+    , m_entry(std::move(entry))
+    , m_bytes(bytes) {
+}
+
+memory_governor::charge::~charge() {
+    resize(0);
+}
+
+memory_governor::charge::charge(charge&& other) noexcept
+    : m_governor(std::exchange(other.m_governor, nullptr))
+    , m_entry(std::move(other.m_entry))
+    , m_bytes(std::exchange(other.m_bytes, 0)) {
+}
+
+memory_governor::charge& memory_governor::charge::operator=(charge&& other) noexcept {
+    if (this != &other) {
+        resize(0);
+        m_governor = std::exchange(other.m_governor, nullptr);
+        m_entry = std::move(other.m_entry);
+        m_bytes = std::exchange(other.m_bytes, 0);
+    }
+    return *this;
+}
+
+void memory_governor::charge::resize(size_t bytes) {
+    if (m_entry && bytes != m_bytes) {
+        const auto delta = static_cast<std::ptrdiff_t>(bytes) - static_cast<std::ptrdiff_t>(m_bytes);
+        m_governor->adjust(*m_entry, delta, delta > 0);
+    }
+    m_bytes = bytes;
+}
+
+memory_governor::memory_governor(size_t budget_bytes, double low_watermark) {
+    set_budget(budget_bytes, low_watermark);
+}
+
+memory_governor::~memory_governor() = default;
+
+memory_governor& memory_governor::instance() {
+    static memory_governor governor;
+    return governor;
+}
+
+void memory_governor::set_budget(size_t budget_bytes, double low_watermark) {
+    if (!(low_watermark > 0.0 && low_watermark <= 1.0)) {
+        throw std::invalid_argument("memory_governor low_watermark must be in (0, 1]");
+    }
+    bool over = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_budget = budget_bytes;
+        m_low_watermark = low_watermark;
+        over = m_budget > 0 && m_total > m_budget;
+    }
+    if (over) {
+        enforce_budget();
+    }
+}
+
+size_t memory_governor::get_budget() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_budget;
+}
+
+memory_governor::registration memory_governor::register_component(std::string name, double reclaim_cost,
+                                                                  shrink_callback shrink) {
+    auto entry = std::make_shared<component>();
+    entry->name = std::move(name);
+    entry->reclaim_cost = reclaim_cost;
+    entry->shrink = std::move(shrink);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_components.push_back(entry);
+    return registration(this, std::move(entry));
+}
+
+void memory_governor::update(component& entry, size_t bytes) {
+    bool over = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        over = set_bytes_locked(entry, bytes);
+    }
+    if (over) {
+        enforce_budget();
+    }
+}
+
+// Read and write under one lock, so concurrent deltas are never lost
+void memory_governor::adjust(component& entry, std::ptrdiff_t delta, bool enforce) {
+    bool over = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Charges can outlive their registration
+        if (!entry.registered) {
+            return;
+        }
+        const size_t bytes = delta < 0 ? entry.bytes - std::min(entry.bytes, static_cast<size_t>(-delta))
+                                       : entry.bytes + static_cast<size_t>(delta);
+        over = set_bytes_locked(entry, bytes) && enforce;
+    }
+    if (over) {
+        enforce_budget();
+    }
+}
+
+bool memory_governor::set_bytes_locked(component& entry, size_t bytes) {
+    m_total = m_total - entry.bytes + bytes;
+    entry.bytes = bytes;
+    entry.peak_bytes = std::max(entry.peak_bytes, bytes);
+    m_peak_total = std::max(m_peak_total, m_total);
+    const bool over = m_budget > 0 && m_total > m_budget;
+    if (over) {
+        ++m_pressure_events;
+    }
+    return over;
+}
+
+void memory_governor::unregister(const std::shared_ptr<component>& entry) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = std::find(m_components.begin(), m_components.end(), entry);
+    if (it != m_components.end()) {
+        m_total -= entry->bytes;
+        entry->registered = false;
+        m_components.erase(it);
+    }
+}
+
+void memory_governor::enforce_budget() {
+    size_t excess = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto target = static_cast<size_t>(static_cast<double>(m_budget) * m_low_watermark);
+        excess = m_budget > 0 && m_total > target ? m_total - target : 0;
+    }
+    if (excess == 0) {
+        return;
+    }
+    reclaim(excess);
+    size_t total = 0;
+    size_t budget = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        total = m_total;
+        budget = m_budget;
+    }
+    // Not under the lock: the logger's file output reports its queue here
+    if (budget > 0 && total > budget) {
+        LOG_WARNING_SAMPLED("memory_governor: " + std::to_string(total) + " bytes in use, over the budget of " +
+                            std::to_string(budget) + " after reclaiming");
+    }
+}
+
+size_t memory_governor::reclaim(size_t bytes) {
+    // One pass at a time; shrink callbacks that report usage must not start another
+    if (bytes == 0 || m_reclaiming.exchange(true)) {
+        return 0;
+    }
+
+    std::vector<std::shared_ptr<component>> order;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        order = m_components;
+        std::stable_sort(order.begin(), order.end(), [](const auto& a, const auto& b) {
+            return a->reclaim_cost != b->reclaim_cost ? a->reclaim_cost < b->reclaim_cost : a->bytes > b->bytes;
+        });
+    }
+
+    size_t freed = 0;
+    for (const auto& entry : order) {
+        if (freed >= bytes) {
+            break;
+        }
+        std::lock_guard<std::mutex> shrink_lock(entry->shrink_mutex);
+        if (!entry->active || !entry->shrink) {
+            continue;
+        }
+        size_t before = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            before = entry->bytes;
+        }
+        const size_t wanted = std::min(bytes - freed, before);
+        if (wanted == 0) {
+            continue;
+        }
+
+        size_t returned = 0;
+        try {
+            returned = entry->shrink(wanted);
+        } catch (const std::exception& e) {
+            LOG_ERROR_SAMPLED("memory_governor: shrinking " + entry->name + " failed: " + e.what());
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t released = 0;
+        if (entry->bytes < before) {
+            released = before - entry->bytes;   // reported through update()
+        } else {
+            released = std::min(returned, entry->bytes);
+            entry->bytes -= released;
+            m_total -= released;
+        }
+        entry->reclaimed_bytes += released;
+        ++entry->shrink_calls;
+        m_reclaimed += released;
+        freed += released;
+    }
+
+    m_reclaiming = false;
+    return freed;
+}
+
+size_t memory_governor::total_bytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_total;
+}
+
+std::vector<memory_usage> memory_governor::usage() const {
+    std::vector<memory_usage> result;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        result.reserve(m_components.size());
+        for (const auto& entry : m_components) {
+            result.push_back({entry->name, entry->reclaim_cost, entry->bytes, entry->peak_bytes,
+                              entry->reclaimed_bytes, entry->shrink_calls});
+        }
+    }
+    std::stable_sort(result.begin(), result.end(),
+                     [](const auto& a, const auto& b) { return a.reclaim_cost < b.reclaim_cost; });
+    return result;
+}
+
+memory_governor_stats memory_governor::get_stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return {m_total, m_peak_total, m_budget, m_pressure_events, m_reclaimed, m_components.size()};
+}
+
+size_t memory_governor::estimate_json_bytes(const nlohmann::json& value) {
+    return sizeof(nlohmann::json) + json_heap_bytes(value);
+}
+
+} // hyni
@@ -0,0 +1,230 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @brief Accounting of one registered component, see memory_governor::usage()
+ */
+struct memory_usage {
+    std::string name;
+    double reclaim_cost = 0.0;
+    size_t bytes = 0;               ///< Last reported usage
+    size_t peak_bytes = 0;
+    size_t reclaimed_bytes = 0;     ///< Freed through the shrink callback, in total
+    size_t shrink_calls = 0;
+};
+
+/**
+ * @brief Process-wide counters of a memory_governor
+ */
+struct memory_governor_stats {
+    size_t total_bytes = 0;
+    size_t peak_total_bytes = 0;
+    size_t budget_bytes = 0;        ///< 0 when unlimited
+    size_t pressure_events = 0;     ///< Updates that found the total over budget
+    size_t reclaimed_bytes = 0;
+    size_t components = 0;
+};
+
+/**
+ * @class memory_governor
+ * @brief Keeps the memory of hyni's caches, pools and buffers under one budget
+ *
+ * Components that hold memory they could give back register with a name, a
+ * reclaim cost and a shrink callback, and report their usage as it changes.
+ * When an update takes the total over the budget, the governor asks
+ * components to shrink, cheapest reclaim cost first (largest first among
+ * equal costs), until the total is back under low_watermark times the budget.
+ * Shedding is cooperative: a component frees what it can and may free less
+ * than asked, or nothing.
+ *
+ * Reclaiming runs on the thread whose update crossed the budget, one pass at a
+ * time; updates arriving meanwhile are only counted. Report usage without
+ * holding locks the shrink callback takes.
+ *
+ * @note Thread-safe. Registrations must not outlive the governor; instance()
+ *       lives for the whole process.
+ */
+class memory_governor final {
+public:
+    /**
+     * @brief Frees up to bytes; either reports the new usage through update() or returns the bytes freed
+     */
+    using shrink_callback = std::function<size_t(size_t bytes)>;
+
+    struct component;
+    class registration;
+
+    /**
+     * @brief Bytes held against a component until the charge is destroyed
+     *
+     * For memory that is freed elsewhere than where it was accounted, such as a
+     * cached schema that contexts keep alive after the cache dropped it. A charge
+     * may outlive its registration; it then no longer counts.
+     */
+    class charge {
+    public:
+        charge() = default;
+        ~charge();
+
+        charge(charge&& other) noexcept;
+        charge& operator=(charge&& other) noexcept;
+        charge(const charge&) = delete;
+        charge& operator=(const charge&) = delete;
+
+        /**
+         * @brief Changes the bytes held; growing may reclaim like registration::add()
+         */
+        void resize(size_t bytes);
+
+        [[nodiscard]] size_t bytes() const noexcept { return m_bytes; }
+        explicit operator bool() const noexcept { return m_entry != nullptr; }
+
+    private:
+        friend class registration;
+        charge(memory_governor* governor, std::shared_ptr<component> entry, size_t bytes);
+
+        memory_governor* m_governor = nullptr;
+        std::shared_ptr<component> m_entry;
+        size_t m_bytes = 0;
+    };
+
+    /**
+     * @brief A component's membership; unregisters it when destroyed
+     */
+    class registration {
+    public:
+        registration() = default;
+        registration(memory_governor* governor, std::shared_ptr<component> entry);
+        ~registration();
+
+        registration(registration&& other) noexcept;
+        registration& operator=(registration&& other) noexcept;
+        registration(const registration&) = delete;
+        registration& operator=(const registration&) = delete;
+
+        /**
+         * @brief Reports the component's current usage; may reclaim from others, or this one
+         */
+        void update(size_t bytes);
+
+        /**
+         * @brief Adjusts the reported usage by delta bytes, atomically with other updates
+         */
+        void add(std::ptrdiff_t delta);
+
+        /**
+         * @brief Adjusts the reported usage by delta bytes without reclaiming
+         *
+         * For callers holding locks that a shrink callback or the logger may take;
+         * the budget is enforced by the next update that needs it.
+         */
+        void account(std::ptrdiff_t delta);
+
+        /**
+         * @brief Adds bytes to the usage until the returned charge is destroyed
+         */
+        [[nodiscard]] charge hold(size_t bytes);
+
+        [[nodiscard]] size_t bytes() const;
+        explicit operator bool() const noexcept { return m_entry != nullptr; }
+
+        /**
+         * @brief Unregisters now, waiting for a running shrink callback to return
+         */
+        void reset();
+
+    private:
+        memory_governor* m_governor = nullptr;
+        std::shared_ptr<component> m_entry;
+    };
+
+    /**
+     * @param budget_bytes Limit for the total; 0 for none
+     * @param low_watermark Share of the budget reclaiming brings the total down to
+     */
+    explicit memory_governor(size_t budget_bytes = 0, double low_watermark = 0.9);
+    ~memory_governor();
+
+    memory_governor(const memory_governor&) = delete;
+    memory_governor& operator=(const memory_governor&) = delete;
+
+    /**
+     * @brief The governor hyni's own components register with, unlimited until set_budget()
+     */
+    static memory_governor& instance();
+
+    /**
+     * @brief Changes the budget, reclaiming at once if the total is over it
+     * @throws std::invalid_argument If low_watermark is not in (0, 1]
+     */
+    void set_budget(size_t budget_bytes, double low_watermark = 0.9);
+    [[nodiscard]] size_t get_budget() const;
+
+    /**
+     * @param name Shown in usage(); need not be unique
+     * @param reclaim_cost Relative cost of rebuilding what the component frees; lower is shed first
+     * @param shrink Called with the bytes wanted from this component; may be null for usage that
+     *        is only accounted
+     */
+    [[nodiscard]] registration register_component(std::string name, double reclaim_cost, shrink_callback shrink);
+
+    /**
+     * @brief Asks components for bytes, cheapest first, whatever the budget
+     * @return Bytes freed
+     */
+    size_t reclaim(size_t bytes);
+
+    [[nodiscard]] size_t total_bytes() const;
+
+    /**
+     * @brief Per-component accounting, cheapest reclaim cost first
+     */
+    [[nodiscard]] std::vector<memory_usage> usage() const;
+
+    [[nodiscard]] memory_governor_stats get_stats() const;
+
+    /**
+     * @brief Approximate heap bytes of a JSON value: nodes, strings and container overhead
+     */
+    [[nodiscard]] static size_t estimate_json_bytes(const nlohmann::json& value);
+
+private:
+    void update(component& entry, size_t bytes);
+    void adjust(component& entry, std::ptrdiff_t delta, bool enforce);
+    bool set_bytes_locked(component& entry, size_t bytes);
+    void unregister(const std::shared_ptr<component>& entry);
+    void enforce_budget();
+
+    mutable std::mutex m_mutex;
+    std::vector<std::shared_ptr<component>> m_components;
+    size_t m_budget = 0;
+    double m_low_watermark = 0.9;
+    size_t m_total = 0;
+    size_t m_peak_total = 0;
+    size_t m_pressure_events = 0;
+    size_t m_reclaimed = 0;
+    std::atomic<bool> m_reclaiming{false};
+};
+
+} // hyni
@@ -0,0 +1,203 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "model_cascade.h"
+#include "chat_api.h"
+#include "logger.h"
+#include "prompt_minifier.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace hyni {
+
+namespace {
+
+std::string lowercase(std::string_view text) {
+    std::string lower(text);
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return lower;
+}
+
+std::string_view trim(std::string_view text) {
+    const auto first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    const auto last = text.find_last_not_of(" \t\r\n");
+    return text.substr(first, last - first + 1);
+}
+
+} // anonymous namespace
+
+acceptance_check cascade_checks::no_refusal(std::vector<std::string> markers) {
+    if (markers.empty()) {
+        markers = {"i'm sorry", "i am sorry", "i cannot", "i can't", "i am unable", "i'm unable",
+                   "i'm not sure", "i am not sure", "i don't know", "i do not know", "as an ai"};
+    }
+    for (auto& marker : markers) {
+        marker = lowercase(marker);
+    }
+    return [markers = std::move(markers)](const std::string& response) {
+        const std::string lower = lowercase(response);
+        return std::none_of(markers.begin(), markers.end(), [&](const std::string& marker) {
+            return lower.find(marker) != std::string::npos;
+        });
+    };
+}
+
+acceptance_check cascade_checks::valid_json() {
+    return [](const std::string& response) {
+        std::string_view text = trim(response);
+        // Models like to wrap JSON in a ```json fence
+        if (text.size() >= 6 && text.substr(0, 3) == "```" && text.substr(text.size() - 3) == "```") {
+            text.remove_suffix(3);
+            text = text.substr(std::min(text.find('\n'), text.size()));
+        }
+        return nlohmann::json::accept(trim(text));
+    };
+}
+
+acceptance_check cascade_checks::min_length(size_t min_chars) {
+    return [min_chars](const std::string& response) {
+        return trim(response).size() >= min_chars;
+    };
+}
+
+acceptance_check cascade_checks::all_of(std::vector<acceptance_check> checks) {
+    return [checks = std::move(checks)](const std::string& response) {
+        return std::all_of(checks.begin(), checks.end(),
+                           [&](const acceptance_check& check) { return check(response); });
+    };
+}
+
+model_cascade::model_cascade(std::shared_ptr<chat_api> api, std::vector<cascade_tier> tiers,
+                             acceptance_check check)
+    : m_api(std::move(api))
+    , m_tiers(std::move(tiers))
+    , m_check(std::move(check)) {
+    if (!m_api) {
+        throw std::invalid_argument("model_cascade needs a chat_api");
+    }
+    if (m_tiers.empty()) {
+        throw std::invalid_argument("model_cascade needs at least one tier");
+    }
+    reset_stats();
+}
+
+void model_cascade::reset_stats() {
+    m_stats.assign(m_tiers.size(), {});
+    for (size_t i = 0; i < m_tiers.size(); ++i) {
+        m_stats[i].model = m_tiers[i].model;
+    }
+}
+
+cascade_result model_cascade::send_message(const std::string& message, progress_callback cancel_check) {
+    general_context& context = m_api->get_context();
+    const std::string original_model = context.get_model();
+
+    // Put the caller's model back however the cascade ends
+    struct model_restorer {
+        general_context& context;
+        const std::string& model;
+        ~model_restorer() {
+            if (!model.empty() && context.get_model() != model) {
+                context.set_model(model);
+            }
+        }
+    } restorer{context, original_model};
+
+    cascade_result result;
+    for (size_t i = 0; i < m_tiers.size(); ++i) {
+        const cascade_tier& tier = m_tiers[i];
+        cascade_tier_stats& stats = m_stats[i];
+        const bool last = i + 1 == m_tiers.size();
+
+        context.set_model(tier.model);
+        ++stats.requests;
+        const auto start = std::chrono::steady_clock::now();
+        auto elapsed_ms = [&] {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+
+        std::string text;
+        try {
+            text = m_api->send_message(message, cancel_check);
+        } catch (const std::exception& e) {
+            const double latency = elapsed_ms();
+            ++stats.errors;
+            stats.latency_ms += latency;
+            result.latency_ms += latency;
+            if (last || (cancel_check && cancel_check())) {
+                throw;
+            }
+            ++stats.escalated;
+            LOG_WARNING_SAMPLED("model_cascade: " + tier.model + " failed, escalating: " + e.what());
+            continue;
+        }
+
+        const double latency = elapsed_ms();
+        const size_t input_tokens = context.estimate_request_tokens();
+        const size_t output_tokens = prompt_minifier::estimate_tokens(text);
+        const double cost = (static_cast<double>(input_tokens) * tier.input_cost_per_mtok +
+                             static_cast<double>(output_tokens) * tier.output_cost_per_mtok) / 1e6;
+        stats.latency_ms += latency;
+        stats.cost += cost;
+        result.latency_ms += latency;
+        result.cost += cost;
+
+        const bool accepted = !m_check || m_check(text);
+        if (accepted || last) {
+            if (accepted) {
+                ++stats.accepted;
+            }
+            result.text = std::move(text);
+            result.model = tier.model;
+            result.tier = i;
+            result.accepted = accepted;
+            return result;
+        }
+        ++stats.escalated;
+    }
+    return result;  // not reached: the last tier returns or throws
+}
+
+std::string model_cascade::report() const {
+    std::ostringstream out;
+    out << std::left << std::setw(24) << "model"
+        << std::right << std::setw(10) << "requests"
+        << std::setw(10) << "hit rate"
+        << std::setw(11) << "escalated"
+        << std::setw(8) << "errors"
+        << std::setw(14) << "avg ms"
+        << std::setw(12) << "cost" << '\n';
+
+    double total_cost = 0.0;
+    for (const auto& stats : m_stats) {
+        out << std::left << std::setw(24) << stats.model
+            << std::right << std::setw(10) << stats.requests
+            << std::setw(9) << std::fixed << std::setprecision(1) << stats.hit_rate() * 100.0 << '%'
+            << std::setw(11) << stats.escalated
+            << std::setw(8) << stats.errors
+            << std::setw(14) << std::setprecision(1) << stats.average_latency_ms()
+            << std::setw(12) << std::setprecision(4) << stats.cost << '\n';
+        total_cost += stats.cost;
+    }
+    out << std::left << std::setw(24) << "total" << std::right << std::setw(65) << std::fixed
+        << std::setprecision(4) << total_cost << '\n';
+    return out.str();
+}
+
+} // hyni
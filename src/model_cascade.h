@@ -0,0 +1,142 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "http_client.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace hyni {
+
+class chat_api;
+
+/**
+ * @brief One model of a cascade, cheapest first
+ */
+struct cascade_tier {
+    std::string model;
+    double input_cost_per_mtok = 0.0;   ///< Price per million prompt tokens
+    double output_cost_per_mtok = 0.0;  ///< Price per million response tokens
+};
+
+/**
+ * @brief Decides whether a tier's response is good enough to return
+ */
+using acceptance_check = std::function<bool(const std::string& response)>;
+
+/**
+ * @class cascade_checks
+ * @brief Common acceptance checks for model_cascade
+ */
+class cascade_checks final {
+public:
+    /**
+     * @brief Rejects responses containing a refusal or uncertainty marker, case-insensitively
+     * @param markers Phrases to look for; empty for a built-in English list
+     */
+    [[nodiscard]] static acceptance_check no_refusal(std::vector<std::string> markers = {});
+
+    /**
+     * @brief Accepts responses that parse as JSON, optionally inside a ``` fence
+     */
+    [[nodiscard]] static acceptance_check valid_json();
+
+    /**
+     * @brief Accepts responses of at least min_chars characters, ignoring surrounding whitespace
+     */
+    [[nodiscard]] static acceptance_check min_length(size_t min_chars);
+
+    /**
+     * @brief Accepts responses that pass every check
+     */
+    [[nodiscard]] static acceptance_check all_of(std::vector<acceptance_check> checks);
+};
+
+/**
+ * @brief Counters of one cascade tier
+ */
+struct cascade_tier_stats {
+    std::string model;
+    size_t requests = 0;        ///< Prompts sent to this tier
+    size_t accepted = 0;        ///< Responses that passed the check and were returned
+    size_t escalated = 0;       ///< Responses rejected, or errors, passed on to the next tier
+    size_t errors = 0;          ///< Requests that failed
+    double latency_ms = 0.0;    ///< Total time spent in this tier
+    double cost = 0.0;          ///< Total estimated cost of this tier
+
+    [[nodiscard]] double hit_rate() const noexcept
+    { return requests ? static_cast<double>(accepted) / static_cast<double>(requests) : 0.0; }
+    [[nodiscard]] double average_latency_ms() const noexcept
+    { return requests ? latency_ms / static_cast<double>(requests) : 0.0; }
+};
+
+/**
+ * @brief Response of a cascade and what it took to get it
+ */
+struct cascade_result {
+    std::string text;
+    std::string model;      ///< Model that produced text
+    size_t tier = 0;        ///< Index of that model in the cascade
+    bool accepted = false;  ///< False if no tier passed the check and text is the last tier's answer
+    double latency_ms = 0.0;
+    double cost = 0.0;      ///< Estimated cost of all tiers tried
+};
+
+/**
+ * @class model_cascade
+ * @brief Sends a prompt to the cheapest model first, escalating only when its answer is rejected
+ *
+ * Each tier sets the model on the chat_api's context and sends the prompt. The
+ * first response that passes the acceptance check is returned; a rejected
+ * response or a failed request moves on to the next tier. If the last tier's
+ * response is rejected as well, it is returned anyway, marked not accepted.
+ * The context's model is restored afterwards.
+ *
+ * Costs are estimated from the tiers' prices, general_context::estimate_request_tokens()
+ * and prompt_minifier::estimate_tokens of the response, since responses do not
+ * carry token usage through chat_api.
+ *
+ * @note NOT thread-safe, like chat_api.
+ */
+class model_cascade {
+public:
+    /**
+     * @throws std::invalid_argument If api is null or tiers is empty
+     */
+    model_cascade(std::shared_ptr<chat_api> api, std::vector<cascade_tier> tiers, acceptance_check check);
+
+    /**
+     * @brief Sends message as the only user message, like chat_api::send_message()
+     * @throws The last tier's exception if every tier fails
+     */
+    cascade_result send_message(const std::string& message, progress_callback cancel_check = nullptr);
+
+    [[nodiscard]] const std::vector<cascade_tier_stats>& get_stats() const noexcept { return m_stats; }
+    void reset_stats();
+
+    /**
+     * @brief Human-readable table of get_stats()
+     */
+    [[nodiscard]] std::string report() const;
+
+    [[nodiscard]] const std::vector<cascade_tier>& get_tiers() const noexcept { return m_tiers; }
+
+private:
+    std::shared_ptr<chat_api> m_api;
+    std::vector<cascade_tier> m_tiers;
+    acceptance_check m_check;
+    std::vector<cascade_tier_stats> m_stats;
+};
+
+} // hyni
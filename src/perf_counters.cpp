@@ -0,0 +1,227 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "perf_counters.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace hyni {
+
+namespace {
+
+#ifdef __linux__
+constexpr std::array<uint64_t, perf_sample::COUNTER_COUNT> EVENT_CONFIGS = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+int open_counter(uint64_t config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // pid = 0, cpu = -1: measure the calling thread on any CPU
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+
+const char* counter_name(size_t c) {
+    switch (c) {
+    case perf_sample::CYCLES:        return "cycles";
+    case perf_sample::INSTRUCTIONS:  return "instructions";
+    case perf_sample::CACHE_MISSES:  return "cache-misses";
+    case perf_sample::BRANCH_MISSES: return "branch-misses";
+    default:                         return "unknown";
+    }
+}
+
+} // anonymous namespace
+
+perf_sample& perf_sample::operator+=(const perf_sample& other) noexcept {
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        values[i] += other.values[i];
+        valid[i] = valid[i] || other.valid[i];
+    }
+    return *this;
+}
+
+perf_sample perf_sample::operator-(const perf_sample& other) const noexcept {
+    perf_sample result;
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        result.valid[i] = valid[i] && other.valid[i];
+        result.values[i] = (result.valid[i] && values[i] >= other.values[i])
+                               ? values[i] - other.values[i] : 0;
+    }
+    return result;
+}
+
+perf_counters::perf_counters() {
+    m_fds.fill(-1);
+
+#ifdef __linux__
+    int last_errno = 0;
+    for (size_t i = 0; i < perf_sample::COUNTER_COUNT; ++i) {
+        m_fds[i] = open_counter(EVENT_CONFIGS[i]);
+        if (m_fds[i] < 0) {
+            last_errno = errno;
+            continue;
+        }
+        ioctl(m_fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(m_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    if (!available()) {
+        m_reason = std::string("perf_event_open failed: ") + std::strerror(last_errno);
+        if (last_errno == EACCES || last_errno == EPERM) {
+            m_reason += " (check /proc/sys/kernel/perf_event_paranoid or container seccomp policy)";
+        }
+    }
+#else
+    m_reason = "hardware counters are only supported on Linux";
+#endif
+
+    m_start = read();
+}
+
+perf_counters::~perf_counters() {
+#ifdef __linux__
+    for (int fd : m_fds) {
+        if (fd >= 0) close(fd);
+    }
+#endif
+}
+
+bool perf_counters::available() const noexcept {
+    return std::any_of(m_fds.begin(), m_fds.end(), [](int fd) { return fd >= 0; });
+}
+
+perf_sample perf_counters::read() const noexcept {
+    perf_sample sample;
+
+#ifdef __linux__
+    for (size_t i = 0; i < perf_sample::COUNTER_COUNT; ++i) {
+        if (m_fds[i] < 0) continue;
+
+        // value, time_enabled, time_running
+        uint64_t data[3] = {0, 0, 0};
+        if (::read(m_fds[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) {
+            continue;
+        }
+
+        // The PMU may be multiplexed between more events than it has slots for
+        if (data[2] == 0) {
+            sample.values[i] = 0;
+        } else if (data[2] < data[1]) {
+            sample.values[i] = static_cast<uint64_t>(
+                static_cast<double>(data[0]) * data[1] / data[2]);
+        } else {
+            sample.values[i] = data[0];
+        }
+        sample.valid[i] = true;
+    }
+#endif
+
+    return sample;
+}
+
+perf_counters& perf_counters::thread_instance() {
+    thread_local perf_counters counters;
+    return counters;
+}
+
+perf_probe_registry& perf_probe_registry::instance() {
+    static perf_probe_registry registry;
+    return registry;
+}
+
+void perf_probe_registry::record(const char* name, uint64_t elapsed_ns, const perf_sample& sample) {
+    std::lock_guard lock(m_mutex);
+    auto& stats = m_probes[name];
+    if (stats.name.empty()) {
+        stats.name = name;
+    }
+    stats.calls++;
+    stats.total_ns += elapsed_ns;
+    stats.counters += sample;
+}
+
+std::vector<probe_stats> perf_probe_registry::snapshot() const {
+    std::vector<probe_stats> result;
+    {
+        std::lock_guard lock(m_mutex);
+        result.reserve(m_probes.size());
+        for (const auto& [name, stats] : m_probes) {
+            result.push_back(stats);
+        }
+    }
+    std::sort(result.begin(), result.end(),
+              [](const probe_stats& a, const probe_stats& b) { return a.name < b.name; });
+    return result;
+}
+
+std::string perf_probe_registry::report() const {
+    std::ostringstream out;
+    out << std::left << std::setw(36) << "probe"
+        << std::right << std::setw(10) << "calls"
+        << std::setw(14) << "ns/call"
+        << std::setw(8) << "IPC";
+    for (size_t c = perf_sample::CACHE_MISSES; c < perf_sample::COUNTER_COUNT; ++c) {
+        out << std::setw(18) << (std::string(counter_name(c)) + "/call");
+    }
+    out << '\n';
+
+    for (const auto& stats : snapshot()) {
+        out << std::left << std::setw(36) << stats.name
+            << std::right << std::setw(10) << stats.calls
+            << std::setw(14) << std::fixed << std::setprecision(1) << stats.ns_per_call();
+
+        if (stats.counters.has(perf_sample::CYCLES) && stats.counters.has(perf_sample::INSTRUCTIONS)) {
+            out << std::setw(8) << std::setprecision(2) << stats.counters.ipc();
+        } else {
+            out << std::setw(8) << "n/a";
+        }
+
+        for (size_t c = perf_sample::CACHE_MISSES; c < perf_sample::COUNTER_COUNT; ++c) {
+            auto counter = static_cast<perf_sample::counter>(c);
+            if (stats.counters.has(counter)) {
+                out << std::setw(18) << std::setprecision(2) << stats.per_call(counter);
+            } else {
+                out << std::setw(18) << "n/a";
+            }
+        }
+        out << '\n';
+    }
+    return out.str();
+}
+
+void perf_probe_registry::clear() {
+    std::lock_guard lock(m_mutex);
+    m_probes.clear();
+}
+
+} // hyni
@@ -0,0 +1,210 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @brief Snapshot of hardware counter values for the calling thread
+ *
+ * Each counter carries its own validity flag because kernels, hypervisors and
+ * container runtimes frequently expose only a subset of the generic events.
+ */
+struct perf_sample {
+    enum counter : size_t {
+        CYCLES = 0,
+        INSTRUCTIONS,
+        CACHE_MISSES,
+        BRANCH_MISSES,
+        COUNTER_COUNT
+    };
+
+    std::array<uint64_t, COUNTER_COUNT> values{};
+    std::array<bool, COUNTER_COUNT> valid{};
+
+    [[nodiscard]] uint64_t cycles() const noexcept { return values[CYCLES]; }
+    [[nodiscard]] uint64_t instructions() const noexcept { return values[INSTRUCTIONS]; }
+    [[nodiscard]] uint64_t cache_misses() const noexcept { return values[CACHE_MISSES]; }
+    [[nodiscard]] uint64_t branch_misses() const noexcept { return values[BRANCH_MISSES]; }
+
+    [[nodiscard]] bool has(counter c) const noexcept { return valid[c]; }
+
+    /**
+     * @brief Instructions per cycle, or 0 if either counter is unavailable
+     */
+    [[nodiscard]] double ipc() const noexcept {
+        if (!valid[CYCLES] || !valid[INSTRUCTIONS] || values[CYCLES] == 0) return 0.0;
+        return static_cast<double>(values[INSTRUCTIONS]) / static_cast<double>(values[CYCLES]);
+    }
+
+    perf_sample& operator+=(const perf_sample& other) noexcept;
+    [[nodiscard]] perf_sample operator-(const perf_sample& other) const noexcept;
+};
+
+/**
+ * @class perf_counters
+ * @brief Per-thread hardware performance counters based on perf_event_open
+ *
+ * Counters are opened for the calling thread only and are left running; callers
+ * measure a region by taking two snapshots and subtracting them, so nested
+ * measurements on the same thread are cheap and do not interfere with each other.
+ *
+ * When counters cannot be opened (non-Linux build, perf_event_paranoid, seccomp
+ * filters in containers, missing PMU in VMs) the object stays usable and simply
+ * reports invalid samples.
+ *
+ * @note NOT thread-safe. Create one instance per thread.
+ */
+class perf_counters {
+public:
+    perf_counters();
+    ~perf_counters();
+
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+    /**
+     * @brief Checks whether at least one counter could be opened
+     */
+    [[nodiscard]] bool available() const noexcept;
+
+    /**
+     * @brief Human readable reason when no counter is available
+     */
+    [[nodiscard]] const std::string& unavailable_reason() const noexcept { return m_reason; }
+
+    /**
+     * @brief Reads the current (multiplexing-scaled) counter values
+     */
+    [[nodiscard]] perf_sample read() const noexcept;
+
+    /**
+     * @brief Starts a measurement region
+     */
+    void start() noexcept { m_start = read(); }
+
+    /**
+     * @brief Ends the measurement region started with start()
+     * @return Counter deltas since start()
+     */
+    [[nodiscard]] perf_sample stop() const noexcept { return read() - m_start; }
+
+    /**
+     * @brief Returns the counters of the calling thread, opened on first use
+     */
+    static perf_counters& thread_instance();
+
+private:
+    std::array<int, perf_sample::COUNTER_COUNT> m_fds;
+    perf_sample m_start;
+    std::string m_reason;
+};
+
+/**
+ * @brief Aggregated statistics of a named probe
+ */
+struct probe_stats {
+    std::string name;
+    uint64_t calls = 0;
+    uint64_t total_ns = 0;
+    perf_sample counters;
+
+    [[nodiscard]] double ns_per_call() const noexcept {
+        return calls ? static_cast<double>(total_ns) / calls : 0.0;
+    }
+    [[nodiscard]] double per_call(perf_sample::counter c) const noexcept {
+        return calls && counters.has(c) ? static_cast<double>(counters.values[c]) / calls : 0.0;
+    }
+};
+
+/**
+ * @class perf_probe_registry
+ * @brief Process-wide sink for scoped_perf_probe measurements
+ * @note Thread-safe.
+ */
+class perf_probe_registry {
+public:
+    static perf_probe_registry& instance();
+
+    void record(const char* name, uint64_t elapsed_ns, const perf_sample& sample);
+
+    /**
+     * @brief Returns a snapshot of all probes sorted by name
+     */
+    [[nodiscard]] std::vector<probe_stats> snapshot() const;
+
+    /**
+     * @brief Formats the snapshot as a table (timings, IPC and misses per call)
+     */
+    [[nodiscard]] std::string report() const;
+
+    void clear();
+
+private:
+    perf_probe_registry() = default;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, probe_stats> m_probes;
+};
+
+/**
+ * @class scoped_perf_probe
+ * @brief Measures wall time and hardware counters of the enclosing scope
+ *
+ * Use through HYNI_PERF_PROBE so that the probes compile away unless the
+ * library is built with HYNI_ENABLE_PERF_PROBES.
+ */
+class scoped_perf_probe {
+public:
+    explicit scoped_perf_probe(const char* name) noexcept
+        : m_name(name)
+        , m_counters(perf_counters::thread_instance())
+        , m_start_sample(m_counters.read())
+        , m_start_time(std::chrono::steady_clock::now()) {}
+
+    ~scoped_perf_probe() {
+        auto elapsed = std::chrono::steady_clock::now() - m_start_time;
+        perf_probe_registry::instance().record(
+            m_name,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+            m_counters.read() - m_start_sample);
+    }
+
+    scoped_perf_probe(const scoped_perf_probe&) = delete;
+    scoped_perf_probe& operator=(const scoped_perf_probe&) = delete;
+
+private:
+    const char* m_name;
+    perf_counters& m_counters;
+    perf_sample m_start_sample;
+    std::chrono::steady_clock::time_point m_start_time;
+};
+
+} // hyni
+
+#define HYNI_PERF_CONCAT_IMPL(a, b) a##b
+#define HYNI_PERF_CONCAT(a, b) HYNI_PERF_CONCAT_IMPL(a, b)
+
+#ifdef HYNI_ENABLE_PERF_PROBES
+#define HYNI_PERF_PROBE(name) \
+    ::hyni::scoped_perf_probe HYNI_PERF_CONCAT(hyni_perf_probe_, __LINE__)(name)
+#else
+#define HYNI_PERF_PROBE(name) ((void)0)
+#endif
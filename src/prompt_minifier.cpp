@@ -0,0 +1,312 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "prompt_minifier.h"
+#include "response_utils.h"
+#include <algorithm>
+#include <cctype>
+#include <unordered_set>
+
+namespace hyni {
+
+namespace {
+
+struct line {
+    std::string text;
+    bool in_fence = false;   // inside or delimiting a ``` block
+};
+
+bool is_blank(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\f' || ch == '\v';
+}
+
+bool is_empty_line(const std::string& text) {
+    for (char ch : text) {
+        if (!is_blank(ch)) return false;
+    }
+    return true;
+}
+
+bool is_fence(std::string_view text) {
+    size_t start = 0;
+    while (start < text.size() && is_blank(text[start])) ++start;
+    return text.substr(start, 3) == "```";
+}
+
+void trim_end(std::string& text) {
+    while (!text.empty() && is_blank(text.back())) text.pop_back();
+}
+
+// Keeps leading indentation, turns every other blank run into one space
+std::string normalize_line(std::string_view text) {
+    std::string result;
+    result.reserve(text.size());
+    size_t i = 0;
+    while (i < text.size() && is_blank(text[i]) && text[i] != '\r') {
+        result += text[i++];
+    }
+    bool pending_space = false;
+    for (; i < text.size(); ++i) {
+        if (is_blank(text[i])) {
+            pending_space = true;
+            continue;
+        }
+        if (pending_space) {
+            result += ' ';
+            pending_space = false;
+        }
+        result += text[i];
+    }
+    return result;
+}
+
+std::string normalized_word(const std::string& word) {
+    std::string result;
+    for (const auto& part : response_utils::split_and_normalize(word)) {
+        result += part;
+    }
+    for (char& ch : result) {
+        ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+    }
+    return result;
+}
+
+bool ends_sentence(char ch) {
+    return ch == '.' || ch == '?' || ch == '!';
+}
+
+std::string remove_fillers(const std::string& text, const std::unordered_set<std::string>& fillers) {
+    // Doubled words that are often grammatical: "that that", "had had"
+    static const std::unordered_set<std::string> legit_doubles = {"that", "had"};
+
+    size_t indent = 0;
+    while (indent < text.size() && is_blank(text[indent])) ++indent;
+
+    std::string result = text.substr(0, indent);
+    std::string previous;    // normalized form of the last kept word
+    bool previous_bare = false;   // last kept word had no trailing punctuation
+    size_t kept = 0;
+
+    size_t pos = indent;
+    while (pos < text.size()) {
+        size_t end = pos;
+        while (end < text.size() && !is_blank(text[end])) ++end;
+        std::string word = text.substr(pos, end - pos);
+        pos = end;
+        while (pos < text.size() && is_blank(text[pos])) ++pos;
+        if (word.empty()) continue;
+
+        const std::string norm = normalized_word(word);
+        const bool filler = !norm.empty() && fillers.count(norm);
+        const bool stutter = !norm.empty() && norm == previous && previous_bare && !legit_doubles.count(norm);
+        if (filler || stutter) {
+            // "so, um." still ends the sentence
+            if (kept > 0 && ends_sentence(word.back()) && !ends_sentence(result.back())) {
+                if (result.back() == ',' || result.back() == ';') result.pop_back();
+                result += word.back();
+                previous_bare = false;
+            }
+            continue;
+        }
+
+        if (kept > 0) result += ' ';
+        result += word;
+        ++kept;
+        previous = norm;
+        previous_bare = std::isalnum(static_cast<unsigned char>(word.back())) != 0;
+    }
+    return result;
+}
+
+uint64_t block_hash(const std::string& text) {
+    uint64_t hash = 14695981039346656037ULL;   // FNV-1a
+    for (unsigned char ch : text) {
+        hash = (hash ^ ch) * 1099511628211ULL;
+    }
+    return hash ^ (static_cast<uint64_t>(text.size()) << 48);
+}
+
+// One component for all minifiers; each conversation has its own
+memory_governor::registration& seen_blocks_memory() {
+    static memory_governor::registration registration =
+        memory_governor::instance().register_component("prompt_minifier.seen_blocks", 0.0, nullptr);
+    return registration;
+}
+
+} // anonymous namespace
+
+minify_result prompt_minifier::minify(std::string_view text, const minify_options& options) {
+    auto result = minify_tentative(text, options);
+    commit(result);
+    return result;
+}
+
+void prompt_minifier::commit(const minify_result& result) {
+    m_seen_blocks.insert(result.new_blocks.begin(), result.new_blocks.end());
+
+    // A node holds the hash and the next pointer
+    const size_t bytes = m_seen_blocks.size() * (sizeof(uint64_t) + sizeof(void*)) +
+                         m_seen_blocks.bucket_count() * sizeof(void*);
+    if (!m_memory) {
+        m_memory = seen_blocks_memory().hold(bytes);
+    } else {
+        m_memory.resize(bytes);
+    }
+}
+
+minify_result prompt_minifier::minify_tentative(std::string_view text, const minify_options& options) const {
+    minify_result result;
+    result.tokens_before = estimate_tokens(text);
+
+    std::unordered_set<std::string> fillers;
+    if (options.remove_fillers) {
+        for (const auto& word : options.filler_words) {
+            fillers.insert(normalized_word(word));
+        }
+    }
+
+    // Line passes
+    std::vector<line> lines;
+    bool in_fence = false;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view raw = text.substr(start, end - start);
+        start = end + 1;
+
+        const bool fence = is_fence(raw);
+        line current{std::string(raw), in_fence || fence};
+        if (fence) in_fence = !in_fence;
+
+        if (options.normalize_whitespace) {
+            if (current.in_fence) {
+                trim_end(current.text);
+            } else {
+                current.text = normalize_line(current.text);
+                trim_end(current.text);
+            }
+        }
+        if (options.remove_fillers && !current.in_fence) {
+            current.text = remove_fillers(current.text, fillers);
+        }
+
+        const bool empty = is_empty_line(current.text);
+        if (!current.in_fence && !lines.empty() && !lines.back().in_fence) {
+            if (options.collapse_repeated_lines && !empty && current.text == lines.back().text) {
+                continue;
+            }
+            if (options.normalize_whitespace && empty && is_empty_line(lines.back().text)) {
+                continue;
+            }
+        }
+        if (options.normalize_whitespace && empty && !current.in_fence && lines.empty()) {
+            continue;   // leading blank lines
+        }
+        lines.push_back(std::move(current));
+    }
+    if (options.normalize_whitespace) {
+        while (!lines.empty() && !lines.back().in_fence && is_empty_line(lines.back().text)) {
+            lines.pop_back();
+        }
+    }
+
+    // Paragraphs are runs of lines between blank lines outside code fences
+    std::vector<bool> dropped(lines.size(), false);
+    size_t i = 0;
+    while (options.dedup_blocks && i < lines.size()) {
+        if (!lines[i].in_fence && is_empty_line(lines[i].text)) {
+            ++i;
+            continue;
+        }
+        const size_t first = i;
+        std::string block;
+        for (; i < lines.size() && (lines[i].in_fence || !is_empty_line(lines[i].text)); ++i) {
+            if (i > first) block += '\n';
+            block += lines[i].text;
+        }
+        if (block.size() < options.min_block_chars) {
+            continue;
+        }
+        const uint64_t hash = block_hash(block);
+        const bool seen = m_seen_blocks.count(hash) > 0 ||
+                          std::find(result.new_blocks.begin(), result.new_blocks.end(), hash) !=
+                              result.new_blocks.end();
+        if (!seen) {
+            result.new_blocks.push_back(hash);
+        } else {
+            std::fill(dropped.begin() + first, dropped.begin() + i, true);
+            // Take one separating blank line with it
+            if (i < lines.size()) {
+                dropped[i] = true;
+            } else if (first > 0) {
+                dropped[first - 1] = true;
+            }
+        }
+    }
+
+    // A message that only repeats earlier blocks is sent as it is: an empty
+    // message would be rejected by the provider
+    bool kept_text = false;
+    for (size_t j = 0; j < lines.size() && !kept_text; ++j) {
+        kept_text = !dropped[j] && !is_empty_line(lines[j].text);
+    }
+    if (!kept_text) {
+        std::fill(dropped.begin(), dropped.end(), false);
+    }
+
+    bool first_line = true;
+    for (size_t j = 0; j < lines.size(); ++j) {
+        if (dropped[j]) continue;
+        if (!first_line) result.text += '\n';
+        result.text += lines[j].text;
+        first_line = false;
+    }
+
+    result.tokens_after = estimate_tokens(result.text);
+    return result;
+}
+
+size_t prompt_minifier::estimate_tokens(std::string_view text) noexcept {
+    size_t tokens = 0;
+    size_t i = 0;
+    while (i < text.size()) {
+        const unsigned char ch = static_cast<unsigned char>(text[i]);
+        if (std::isalnum(ch)) {
+            size_t run = 0;
+            while (i < text.size() && std::isalnum(static_cast<unsigned char>(text[i]))) {
+                ++run;
+                ++i;
+            }
+            tokens += (run + 3) / 4;
+        } else if (ch == '\n') {
+            ++tokens;   // a run of newlines is usually one token
+            while (i < text.size() && text[i] == '\n') ++i;
+        } else if (ch == ' ') {
+            ++i;        // a single space is merged into the next word
+            if (i < text.size() && text[i] == ' ') {
+                ++tokens;   // longer runs are tokens of their own
+                while (i < text.size() && text[i] == ' ') ++i;
+            }
+        } else if (ch >= 0x80) {
+            // One per UTF-8 sequence, skipping continuation bytes
+            ++tokens;
+            ++i;
+            while (i < text.size() && (static_cast<unsigned char>(text[i]) & 0xC0) == 0x80) ++i;
+        } else {
+            ++tokens;
+            ++i;
+        }
+    }
+    return tokens;
+}
+
+} // hyni
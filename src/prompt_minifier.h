@@ -0,0 +1,111 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "memory_governor.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace hyni {
+
+/**
+ * @brief Which minification passes run, see prompt_minifier
+ */
+struct minify_options {
+    bool normalize_whitespace = true;     ///< Collapse blank runs and blank lines, trim line ends
+    bool collapse_repeated_lines = true;  ///< Keep one of several identical consecutive lines
+    bool remove_fillers = false;          ///< Drop filler words and stutters; meant for transcripts
+    bool dedup_blocks = true;             ///< Drop paragraphs already sent earlier in the conversation
+    size_t min_block_chars = 200;         ///< Shorter paragraphs are never deduplicated
+    std::vector<std::string> filler_words = {"um", "umm", "uh", "uhh", "uhm", "erm", "er", "ah", "hmm", "mm", "mhm"};
+
+    bool operator==(const minify_options&) const = default;
+};
+
+/**
+ * @brief Minified text with its estimated token counts
+ */
+struct minify_result {
+    std::string text;
+    size_t tokens_before = 0;
+    size_t tokens_after = 0;
+    std::vector<uint64_t> new_blocks;  ///< Hashes of blocks not seen before, recorded by commit()
+};
+
+/**
+ * @class prompt_minifier
+ * @brief Removes tokens from prompt text that carry no information for the model
+ *
+ * Transcripts and pasted documents are full of blank runs, repeated lines,
+ * fillers ("um", "uh", "I I think") and context blocks pasted again on every
+ * turn. Each pass can be switched off in minify_options:
+ *
+ * - whitespace: tabs and blank runs inside a line become one space, line ends
+ *   are trimmed, more than one blank line becomes one. Leading indentation is kept.
+ * - repeated lines: identical consecutive non-empty lines are kept once.
+ * - fillers: words in filler_words and immediately repeated words are dropped,
+ *   compared after response_utils normalization so "Um," matches "um".
+ * - block dedup: a paragraph of at least min_block_chars that was already seen
+ *   by this minifier is dropped, unless that would leave no text at all. The
+ *   minifier remembers blocks across calls, so call reset() whenever earlier
+ *   text is no longer sent.
+ *
+ * Fenced code blocks (```) are copied unchanged apart from trailing blanks.
+ *
+ * @note NOT thread-safe; general_context owns one per conversation.
+ */
+class prompt_minifier {
+public:
+    /**
+     * @brief Minifies text and remembers its blocks for later calls
+     */
+    [[nodiscard]] minify_result minify(std::string_view text, const minify_options& options = {});
+
+    /**
+     * @brief Minifies text without remembering its blocks
+     *
+     * For callers that may still discard the text: pass the result to commit()
+     * once it is actually sent, so a rejected message is not treated as a
+     * duplicate when retried.
+     */
+    [[nodiscard]] minify_result minify_tentative(std::string_view text, const minify_options& options = {}) const;
+
+    /**
+     * @brief Remembers the new blocks of a minify_tentative() result
+     */
+    void commit(const minify_result& result);
+
+    /**
+     * @brief Forgets the blocks seen so far
+     */
+    void reset() noexcept {
+        m_seen_blocks.clear();
+        m_memory.resize(0);
+    }
+
+    /**
+     * @brief Rough BPE token count: ~4 characters per word piece, one per symbol
+     *
+     * Matches cl100k-style tokenizers within about 15% on English prose, which is
+     * enough to compare a text before and after minification.
+     */
+    [[nodiscard]] static size_t estimate_tokens(std::string_view text) noexcept;
+
+private:
+    std::unordered_set<uint64_t> m_seen_blocks;
+    memory_governor::charge m_memory;   // m_seen_blocks, counted under "prompt_minifier.seen_blocks"
+};
+
+} // hyni
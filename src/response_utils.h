@@ -6,7 +6,10 @@
 #include <vector>
 #include <unordered_map>
 #include <algorithm>
+#include <array>
+#include <cstdlib>
 #include <numeric>
+#include <string_view>
 
 namespace hyni {
 
@@ -294,6 +297,121 @@ public:
         return result;
     }
 
+    /**
+     * Fuzzy variant of merge_strings for ASR fragments that revise words in the overlap.
+     *
+     * Finds the suffix of a's last max_lookback_words words and the prefix of b
+     * with the best word-level alignment, where an alignment scores one point per
+     * overlapping word and loses two per edit (substitution, insertion or deletion),
+     * and accepts it if its edit count is at most max_edit_ratio times its length
+     * in b. Words are compared case-insensitively and without surrounding
+     * punctuation. The overlap is taken from b, which is the newer transcript.
+     *
+     * Words are interned to IDs and the edit distances computed with Myers'
+     * bit-parallel algorithm, one machine word per column: one pass over the
+     * lookback window yields the cost of every prefix of b, a second pass over the
+     * reversed strings locates where the chosen overlap starts in a. Only prefixes
+     * of b within max_edit_ratio of the window length can qualify, which bounds the
+     * band at 64 words.
+     *
+     * @param best_match_index Index of the first word of a replaced by b, or -1
+     */
+    [[nodiscard]] static std::string merge_strings_fuzzy(
+        std::string_view a,
+        std::string_view b,
+        int& best_match_index,
+        int max_lookback_words = 8,
+        double max_edit_ratio = 0.34
+    ) noexcept {
+        best_match_index = -1;
+        if (a.empty()) return std::string(b);
+        if (b.empty()) return std::string(a);
+
+        const auto base = split_words(a);
+        const auto tail = split_words(b);
+
+        const int n = static_cast<int>(base.size());
+        const int window = std::min(n, std::max(0, max_lookback_words));
+        const int band = static_cast<int>(window * std::max(0.0, max_edit_ratio));
+        const int m = std::min({static_cast<int>(tail.size()), window + band, 64});
+
+        if (window > 0 && m > 0) {
+            word_interner interner;
+            std::array<uint64_t, 65> peq{};
+            std::array<uint8_t, 64> tail_ids{};
+            for (int r = 0; r < m; ++r) {
+                tail_ids[r] = interner.intern(tail[r]);
+                peq[tail_ids[r]] |= uint64_t{1} << r;
+            }
+            std::vector<uint8_t> window_ids(window);
+            for (int k = 0; k < window; ++k) {
+                window_ids[k] = interner.find(base[n - window + k]);
+            }
+
+            // Pass 1: b's prefix as pattern, free start in the window. After the
+            // last word of a, row j of the column is min over i of
+            // edit(b[0..j), a[i..n)).
+            uint64_t pv = ~uint64_t{0};
+            uint64_t mv = 0;
+            for (int k = 0; k < window; ++k) {
+                myers_step(peq[window_ids[k]], pv, mv, false);
+            }
+
+            int best_j = -1;
+            int best_cost = 0;
+            int best_score = 0;
+            int cost = 0;
+            for (int j = 1; j <= m; ++j) {
+                const uint64_t bit = uint64_t{1} << (j - 1);
+                cost += (pv & bit) ? 1 : 0;
+                cost -= (mv & bit) ? 1 : 0;
+                const int score = j - 2 * cost;
+                if (cost <= j * max_edit_ratio && score > 0 && score >= best_score) {
+                    best_j = j;
+                    best_cost = cost;
+                    best_score = score;
+                }
+            }
+
+            if (best_j > 0) {
+                // Pass 2: reversed b[0..best_j) against a read backwards, anchored
+                // at a's end; after e words the score is edit(b[0..best_j), a[n-e..n)).
+                std::array<uint64_t, 65> reversed_peq{};
+                for (int r = 0; r < best_j; ++r) {
+                    reversed_peq[tail_ids[best_j - 1 - r]] |= uint64_t{1} << r;
+                }
+                const uint64_t high = uint64_t{1} << (best_j - 1);
+                pv = ~uint64_t{0};
+                mv = 0;
+                int score = best_j;
+                int best_e = -1;
+                for (int e = 1; e <= window; ++e) {
+                    const auto [ph, mh] = myers_step(reversed_peq[window_ids[window - e]], pv, mv, true);
+                    score += (ph & high) ? 1 : 0;
+                    score -= (mh & high) ? 1 : 0;
+                    if (score == best_cost && (best_e < 0 || std::abs(e - best_j) < std::abs(best_e - best_j))) {
+                        best_e = e;
+                    }
+                }
+                if (best_e > 0) {
+                    best_match_index = n - best_e;
+                }
+            }
+        }
+
+        std::string result;
+        if (best_match_index >= 0) {
+            result.assign(a.substr(0, static_cast<size_t>(base[best_match_index].data() - a.data())));
+        } else {
+            result.assign(a);
+        }
+        if (!result.empty() && result.back() != ' ') {
+            result += ' ';
+        }
+        result += b;
+        return result;
+    }
+
     [[nodiscard]] static std::string base64_encode(const unsigned char* data, size_t len) {
         static constexpr char encoding_table[] =
             "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
@@ -326,6 +444,91 @@ public:
     }
 
 private:
+    [[nodiscard]] static std::vector<std::string_view> split_words(std::string_view str) {
+        std::vector<std::string_view> words;
+        size_t start = 0;
+        while (start < str.size()) {
+            size_t end = str.find(' ', start);
+            if (end == std::string_view::npos) end = str.size();
+            if (end > start) words.push_back(str.substr(start, end - start));
+            start = end + 1;
+        }
+        return words;
+    }
+
+    // Maps up to 64 words to IDs 1..64 by their normalized form; 0 is "not interned"
+    class word_interner {
+    public:
+        uint8_t intern(std::string_view word) noexcept {
+            const uint64_t hash = normalized_hash(word);
+            size_t slot = hash & (SLOTS - 1);
+            while (m_ids[slot] != 0) {
+                if (m_hashes[slot] == hash) return m_ids[slot];
+                slot = (slot + 1) & (SLOTS - 1);
+            }
+            m_hashes[slot] = hash;
+            m_ids[slot] = ++m_count;
+            return m_count;
+        }
+
+        [[nodiscard]] uint8_t find(std::string_view word) const noexcept {
+            const uint64_t hash = normalized_hash(word);
+            size_t slot = hash & (SLOTS - 1);
+            while (m_ids[slot] != 0) {
+                if (m_hashes[slot] == hash) return m_ids[slot];
+                slot = (slot + 1) & (SLOTS - 1);
+            }
+            return 0;
+        }
+
+    private:
+        static constexpr size_t SLOTS = 128;
+
+        // FNV-1a over the lowercased word without leading or trailing punctuation
+        [[nodiscard]] static uint64_t normalized_hash(std::string_view word) noexcept {
+            auto is_punct = [](char ch) {
+                return is_filtered_char(ch) || ch == '?' || ch == '!' || ch == ':' || ch == '"' || ch == '\'';
+            };
+            size_t first = 0;
+            size_t last = word.size();
+            while (first < last && is_punct(word[first])) ++first;
+            while (last > first && is_punct(word[last - 1])) --last;
+
+            uint64_t hash = 14695981039346656037ull;
+            for (size_t i = first; i < last; ++i) {
+                char ch = word[i];
+                if (ch >= 'A' && ch <= 'Z') ch = static_cast<char>(ch - 'A' + 'a');
+                hash = (hash ^ static_cast<unsigned char>(ch)) * 1099511628211ull;
+            }
+            return hash;
+        }
+
+        std::array<uint64_t, SLOTS> m_hashes{};
+        std::array<uint8_t, SLOTS> m_ids{};
+        uint8_t m_count = 0;
+    };
+
+    struct myers_delta {
+        uint64_t ph;
+        uint64_t mh;
+    };
+
+    // One text symbol of Myers' bit-vector edit distance (Hyyrö's formulation).
+    // Updates the vertical deltas and returns the horizontal ones, unshifted. With
+    // anchored, row 0 grows by one per symbol (global alignment); otherwise it stays
+    // 0, letting the match start anywhere in the text.
+    static myers_delta myers_step(uint64_t eq, uint64_t& pv, uint64_t& mv, bool anchored) noexcept {
+        const uint64_t xv = eq | mv;
+        const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        const uint64_t ph = mv | ~(xh | pv);
+        const uint64_t mh = pv & xh;
+        const uint64_t ph_shifted = (ph << 1) | (anchored ? 1 : 0);
+        const uint64_t mh_shifted = mh << 1;
+        pv = mh_shifted | ~(xv | ph_shifted);
+        mv = ph_shifted & xv;
+        return {ph, mh};
+    }
+
     [[nodiscard]] static constexpr bool is_filtered_char(char ch) noexcept {
         const unsigned char uc = static_cast<unsigned char>(ch);
         return (uc == ' ') | (uc == ',') | (uc == '.') | (uc == ';') | (uc == '-');
@@ -0,0 +1,134 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "text_attachment.h"
+#include "prompt_minifier.h"
+#include "utf8.h"
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <fcntl.h>
+#include <openssl/rand.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace hyni {
+
+namespace {
+
+// A control character no real message starts with, then a random token in hex
+constexpr std::string_view PLACEHOLDER_PREFIX = "\x1Ahyni-attachment:";
+constexpr size_t TOKEN_BYTES = 16;
+
+std::string make_placeholder() {
+    unsigned char token[TOKEN_BYTES];
+    if (RAND_bytes(token, sizeof(token)) != 1) {
+        throw std::runtime_error("Failed to generate attachment token");
+    }
+    static constexpr char HEX[] = "0123456789abcdef";
+    std::string placeholder(PLACEHOLDER_PREFIX);
+    for (unsigned char byte : token) {
+        placeholder += HEX[byte >> 4];
+        placeholder += HEX[byte & 0x0F];
+    }
+    return placeholder;
+}
+
+} // anonymous namespace
+
+text_attachment::text_attachment(private_tag, std::string name)
+    : m_name(std::move(name))
+    , m_placeholder(make_placeholder()) {
+}
+
+text_attachment::~text_attachment() {
+    if (m_mapping) {
+        ::munmap(m_mapping, m_mapping_size);
+    }
+}
+
+std::shared_ptr<const text_attachment> text_attachment::finish(std::shared_ptr<text_attachment> attachment) {
+    attachment->m_valid_utf8 = utf8::is_valid(attachment->m_view);
+    return attachment;
+}
+
+std::shared_ptr<const text_attachment> text_attachment::read_file(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open attachment " + path.string() + ": " + std::strerror(errno));
+    }
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (file.bad()) {
+        throw std::runtime_error("Failed to read attachment " + path.string());
+    }
+    return from_string(std::move(text), path.string());
+}
+
+std::shared_ptr<const text_attachment> text_attachment::map_file(const std::filesystem::path& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open attachment " + path.string() + ": " + std::strerror(errno));
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Failed to stat attachment " + path.string() + ": " + std::strerror(error));
+    }
+
+    auto attachment = std::make_shared<text_attachment>(private_tag{}, path.string());
+    const auto size = static_cast<size_t>(st.st_size);
+    if (size > 0) {
+        void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            const int error = errno;
+            ::close(fd);
+            throw std::runtime_error("Failed to map attachment " + path.string() + ": " + std::strerror(error));
+        }
+        // Validation and serialization both read front to back
+        ::madvise(mapping, size, MADV_SEQUENTIAL);
+        attachment->m_mapping = mapping;
+        attachment->m_mapping_size = size;
+        attachment->m_view = std::string_view(static_cast<const char*>(mapping), size);
+    }
+    ::close(fd);
+    return finish(std::move(attachment));
+}
+
+std::shared_ptr<const text_attachment> text_attachment::from_string(std::string text, std::string name) {
+    auto attachment = std::make_shared<text_attachment>(private_tag{}, std::move(name));
+    attachment->m_owned = std::move(text);
+    attachment->m_view = attachment->m_owned;
+    return finish(std::move(attachment));
+}
+
+std::shared_ptr<const text_attachment> text_attachment::from_view(std::string_view text,
+                                                                  std::shared_ptr<const void> owner,
+                                                                  std::string name) {
+    auto attachment = std::make_shared<text_attachment>(private_tag{}, std::move(name));
+    attachment->m_owner = std::move(owner);
+    attachment->m_view = text;
+    return finish(std::move(attachment));
+}
+
+bool text_attachment::is_placeholder(std::string_view text) noexcept {
+    return text.size() == PLACEHOLDER_PREFIX.size() + 2 * TOKEN_BYTES && text.starts_with(PLACEHOLDER_PREFIX);
+}
+
+size_t text_attachment::estimated_tokens() const {
+    std::call_once(m_tokens_once, [this] { m_tokens = prompt_minifier::estimate_tokens(m_view); });
+    return m_tokens;
+}
+
+} // hyni
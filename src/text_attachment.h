@@ -0,0 +1,148 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace hyni {
+
+class text_attachment;
+
+/**
+ * @brief Attachments a request may reference, keyed by placeholder
+ */
+using text_attachment_map = std::unordered_map<std::string, std::shared_ptr<const text_attachment>>;
+
+/**
+ * @class text_attachment
+ * @brief Large message text kept outside the message JSON
+ *
+ * A document attached to a message (log, source file, transcript) is
+ * represented in the message by placeholder(), a short string. Copying
+ * messages and building requests then copies only the placeholder;
+ * json_serializer::dump() escapes the attachment's bytes straight into the
+ * request body in place of the placeholder, so sending a multi-MB document
+ * costs one pass over it.
+ *
+ * A placeholder carries a random 128-bit token and only resolves through a
+ * text_attachment_map the caller passes to the serializer, normally the
+ * attachments of the context that built the request. Message text that
+ * mimics a placeholder can therefore never pull in another context's file.
+ *
+ * The text is checked for valid UTF-8 once, when the attachment is created.
+ *
+ * @note Thread-safe; attachments are immutable once created.
+ */
+class text_attachment final {
+public:
+    /**
+     * @brief Reads a file into memory
+     *
+     * Use for files that may still grow or be truncated, such as live logs and
+     * transcripts; the attachment keeps the contents as they were when read.
+     *
+     * @throws std::runtime_error If the file cannot be read
+     */
+    [[nodiscard]] static std::shared_ptr<const text_attachment> read_file(const std::filesystem::path& path);
+
+    /**
+     * @brief Maps a file read-only without copying it
+     *
+     * The file must not change while the attachment lives: reading a mapping
+     * whose file was truncated raises SIGBUS. Because the mapped bytes may
+     * still change, the serializer re-validates them instead of trusting
+     * is_valid_utf8(). Prefer read_file() for files that are still written.
+     *
+     * @throws std::runtime_error If the file cannot be opened or mapped
+     */
+    [[nodiscard]] static std::shared_ptr<const text_attachment> map_file(const std::filesystem::path& path);
+
+    /**
+     * @brief Takes ownership of text; move it in to avoid a copy
+     */
+    [[nodiscard]] static std::shared_ptr<const text_attachment> from_string(std::string text,
+                                                                            std::string name = "buffer");
+
+    /**
+     * @brief References text owned elsewhere
+     * @param owner Keeps the memory behind text alive; may be null if the caller guarantees
+     *        it outlives the attachment
+     */
+    [[nodiscard]] static std::shared_ptr<const text_attachment> from_view(std::string_view text,
+                                                                          std::shared_ptr<const void> owner,
+                                                                          std::string name = "buffer");
+
+    /**
+     * @brief Cheap check whether text has the placeholder form, without a lookup
+     */
+    [[nodiscard]] static bool is_placeholder(std::string_view text) noexcept;
+
+    text_attachment(const text_attachment&) = delete;
+    text_attachment& operator=(const text_attachment&) = delete;
+    ~text_attachment();
+
+    [[nodiscard]] std::string_view view() const noexcept { return m_view; }
+    [[nodiscard]] size_t size() const noexcept { return m_view.size(); }
+
+    /**
+     * @brief File path, or the name given for a buffer
+     */
+    [[nodiscard]] const std::string& name() const noexcept { return m_name; }
+
+    /**
+     * @brief String standing for this attachment in message JSON
+     */
+    [[nodiscard]] const std::string& placeholder() const noexcept { return m_placeholder; }
+
+    [[nodiscard]] bool is_valid_utf8() const noexcept { return m_valid_utf8; }
+
+    /**
+     * @brief True for map_file() attachments, whose bytes are not owned and may change
+     */
+    [[nodiscard]] bool is_mapped() const noexcept { return m_mapping != nullptr; }
+
+    /**
+     * @brief prompt_minifier::estimate_tokens of the text, computed on first use
+     */
+    [[nodiscard]] size_t estimated_tokens() const;
+
+private:
+    struct private_tag {};
+
+public:
+    text_attachment(private_tag, std::string name);
+
+private:
+    static std::shared_ptr<const text_attachment> finish(std::shared_ptr<text_attachment> attachment);
+
+    std::string m_name;
+    std::string m_placeholder;
+    std::string_view m_view;
+    bool m_valid_utf8 = true;
+
+    // Backing storage, at most one of which is set
+    std::string m_owned;
+    std::shared_ptr<const void> m_owner;
+    void* m_mapping = nullptr;
+    size_t m_mapping_size = 0;
+
+    mutable std::once_flag m_tokens_once;
+    mutable size_t m_tokens = 0;
+};
+
+} // hyni
@@ -0,0 +1,328 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#include "utf8.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define HYNI_UTF8_AVX2 1
+#endif
+
+namespace hyni {
+
+namespace {
+
+struct sequence {
+    size_t length;    // bytes of a valid sequence, or of the maximal invalid subpart
+    bool valid;
+    bool truncated;   // a valid prefix cut off by the end of the text
+};
+
+sequence decode(std::string_view text, size_t i) {
+    const auto* p = reinterpret_cast<const unsigned char*>(text.data());
+    const unsigned char lead = p[i];
+    if (lead < 0x80) {
+        return {1, true, false};
+    }
+
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+    size_t length;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        if (lead == 0xE0) low = 0xA0;
+        if (lead == 0xED) high = 0x9F;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        if (lead == 0xF0) low = 0x90;
+        if (lead == 0xF4) high = 0x8F;
+    } else {
+        return {1, false, false};
+    }
+
+    for (size_t k = 1; k < length; ++k) {
+        if (i + k >= text.size()) {
+            return {k, false, true};
+        }
+        const unsigned char c = p[i + k];
+        if (k == 1 ? (c < low || c > high) : (c & 0xC0) != 0x80) {
+            return {k, false, false};
+        }
+    }
+    return {length, true, false};
+}
+
+bool is_ascii16(const char* p) {
+    uint64_t a, b;
+    std::memcpy(&a, p, 8);
+    std::memcpy(&b, p + 8, 8);
+    return ((a | b) & 0x8080808080808080ULL) == 0;
+}
+
+// Offset of the first invalid sequence, npos if none
+size_t scan_scalar(std::string_view text) {
+    const size_t n = text.size();
+    size_t i = 0;
+    while (i < n) {
+        if (i + 16 <= n && is_ascii16(text.data() + i)) {
+            i += 16;
+            continue;
+        }
+        const auto seq = decode(text, i);
+        if (!seq.valid) {
+            return i;
+        }
+        i += seq.length;
+    }
+    return std::string_view::npos;
+}
+
+#ifdef HYNI_UTF8_AVX2
+// Keiser & Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte" (2021).
+// Three 16-entry lookups on the high nibble of the previous byte, its low nibble
+// and the high nibble of the current byte flag every invalid two-byte pattern;
+// 3- and 4-byte sequences are checked by requiring continuations 2 and 3 bytes
+// after 111_____ and 1111____ leads.
+constexpr uint8_t TOO_SHORT = 1 << 0;
+constexpr uint8_t TOO_LONG = 1 << 1;
+constexpr uint8_t OVERLONG_3 = 1 << 2;
+constexpr uint8_t TOO_LARGE = 1 << 3;
+constexpr uint8_t SURROGATE = 1 << 4;
+constexpr uint8_t OVERLONG_2 = 1 << 5;
+constexpr uint8_t TOO_LARGE_1000 = 1 << 6;
+constexpr uint8_t OVERLONG_4 = 1 << 6;
+constexpr uint8_t TWO_CONTS = 1 << 7;
+constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+alignas(16) constexpr uint8_t BYTE_1_HIGH[16] = {
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+    TOO_SHORT | OVERLONG_2,
+    TOO_SHORT,
+    TOO_SHORT | OVERLONG_3 | SURROGATE,
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+};
+
+alignas(16) constexpr uint8_t BYTE_1_LOW[16] = {
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+    CARRY | OVERLONG_2,
+    CARRY,
+    CARRY,
+    CARRY | TOO_LARGE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+};
+
+alignas(16) constexpr uint8_t BYTE_2_HIGH[16] = {
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+};
+
+struct avx2_state {
+    __m256i error;
+    __m256i prev_input;
+    __m256i prev_incomplete;
+};
+
+__attribute__((target("avx2")))
+inline __m256i lookup(const uint8_t (&table)[16], __m256i index) {
+    return _mm256_shuffle_epi8(
+        _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(table))), index);
+}
+
+__attribute__((target("avx2")))
+inline void check_chunk(avx2_state& state, __m256i input) {
+    if (_mm256_movemask_epi8(input) == 0) {
+        state.error = _mm256_or_si256(state.error, state.prev_incomplete);
+        state.prev_input = input;
+        return;
+    }
+
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i shifted = _mm256_permute2x128_si256(state.prev_input, input, 0x21);
+    const __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+    const __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+    const __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+
+    const __m256i special = _mm256_and_si256(
+        _mm256_and_si256(lookup(BYTE_1_HIGH, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+                         lookup(BYTE_1_LOW, _mm256_and_si256(prev1, nibble))),
+        lookup(BYTE_2_HIGH, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+
+    // High bit set where a continuation is required by a 3- or 4-byte lead
+    const __m256i must_be_continuation = _mm256_and_si256(
+        _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80))),
+                        _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)))),
+        _mm256_set1_epi8(static_cast<char>(0x80)));
+
+    // A lead byte in the last 1, 2 or 3 positions still needs bytes from the next chunk
+    const __m256i incomplete_max = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1));
+
+    state.error = _mm256_or_si256(state.error, _mm256_xor_si256(must_be_continuation, special));
+    state.prev_incomplete = _mm256_subs_epu8(input, incomplete_max);
+    state.prev_input = input;
+}
+
+__attribute__((target("avx2")))
+bool validate_avx2(const char* data, size_t n) {
+    avx2_state state{_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        check_chunk(state, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+        check_chunk(state, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 32)));
+        if (!_mm256_testz_si256(state.error, state.error)) {
+            return false;
+        }
+    }
+    for (; i < n; i += 32) {
+        // Zero padding is ASCII, so a truncated sequence shows up as too short
+        alignas(32) char tail[32] = {};
+        std::memcpy(tail, data + i, std::min<size_t>(32, n - i));
+        check_chunk(state, _mm256_load_si256(reinterpret_cast<const __m256i*>(tail)));
+    }
+    const __m256i error = _mm256_or_si256(state.error, state.prev_incomplete);
+    return _mm256_testz_si256(error, error);
+}
+#endif
+
+bool has_avx2() {
+#ifdef HYNI_UTF8_AVX2
+    static const bool supported = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+std::string repair_impl(std::string_view text, size_t& replacements) {
+    std::string out;
+    out.reserve(text.size() + 8);
+    size_t run = 0;
+    size_t i = 0;
+    while (i < text.size()) {
+        if (i + 16 <= text.size() && is_ascii16(text.data() + i)) {
+            i += 16;
+            continue;
+        }
+        const auto seq = decode(text, i);
+        if (!seq.valid) {
+            out.append(text.data() + run, i - run);
+            out.append(utf8::REPLACEMENT);
+            ++replacements;
+            run = i + seq.length;
+        }
+        i += seq.length;
+    }
+    out.append(text.data() + run, text.size() - run);
+    return out;
+}
+
+} // anonymous namespace
+
+bool utf8::is_valid(std::string_view text) noexcept {
+#ifdef HYNI_UTF8_AVX2
+    if (has_avx2()) {
+        return validate_avx2(text.data(), text.size());
+    }
+#endif
+    return scan_scalar(text) == std::string_view::npos;
+}
+
+size_t utf8::find_invalid(std::string_view text) noexcept {
+    if (is_valid(text)) {
+        return std::string_view::npos;
+    }
+    return scan_scalar(text);
+}
+
+std::string utf8::repair(std::string_view text) {
+    if (is_valid(text)) {
+        return std::string(text);
+    }
+    size_t replacements = 0;
+    return repair_impl(text, replacements);
+}
+
+bool utf8::repair_in_place(std::string& text) {
+    if (is_valid(text)) {
+        return false;
+    }
+    size_t replacements = 0;
+    text = repair_impl(text, replacements);
+    return true;
+}
+
+const char* utf8::simd_level() noexcept {
+    return has_avx2() ? "avx2" : "scalar";
+}
+
+std::string utf8_stream_repairer::feed(std::string_view chunk) {
+    std::string joined;
+    std::string_view data = chunk;
+    if (!m_pending.empty()) {
+        joined = m_pending + std::string(chunk);
+        data = joined;
+    }
+
+    // Hold back a partial character at the end; it may complete in the next chunk
+    size_t keep = data.size();
+    for (size_t back = 1; back <= 3 && back <= data.size(); ++back) {
+        const auto c = static_cast<unsigned char>(data[data.size() - back]);
+        if ((c & 0xC0) == 0x80) {
+            continue;
+        }
+        if (c >= 0xC0 && decode(data, data.size() - back).truncated) {
+            keep = data.size() - back;
+        }
+        break;
+    }
+
+    const std::string_view complete = data.substr(0, keep);
+    std::string result = utf8::is_valid(complete) ? std::string(complete) : repair_impl(complete, m_replacements);
+    m_pending = std::string(data.substr(keep));
+    return result;
+}
+
+std::string utf8_stream_repairer::finish() {
+    if (m_pending.empty()) {
+        return {};
+    }
+    m_pending.clear();
+    ++m_replacements;
+    return std::string(utf8::REPLACEMENT);
+}
+
+} // hyni
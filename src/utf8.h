@@ -0,0 +1,103 @@
+// -------------------------------------------------------------------------------------------------
+//
+// Copyright (C) all of the contributors. All rights reserved.
+//
+// This software, including documentation, is protected by copyright controlled by
+// contributors. All rights are reserved. Copying, including reproducing, storing,
+// adapting or translating, any or all of this material requires the prior written
+// consent of all contributors.
+//
+// -------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace hyni {
+
+/**
+ * @brief What to do with text that is not valid UTF-8
+ */
+enum class utf8_policy {
+    none,       ///< Accept as is; serialization throws later
+    validate,   ///< Reject with an exception where the text comes in
+    repair      ///< Replace each invalid sequence with U+FFFD
+};
+
+/**
+ * @class utf8
+ * @brief UTF-8 validation and repair
+ *
+ * Validation follows RFC 3629 (no overlong forms, surrogates or code points
+ * above U+10FFFF). With AVX2, checked at runtime, it uses the Keiser-Lemire
+ * lookup algorithm and validates 64 bytes per step at several GB/s; elsewhere
+ * ASCII runs are skipped 16 bytes at a time and only non-ASCII sequences are
+ * decoded.
+ *
+ * Repair replaces every maximal invalid subsequence with U+FFFD, the same
+ * substitution browsers and most decoders apply.
+ *
+ * @note Thread-safe; all functions are stateless.
+ */
+class utf8 final {
+public:
+    [[nodiscard]] static bool is_valid(std::string_view text) noexcept;
+
+    /**
+     * @brief Offset of the first byte that is not part of a valid sequence, npos if none
+     */
+    [[nodiscard]] static size_t find_invalid(std::string_view text) noexcept;
+
+    /**
+     * @brief Copy of text with invalid sequences replaced by U+FFFD
+     */
+    [[nodiscard]] static std::string repair(std::string_view text);
+
+    /**
+     * @brief Repairs text in place
+     * @return True if anything was replaced
+     */
+    static bool repair_in_place(std::string& text);
+
+    /**
+     * @brief Instruction set used for validation: "avx2" or "scalar"
+     */
+    [[nodiscard]] static const char* simd_level() noexcept;
+
+    static constexpr std::string_view REPLACEMENT = "\xEF\xBF\xBD";
+};
+
+/**
+ * @class utf8_stream_repairer
+ * @brief Repairs text that arrives in chunks, e.g. a streamed response body
+ *
+ * Network chunks can end in the middle of a multibyte character. An
+ * incomplete but so far valid sequence at the end of a chunk is held back
+ * and completed by the next chunk instead of being replaced.
+ *
+ * @note NOT thread-safe; use one instance per stream.
+ */
+class utf8_stream_repairer {
+public:
+    /**
+     * @brief Valid UTF-8 for the chunk, minus a trailing partial character
+     */
+    [[nodiscard]] std::string feed(std::string_view chunk);
+
+    /**
+     * @brief Flushes a partial character left at the end of the stream as U+FFFD
+     */
+    [[nodiscard]] std::string finish();
+
+    /**
+     * @brief Number of invalid sequences replaced so far
+     */
+    [[nodiscard]] size_t replacements() const noexcept { return m_replacements; }
+
+private:
+    std::string m_pending;
+    size_t m_replacements = 0;
+};
+
+} // hyni
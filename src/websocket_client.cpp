@@ -4,20 +4,129 @@
 hyni_websocket_client::hyni_websocket_client(asio::io_context& io_context,
                                              const std::string& host,
                                              const std::string& port)
-    : m_websocket(asio::make_strand(io_context))
+    : m_io_context(io_context)
     , m_resolver(asio::make_strand(io_context))
     , m_ping_timer(io_context)
     , m_host(host)
     , m_port(port)
     , m_disconnect_timer(io_context)
-{}
+{
+    make_connection();
+}
+
+hyni_websocket_client::hyni_websocket_client(asio::io_context& io_context, const std::string& url)
+    : m_io_context(io_context)
+    , m_resolver(asio::make_strand(io_context))
+    , m_ping_timer(io_context)
+    , m_disconnect_timer(io_context)
+{
+    std::string rest;
+    if (url.rfind("wss://", 0) == 0) {
+        m_secure = true;
+        rest = url.substr(6);
+    } else if (url.rfind("ws://", 0) == 0) {
+        rest = url.substr(5);
+    } else {
+        throw std::invalid_argument("WebSocket URL must start with ws:// or wss://: " + url);
+    }
+
+    const auto target_start = rest.find_first_of("/?");
+    std::string authority = rest.substr(0, target_start);
+    if (target_start != std::string::npos) {
+        m_target = rest.substr(target_start);
+        if (m_target.front() == '?') {
+            m_target.insert(0, "/");
+        }
+    }
+
+    // [v6]:port, host:port or host
+    const auto bracket = authority.find(']');
+    const auto colon = authority.find(':', bracket == std::string::npos ? 0 : bracket);
+    m_host = authority.substr(0, colon);
+    m_port = colon == std::string::npos ? (m_secure ? "443" : "80") : authority.substr(colon + 1);
+    if (m_host.size() > 1 && m_host.front() == '[' && m_host.back() == ']') {
+        m_host = m_host.substr(1, m_host.size() - 2);
+    }
+    if (m_host.empty()) {
+        throw std::invalid_argument("WebSocket URL has no host: " + url);
+    }
+
+    if (m_secure) {
+        make_tls_context();
+    }
+    make_connection();
+}
 
 hyni_websocket_client::~hyni_websocket_client() {
 }
 
+void hyni_websocket_client::make_tls_context() {
+    m_tls_context = std::make_unique<asio::ssl::context>(asio::ssl::context::tls_client);
+    if (m_tls_options.verify_peer) {
+        m_tls_context->set_verify_mode(asio::ssl::verify_peer);
+        if (m_tls_options.ca_file.empty()) {
+            m_tls_context->set_default_verify_paths();
+        } else {
+            m_tls_context->load_verify_file(m_tls_options.ca_file);
+        }
+    } else {
+        m_tls_context->set_verify_mode(asio::ssl::verify_none);
+    }
+
+    // Sessions are kept by the client, not in OpenSSL's internal cache. TLS 1.3
+    // tickets arrive after the handshake, so they are collected by callback.
+    SSL_CTX* native = m_tls_context->native_handle();
+    SSL_CTX_set_session_cache_mode(native, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(native, &hyni_websocket_client::on_new_tls_session);
+
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    m_tls_session.reset();
+}
+
+// asio keeps its verify callback in the SSL app data, so the client has its own slot
+static int client_ex_data_index() {
+    static const int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+int hyni_websocket_client::on_new_tls_session(SSL* ssl, SSL_SESSION* session) {
+    auto* self = static_cast<hyni_websocket_client*>(SSL_get_ex_data(ssl, client_ex_data_index()));
+    if (!self || !self->m_tls_options.session_resumption) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(self->m_stats_mutex);
+    self->m_tls_session.reset(session, SSL_SESSION_free);
+    return 1;  // ownership taken
+}
+
+void hyni_websocket_client::make_connection() {
+    m_previous_connection = std::move(m_connection);
+    m_connection = std::make_unique<connection>();
+    if (m_secure) {
+        m_connection->tls = std::make_unique<tls_stream>(asio::make_strand(m_io_context), *m_tls_context);
+    } else {
+        m_connection->plain = std::make_unique<plain_stream>(asio::make_strand(m_io_context));
+    }
+}
+
 void hyni_websocket_client::connect() {
     if (m_connected) return;
 
+    // An explicit connect after disconnect() starts over; shutdown() is final
+    // for internal reconnects, which check m_shutting_down first
+    m_shutting_down = false;
+    m_ping_timer.cancel();
+    // A dropped connection leaves its socket open; replace the stream, since
+    // neither a websocket nor a TLS stream can be reused after a failure
+    if (with_stream([](auto& ws) { return beast::get_lowest_layer(ws).socket().is_open(); })) {
+        with_stream([](auto& ws) {
+            beast::error_code ignored;
+            beast::get_lowest_layer(ws).socket().close(ignored);
+        });
+        make_connection();
+    }
+
+    m_connect_start = std::chrono::steady_clock::now();
     m_resolver.async_resolve(
         m_host,
         m_port,
@@ -31,13 +140,15 @@ void hyni_websocket_client::disconnect() {
 
     m_shutting_down = true;
     auto weak_self = weak_from_this();
-    m_websocket.async_close(
-        websocket::close_code::normal,
-        [weak_self](beast::error_code ec) {
-            if (auto self = weak_self.lock()) {
-                self->on_close(ec);
-            }
-        });
+    with_stream([&](auto& ws) {
+        ws.async_close(
+            websocket::close_code::normal,
+            [weak_self](beast::error_code ec) {
+                if (auto self = weak_self.lock()) {
+                    self->on_close(ec);
+                }
+            });
+    });
 }
 
 void hyni_websocket_client::send(const std::string& message) {
@@ -52,12 +163,14 @@ void hyni_websocket_client::send(const std::string& message) {
     m_write_queue.push(message);
 
     if (!write_in_progress) {
-        m_websocket.text(true); // Set text mode
-        m_websocket.async_write(
-            asio::buffer(m_write_queue.front()),
-            beast::bind_front_handler(
-                &hyni_websocket_client::on_write,
-                shared_from_this()));
+        with_stream([&](auto& ws) {
+            ws.text(true); // Set text mode
+            ws.async_write(
+                asio::buffer(m_write_queue.front()),
+                beast::bind_front_handler(
+                    &hyni_websocket_client::on_write,
+                    shared_from_this()));
+        });
     }
 }
 
@@ -73,12 +186,14 @@ void hyni_websocket_client::sendAudioBuffer(const std::vector<uint8_t>& audioBuf
     m_audio_queue.push(audioBuffer);
 
     if (!write_in_progress) {
-        m_websocket.binary(true); // Set binary mode
-        m_websocket.async_write(
-            asio::buffer(m_audio_queue.front()),
-            beast::bind_front_handler(
-                &hyni_websocket_client::on_audio_write,
-                shared_from_this()));
+        with_stream([&](auto& ws) {
+            ws.binary(true); // Set binary mode
+            ws.async_write(
+                asio::buffer(m_audio_queue.front()),
+                beast::bind_front_handler(
+                    &hyni_websocket_client::on_audio_write,
+                    shared_from_this()));
+        });
     }
 }
 
@@ -86,20 +201,22 @@ void hyni_websocket_client::shutdown() {
     m_shutting_down.store(true);
     m_ping_timer.cancel();
 
-    if (m_websocket.is_open()) {
-        beast::get_lowest_layer(m_websocket).cancel();
-    }
+    with_stream([&](auto& ws) {
+        if (ws.is_open()) {
+            beast::get_lowest_layer(ws).cancel();
+        }
 
-    if (m_connected.load()) {
-        auto weak_self = weak_from_this();
-        m_websocket.async_close(
-            websocket::close_code::going_away,
-            [weak_self](beast::error_code ec) {
-                if (auto self = weak_self.lock()) {
-                    self->handle_final_close(ec);
-                }
-            });
-    }
+        if (m_connected.load()) {
+            auto weak_self = weak_from_this();
+            ws.async_close(
+                websocket::close_code::going_away,
+                [weak_self](beast::error_code ec) {
+                    if (auto self = weak_self.lock()) {
+                        self->handle_final_close(ec);
+                    }
+                });
+        }
+    });
 }
 
 void hyni_websocket_client::handle_final_close(beast::error_code ec) {
@@ -134,39 +251,126 @@ void hyni_websocket_client::set_close_handler(close_handler_t handler) {
     m_close_handler = std::move(handler);
 }
 
+void hyni_websocket_client::set_target(const std::string& target) {
+    m_target = target.empty() ? "/" : target;
+}
+
+void hyni_websocket_client::set_tls_options(const websocket_tls_options& options) {
+    m_tls_options = options;
+    if (m_secure) {
+        make_tls_context();
+        if (!m_connected) {
+            make_connection();
+        }
+    }
+}
+
+void hyni_websocket_client::set_disconnect_timeout(std::chrono::milliseconds timeout) {
+    m_disconnect_timeout = timeout;
+}
+
+void hyni_websocket_client::set_ping_interval(std::chrono::milliseconds interval) {
+    m_ping_interval = interval;
+}
+
+websocket_connection_stats hyni_websocket_client::get_connection_stats() const {
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    return m_stats;
+}
+
 void hyni_websocket_client::on_resolve(beast::error_code ec, asio::ip::tcp::resolver::results_type results) {
     if (m_shutting_down.load()) return;
     if (ec) {
         if (m_error_handler) m_error_handler("Resolve failed: " + ec.message());
+        start_disconnect_timer();
         return;
     }
 
-    beast::get_lowest_layer(m_websocket).expires_after(std::chrono::seconds(30));
-    beast::get_lowest_layer(m_websocket).async_connect(
-        results,
-        beast::bind_front_handler(
-            &hyni_websocket_client::on_connect,
-            shared_from_this()));
+    with_stream([&](auto& ws) {
+        beast::get_lowest_layer(ws).expires_after(std::chrono::seconds(30));
+        beast::get_lowest_layer(ws).async_connect(
+            results,
+            beast::bind_front_handler(
+                &hyni_websocket_client::on_connect,
+                shared_from_this()));
+    });
 }
 
 void hyni_websocket_client::on_connect(beast::error_code ec, asio::ip::tcp::resolver::results_type::endpoint_type) {
     if (m_shutting_down.load()) return;
     if (ec) {
         if (m_error_handler) m_error_handler("Connect failed: " + ec.message());
+        start_disconnect_timer();
+        return;
+    }
+
+    if (!m_connection->tls) {
+        start_websocket_handshake();
         return;
     }
 
-    beast::get_lowest_layer(m_websocket).expires_never();
-    m_websocket.set_option(websocket::stream_base::timeout::suggested(beast::role_type::client));
+    auto& tls = m_connection->tls->next_layer();
+    SSL* ssl = tls.native_handle();
+    SSL_set_ex_data(ssl, client_ex_data_index(), this);
+    // SNI, and the name the certificate must carry
+    if (!SSL_set_tlsext_host_name(ssl, m_host.c_str())) {
+        if (m_error_handler) m_error_handler("TLS setup failed: cannot set SNI host name");
+        start_disconnect_timer();
+        return;
+    }
+    if (m_tls_options.verify_peer) {
+        tls.set_verify_callback(asio::ssl::host_name_verification(m_host));
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_stats_mutex);
+        if (m_tls_options.session_resumption && m_tls_session) {
+            SSL_set_session(ssl, m_tls_session.get());
+        }
+    }
 
-    m_websocket.async_handshake(
-        m_host + ":" + m_port,
-        "/",
+    m_tls_start = std::chrono::steady_clock::now();
+    tls.async_handshake(
+        asio::ssl::stream_base::client,
         beast::bind_front_handler(
-            &hyni_websocket_client::on_handshake,
+            &hyni_websocket_client::on_tls_handshake,
             shared_from_this()));
 }
 
+void hyni_websocket_client::on_tls_handshake(beast::error_code ec) {
+    if (m_shutting_down.load()) return;
+    if (ec) {
+        if (m_error_handler) m_error_handler("TLS handshake failed: " + ec.message());
+        start_disconnect_timer();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_stats_mutex);
+        if (SSL_session_reused(m_connection->tls->next_layer().native_handle())) {
+            ++m_stats.tls_resumed_handshakes;
+        } else {
+            ++m_stats.tls_full_handshakes;
+        }
+        m_stats.last_tls_handshake_ms =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_tls_start).count();
+    }
+    start_websocket_handshake();
+}
+
+void hyni_websocket_client::start_websocket_handshake() {
+    with_stream([&](auto& ws) {
+        beast::get_lowest_layer(ws).expires_never();
+        ws.set_option(websocket::stream_base::timeout::suggested(beast::role_type::client));
+
+        ws.async_handshake(
+            m_host + ":" + m_port,
+            m_target,
+            beast::bind_front_handler(
+                &hyni_websocket_client::on_handshake,
+                shared_from_this()));
+    });
+}
+
 void hyni_websocket_client::on_handshake(beast::error_code ec) {
     if (m_shutting_down.load()) return;
 
@@ -180,20 +384,37 @@ void hyni_websocket_client::on_handshake(beast::error_code ec) {
     m_ping_outstanding = false;
     m_reconnect_attempts = 0;
     stop_disconnect_timer();
+    {
+        std::lock_guard<std::mutex> lock(m_stats_mutex);
+        ++m_stats.connects;
+        m_stats.last_connect_ms =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_connect_start).count();
+    }
 
     if (m_connection_handler) m_connection_handler(true);
 
-    m_websocket.async_read(
-        m_buffer,
-        beast::bind_front_handler(
-            &hyni_websocket_client::on_read,
-            shared_from_this()));
+    m_buffer.clear();
+    with_stream([&](auto& ws) {
+        // Pongs arrive while a read is pending
+        auto weak_self = weak_from_this();
+        ws.control_callback([weak_self](websocket::frame_type kind, beast::string_view) {
+            if (auto self = weak_self.lock(); self && kind == websocket::frame_type::pong) {
+                self->m_ping_outstanding = false;
+            }
+        });
+        ws.async_read(
+            m_buffer,
+            beast::bind_front_handler(
+                &hyni_websocket_client::on_read,
+                shared_from_this()));
+    });
 
     start_ping();
 }
 
 void hyni_websocket_client::on_read(beast::error_code ec, std::size_t bytes_transferred) {
-    if (m_shutting_down.load()) return;
+    // Aborted reads belong to a connection that was replaced or shut down
+    if (m_shutting_down.load() || ec == asio::error::operation_aborted) return;
 
     if (ec == websocket::error::closed) {
         m_connected = false;
@@ -209,7 +430,7 @@ void hyni_websocket_client::on_read(beast::error_code ec, std::size_t bytes_tran
     }
 
     // Handle binary or text message
-    if (m_websocket.got_text()) {
+    if (with_stream([](auto& ws) { return ws.got_text(); })) {
         if (m_message_handler) {
             m_message_handler(beast::buffers_to_string(m_buffer.data()));
         }
@@ -221,11 +442,13 @@ void hyni_websocket_client::on_read(beast::error_code ec, std::size_t bytes_tran
     }
 
     m_buffer.consume(bytes_transferred);
-    m_websocket.async_read(
-        m_buffer,
-        beast::bind_front_handler(
-            &hyni_websocket_client::on_read,
-            shared_from_this()));
+    with_stream([&](auto& ws) {
+        ws.async_read(
+            m_buffer,
+            beast::bind_front_handler(
+                &hyni_websocket_client::on_read,
+                shared_from_this()));
+    });
 }
 
 void hyni_websocket_client::on_write(beast::error_code ec, std::size_t) {
@@ -240,12 +463,14 @@ void hyni_websocket_client::on_write(beast::error_code ec, std::size_t) {
     m_write_queue.pop();
 
     if (!m_write_queue.empty()) {
-        m_websocket.text(true);
-        m_websocket.async_write(
-            asio::buffer(m_write_queue.front()),
-            beast::bind_front_handler(
-                &hyni_websocket_client::on_write,
-                shared_from_this()));
+        with_stream([&](auto& ws) {
+            ws.text(true);
+            ws.async_write(
+                asio::buffer(m_write_queue.front()),
+                beast::bind_front_handler(
+                    &hyni_websocket_client::on_write,
+                    shared_from_this()));
+        });
     }
 }
 
@@ -261,12 +486,14 @@ void hyni_websocket_client::on_audio_write(beast::error_code ec, std::size_t) {
     m_audio_queue.pop();
 
     if (!m_audio_queue.empty()) {
-        m_websocket.binary(true);
-        m_websocket.async_write(
-            asio::buffer(m_audio_queue.front()),
-            beast::bind_front_handler(
-                &hyni_websocket_client::on_audio_write,
-                shared_from_this()));
+        with_stream([&](auto& ws) {
+            ws.binary(true);
+            ws.async_write(
+                asio::buffer(m_audio_queue.front()),
+                beast::bind_front_handler(
+                    &hyni_websocket_client::on_audio_write,
+                    shared_from_this()));
+        });
     }
 }
 
@@ -290,7 +517,7 @@ void hyni_websocket_client::on_close(beast::error_code ec) {
 void hyni_websocket_client::start_ping() {
     if (m_shutting_down.load()) return;
 
-    m_ping_timer.expires_after(std::chrono::seconds(30));
+    m_ping_timer.expires_after(m_ping_interval);
     m_ping_timer.async_wait(
         beast::bind_front_handler(
             &hyni_websocket_client::on_ping_timer,
@@ -301,19 +528,26 @@ void hyni_websocket_client::on_ping_timer(beast::error_code ec) {
     if (ec || m_shutting_down.load()) return;
 
     if (m_ping_outstanding) {
+        // The connection is dead, not closed by the caller: drop it and reconnect.
+        // disconnect() would mark the close as intended and stop reconnects.
         if (m_error_handler) m_error_handler("Ping timeout");
-        disconnect();
+        m_connected = false;
+        with_stream([](auto& ws) { beast::get_lowest_layer(ws).cancel(); });
+        if (m_connection_handler) m_connection_handler(false);
+        start_disconnect_timer();
         return;
     }
 
     m_ping_outstanding = true;
     m_last_ping = std::chrono::steady_clock::now();
 
-    m_websocket.async_ping(
-        {},
-        beast::bind_front_handler(
-            &hyni_websocket_client::on_ping,
-            shared_from_this()));
+    with_stream([&](auto& ws) {
+        ws.async_ping(
+            {},
+            beast::bind_front_handler(
+                &hyni_websocket_client::on_ping,
+                shared_from_this()));
+    });
 }
 
 void hyni_websocket_client::on_ping(beast::error_code ec) {
@@ -324,7 +558,7 @@ void hyni_websocket_client::on_ping(beast::error_code ec) {
         return;
     }
 
-    m_ping_outstanding = false;
+    // Outstanding until the pong arrives; the next tick checks
     start_ping();
 }
 
@@ -349,7 +583,7 @@ void hyni_websocket_client::stop_disconnect_timer() {
 }
 
 void hyni_websocket_client::on_disconnect_timeout(beast::error_code ec) {
-    if (ec == asio::error::operation_aborted) return;
+    if (ec == asio::error::operation_aborted || m_shutting_down.load()) return;
 
     m_disconnect_timer_active = false;
 
@@ -359,6 +593,6 @@ void hyni_websocket_client::on_disconnect_timeout(beast::error_code ec) {
             std::chrono::seconds(1 << m_reconnect_attempts),
             std::chrono::seconds(60));
         m_disconnect_timer.expires_after(delay);
-        connect(); // Attempt to reconnect
+        connect(); // Attempt to reconnect; with wss the cached TLS session is resumed
     }
 }
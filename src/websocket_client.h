@@ -5,9 +5,12 @@
 #include <functional>
 #include <queue>
 #include <memory>
+#include <mutex>
 #include <atomic>
 #include <boost/beast.hpp>
+#include <boost/beast/ssl.hpp>
 #include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
 #include <nlohmann/json.hpp>
 
 namespace beast = boost::beast;
@@ -15,6 +18,22 @@ namespace websocket = beast::websocket;
 namespace asio = boost::asio;
 using json = nlohmann::json;
 
+// TLS settings for wss:// connections
+struct websocket_tls_options {
+    bool verify_peer = true;         // verify the certificate chain and the host name
+    std::string ca_file;             // PEM bundle to trust; empty for the system default paths
+    bool session_resumption = true;  // resume the previous TLS session on reconnect
+};
+
+// Connection counters; TLS resumption skips the certificate exchange and key agreement
+struct websocket_connection_stats {
+    size_t connects = 0;                 // completed WebSocket handshakes
+    size_t tls_full_handshakes = 0;
+    size_t tls_resumed_handshakes = 0;
+    double last_connect_ms = 0.0;        // resolve to completed WebSocket handshake
+    double last_tls_handshake_ms = 0.0;
+};
+
 class hyni_websocket_client : public std::enable_shared_from_this<hyni_websocket_client> {
 public:
     using message_handler_t = std::function<void(const std::string&)>;
@@ -23,7 +42,13 @@ public:
     using error_handler_t = std::function<void(const std::string&)>;
     using close_handler_t = std::function<void(boost::beast::error_code)>;
 
+    // Plain ws:// to host:port, target "/"
     hyni_websocket_client(asio::io_context& io_context, const std::string& host, const std::string& port);
+
+    // ws:// or wss:// URL with optional port, path and query, e.g.
+    // "wss://api.example.com/v1/realtime?model=x"; throws std::invalid_argument for other schemes
+    hyni_websocket_client(asio::io_context& io_context, const std::string& url);
+
     ~hyni_websocket_client();
 
     void connect();
@@ -38,11 +63,49 @@ public:
     void set_error_handler(error_handler_t handler);
     void set_close_handler(close_handler_t handler);
 
+    // Path and query sent in the handshake; takes effect on the next connect
+    void set_target(const std::string& target);
+    const std::string& get_target() const noexcept { return m_target; }
+
+    // Applies to wss:// only; takes effect on the next connect and drops a cached session
+    void set_tls_options(const websocket_tls_options& options);
+    bool is_secure() const noexcept { return m_secure; }
+
+    // Delay before reconnecting after the connection is lost
+    void set_disconnect_timeout(std::chrono::milliseconds timeout);
+
+    // Time between pings; a ping still unanswered at the next one drops the connection
+    void set_ping_interval(std::chrono::milliseconds interval);
+
+    websocket_connection_stats get_connection_stats() const;
+
     void shutdown();
 
 private:
+    using plain_stream = websocket::stream<beast::tcp_stream>;
+    using tls_stream = websocket::stream<beast::ssl_stream<beast::tcp_stream>>;
+
+    // Exactly one stream is set. A fresh one is made for every connect; the
+    // previous connection is kept until the next one so its cancelled
+    // operations can still complete against it.
+    struct connection {
+        std::unique_ptr<plain_stream> plain;
+        std::unique_ptr<tls_stream> tls;
+    };
+
+    template<typename Fn>
+    decltype(auto) with_stream(Fn&& fn) {
+        return m_connection->tls ? fn(*m_connection->tls) : fn(*m_connection->plain);
+    }
+
+    void make_connection();
+    void make_tls_context();
+    static int on_new_tls_session(SSL* ssl, SSL_SESSION* session);
+
     void on_resolve(beast::error_code ec, asio::ip::tcp::resolver::results_type results);
     void on_connect(beast::error_code ec, asio::ip::tcp::resolver::results_type::endpoint_type);
+    void on_tls_handshake(beast::error_code ec);
+    void start_websocket_handshake();
     void on_handshake(beast::error_code ec);
     void on_read(beast::error_code ec, std::size_t bytes_transferred);
     void on_write(beast::error_code ec, std::size_t bytes_transferred);
@@ -56,11 +119,23 @@ private:
     void stop_disconnect_timer();
     void on_disconnect_timeout(beast::error_code ec);
 
-    websocket::stream<beast::tcp_stream> m_websocket;
+    asio::io_context& m_io_context;
+    std::unique_ptr<connection> m_connection;
+    std::unique_ptr<connection> m_previous_connection;
     asio::ip::tcp::resolver m_resolver;
     asio::steady_timer m_ping_timer;
     std::string m_host;
     std::string m_port;
+    std::string m_target = "/";
+    bool m_secure = false;
+
+    websocket_tls_options m_tls_options;
+    std::unique_ptr<asio::ssl::context> m_tls_context;
+    std::shared_ptr<SSL_SESSION> m_tls_session;   // latest session ticket from the server
+    std::chrono::steady_clock::time_point m_connect_start;
+    std::chrono::steady_clock::time_point m_tls_start;
+    mutable std::mutex m_stats_mutex;             // guards m_tls_session and m_stats
+    websocket_connection_stats m_stats;
 
     beast::flat_buffer m_buffer;
     std::queue<std::string> m_write_queue;
@@ -78,7 +153,8 @@ private:
     std::atomic<bool> m_ping_outstanding{false};
 
     asio::steady_timer m_disconnect_timer;
-    std::chrono::seconds m_disconnect_timeout{10};
+    std::chrono::milliseconds m_disconnect_timeout{10000};
+    std::chrono::milliseconds m_ping_interval{30000};
     bool m_disconnect_timer_active{false};
     int m_reconnect_attempts{0};
 };
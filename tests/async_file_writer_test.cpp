@@ -0,0 +1,190 @@
+#include "../src/async_file_writer.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+namespace hyni {
+namespace testing {
+
+namespace {
+
+std::string read_file(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    return ss.str();
+}
+
+} // anonymous namespace
+
+class AsyncFileWriterTest : public ::testing::TestWithParam<async_io_service::backend> {
+protected:
+    void SetUp() override {
+        if (GetParam() == async_io_service::backend::io_uring && !async_io_service::io_uring_supported()) {
+            GTEST_SKIP() << "io_uring is not available here";
+        }
+        m_dir = std::filesystem::temp_directory_path() /
+                ("hyni_async_writer_" + std::to_string(::getpid()));
+        std::filesystem::create_directories(m_dir);
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        std::filesystem::remove_all(m_dir, ec);
+    }
+
+    std::filesystem::path m_dir;
+};
+
+TEST_P(AsyncFileWriterTest, KeepsOrderAcrossBuffers) {
+    async_io_service service(GetParam(), 4096, 4);  // small pool so heap buffers are used too
+    EXPECT_EQ(service.uses_io_uring(), GetParam() == async_io_service::backend::io_uring);
+
+    std::string expected;
+    {
+        async_file_writer writer(m_dir / "ordered.log", {}, service);
+        for (int i = 0; i < 2000; ++i) {
+            std::string line = "line " + std::to_string(i) + " " + std::string(i % 97, 'x') + "\n";
+            writer.write(line);
+            expected += line;
+        }
+        EXPECT_EQ(writer.bytes_written(), expected.size());
+        EXPECT_TRUE(writer.close());
+    }
+    EXPECT_EQ(read_file(m_dir / "ordered.log"), expected);
+
+    auto stats = service.get_stats();
+    EXPECT_EQ(stats.bytes, expected.size());
+    EXPECT_EQ(stats.errors, 0u);
+    if (service.uses_registered_buffers()) {
+        EXPECT_GT(stats.registered_writes, 0u);
+    }
+}
+
+TEST_P(AsyncFileWriterTest, BatchesWritesOfConcurrentFiles) {
+    async_io_service service(GetParam(), 4096, 16);
+    constexpr int files = 4;
+    constexpr int lines = 5000;
+
+    std::vector<std::thread> threads;
+    for (int f = 0; f < files; ++f) {
+        threads.emplace_back([&, f] {
+            async_file_writer writer(m_dir / ("concurrent_" + std::to_string(f) + ".log"), {}, service);
+            for (int i = 0; i < lines; ++i) {
+                writer.write("file " + std::to_string(f) + " line " + std::to_string(i) + "\n");
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (int f = 0; f < files; ++f) {
+        std::istringstream content(read_file(m_dir / ("concurrent_" + std::to_string(f) + ".log")));
+        std::string line;
+        int i = 0;
+        while (std::getline(content, line)) {
+            ASSERT_EQ(line, "file " + std::to_string(f) + " line " + std::to_string(i));
+            ++i;
+        }
+        EXPECT_EQ(i, lines);
+    }
+
+    auto stats = service.get_stats();
+    EXPECT_GT(stats.writes, 0u);
+    EXPECT_LE(stats.batches, stats.writes + stats.fsyncs);
+    if (service.uses_io_uring()) {
+        EXPECT_LE(stats.submit_calls, stats.writes + stats.fsyncs);
+    }
+}
+
+TEST_P(AsyncFileWriterTest, FlushSyncAndPolicies) {
+    async_io_service service(GetParam(), 4096, 4);
+
+    async_file_writer writer(m_dir / "synced.log", {fsync_policy::always}, service);
+    writer.write("first\n");
+    writer.flush();
+    EXPECT_EQ(read_file(m_dir / "synced.log"), "first\n");
+
+    writer.write("second\n");
+    writer.sync();
+    EXPECT_EQ(read_file(m_dir / "synced.log"), "first\nsecond\n");
+    EXPECT_GE(service.get_stats().fsyncs, 1u);
+    EXPECT_TRUE(writer.close());
+    EXPECT_FALSE(writer.is_open());
+
+    // Appends by default, truncates on request; never-synced files issue no fsync
+    auto fsyncs = service.get_stats().fsyncs;
+    {
+        async_file_writer append(m_dir / "synced.log", {fsync_policy::never}, service);
+        append.write("third\n");
+    }
+    EXPECT_EQ(read_file(m_dir / "synced.log"), "first\nsecond\nthird\n");
+    EXPECT_EQ(service.get_stats().fsyncs, fsyncs);
+
+    {
+        async_file_writer truncate(m_dir / "synced.log", {fsync_policy::on_close, {}, true}, service);
+        truncate.write("fresh\n");
+    }
+    EXPECT_EQ(read_file(m_dir / "synced.log"), "fresh\n");
+    EXPECT_EQ(service.get_stats().fsyncs, fsyncs + 1);
+
+    EXPECT_THROW(async_file_writer(m_dir / "missing_dir" / "x.log", {}, service), std::runtime_error);
+}
+
+TEST_P(AsyncFileWriterTest, SyncingWritersSaturatingTheQueue) {
+    // Queue limit of two buffers: writers wait for space all the time, while the
+    // I/O thread queues an fsync after every batch
+    async_io_service service(GetParam(), 4096, 4, 2 * 4096);
+    EXPECT_EQ(service.max_queued_bytes(), 2 * 4096u);
+    constexpr int threads_per_file = 2;
+    constexpr int files = 3;
+    constexpr int lines = 3000;
+    const std::string padding(100, 'p');
+
+    std::vector<std::unique_ptr<async_file_writer>> writers;
+    for (int f = 0; f < files; ++f) {
+        const auto policy = f == 0 ? fsync_policy::interval : fsync_policy::always;
+        writers.push_back(std::make_unique<async_file_writer>(
+            m_dir / ("saturated_" + std::to_string(f) + ".log"),
+            async_file_options{policy, std::chrono::milliseconds(0)}, service));
+    }
+
+    std::vector<std::thread> threads;
+    for (int f = 0; f < files; ++f) {
+        for (int t = 0; t < threads_per_file; ++t) {
+            threads.emplace_back([&, f, t] {
+                for (int i = 0; i < lines; ++i) {
+                    writers[f]->write(std::to_string(t) + " " + padding + "\n");
+                }
+            });
+        }
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (auto& writer : writers) {
+        EXPECT_TRUE(writer->close());
+    }
+
+    const size_t line_size = 2 + padding.size() + 1;
+    for (int f = 0; f < files; ++f) {
+        EXPECT_EQ(read_file(m_dir / ("saturated_" + std::to_string(f) + ".log")).size(),
+                  threads_per_file * lines * line_size);
+    }
+    auto stats = service.get_stats();
+    EXPECT_GT(stats.fsyncs, static_cast<uint64_t>(files));
+    EXPECT_EQ(stats.errors, 0u);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, AsyncFileWriterTest,
+                         ::testing::Values(async_io_service::backend::thread,
+                                           async_io_service::backend::io_uring),
+                         [](const auto& info) {
+                             return info.param == async_io_service::backend::thread ? "Thread" : "IoUring";
+                         });
+
+} // namespace testing
+} // namespace hyni
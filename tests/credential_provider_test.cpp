@@ -0,0 +1,141 @@
+#include "../src/credential_provider.h"
+#include "../src/schema_registry.h"
+#include "../src/context_factory.h"
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace hyni {
+namespace testing {
+
+class CredentialProviderTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        m_dir = std::filesystem::temp_directory_path() / "hyni_credential_test";
+        std::filesystem::create_directories(m_dir);
+        m_rc_path = m_dir / ".hynirc";
+        unsetenv("HYNI_TEST_API_KEY");
+    }
+
+    void TearDown() override {
+        unsetenv("HYNI_TEST_API_KEY");
+        std::filesystem::remove_all(m_dir);
+    }
+
+    void write_rc(const std::string& content) {
+        std::ofstream file(m_rc_path, std::ios::trunc);
+        file << content;
+    }
+
+    std::filesystem::path m_dir;
+    std::filesystem::path m_rc_path;
+};
+
+TEST_F(CredentialProviderTest, ParsesRcFile) {
+    write_rc("  HYNI_TEST_API_KEY = abc123 \nno delimiter\nOTHER=x=y\r\n");
+    auto values = credential_provider::parse_rc_file(m_rc_path);
+
+    EXPECT_EQ(values["HYNI_TEST_API_KEY"], "abc123");
+    EXPECT_EQ(values["OTHER"], "x=y");
+    EXPECT_EQ(values.size(), 2u);
+}
+
+TEST_F(CredentialProviderTest, EnvironmentTakesPrecedenceOverRcFile) {
+    write_rc("HYNI_TEST_API_KEY=from-file\n");
+    setenv("HYNI_TEST_API_KEY", "from-env", 1);
+
+    credential_provider provider(m_rc_path, std::chrono::milliseconds(0));
+    provider.register_env_var("test", "HYNI_TEST_API_KEY");
+    EXPECT_EQ(provider.get_api_key("test"), "from-env");
+
+    unsetenv("HYNI_TEST_API_KEY");
+    EXPECT_EQ(provider.get_api_key("test"), "from-env"); // cached until refresh
+
+    provider.refresh();
+    EXPECT_EQ(provider.get_api_key("test"), "from-file");
+}
+
+TEST_F(CredentialProviderTest, RcFileIsReadOnceForRepeatedLookups) {
+    write_rc("HYNI_TEST_API_KEY=cached\n");
+
+    credential_provider provider(m_rc_path, std::chrono::milliseconds(0));
+    provider.register_env_var("test", "HYNI_TEST_API_KEY");
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(provider.get_api_key("test"), "cached");
+    }
+    EXPECT_EQ(provider.get_api_key("unknown"), "");
+    EXPECT_EQ(provider.get_reload_count(), 1u);
+}
+
+TEST_F(CredentialProviderTest, PicksUpRotatedKeyFromWatchedFile) {
+    write_rc("HYNI_TEST_API_KEY=old-key\n");
+
+    credential_provider provider(m_rc_path, std::chrono::milliseconds(10));
+    provider.register_env_var("test", "HYNI_TEST_API_KEY");
+    ASSERT_EQ(provider.get_api_key("test"), "old-key");
+
+    write_rc("HYNI_TEST_API_KEY=rotated-key-value\n");
+
+    std::string key;
+    for (int i = 0; i < 200 && key != "rotated-key-value"; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        key = provider.get_api_key("test");
+    }
+    EXPECT_EQ(key, "rotated-key-value");
+    EXPECT_EQ(provider.get_reload_count(), 2u);
+}
+
+TEST_F(CredentialProviderTest, WatchesOnlyWhenRcFileExists) {
+    credential_provider provider(m_rc_path, std::chrono::milliseconds(10));
+    provider.register_env_var("test", "HYNI_TEST_API_KEY");
+    EXPECT_FALSE(provider.is_watching());
+    EXPECT_EQ(provider.get_api_key("test"), "");
+
+    write_rc("HYNI_TEST_API_KEY=created-later\n");
+    provider.refresh();
+    EXPECT_TRUE(provider.is_watching());
+    EXPECT_EQ(provider.get_api_key("test"), "created-later");
+
+    credential_provider disabled(m_rc_path, std::chrono::milliseconds(0));
+    EXPECT_FALSE(disabled.is_watching());
+}
+
+TEST_F(CredentialProviderTest, EnvVarComesFromSchema) {
+    credential_provider provider(m_rc_path, std::chrono::milliseconds(0));
+
+    // Bundled providers keep their historical names without a schema
+    EXPECT_EQ(provider.get_env_var("openai"), "OA_API_KEY");
+    EXPECT_EQ(provider.get_env_var("my-provider"), "MY_PROVIDER_API_KEY");
+
+    auto schema = nlohmann::json::parse(R"({
+        "provider": {"name": "openai"},
+        "authentication": {"type": "header", "env_var": "HYNI_TEST_API_KEY"}
+    })");
+    provider.register_schema(schema);
+    EXPECT_EQ(provider.get_env_var("openai"), "HYNI_TEST_API_KEY");
+
+    setenv("HYNI_TEST_API_KEY", "schema-mapped", 1);
+    EXPECT_EQ(provider.get_api_key("openai"), "schema-mapped");
+}
+
+TEST_F(CredentialProviderTest, BundledSchemasDeclareEnvVars) {
+    auto registry = schema_registry::create().set_schema_directory("../schemas").build();
+    context_factory factory(registry);
+
+    const std::unordered_map<std::string, std::string> expected = {
+        {"openai", "OA_API_KEY"},
+        {"deepseek", "DS_API_KEY"},
+        {"claude", "CL_API_KEY"},
+        {"mistral", "MS_API_KEY"},
+    };
+    for (const auto& [provider, env_var] : expected) {
+        auto context = factory.create_context(provider);
+        EXPECT_EQ(context->get_schema()["authentication"]["env_var"], env_var);
+        EXPECT_EQ(credential_provider::instance().get_env_var(provider), env_var);
+    }
+}
+
+} // namespace testing
+} // namespace hyni
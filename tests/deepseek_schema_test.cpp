@@ -35,9 +35,10 @@ protected:
             GTEST_SKIP() << "DeepSeek schema file not found at: " << m_schema_path;
         }
 
+        // The schema extends openai.json; test the resolved result
         try {
-            file >> m_schema;
-        } catch (const json::parse_error& e) {
+            m_schema = general_context::load_schema_file(m_schema_path);
+        } catch (const schema_exception& e) {
             FAIL() << "Failed to parse DeepSeek schema: " << e.what();
         }
 
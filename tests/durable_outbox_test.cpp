@@ -0,0 +1,274 @@
+#include "../src/durable_outbox.h"
+#include "../src/chat_api.h"
+#include "../src/context_factory.h"
+#include "mock_http_server.h"
+#include <gtest/gtest.h>
+#include <csignal>
+#include <fstream>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace hyni {
+namespace testing {
+
+namespace {
+
+std::string text_of(const nlohmann::json& message) {
+    const auto& content = message["content"];
+    return content.is_string() ? content.get<std::string>() : content[0]["text"].get<std::string>();
+}
+
+// Answers like OpenAI, echoing the last message's text back
+mock_response echo(const mock_request& request) {
+    auto body = nlohmann::json::parse(request.body);
+    std::string content = text_of(body["messages"].back());
+    nlohmann::json response = {{"choices", {{{"message", {{"role", "assistant"}, {"content", "re: " + content}}}}}}};
+    return {200, "application/json", response.dump()};
+}
+
+outbox_request make_request(const std::string& id, const std::string& text) {
+    outbox_request request;
+    request.id = id;
+    request.messages.push_back({"user", text});
+    return request;
+}
+
+} // anonymous namespace
+
+class DurableOutboxTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        m_dir = std::filesystem::temp_directory_path() / ("hyni_outbox_" + std::to_string(::getpid()));
+        std::filesystem::remove_all(m_dir);
+
+        auto registry = schema_registry::create().set_schema_directory("../schemas").build();
+        context_factory factory(registry);
+        m_schema = factory.create_context("openai")->get_schema();
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        std::filesystem::remove_all(m_dir, ec);
+    }
+
+    durable_outbox::api_factory api_for(const mock_http_server& server) {
+        auto schema = m_schema;
+        schema["api"]["endpoint"] = server.url() + "/v1/chat/completions";
+        return [schema] {
+            auto context = std::make_unique<general_context>(schema);
+            context->set_api_key("test-key");
+            return std::make_shared<chat_api>(std::move(context));
+        };
+    }
+
+    static outbox_options fast_options(size_t workers) {
+        outbox_options options;
+        options.workers = workers;
+        options.retry_delay = std::chrono::milliseconds(5);
+        return options;
+    }
+
+    std::filesystem::path m_dir;
+    nlohmann::json m_schema;
+};
+
+TEST_F(DurableOutboxTest, SendsQueuedRequestsAndJournalsResults) {
+    mock_http_server server(echo);
+    std::atomic<int> callbacks{0};
+    {
+        durable_outbox outbox(m_dir, api_for(server), fast_options(2),
+                              [&](const outbox_result&) { ++callbacks; });
+        for (int i = 0; i < 20; ++i) {
+            EXPECT_TRUE(outbox.enqueue(make_request("req-" + std::to_string(i), "text " + std::to_string(i))));
+        }
+        ASSERT_TRUE(outbox.wait_idle(std::chrono::seconds(10)));
+
+        auto result = outbox.get_result("req-7");
+        ASSERT_TRUE(result);
+        EXPECT_TRUE(result->success);
+        EXPECT_EQ(result->response, "re: text 7");
+        EXPECT_EQ(result->attempts, 1u);
+
+        auto stats = outbox.get_stats();
+        EXPECT_EQ(stats.enqueued, 20u);
+        EXPECT_EQ(stats.succeeded, 20u);
+        // Requests queued together share an fsync
+        EXPECT_LT(stats.commits, 20u);
+    }
+    EXPECT_EQ(callbacks.load(), 20);
+    EXPECT_EQ(server.request_count(), 20u);
+
+    // Results survive a restart; finished requests are not sent again
+    durable_outbox reopened(m_dir, api_for(server), fast_options(2));
+    EXPECT_EQ(reopened.get_stats().recovered, 0u);
+    EXPECT_EQ(reopened.get_result("req-7")->response, "re: text 7");
+    EXPECT_FALSE(reopened.enqueue(make_request("req-7", "again")));
+    EXPECT_EQ(reopened.get_stats().duplicates, 1u);
+}
+
+TEST_F(DurableOutboxTest, ResumesPendingRequestsAfterRestart) {
+    mock_http_server server(echo);
+    {
+        // No workers: the process "crashes" with everything still queued
+        durable_outbox outbox(m_dir, api_for(server), fast_options(0));
+        EXPECT_TRUE(outbox.enqueue(make_request("a", "first")));
+        EXPECT_TRUE(outbox.enqueue(make_request("b", "second")));
+        EXPECT_FALSE(outbox.enqueue(make_request("a", "duplicate")));
+        outbox.commit();
+        EXPECT_EQ(outbox.pending(), 2u);
+    }
+    // A record cut short by the crash is ignored
+    std::ofstream(m_dir / "requests.log", std::ios::app) << R"({"id":"torn","messa)";
+
+    durable_outbox outbox(m_dir, api_for(server), fast_options(1));
+    EXPECT_EQ(outbox.get_stats().recovered, 2u);
+    ASSERT_TRUE(outbox.wait_idle(std::chrono::seconds(10)));
+    EXPECT_EQ(outbox.get_result("a")->response, "re: first");
+    EXPECT_EQ(outbox.get_result("b")->response, "re: second");
+    EXPECT_FALSE(outbox.get_result("torn"));
+    EXPECT_EQ(server.request_count(), 2u);
+}
+
+TEST_F(DurableOutboxTest, RetriesAndRecordsFailures) {
+    std::atomic<int> calls{0};
+    mock_http_server server([&](const mock_request& request) {
+        auto body = nlohmann::json::parse(request.body);
+        if (text_of(body["messages"].back()) == "never" || ++calls < 3) {
+            return mock_response{503, "application/json", R"({"error":{"message":"overloaded"}})"};
+        }
+        return echo(request);
+    });
+
+    durable_outbox outbox(m_dir, api_for(server), fast_options(1));
+    outbox.enqueue(make_request("flaky", "eventually"));
+    ASSERT_TRUE(outbox.wait_idle(std::chrono::seconds(10)));
+    auto flaky = outbox.get_result("flaky");
+    EXPECT_TRUE(flaky->success);
+    EXPECT_EQ(flaky->attempts, 3u);
+
+    outbox.enqueue(make_request("doomed", "never"));
+    ASSERT_TRUE(outbox.wait_idle(std::chrono::seconds(10)));
+    auto doomed = outbox.get_result("doomed");
+    EXPECT_FALSE(doomed->success);
+    EXPECT_EQ(doomed->attempts, 5u);
+    EXPECT_FALSE(doomed->error.empty());
+    EXPECT_EQ(outbox.get_stats().failed, 1u);
+}
+
+TEST_F(DurableOutboxTest, FailedSyncIsNotAcknowledged) {
+    mock_http_server server(echo);
+    durable_outbox outbox(m_dir, api_for(server), fast_options(1));
+
+    // Writes past the file size limit fail with EFBIG, as they would on a full disk
+    rlimit saved{};
+    ::getrlimit(RLIMIT_FSIZE, &saved);
+    auto previous = std::signal(SIGXFSZ, SIG_IGN);
+    rlimit limited = saved;
+    limited.rlim_cur = 64 * 1024;
+    ::setrlimit(RLIMIT_FSIZE, &limited);
+
+    outbox.enqueue(make_request("too-big", std::string(256 * 1024, 'x')));
+    EXPECT_THROW(outbox.commit(), std::runtime_error);
+
+    ::setrlimit(RLIMIT_FSIZE, &saved);
+    std::signal(SIGXFSZ, previous);
+
+    EXPECT_FALSE(outbox.last_error().empty());
+    EXPECT_THROW(outbox.enqueue(make_request("later", "text")), std::runtime_error);
+    EXPECT_FALSE(outbox.wait_idle(std::chrono::milliseconds(50)));
+    EXPECT_EQ(outbox.pending(), 1u);
+    EXPECT_EQ(server.request_count(), 0u);
+}
+
+TEST_F(DurableOutboxTest, ClientErrorsAreNotRetried) {
+    mock_http_server server([](const mock_request&) {
+        return mock_response{400, "application/json", R"({"error":{"message":"bad request"}})"};
+    });
+
+    durable_outbox outbox(m_dir, api_for(server), fast_options(1));
+    outbox.enqueue(make_request("rejected", "malformed"));
+    ASSERT_TRUE(outbox.wait_idle(std::chrono::seconds(10)));
+
+    auto rejected = outbox.get_result("rejected");
+    ASSERT_TRUE(rejected);
+    EXPECT_FALSE(rejected->success);
+    EXPECT_EQ(rejected->attempts, 1u);
+    EXPECT_NE(rejected->error.find("400"), std::string::npos);
+    EXPECT_EQ(server.request_count(), 1u);
+}
+
+TEST_F(DurableOutboxTest, FailingApiFactoryDoesNotStrandRequests) {
+    auto options = fast_options(2);
+    options.max_attempts = 3;
+    durable_outbox outbox(m_dir, []() -> std::shared_ptr<chat_api> {
+        throw std::runtime_error("no credentials");
+    }, options);
+
+    outbox.enqueue(make_request("stranded", "hello"));
+    ASSERT_TRUE(outbox.wait_idle(std::chrono::seconds(10)));
+
+    auto stranded = outbox.get_result("stranded");
+    ASSERT_TRUE(stranded);
+    EXPECT_FALSE(stranded->success);
+    EXPECT_EQ(stranded->attempts, 3u);
+    EXPECT_EQ(stranded->error, "no credentials");
+}
+
+TEST_F(DurableOutboxTest, KeepsOnlyTheNewestResults) {
+    mock_http_server server(echo);
+    auto options = fast_options(1);
+    options.max_results = 3;
+    {
+        durable_outbox outbox(m_dir, api_for(server), options);
+        for (int i = 0; i < 5; ++i) {
+            outbox.enqueue(make_request("req-" + std::to_string(i), "text"));
+            ASSERT_TRUE(outbox.wait_idle(std::chrono::seconds(10)));
+        }
+        EXPECT_FALSE(outbox.get_result("req-1"));
+        EXPECT_TRUE(outbox.get_result("req-2"));
+        EXPECT_TRUE(outbox.get_result("req-4"));
+    }
+
+    durable_outbox reopened(m_dir, api_for(server), options);
+    EXPECT_EQ(reopened.get_stats().recovered, 0u);
+    EXPECT_FALSE(reopened.get_result("req-1"));
+    EXPECT_TRUE(reopened.get_result("req-2"));
+
+    std::ifstream results(m_dir / "results.log");
+    size_t lines = 0;
+    for (std::string line; std::getline(results, line);) {
+        ++lines;
+    }
+    EXPECT_EQ(lines, 3u);
+    EXPECT_EQ(server.request_count(), 5u);
+}
+
+TEST_F(DurableOutboxTest, AppliesSystemMessageAndParametersPerRequest) {
+    std::mutex mutex;
+    std::vector<nlohmann::json> bodies;
+    mock_http_server server([&](const mock_request& request) {
+        std::lock_guard<std::mutex> lock(mutex);
+        bodies.push_back(nlohmann::json::parse(request.body));
+        return echo(request);
+    });
+
+    durable_outbox outbox(m_dir, api_for(server), fast_options(1));
+    auto classify = make_request("classify", "is this spam?");
+    classify.system_message = "Answer yes or no.";
+    classify.parameters = {{"temperature", 0.0}};
+    outbox.enqueue(classify);
+    outbox.enqueue(make_request("plain", "hello"));
+    ASSERT_TRUE(outbox.wait_idle(std::chrono::seconds(10)));
+
+    ASSERT_EQ(bodies.size(), 2u);
+    EXPECT_EQ(text_of(bodies[0]["messages"][0]), "Answer yes or no.");
+    EXPECT_EQ(bodies[0]["temperature"], 0.0);
+    // Nothing carries over to the next request
+    EXPECT_EQ(bodies[1]["messages"].size(), 1u);
+    EXPECT_NE(bodies[1]["temperature"], 0.0);
+
+    EXPECT_THROW(outbox.enqueue(make_request("", "no id")), std::invalid_argument);
+}
+
+} // namespace testing
+} // namespace hyni
@@ -0,0 +1,149 @@
+#include "../src/endpoint_selector.h"
+#include "../src/http_client.h"
+#include "../src/http_client_factory.h"
+#include "../src/context_factory.h"
+#include "mock_http_server.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+namespace hyni {
+namespace testing {
+
+namespace {
+
+// Nothing listens on port 1, so connecting fails at once
+const std::string UNREACHABLE = "http://127.0.0.1:1/v1/chat";
+
+mock_http_server::handler delayed(std::chrono::milliseconds delay) {
+    return [delay](const mock_request&) {
+        std::this_thread::sleep_for(delay);
+        return mock_response{200, "application/json", R"({"ok":true})"};
+    };
+}
+
+endpoint_selector_options test_options() {
+    endpoint_selector_options options;
+    options.seed = 42;
+    options.explore_probability = 0.2;
+    options.race_delay = std::chrono::milliseconds(20);
+    return options;
+}
+
+} // anonymous namespace
+
+TEST(EndpointSelectorTest, RaceSkipsUnreachableEndpoint) {
+    mock_http_server server(delayed(std::chrono::milliseconds(0)));
+
+    // The unreachable endpoint has the larger weight and starts the race first
+    endpoint_selector selector({{UNREACHABLE, 5.0}, {server.url() + "/v1/chat", 1.0}}, test_options());
+    EXPECT_EQ(selector.race(), 1u);
+
+    auto stats = selector.get_stats();
+    EXPECT_GT(stats[1].rtt_ms, 0.0);
+    EXPECT_EQ(stats[0].error_rate, 1.0);
+}
+
+TEST(EndpointSelectorTest, FirstSelectionDoesNotWaitForRace) {
+    mock_http_server server(delayed(std::chrono::milliseconds(0)));
+    // Not routable: the handshake hangs until race_timeout, or fails at once without a route
+    auto options = test_options();
+    options.explore_probability = 0.0;
+    endpoint_selector selector({{"http://10.255.255.1:81/v1/chat", 1.0}, {server.url() + "/v1/chat", 2.0}}, options);
+
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(selector.select(), 1u);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+
+    // The race measures the reachable endpoint meanwhile
+    for (int i = 0; i < 200 && selector.get_stats()[1].rtt_ms == 0.0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_GT(selector.get_stats()[1].rtt_ms, 0.0);
+}
+
+TEST(EndpointSelectorTest, PrefersFastEndpointAndDrainsSlowOne) {
+    mock_http_server slow(delayed(std::chrono::milliseconds(40)));
+    mock_http_server fast(delayed(std::chrono::milliseconds(0)));
+    const std::string slow_url = slow.url() + "/v1/chat";
+    const std::string fast_url = fast.url() + "/v1/chat";
+
+    auto selector = std::make_shared<endpoint_selector>(
+        std::vector<endpoint_config>{{slow_url, 1.0}, {fast_url, 1.0}}, test_options());
+    http_client client;
+    client.set_endpoint_selector(selector);
+
+    for (int i = 0; i < 60; ++i) {
+        // Always addressed to the first endpoint; the selector decides where it goes
+        auto response = client.post(slow_url, {{"n", i}});
+        ASSERT_TRUE(response.success) << response.error_message;
+        EXPECT_TRUE(response.timings.endpoint == slow_url || response.timings.endpoint == fast_url);
+    }
+
+    auto stats = selector->get_stats();
+    EXPECT_GT(stats[1].requests, stats[0].requests * 3);
+    EXPECT_GT(stats[0].ttfb_ms, stats[1].ttfb_ms);
+    if (stats[0].requests >= 3) {
+        EXPECT_TRUE(stats[0].drained);
+        EXPECT_EQ(stats[0].drains, 1u);
+    }
+    EXPECT_FALSE(stats[1].drained);
+}
+
+TEST(EndpointSelectorTest, FailsOverWhenEndpointIsDown) {
+    mock_http_server server(delayed(std::chrono::milliseconds(0)));
+    auto options = test_options();
+    options.explore_probability = 0.5;
+    auto selector = std::make_shared<endpoint_selector>(
+        std::vector<endpoint_config>{{UNREACHABLE, 1.0}, {server.url() + "/v1/chat", 1.0}}, options);
+    http_client client;
+    client.set_endpoint_selector(selector);
+
+    for (int i = 0; i < 20; ++i) {
+        auto response = client.post(UNREACHABLE, {{"n", i}});
+        ASSERT_TRUE(response.success) << response.error_message;
+        EXPECT_EQ(response.timings.endpoint, server.url() + "/v1/chat");
+    }
+    EXPECT_EQ(server.request_count(), 20u);
+
+    // Drained after min_samples failures, so exploration stops trying it
+    auto stats = selector->get_stats();
+    EXPECT_TRUE(stats[0].drained);
+    EXPECT_LE(stats[0].requests, options.min_samples);
+
+    // URLs the selector does not know are sent as they are
+    auto direct = client.post(server.url() + "/other", {{"n", 0}});
+    EXPECT_EQ(direct.timings.endpoint, server.url() + "/other");
+}
+
+TEST(EndpointSelectorTest, SchemaEndpointList) {
+    auto registry = schema_registry::create().set_schema_directory("../schemas").build();
+    context_factory factory(registry);
+    auto schema = factory.create_context("openai")->get_schema();
+
+    general_context single(schema);
+    ASSERT_EQ(single.get_endpoints().size(), 1u);
+    EXPECT_EQ(single.get_endpoints()[0].url, single.get_endpoint());
+    EXPECT_EQ(http_client_factory::create_http_client(single)->get_endpoint_selector(), nullptr);
+
+    schema["api"]["endpoints"] = {{{"url", "https://eu.example.com/v1/chat"}, {"weight", 2}},
+                                  {{"url", "https://us.example.com/v1/chat"}}};
+    general_context multi(schema);
+    EXPECT_EQ(multi.get_endpoint(), "https://eu.example.com/v1/chat");
+    ASSERT_EQ(multi.get_endpoints().size(), 2u);
+    EXPECT_EQ(multi.get_endpoints()[0].weight, 2.0);
+    EXPECT_EQ(multi.get_endpoints()[1].weight, 1.0);
+
+    // Clients of the same endpoint list share measurements
+    auto a = http_client_factory::create_http_client(multi);
+    auto b = http_client_factory::create_http_client(multi);
+    ASSERT_NE(a->get_endpoint_selector(), nullptr);
+    EXPECT_EQ(a->get_endpoint_selector(), b->get_endpoint_selector());
+
+    schema["api"]["endpoints"] = nlohmann::json::array();
+    EXPECT_THROW(general_context{schema}, schema_exception);
+    schema["api"]["endpoints"] = {{{"url", "https://x"}, {"weight", 0}}};
+    EXPECT_THROW(general_context{schema}, schema_exception);
+}
+
+} // namespace testing
+} // namespace hyni
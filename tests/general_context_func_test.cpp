@@ -278,7 +278,8 @@ TEST_F(GeneralContextFunctionalTest, ContextFactoryFunctionality) {
 // Test thread-local context
 TEST_F(GeneralContextFunctionalTest, ThreadLocalContext) {
     // Get thread-local context
-    auto& tl_context = m_factory->get_thread_local_context("claude");
+    const auto tl_holder = m_factory->get_thread_local_context("claude");
+    auto& tl_context = *tl_holder;
     tl_context.set_api_key(m_api_key);
 
     // Add a message to identify this context
@@ -291,7 +292,8 @@ TEST_F(GeneralContextFunctionalTest, ThreadLocalContext) {
 
     // Test in another thread
     std::thread t([this]() {
-        auto& thread_context = m_factory->get_thread_local_context("claude");
+        const auto thread_holder = m_factory->get_thread_local_context("claude");
+        auto& thread_context = *thread_holder;
         thread_context.set_api_key(m_api_key);
 
         // This context should be different from main thread's context
@@ -310,7 +312,8 @@ TEST_F(GeneralContextFunctionalTest, ThreadLocalContext) {
 // Test provider_context helper
 TEST_F(GeneralContextFunctionalTest, ProviderContextHelper) {
     provider_context claude_ctx(m_factory, "claude");
-    auto& context = claude_ctx.get();
+    const auto holder = claude_ctx.get();
+    auto& context = *holder;
     context.set_api_key(m_api_key);
 
     // Test basic functionality
@@ -718,7 +721,8 @@ TEST_F(GeneralContextFunctionalTest, MultiProviderSupport) {
             config.default_max_tokens = 50;
 
             provider_context ctx(m_factory, provider);
-            auto& context = ctx.get();
+            const auto holder = ctx.get();
+            auto& context = *holder;
 
             // Set up a simple request
             context.add_user_message("Respond with exactly one word: 'Success'");
@@ -842,7 +846,8 @@ TEST_F(GeneralContextFunctionalTest, ProviderSpecificFeatures) {
     if (!oa_api_key.empty()) {
         try {
             provider_context ctx(m_factory, "openai");
-            auto& oa_context = ctx.get();
+            const auto holder = ctx.get();
+            auto& oa_context = *holder;
 
             // Test OpenAI-specific parameters like response_format for JSON mode
             oa_context.set_parameter("response_format", {{"type", "json_object"}});
@@ -881,7 +886,8 @@ TEST_F(GeneralContextFunctionalTest, ProviderSpecificFeatures) {
     if (!ds_api_key.empty()) {
         try {
             provider_context ctx(m_factory, "deepseek");
-            auto& ds_context = ctx.get();
+            const auto holder = ctx.get();
+            auto& ds_context = *holder;
 
             // Test DeepSeek-specific parameters or models
             ds_context.set_model("deepseek-coder");
@@ -0,0 +1,248 @@
+#include "../src/http_client.h"
+#include "../src/chat_api.h"
+#include "../src/http_client_factory.h"
+#include "../src/context_factory.h"
+#include "mock_http_server.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <future>
+#include <unistd.h>
+
+namespace hyni {
+namespace testing {
+
+namespace {
+
+std::filesystem::path temp_socket_path(const std::string& name) {
+    return std::filesystem::temp_directory_path() /
+           ("hyni_" + name + "_" + std::to_string(::getpid()) + ".sock");
+}
+
+mock_response echo(const mock_request& request) {
+    return {200, "application/json", nlohmann::json{{"path", request.path}, {"body", request.body}}.dump()};
+}
+
+// Runs post_stream to completion and returns the final response
+http_response stream(http_client& client, const std::string& url, std::string& received) {
+    std::promise<http_response> done;
+    client.post_stream(url, {{"stream", true}},
+                       [&](const std::string& chunk) { received += chunk; },
+                       [&](const http_response& response) { done.set_value(response); });
+    return done.get_future().get();
+}
+
+} // anonymous namespace
+
+TEST(HttpClientTest, PostOverLoopbackTcp) {
+    mock_http_server server(echo);
+    http_client client;
+
+    auto response = client.post(server.url() + "/v1/echo", {{"n", 1}});
+    ASSERT_TRUE(response.success) << response.error_message;
+    auto body = nlohmann::json::parse(response.body);
+    EXPECT_EQ(body["path"], "/v1/echo");
+    EXPECT_EQ(nlohmann::json::parse(body["body"].get<std::string>())["n"], 1);
+}
+
+TEST(HttpClientTest, PostOverUnixSocket) {
+    mock_http_server server(temp_socket_path("http_client"), echo);
+    http_client client;
+    client.set_unix_socket_path(server.socket_path().string());
+    EXPECT_EQ(client.get_unix_socket_path(), server.socket_path().string());
+
+    for (int i = 0; i < 3; ++i) {
+        auto response = client.post("http://localhost/v1/echo", {{"n", i}});
+        ASSERT_TRUE(response.success) << response.error_message;
+        EXPECT_EQ(nlohmann::json::parse(response.body)["path"], "/v1/echo");
+    }
+    EXPECT_EQ(server.request_count(), 3u);
+    EXPECT_EQ(server.connection_count(), 1u);  // keep-alive over the socket
+
+    // Back to TCP: nothing listens on this port, the socket server sees no new request
+    client.set_unix_socket_path("");
+    auto response = client.post("http://127.0.0.1:1/v1/echo", {{"n", 0}});
+    EXPECT_FALSE(response.success);
+    EXPECT_EQ(server.request_count(), 3u);
+}
+
+TEST(HttpClientTest, SchemaRoutesProviderThroughUnixSocket) {
+    mock_http_server server(temp_socket_path("sidecar"), [](const mock_request& request) {
+        EXPECT_EQ(request.path, "/v1/chat/completions");
+        return mock_response{200, "application/json", R"({
+            "choices": [{"message": {"role": "assistant", "content": "over the socket"}}]
+        })"};
+    });
+
+    auto registry = schema_registry::create().set_schema_directory("../schemas").build();
+    context_factory factory(registry);
+    auto schema = factory.create_context("openai")->get_schema();
+    schema["api"]["endpoint"] = "http://sidecar/v1/chat/completions";
+    schema["api"]["unix_socket"] = server.socket_path().string();
+
+    auto context = std::make_unique<general_context>(schema);
+    EXPECT_EQ(context->get_unix_socket_path(), server.socket_path().string());
+    context->set_api_key("test-key");
+
+    chat_api chat(std::move(context));
+    EXPECT_EQ(chat.send_message("Hello"), "over the socket");
+    EXPECT_EQ(server.request_count(), 1u);
+
+    schema["api"]["unix_socket"] = 42;
+    EXPECT_THROW(general_context{schema}, schema_exception);
+}
+
+TEST(HttpClientTest, ReportsProtocolAndTimings) {
+    mock_http_server server(echo);
+    http_client client;
+
+    auto response = client.post(server.url() + "/v1/echo", {{"n", 1}});
+    ASSERT_TRUE(response.success) << response.error_message;
+    EXPECT_EQ(response.timings.protocol, "HTTP/1.1");
+    EXPECT_FALSE(response.timings.fell_back);
+    EXPECT_GT(response.timings.total_ms, 0.0);
+    EXPECT_LE(response.timings.ttfb_ms, response.timings.total_ms);
+    EXPECT_EQ(response.timings.tls_ms, 0.0);
+}
+
+TEST(HttpClientTest, Http3FallsBackToTcp) {
+    mock_http_server server(echo);
+    http_client client;
+    client.set_http_version(http_version::http3);
+
+    // QUIC needs https; a cleartext endpoint is reached over TCP and reported as a fallback
+    auto response = client.post(server.url() + "/v1/echo", {{"n", 1}});
+    ASSERT_TRUE(response.success) << response.error_message;
+    EXPECT_EQ(response.timings.protocol, "HTTP/1.1");
+    EXPECT_TRUE(response.timings.fell_back);
+
+    EXPECT_EQ(http_client::parse_http_version("auto"), http_version::automatic);
+    EXPECT_EQ(http_client::parse_http_version("1.1"), http_version::http1_1);
+    EXPECT_EQ(http_client::parse_http_version("2"), http_version::http2);
+    EXPECT_EQ(http_client::parse_http_version("3"), http_version::http3);
+    EXPECT_THROW(http_client::parse_http_version("quic"), std::invalid_argument);
+}
+
+TEST(HttpClientTest, SchemaSelectsHttpVersion) {
+    auto registry = schema_registry::create().set_schema_directory("../schemas").build();
+    context_factory factory(registry);
+    auto schema = factory.create_context("openai")->get_schema();
+    EXPECT_EQ(general_context{schema}.get_http_version(), "auto");
+
+    schema["api"]["http_version"] = "3";
+    general_context context(schema);
+    EXPECT_EQ(context.get_http_version(), "3");
+    EXPECT_EQ(http_client_factory::create_http_client(context)->get_http_version(), http_version::http3);
+
+    schema["api"]["http_version"] = "4";
+    EXPECT_THROW(general_context{schema}, schema_exception);
+}
+
+TEST(HttpClientTest, StalledStreamIsAbortedQuickly) {
+    mock_http_server server([](const mock_request&) {
+        mock_response response;
+        response.chunks = {{std::chrono::milliseconds(0), "data: one\n\n"},
+                           {std::chrono::milliseconds(10000), "data: two\n\n"}};
+        return response;
+    });
+    http_client client;
+    stream_timeouts timeouts;
+    timeouts.idle_ms = 300;
+    timeouts.max_retries = 2;
+    client.set_stream_timeouts(timeouts);
+
+    std::string received;
+    const auto start = std::chrono::steady_clock::now();
+    auto response = stream(client, server.url() + "/v1/stream", received);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_FALSE(response.success);
+    EXPECT_TRUE(response.stalled);
+    EXPECT_NE(response.error_message.find("idle"), std::string::npos) << response.error_message;
+    EXPECT_LT(elapsed, std::chrono::seconds(3));
+    // Part of the answer already reached the caller, so it is not replayed
+    EXPECT_EQ(received, "data: one\n\n");
+    EXPECT_EQ(response.attempts, 1u);
+    EXPECT_EQ(server.request_count(), 1u);
+}
+
+TEST(HttpClientTest, RetriesStreamWithoutFirstByte) {
+    std::atomic<int> requests{0};
+    mock_http_server server([&](const mock_request&) {
+        mock_response response;
+        response.delay = ++requests == 1 ? std::chrono::milliseconds(10000) : std::chrono::milliseconds(0);
+        response.chunks = {{std::chrono::milliseconds(0), "data: hello\n\n"}};
+        return response;
+    });
+    http_client client;
+    stream_timeouts timeouts;
+    timeouts.first_byte_ms = 300;
+    timeouts.max_retries = 1;
+    timeouts.retry_delay_ms = 10;
+    client.set_stream_timeouts(timeouts);
+
+    std::string received;
+    auto response = stream(client, server.url() + "/v1/stream", received);
+    ASSERT_TRUE(response.success) << response.error_message;
+    EXPECT_FALSE(response.stalled);
+    EXPECT_EQ(response.attempts, 2u);
+    EXPECT_EQ(received, "data: hello\n\n");
+    EXPECT_EQ(server.request_count(), 2u);
+}
+
+TEST(HttpClientTest, HealthyStreamOutlivesOverallTimeout) {
+    mock_http_server server([](const mock_request&) {
+        mock_response response;
+        for (int i = 0; i < 8; ++i) {
+            response.chunks.push_back({std::chrono::milliseconds(150), "data: " + std::to_string(i) + "\n\n"});
+        }
+        return response;
+    });
+    http_client client;
+    client.set_timeout(500);   // post() only
+    stream_timeouts timeouts;
+    timeouts.idle_ms = 1000;
+    client.set_stream_timeouts(timeouts);
+
+    std::string received;
+    auto response = stream(client, server.url() + "/v1/stream", received);
+    ASSERT_TRUE(response.success) << response.error_message;
+    EXPECT_NE(received.find("data: 7"), std::string::npos);
+    EXPECT_GT(response.timings.total_ms, 1000.0);
+}
+
+TEST(HttpClientTest, SchemaConfiguresStreamTimeouts) {
+    auto registry = schema_registry::create().set_schema_directory("../schemas").build();
+    context_factory factory(registry);
+    auto schema = factory.create_context("openai")->get_schema();
+    EXPECT_EQ(http_client_factory::create_http_client(general_context{schema})->get_stream_timeouts().idle_ms,
+              stream_timeouts{}.idle_ms);
+
+    schema["api"]["stream_timeouts"] = {{"idle_ms", 2000}, {"max_retries", 2}};
+    auto timeouts = http_client_factory::create_http_client(general_context{schema})->get_stream_timeouts();
+    EXPECT_EQ(timeouts.idle_ms, 2000);
+    EXPECT_EQ(timeouts.max_retries, 2u);
+    EXPECT_EQ(timeouts.first_byte_ms, stream_timeouts{}.first_byte_ms);
+
+    schema["api"]["stream_timeouts"] = {{"idle_ms", "fast"}};
+    EXPECT_THROW(general_context{schema}, schema_exception);
+}
+
+// Needs a local QUIC server with a certificate the system trusts, e.g.
+// HYNI_HTTP3_TEST_URL=https://localhost:4433/ with the quiche or ngtcp2 example server
+TEST(HttpClientTest, Http3AgainstLocalQuicServer) {
+    const char* url = std::getenv("HYNI_HTTP3_TEST_URL");
+    if (!url || !http_client::http3_available()) {
+        GTEST_SKIP() << "Set HYNI_HTTP3_TEST_URL and link a libcurl with HTTP/3 support";
+    }
+
+    http_client client;
+    client.set_http_version(http_version::http3);
+    auto response = client.get(url);
+    ASSERT_TRUE(response.status_code > 0) << response.error_message;
+    EXPECT_EQ(response.timings.protocol, "HTTP/3");
+    EXPECT_FALSE(response.timings.fell_back);
+}
+
+} // namespace testing
+} // namespace hyni
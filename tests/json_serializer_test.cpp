@@ -0,0 +1,111 @@
+#include "../src/json_serializer.h"
+#include <gtest/gtest.h>
+#include <random>
+
+namespace hyni {
+namespace testing {
+
+namespace {
+
+std::string escaped(std::string_view text) {
+    std::string out;
+    json_serializer::escape_string(text, out);
+    return out;
+}
+
+} // anonymous namespace
+
+TEST(JsonSerializerTest, EscapesLikeNlohmann) {
+    const std::vector<std::string> cases = {
+        "",
+        "plain",
+        "quote \" backslash \\ slash /",
+        "\b\f\n\r\t",
+        std::string("nul \0 and \x01\x1f\x7f", 15),
+        "caf\xC3\xA9 \xE6\x97\xA5\xE6\x9C\xAC \xF0\x9F\x98\x80",
+    };
+    for (const auto& text : cases) {
+        EXPECT_EQ(escaped(text), nlohmann::json(text).dump()) << text;
+    }
+}
+
+TEST(JsonSerializerTest, MatchesNlohmannAcrossBlockBoundaries) {
+    // Every interesting byte at every offset around the 64-byte blocks
+    const std::vector<std::string> specials = {"\"", "\\", "\n", "\x01", "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80"};
+    for (size_t length : {63, 64, 65, 127, 128, 129, 200}) {
+        for (const auto& special : specials) {
+            for (size_t offset = 0; offset + special.size() <= length; ++offset) {
+                std::string text(length, 'a');
+                text.replace(offset, special.size(), special);
+                ASSERT_EQ(escaped(text), nlohmann::json(text).dump())
+                    << "length " << length << " offset " << offset;
+            }
+        }
+    }
+}
+
+TEST(JsonSerializerTest, MatchesNlohmannOnRandomText) {
+    std::mt19937 rng(1);
+    const std::vector<std::string> pieces = {"word ", "\"", "\\", "\n", "\t", "\x02", "\xC3\xA9", "\xE2\x82\xAC",
+                                             "\xF0\x9F\x98\x80", "0123456789abcdefghijklmnopqrstuvwxyz"};
+    for (int round = 0; round < 200; ++round) {
+        std::string text;
+        const size_t count = rng() % 200;
+        for (size_t i = 0; i < count; ++i) {
+            text += pieces[rng() % pieces.size()];
+        }
+        ASSERT_EQ(escaped(text), nlohmann::json(text).dump());
+    }
+}
+
+TEST(JsonSerializerTest, DumpsDocumentsLikeNlohmann) {
+    nlohmann::json request = {
+        {"model", "gpt-4o"},
+        {"max_tokens", 1024},
+        {"temperature", 0.7},
+        {"top_p", 1e-7},
+        {"n", -3},
+        {"seed", 18446744073709551615ULL},
+        {"stream", false},
+        {"stop", nullptr},
+        {"messages", {{{"role", "user"}, {"content", {{{"type", "text"}, {"text", std::string(5000, 'x') + "\"end\""}}}}}}},
+        {"empty_object", nlohmann::json::object()},
+        {"empty_array", nlohmann::json::array()},
+        {"k\xC3\xA9y \"quoted\"", "v"},
+    };
+    EXPECT_EQ(json_serializer::dump(request), request.dump());
+    EXPECT_EQ(json_serializer::dump(nlohmann::json("x")), "\"x\"");
+    EXPECT_EQ(json_serializer::dump(nlohmann::json(42)), "42");
+}
+
+TEST(JsonSerializerTest, RejectsInvalidUtf8) {
+    const std::vector<std::string> invalid = {
+        "\xC3",                          // truncated
+        "\x80 stray continuation",
+        "\xC0\xAF overlong",
+        "\xED\xA0\x80 surrogate",
+        "\xF4\x90\x80\x80 above U+10FFFF",
+        std::string(100, 'a') + "\xFF",  // inside a SIMD block
+        std::string(60, 'a') + "\xE2\x82",
+    };
+    for (const auto& text : invalid) {
+        EXPECT_THROW(json_serializer::dump(nlohmann::json(text)), nlohmann::json::type_error) << text;
+        EXPECT_THROW(nlohmann::json(text).dump(), nlohmann::json::type_error);
+    }
+
+    try {
+        escaped(std::string(70, 'a') + "\xFF");
+        FAIL();
+    } catch (const nlohmann::json::type_error& e) {
+        EXPECT_EQ(e.id, 316);
+        EXPECT_NE(std::string(e.what()).find("index 70"), std::string::npos) << e.what();
+    }
+}
+
+TEST(JsonSerializerTest, ReportsSimdLevel) {
+    const std::string level = json_serializer::simd_level();
+    EXPECT_TRUE(level == "avx2" || level == "sse2" || level == "neon" || level == "scalar") << level;
+}
+
+} // namespace testing
+} // namespace hyni
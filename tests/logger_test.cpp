@@ -0,0 +1,303 @@
+#include "../src/logger.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::string read_file(const std::string& path) {
+    std::ifstream file(path);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    return ss.str();
+}
+
+size_t count_occurrences(const std::string& text, const std::string& needle) {
+    size_t count = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+} // anonymous namespace
+
+TEST(LogRateLimiterTest, FirstNThenEveryM) {
+    log_rate_limiter limiter(3, 5, std::chrono::milliseconds(0));
+
+    std::vector<int> emitted;
+    std::vector<uint64_t> suppressed_counts;
+    for (int i = 0; i < 20; ++i) {
+        uint64_t suppressed = 0;
+        if (limiter.should_log(suppressed)) {
+            emitted.push_back(i);
+            suppressed_counts.push_back(suppressed);
+        }
+    }
+
+    // 0,1,2 pass; then every 5th of the remainder: 7, 12, 17
+    EXPECT_EQ(emitted, (std::vector<int>{0, 1, 2, 7, 12, 17}));
+    EXPECT_EQ(suppressed_counts, (std::vector<uint64_t>{0, 0, 0, 4, 4, 4}));
+    EXPECT_EQ(limiter.take_suppressed(), 2u);
+    EXPECT_EQ(limiter.take_suppressed(), 0u);
+}
+
+TEST(LogRateLimiterTest, EveryZeroSuppressesAfterBurst) {
+    log_rate_limiter limiter(2, 0, std::chrono::milliseconds(0));
+
+    int emitted = 0;
+    for (int i = 0; i < 100; ++i) {
+        uint64_t suppressed = 0;
+        emitted += limiter.should_log(suppressed) ? 1 : 0;
+    }
+    EXPECT_EQ(emitted, 2);
+    EXPECT_EQ(limiter.take_suppressed(), 98u);
+}
+
+TEST(LogRateLimiterTest, WindowResetsBurst) {
+    log_rate_limiter limiter(1, 0, std::chrono::milliseconds(20));
+
+    uint64_t suppressed = 0;
+    EXPECT_TRUE(limiter.should_log(suppressed));
+    EXPECT_FALSE(limiter.should_log(suppressed));
+    EXPECT_FALSE(limiter.should_log(suppressed));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+
+    EXPECT_TRUE(limiter.should_log(suppressed));
+    EXPECT_EQ(suppressed, 2u);
+}
+
+TEST(LogRateLimiterTest, ConcurrentCallersCountEveryEvent) {
+    log_rate_limiter limiter(10, 100, std::chrono::milliseconds(0));
+    std::atomic<uint64_t> emitted{0};
+    std::atomic<uint64_t> reported_suppressed{0};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 10000; ++i) {
+                uint64_t suppressed = 0;
+                if (limiter.should_log(suppressed)) {
+                    emitted++;
+                    reported_suppressed += suppressed;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    EXPECT_EQ(emitted + reported_suppressed + limiter.take_suppressed(), 40000u);
+    EXPECT_EQ(emitted.load(), 10u + (40000u - 10u) / 100u);
+}
+
+TEST(LoggerTest, SampledMacroWritesSummaries) {
+    auto& log = logger::instance();
+    log.init(true, false);
+    log.set_min_level(logger::Level::DEBUG);
+    std::string file_name = log.get_log_file_name();
+
+    for (int i = 0; i < 250; ++i) {
+        LOG_SAMPLED(logger::Level::ERROR, "sampled failure", 5, 100);
+    }
+    log.shutdown();
+
+    std::string content = read_file(file_name);
+    // 5 burst lines + 2 sampled lines (events 104 and 204)
+    EXPECT_EQ(count_occurrences(content, "sampled failure"), 7u);
+    EXPECT_NE(content.find("[99 similar messages suppressed]"), std::string::npos);
+    // 45 events after the last sampled line are reported at shutdown
+    EXPECT_NE(content.find("Suppressed 45 sampled messages from logger_test.cpp"), std::string::npos);
+
+    std::filesystem::remove(file_name);
+}
+
+TEST(LoggerTest, DisabledLevelDoesNotEvaluateMessage) {
+    auto& log = logger::instance();
+    log.init(false, false);
+
+    int evaluations = 0;
+    auto make_message = [&] {
+        ++evaluations;
+        return std::string("expensive");
+    };
+
+    LOG_DEBUG(make_message());
+    LOG_INFO_SAMPLED(make_message());
+    EXPECT_EQ(evaluations, 0);
+
+    log.shutdown();
+}
+
+TEST(LoggerTest, RotatesBySizeAndPrunesOldFiles) {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "hyni_logger_rotation_test";
+    fs::remove_all(dir);
+
+    logger::rotation_config rotation;
+    rotation.max_file_bytes = 4 * 1024;
+    rotation.max_files = 3;
+    rotation.directory = dir.string();
+
+    auto& log = logger::instance();
+    log.init(true, false, rotation);
+    log.set_min_level(logger::Level::DEBUG);
+
+    const std::string line(200, 'x');
+    for (int i = 0; i < 500; ++i) {
+        log.log(logger::Level::INFO, line);
+    }
+    log.wait_for_rotation();
+    std::string active = log.get_log_file_name();
+    log.shutdown();
+
+    size_t rotated = 0;
+    size_t compressed = 0;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (fs::equivalent(entry.path(), active)) continue;
+        ++rotated;
+        compressed += entry.path().extension() == ".gz" ? 1 : 0;
+    }
+
+    EXPECT_TRUE(fs::exists(active));
+    EXPECT_EQ(rotated, rotation.max_files);
+    // All rotated files are compressed when the library was built with zlib, none otherwise
+    EXPECT_TRUE(compressed == rotated || compressed == 0) << compressed << " of " << rotated;
+
+    fs::remove_all(dir);
+}
+
+TEST(LoggerTest, PruningLeavesForeignLogsAlone) {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "hyni_logger_foreign_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    // Looks like one of ours, but was written by another process
+    const fs::path foreign = dir / "hyni_log_20000101_000000.log";
+    std::ofstream(foreign) << "someone else's log\n";
+
+    logger::rotation_config rotation;
+    rotation.max_file_bytes = 2 * 1024;
+    rotation.max_files = 1;
+    rotation.compress = false;
+    rotation.directory = dir.string();
+
+    auto& log = logger::instance();
+    log.init(true, false, rotation);
+
+    const std::string line(200, 'x');
+    for (int i = 0; i < 200; ++i) {
+        log.log(logger::Level::INFO, line);
+    }
+    log.wait_for_rotation();
+    std::string active = log.get_log_file_name();
+    log.shutdown();
+
+    size_t rotated = 0;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (fs::equivalent(entry.path(), active) || fs::equivalent(entry.path(), foreign)) continue;
+        ++rotated;
+    }
+
+    EXPECT_TRUE(fs::exists(foreign));
+    EXPECT_EQ(read_file(foreign.string()), "someone else's log\n");
+    EXPECT_EQ(rotated, rotation.max_files);
+
+    fs::remove_all(dir);
+}
+
+TEST(LoggerTest, RetentionCountsFilesFromEarlierRuns) {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "hyni_logger_restart_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    // Rotated by earlier runs, oldest first
+    std::vector<fs::path> previous;
+    for (int i = 0; i < 3; ++i) {
+        previous.push_back(dir / ("hyni_log_20000101_00000" + std::to_string(i) + ".log.old"));
+        std::ofstream(previous.back()) << "run " << i << "\n";
+        fs::last_write_time(previous.back(),
+                            fs::file_time_type::clock::now() - std::chrono::hours(3 - i));
+    }
+    // Still being written by another process
+    const fs::path foreign = dir / "hyni_log_20000101_000000.log";
+    std::ofstream(foreign) << "someone else's log\n";
+
+    logger::rotation_config rotation;
+    rotation.max_file_bytes = 64 * 1024;
+    rotation.max_files = 2;
+    rotation.compress = false;
+    rotation.directory = dir.string();
+
+    auto& log = logger::instance();
+    log.init(true, false, rotation);
+
+    // Trimmed to max_files on startup, oldest first
+    EXPECT_FALSE(fs::exists(previous[0]));
+    EXPECT_TRUE(fs::exists(previous[1]));
+    EXPECT_TRUE(fs::exists(previous[2]));
+
+    const std::string line(200, 'x');
+    for (int i = 0; i < 400; ++i) {
+        log.log(logger::Level::INFO, line);
+    }
+    log.wait_for_rotation();
+    std::string active = log.get_log_file_name();
+    log.shutdown();
+
+    EXPECT_FALSE(fs::exists(previous[1]));
+    EXPECT_TRUE(fs::exists(foreign));
+
+    size_t rotated = 0;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (fs::equivalent(entry.path(), active) || fs::equivalent(entry.path(), foreign)) continue;
+        EXPECT_EQ(entry.path().extension(), ".old") << entry.path();
+        ++rotated;
+    }
+    EXPECT_EQ(rotated, rotation.max_files);
+
+    fs::remove_all(dir);
+}
+
+TEST(LoggerTest, RotationKeepsEveryLine) {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "hyni_logger_rotation_lines_test";
+    fs::remove_all(dir);
+
+    logger::rotation_config rotation;
+    rotation.max_file_bytes = 2 * 1024;
+    rotation.max_files = 0;
+    rotation.compress = false;
+    rotation.directory = dir.string();
+
+    auto& log = logger::instance();
+    log.init(true, false, rotation);
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([&log, t] {
+            for (int i = 0; i < 100; ++i) {
+                log.log(logger::Level::INFO, "writer " + std::to_string(t) + " line " + std::to_string(i));
+            }
+        });
+    }
+    for (auto& w : writers) w.join();
+    log.shutdown();
+
+    size_t files = 0;
+    size_t lines = 0;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        ++files;
+        lines += count_occurrences(read_file(entry.path().string()), "] writer ");
+    }
+
+    EXPECT_GT(files, 1u);
+    EXPECT_EQ(lines, 400u);
+
+    fs::remove_all(dir);
+}
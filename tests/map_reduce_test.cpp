@@ -0,0 +1,195 @@
+#include "../src/map_reduce.h"
+#include "../src/chat_api.h"
+#include "../src/context_factory.h"
+#include "../src/prompt_minifier.h"
+#include "mock_http_server.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <regex>
+#include <set>
+#include <thread>
+
+namespace hyni {
+namespace testing {
+
+namespace {
+
+std::string last_text(const nlohmann::json& body) {
+    const auto& content = body["messages"].back()["content"];
+    return content.is_string() ? content.get<std::string>() : content[0]["text"].get<std::string>();
+}
+
+std::set<std::string> items_in(const std::string& text) {
+    static const std::regex item(R"(item\d+)");
+    return {std::sregex_token_iterator(text.begin(), text.end(), item), std::sregex_token_iterator()};
+}
+
+// Map and reduce both answer with the distinct "itemN" words they were given
+mock_response collect_items(const mock_request& request) {
+    std::string answer;
+    for (const auto& name : items_in(last_text(nlohmann::json::parse(request.body)))) {
+        answer += (answer.empty() ? "" : " ") + name;
+    }
+    nlohmann::json response = {{"choices", {{{"message", {{"role", "assistant"}, {"content", answer}}}}}}};
+    return {200, "application/json", response.dump()};
+}
+
+std::string make_document(size_t paragraphs) {
+    std::string document;
+    for (size_t i = 0; i < paragraphs; ++i) {
+        document += "Paragraph about item" + std::to_string(i) +
+                    ", padded with enough ordinary words to take up some of the budget.\n\n";
+    }
+    return document;
+}
+
+} // anonymous namespace
+
+class MapReduceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        auto registry = schema_registry::create().set_schema_directory("../schemas").build();
+        context_factory factory(registry);
+        m_schema = factory.create_context("openai")->get_schema();
+    }
+
+    map_reduce::api_factory factory_for(const mock_http_server& server) {
+        auto schema = m_schema;
+        schema["api"]["endpoint"] = server.url() + "/v1/chat/completions";
+        return [schema] {
+            auto context = std::make_unique<general_context>(schema);
+            context->set_api_key("test-key");
+            return std::make_shared<chat_api>(std::move(context));
+        };
+    }
+
+    nlohmann::json m_schema;
+};
+
+TEST_F(MapReduceTest, SplitPrefersParagraphsAndCoversText) {
+    const std::string paragraphs = make_document(40);
+    const std::string document = paragraphs + std::string(300, 'x') + " caf\xC3\xA9\xC3\xA9\xC3\xA9";
+    const auto chunks = map_reduce::split(document, 60);
+    ASSERT_GT(chunks.size(), 1u);
+
+    std::string joined;
+    for (auto chunk : chunks) {
+        EXPECT_LE(prompt_minifier::estimate_tokens(chunk), 60u);
+        EXPECT_NE((static_cast<unsigned char>(chunk.front()) & 0xC0), 0x80u);
+        joined += chunk;
+    }
+    EXPECT_EQ(joined, document);
+
+    // Whole paragraphs while they fit
+    for (auto chunk : chunks) {
+        if (chunk.data() + chunk.size() <= document.data() + paragraphs.size()) {
+            EXPECT_TRUE(chunk.ends_with("\n\n"));
+        }
+    }
+    EXPECT_TRUE(map_reduce::split("", 10).empty());
+}
+
+TEST_F(MapReduceTest, ReducesEveryChunkIntoOneResult) {
+    mock_http_server server(collect_items);
+    map_reduce_options options;
+    options.chunk_tokens = 40;
+    options.reduce_fan_in = 3;
+    options.requests_per_minute = -1;
+    options.tokens_per_minute = -1;
+    map_reduce pipeline(factory_for(server), options);
+
+    std::vector<map_reduce_partial> partials;
+    auto result = pipeline.run(make_document(30), "MAP: list the items", "REDUCE: merge the item lists",
+                               [&](const map_reduce_partial& partial) { partials.push_back(partial); });
+
+    std::set<std::string> expected;
+    for (int i = 0; i < 30; ++i) {
+        expected.insert("item" + std::to_string(i));
+    }
+    EXPECT_EQ(items_in(result.text), expected);
+
+    const auto& stats = result.stats;
+    EXPECT_GT(stats.chunks, 3u);
+    EXPECT_EQ(stats.map_calls, stats.chunks);
+    EXPECT_GE(stats.levels, 3u);
+    EXPECT_EQ(partials.size(), stats.map_calls + stats.reduce_calls);
+    EXPECT_EQ(server.request_count(), partials.size());
+    ASSERT_FALSE(partials.empty());
+    EXPECT_TRUE(partials.back().final);
+    EXPECT_EQ(partials.back().level, stats.levels - 1);
+    EXPECT_EQ(stats.retries, 0u);
+}
+
+TEST_F(MapReduceTest, RunsCallsConcurrently) {
+    std::atomic<int> in_flight{0};
+    std::atomic<int> peak{0};
+    mock_http_server server([&](const mock_request& request) {
+        const int now = ++in_flight;
+        int seen = peak.load();
+        while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        --in_flight;
+        return collect_items(request);
+    });
+    map_reduce_options options;
+    options.chunk_tokens = 40;
+    options.concurrency = 3;
+    options.requests_per_minute = -1;
+    options.tokens_per_minute = -1;
+
+    auto result = map_reduce(factory_for(server), options).run(make_document(20), "MAP", "REDUCE");
+    EXPECT_EQ(items_in(result.text).size(), 20u);
+    EXPECT_GT(peak.load(), 1);
+    EXPECT_LE(peak.load(), 3);
+}
+
+TEST_F(MapReduceTest, PacesCallsToTheTokenRate) {
+    mock_http_server server(collect_items);
+    map_reduce_options options;
+    options.chunk_tokens = 40;
+    options.reduce_fan_in = 16;
+    options.requests_per_minute = -1;
+    options.tokens_per_minute = 6000;   // 100 tokens a second
+    options.reserved_output_tokens = 0;
+
+    auto result = map_reduce(factory_for(server), options).run(make_document(8), "MAP", "REDUCE");
+    EXPECT_EQ(items_in(result.text).size(), 8u);
+    EXPECT_GT(result.stats.throttled_ms, 0.0);
+    EXPECT_GT(result.stats.elapsed_ms, 500.0);
+}
+
+TEST_F(MapReduceTest, RetriesFailedCallsThenGivesUp) {
+    std::atomic<int> failures{2};
+    mock_http_server flaky([&](const mock_request& request) {
+        if (failures-- > 0) {
+            return mock_response{500, "application/json", R"({"error":{"message":"overloaded"}})"};
+        }
+        return collect_items(request);
+    });
+    map_reduce_options options;
+    options.chunk_tokens = 40;
+    options.concurrency = 1;
+    options.requests_per_minute = -1;
+    options.tokens_per_minute = -1;
+    options.retry_delay = std::chrono::milliseconds(1);
+
+    auto result = map_reduce(factory_for(flaky), options).run(make_document(6), "MAP", "REDUCE");
+    EXPECT_EQ(result.stats.retries, 2u);
+    EXPECT_EQ(items_in(result.text).size(), 6u);
+
+    mock_http_server down([](const mock_request&) {
+        return mock_response{500, "application/json", R"({"error":{"message":"down"}})"};
+    });
+    options.max_attempts = 2;
+    map_reduce failing(factory_for(down), options);
+    EXPECT_THROW((void)failing.run(make_document(6), "MAP", "REDUCE"), std::runtime_error);
+    EXPECT_EQ(down.request_count(), 2u);
+
+    EXPECT_THROW((void)failing.run(make_document(6), "MAP", "REDUCE", nullptr, [] { return true; }),
+                 std::runtime_error);
+    EXPECT_THROW(map_reduce(nullptr), std::invalid_argument);
+}
+
+} // namespace testing
+} // namespace hyni
@@ -0,0 +1,157 @@
+#include "../src/media_preprocessor.h"
+#include "../src/context_factory.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+namespace hyni {
+namespace testing {
+
+namespace {
+
+const std::string TEST_IMAGE = "../tests/german.png";
+
+bool is_jpeg(const std::string& data) {
+    return data.size() > 3 && static_cast<uint8_t>(data[0]) == 0xFF &&
+           static_cast<uint8_t>(data[1]) == 0xD8 && static_cast<uint8_t>(data[2]) == 0xFF;
+}
+
+} // anonymous namespace
+
+class MediaPreprocessorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        if (!media_preprocessor::available()) {
+            GTEST_SKIP() << "Built without libjpeg";
+        }
+        ASSERT_TRUE(std::filesystem::exists(TEST_IMAGE));
+    }
+};
+
+TEST_F(MediaPreprocessorTest, DownscalesToLimitPreservingAspectRatio) {
+    media_preprocessor preprocessor(1);
+    image_limits limits;
+    limits.max_dimension = 100;
+
+    auto image = preprocessor.process_file(TEST_IMAGE, "image/png", limits);
+    ASSERT_TRUE(image.recompressed);
+    EXPECT_EQ(image.media_type, "image/jpeg");
+    EXPECT_TRUE(is_jpeg(image.data));
+    EXPECT_EQ(image.width, 100);
+    EXPECT_EQ(image.height, 60); // 247x148 scaled by 100/247
+
+    // Decoding the JPEG output exercises the JPEG input path
+    limits.max_dimension = 50;
+    auto smaller = preprocessor.process(image.data, image.media_type, limits);
+    ASSERT_TRUE(smaller.recompressed);
+    EXPECT_EQ(smaller.width, 50);
+    EXPECT_EQ(smaller.height, 30);
+    EXPECT_LT(smaller.data.size(), image.data.size());
+}
+
+TEST_F(MediaPreprocessorTest, PassesThroughWhenNothingToGain) {
+    media_preprocessor preprocessor(1);
+    std::ifstream file(TEST_IMAGE, std::ios::binary);
+    std::string original((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // Already within limits and a tiny PNG: a JPEG re-encode would be larger
+    auto image = preprocessor.process(original, "image/png", image_limits{});
+    EXPECT_FALSE(image.recompressed);
+    EXPECT_EQ(image.media_type, "image/png");
+    EXPECT_EQ(image.data, original);
+
+    // Unsupported formats and undecodable data are left alone
+    auto gif = preprocessor.process("GIF89a...", "image/gif", image_limits{100, 85, 0});
+    EXPECT_FALSE(gif.recompressed);
+    EXPECT_EQ(gif.data, "GIF89a...");
+
+    auto broken = preprocessor.process("not a jpeg", "image/jpeg", image_limits{100, 85, 0});
+    EXPECT_FALSE(broken.recompressed);
+    EXPECT_EQ(broken.data, "not a jpeg");
+}
+
+TEST_F(MediaPreprocessorTest, RejectsOversizedHeadersBeforeDecoding) {
+    media_preprocessor preprocessor(1);
+    image_limits limits;
+    limits.max_dimension = 100;
+    auto jpeg = preprocessor.process_file(TEST_IMAGE, "image/png", limits).data;
+    ASSERT_TRUE(is_jpeg(jpeg));
+
+    // A few hundred bytes claiming 65535x65535 pixels: 12 GB if decoded at full size
+    const auto sof = jpeg.find("\xFF\xC0");
+    ASSERT_NE(sof, std::string::npos);
+    std::string bomb = jpeg;
+    bomb.replace(sof + 5, 4, "\xFF\xFF\xFF\xFF");
+
+    // Even at 1/8 scale the image exceeds the default pixel limit
+    limits.max_dimension = 1024;
+    auto scaled = preprocessor.process(bomb, "image/jpeg", limits);
+    EXPECT_FALSE(scaled.recompressed);
+    EXPECT_EQ(scaled.width, 0);
+    EXPECT_EQ(scaled.data, bomb);
+
+    auto unscaled = preprocessor.process(bomb, "image/jpeg", image_limits{});
+    EXPECT_FALSE(unscaled.recompressed);
+    EXPECT_EQ(unscaled.data, bomb);
+
+    // The limit applies to PNG input too
+    limits.max_dimension = 100;
+    limits.max_pixels = 1000;
+    auto png = preprocessor.process_file(TEST_IMAGE, "image/png", limits);
+    EXPECT_FALSE(png.recompressed);
+    EXPECT_EQ(png.media_type, "image/png");
+}
+
+TEST_F(MediaPreprocessorTest, RejectsOversizedFilesBeforeReading) {
+    media_preprocessor preprocessor(1);
+    image_limits limits;
+    limits.max_file_bytes = std::filesystem::file_size(TEST_IMAGE) - 1;
+    EXPECT_THROW((void)preprocessor.process_file(TEST_IMAGE, "image/png", limits), std::runtime_error);
+    EXPECT_THROW(preprocessor.submit(TEST_IMAGE, "image/png", limits).get(), std::runtime_error);
+
+    // Over the upload limit is fine as long as the image can be shrunk below it
+    limits.max_file_bytes = 0;
+    limits.max_bytes = 100;
+    EXPECT_NO_THROW((void)preprocessor.process_file(TEST_IMAGE, "image/png", limits));
+}
+
+TEST_F(MediaPreprocessorTest, WorkerPoolProcessesSubmittedFiles) {
+    media_preprocessor preprocessor(2);
+    ASSERT_EQ(preprocessor.worker_count(), 2u);
+
+    std::vector<std::future<processed_image>> futures;
+    for (int i = 0; i < 8; ++i) {
+        futures.push_back(preprocessor.submit(TEST_IMAGE, "image/png", image_limits{64 + i, 80, 0}));
+    }
+    for (int i = 0; i < 8; ++i) {
+        auto image = futures[i].get();
+        EXPECT_EQ(image.width, 64 + i);
+        EXPECT_TRUE(is_jpeg(image.data));
+    }
+
+    auto missing = preprocessor.submit("does_not_exist.png", "image/png", image_limits{});
+    EXPECT_THROW(missing.get(), std::runtime_error);
+}
+
+TEST_F(MediaPreprocessorTest, ContextUsesSchemaLimits) {
+    auto registry = schema_registry::create().set_schema_directory("../schemas").build();
+    context_factory factory(registry);
+
+    context_config config;
+    config.enable_image_preprocessing = true;
+    auto context = factory.create_context("claude", config);
+
+    auto schema = context->get_schema();
+    schema["multimodal"]["max_image_dimension"] = 100;
+    general_context small_limit(schema, config);
+    small_limit.add_user_message("Describe this", "image/png", TEST_IMAGE);
+
+    auto request = small_limit.build_request();
+    const auto& source = request["messages"][0]["content"][1]["source"];
+    EXPECT_EQ(source["media_type"], "image/jpeg");
+    // FF D8 FF encodes to "/9j/"
+    EXPECT_TRUE(source["data"].get<std::string>().starts_with("/9j/"));
+}
+
+} // namespace testing
+} // namespace hyni
@@ -0,0 +1,228 @@
+#include "../src/memory_governor.h"
+#include "../src/async_file_writer.h"
+#include "../src/context_factory.h"
+#include "../src/media_preprocessor.h"
+#include "../src/prompt_minifier.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+namespace hyni {
+namespace testing {
+
+namespace {
+
+// A component that frees what it is asked for, up to what it holds, and returns the amount
+struct fake_component {
+    fake_component(memory_governor& governor, const std::string& name, double cost) {
+        registration = governor.register_component(name, cost, [this](size_t bytes) {
+            const size_t freed = std::min(bytes, held);
+            held -= freed;
+            ++shrinks;
+            return freed;
+        });
+    }
+
+    void grow(size_t bytes) {
+        held += bytes;
+        registration.update(held);
+    }
+
+    size_t held = 0;
+    size_t shrinks = 0;
+    memory_governor::registration registration;
+};
+
+size_t component_bytes(const memory_governor& governor, const std::string& name) {
+    size_t bytes = 0;
+    for (const auto& component : governor.usage()) {
+        if (component.name == name) {
+            bytes += component.bytes;
+        }
+    }
+    return bytes;
+}
+
+} // anonymous namespace
+
+TEST(MemoryGovernorTest, ShedsCheapestComponentsFirst) {
+    memory_governor governor(1000, 0.5);
+    fake_component sessions(governor, "sessions", 100.0);
+    fake_component pool(governor, "pool", 5.0);
+    fake_component cache(governor, "cache", 1.0);
+
+    sessions.grow(300);
+    pool.grow(300);
+    cache.grow(300);
+    EXPECT_EQ(governor.total_bytes(), 900u);
+    EXPECT_EQ(cache.shrinks, 0u);
+
+    // Over budget: back down to 500, taking the cache first and the rest from the pool
+    pool.grow(200);
+    EXPECT_EQ(governor.total_bytes(), 500u);
+    EXPECT_EQ(cache.held, 0u);
+    EXPECT_EQ(pool.held, 200u);
+    EXPECT_EQ(sessions.held, 300u);
+    EXPECT_EQ(sessions.shrinks, 0u);
+
+    auto usage = governor.usage();
+    ASSERT_EQ(usage.size(), 3u);
+    EXPECT_EQ(usage[0].name, "cache");
+    EXPECT_EQ(usage[0].reclaimed_bytes, 300u);
+    EXPECT_EQ(usage[0].peak_bytes, 300u);
+    EXPECT_EQ(usage[1].name, "pool");
+    EXPECT_EQ(usage[1].bytes, 200u);
+    EXPECT_EQ(usage[1].reclaimed_bytes, 300u);
+    EXPECT_EQ(usage[1].peak_bytes, 500u);
+    EXPECT_EQ(usage[2].name, "sessions");
+    EXPECT_EQ(usage[2].shrink_calls, 0u);
+
+    auto stats = governor.get_stats();
+    EXPECT_EQ(stats.pressure_events, 1u);
+    EXPECT_EQ(stats.reclaimed_bytes, 600u);
+    EXPECT_EQ(stats.peak_total_bytes, 1100u);
+    EXPECT_EQ(stats.components, 3u);
+}
+
+TEST(MemoryGovernorTest, CooperativeShrinking) {
+    memory_governor governor;
+    // Reports its new usage itself instead of returning it
+    size_t buffered = 400;
+    memory_governor::registration buffers;
+    buffers = governor.register_component("buffers", 1.0, [&](size_t bytes) {
+        buffered -= std::min(bytes, buffered) / 2;
+        buffers.update(buffered);
+        return size_t{0};
+    });
+    buffers.update(buffered);
+    // Cannot give anything back
+    auto pinned = governor.register_component("pinned", 2.0, nullptr);
+    pinned.update(600);
+
+    EXPECT_EQ(governor.reclaim(1000), 200u);
+    EXPECT_EQ(buffers.bytes(), 200u);
+    EXPECT_EQ(governor.total_bytes(), 800u);
+
+    // A budget below what can be freed sheds what it can and stays over
+    governor.set_budget(500);
+    EXPECT_EQ(governor.total_bytes(), 700u);
+    EXPECT_EQ(governor.get_budget(), 500u);
+    EXPECT_THROW(governor.set_budget(500, 0.0), std::invalid_argument);
+    governor.set_budget(0);
+
+    pinned.add(-100);
+    EXPECT_EQ(pinned.bytes(), 500u);
+    auto moved = std::move(pinned);
+    EXPECT_FALSE(pinned);
+    moved.reset();
+    EXPECT_EQ(governor.total_bytes(), 100u);
+    EXPECT_EQ(governor.usage().size(), 1u);
+}
+
+TEST(MemoryGovernorTest, EstimatesJsonSize) {
+    const nlohmann::json small = {{"a", 1}};
+    nlohmann::json large = small;
+    large["text"] = std::string(10000, 'x');
+    large["list"] = nlohmann::json::array({1, 2, 3, "four"});
+    EXPECT_GT(memory_governor::estimate_json_bytes(small), sizeof(nlohmann::json));
+    EXPECT_GT(memory_governor::estimate_json_bytes(large), 10000u);
+    EXPECT_LT(memory_governor::estimate_json_bytes(large), 11000u);
+}
+
+TEST(MemoryGovernorTest, ContextFactoryReportsAndShedsSchemas) {
+    auto& governor = memory_governor::instance();
+    auto registry = schema_registry::create().set_schema_directory("../schemas").build();
+    context_factory factory(registry);
+    auto schema_bytes = [&] { return component_bytes(governor, "context_factory.schemas"); };
+    factory.clear_cache();
+    const size_t before = schema_bytes();
+
+    auto context = factory.create_context("openai");
+    const size_t cached = schema_bytes();
+    EXPECT_GT(cached, before);
+    EXPECT_EQ(factory.get_cache_stats().cache_size, 1u);
+
+    // Under pressure the cache is dropped; the schema the context uses is not freed yet
+    governor.set_budget(1);
+    governor.set_budget(0);
+    EXPECT_EQ(factory.get_cache_stats().cache_size, 0u);
+    EXPECT_GT(schema_bytes(), before);
+    EXPECT_LE(schema_bytes(), cached);
+    EXPECT_EQ(context->get_provider_name(), "openai");
+
+    context.reset();
+    EXPECT_EQ(schema_bytes(), before);
+}
+
+TEST(MemoryGovernorTest, ConcurrentDeltasAreNotLost) {
+    memory_governor governor;
+    auto counter = governor.register_component("counter", 1.0, nullptr);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 10000; ++i) {
+                counter.add(2);
+                counter.account(-1);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(counter.bytes(), 40000u);
+    EXPECT_EQ(governor.total_bytes(), 40000u);
+}
+
+TEST(MemoryGovernorTest, ChargesCountUntilReleased) {
+    memory_governor governor;
+    auto cache = governor.register_component("cache", 1.0, nullptr);
+    auto first = cache.hold(300);
+    {
+        auto second = cache.hold(200);
+        EXPECT_EQ(cache.bytes(), 500u);
+        second.resize(50);
+        EXPECT_EQ(cache.bytes(), 350u);
+        first = std::move(second);
+    }
+    EXPECT_EQ(cache.bytes(), 50u);
+    EXPECT_EQ(first.bytes(), 50u);
+
+    // A charge outliving its registration no longer counts anywhere
+    cache.reset();
+    EXPECT_EQ(governor.total_bytes(), 0u);
+    first.resize(1000);
+    EXPECT_EQ(governor.total_bytes(), 0u);
+}
+
+TEST(MemoryGovernorTest, LibraryBuffersAreAccounted) {
+    auto& governor = memory_governor::instance();
+    auto registered = [&](const std::string& name) {
+        const auto usage = governor.usage();
+        return std::any_of(usage.begin(), usage.end(), [&](const auto& c) { return c.name == name; });
+    };
+    (void)async_io_service::instance();
+    EXPECT_TRUE(registered("async_io_service.queue"));
+    (void)media_preprocessor::instance();
+    EXPECT_TRUE(registered("media_preprocessor.queue"));
+
+    auto registry = schema_registry::create().set_schema_directory("../schemas").build();
+    context_factory factory(registry);
+    const size_t contexts_before = component_bytes(governor, "context_factory.thread_contexts");
+    factory.get_thread_local_context("openai");
+    EXPECT_GT(component_bytes(governor, "context_factory.thread_contexts"), contexts_before);
+    factory.release_thread_local_contexts();
+    EXPECT_EQ(component_bytes(governor, "context_factory.thread_contexts"), contexts_before);
+
+    const size_t blocks_before = component_bytes(governor, "prompt_minifier.seen_blocks");
+    prompt_minifier minifier;
+    std::string text;
+    for (int i = 0; i < 50; ++i) {
+        text += "Paragraph " + std::to_string(i) + " " + std::string(250, 'x') + "\n\n";
+    }
+    (void)minifier.minify(text);
+    EXPECT_GT(component_bytes(governor, "prompt_minifier.seen_blocks"), blocks_before);
+    minifier.reset();
+    EXPECT_EQ(component_bytes(governor, "prompt_minifier.seen_blocks"), blocks_before);
+}
+
+} // namespace testing
+} // namespace hyni
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hyni {
+namespace testing {
+
+/**
+ * @brief Request as seen by mock_http_server
+ */
+struct mock_request {
+    std::string method;
+    std::string path;
+    std::string headers;   ///< Raw header block without the request line
+    std::string body;
+};
+
+/**
+ * @brief Piece of a chunked response, sent after a pause
+ */
+struct mock_chunk {
+    std::chrono::milliseconds delay{0};
+    std::string data;
+};
+
+/**
+ * @brief Canned response returned by a mock_http_server handler
+ *
+ * With chunks, the body is ignored and the response is streamed with chunked
+ * transfer encoding, each chunk after its delay, to simulate slow, stalled or
+ * (with disconnect) broken streams.
+ */
+struct mock_response {
+    int status = 200;
+    std::string content_type = "application/json";
+    std::string body;
+    std::chrono::milliseconds delay{0};   ///< Before the status line
+    std::vector<mock_chunk> chunks;
+    bool disconnect = false;              ///< Close the connection after the chunks, leaving the response unfinished
+};
+
+/**
+ * @class mock_http_server
+ * @brief Minimal HTTP/1.1 server on loopback TCP or a Unix domain socket
+ *
+ * Serves each keep-alive connection on its own thread and answers every request
+ * with the handler's response, optionally delayed or streamed in chunks. Enough for exercising http_client locally; not a
+ * general purpose server.
+ */
+class mock_http_server {
+public:
+    using handler = std::function<mock_response(const mock_request&)>;
+
+    /**
+     * @brief Listens on 127.0.0.1 with an ephemeral port
+     */
+    explicit mock_http_server(handler on_request)
+        : m_handler(std::move(on_request)) {
+        m_listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (m_listen_fd < 0) {
+            throw std::runtime_error("mock_http_server: socket() failed");
+        }
+        int one = 1;
+        ::setsockopt(m_listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t len = sizeof(addr);
+        if (::bind(m_listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::getsockname(m_listen_fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+            ::close(m_listen_fd);
+            throw std::runtime_error("mock_http_server: cannot bind loopback port");
+        }
+        m_port = ntohs(addr.sin_port);
+        start();
+    }
+
+    /**
+     * @brief Listens on a Unix domain socket at socket_path, replacing a stale socket file
+     */
+    mock_http_server(const std::filesystem::path& socket_path, handler on_request)
+        : m_handler(std::move(on_request))
+        , m_socket_path(socket_path) {
+        sockaddr_un addr{};
+        if (socket_path.string().size() >= sizeof(addr.sun_path)) {
+            throw std::runtime_error("mock_http_server: socket path too long");
+        }
+        m_listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (m_listen_fd < 0) {
+            throw std::runtime_error("mock_http_server: socket() failed");
+        }
+        std::filesystem::remove(socket_path);
+
+        addr.sun_family = AF_UNIX;
+        std::copy_n(socket_path.string().c_str(), socket_path.string().size() + 1, addr.sun_path);
+        if (::bind(m_listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ::close(m_listen_fd);
+            throw std::runtime_error("mock_http_server: cannot bind " + socket_path.string());
+        }
+        start();
+    }
+
+    ~mock_http_server() {
+        m_stop = true;
+        ::shutdown(m_listen_fd, SHUT_RDWR);
+        if (m_accept_thread.joinable()) {
+            m_accept_thread.join();
+        }
+        ::close(m_listen_fd);
+        for (auto& t : m_connections) {
+            t.join();
+        }
+        if (!m_socket_path.empty()) {
+            std::error_code ec;
+            std::filesystem::remove(m_socket_path, ec);
+        }
+    }
+
+    mock_http_server(const mock_http_server&) = delete;
+    mock_http_server& operator=(const mock_http_server&) = delete;
+
+    /**
+     * @brief Base URL; for a Unix socket the host part is ignored by the client
+     */
+    [[nodiscard]] std::string url() const {
+        return m_socket_path.empty() ? "http://127.0.0.1:" + std::to_string(m_port) : "http://localhost";
+    }
+
+    [[nodiscard]] const std::filesystem::path& socket_path() const noexcept { return m_socket_path; }
+    [[nodiscard]] size_t request_count() const noexcept { return m_requests.load(); }
+    [[nodiscard]] size_t connection_count() const noexcept { return m_accepted.load(); }
+
+private:
+    handler m_handler;
+    std::filesystem::path m_socket_path;
+    int m_listen_fd = -1;
+    uint16_t m_port = 0;
+    std::atomic<bool> m_stop{false};
+    std::atomic<size_t> m_requests{0};
+    std::atomic<size_t> m_accepted{0};
+    std::thread m_accept_thread;
+    std::list<std::thread> m_connections;   // only touched by the accept thread until shutdown
+
+    void start() {
+        if (::listen(m_listen_fd, 64) != 0) {
+            ::close(m_listen_fd);
+            throw std::runtime_error("mock_http_server: listen() failed");
+        }
+        m_accept_thread = std::thread([this] { accept_loop(); });
+    }
+
+    void accept_loop() {
+        while (!m_stop) {
+            int fd = ::accept(m_listen_fd, nullptr, nullptr);
+            if (fd < 0) {
+                if (m_stop || errno != EINTR) {
+                    return;
+                }
+                continue;
+            }
+            if (m_socket_path.empty()) {
+                int one = 1;
+                ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+            ++m_accepted;
+            m_connections.emplace_back([this, fd] { serve(fd); });
+        }
+    }
+
+    // Waits for data so a stopping server does not block on idle keep-alive connections
+    bool read_more(int fd, std::string& buffer) {
+        char chunk[16384];
+        while (!m_stop) {
+            pollfd pfd{fd, POLLIN, 0};
+            int ready = ::poll(&pfd, 1, 50);
+            if (ready == 0) {
+                continue;
+            }
+            if (ready < 0 && errno == EINTR) {
+                continue;
+            }
+            ssize_t n = ready > 0 ? ::recv(fd, chunk, sizeof(chunk), 0) : -1;
+            if (n <= 0) {
+                return false;
+            }
+            buffer.append(chunk, static_cast<size_t>(n));
+            return true;
+        }
+        return false;
+    }
+
+    // Sleeps in short slices; false if the server is stopping
+    bool pause(std::chrono::milliseconds duration) {
+        const auto until = std::chrono::steady_clock::now() + duration;
+        while (!m_stop && std::chrono::steady_clock::now() < until) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return !m_stop;
+    }
+
+    bool send_response(int fd, const mock_response& response) {
+        if (!pause(response.delay)) {
+            return false;
+        }
+        std::string head = "HTTP/1.1 " + std::to_string(response.status) + " Mock\r\n"
+                           "Content-Type: " + response.content_type + "\r\n";
+        if (response.chunks.empty()) {
+            return send_all(fd, head + "Content-Length: " + std::to_string(response.body.size()) + "\r\n\r\n" +
+                                    response.body);
+        }
+        if (!send_all(fd, head + "Transfer-Encoding: chunked\r\n\r\n")) {
+            return false;
+        }
+        for (const auto& chunk : response.chunks) {
+            if (!pause(chunk.delay)) {
+                return false;
+            }
+            char size[32];
+            std::snprintf(size, sizeof(size), "%zx\r\n", chunk.data.size());
+            if (!chunk.data.empty() && !send_all(fd, size + chunk.data + "\r\n")) {
+                return false;
+            }
+        }
+        return !response.disconnect && send_all(fd, "0\r\n\r\n");
+    }
+
+    static bool send_all(int fd, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    static std::string lowercase(std::string s) {
+        for (auto& c : s) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return s;
+    }
+
+    void serve(int fd) {
+        std::string buffer;
+        while (!m_stop) {
+            size_t header_end;
+            while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+                if (!read_more(fd, buffer)) {
+                    ::close(fd);
+                    return;
+                }
+            }
+
+            mock_request request;
+            auto line_end = buffer.find("\r\n");
+            auto request_line = buffer.substr(0, line_end);
+            auto sp1 = request_line.find(' ');
+            auto sp2 = request_line.find(' ', sp1 + 1);
+            request.method = request_line.substr(0, sp1);
+            request.path = request_line.substr(sp1 + 1, sp2 - sp1 - 1);
+            request.headers = buffer.substr(line_end + 2, header_end - line_end - 2);
+
+            auto lower = lowercase(request.headers);
+            size_t content_length = 0;
+            if (auto pos = lower.find("content-length:"); pos != std::string::npos) {
+                content_length = std::stoul(lower.substr(pos + 15));
+            }
+            if (lower.find("expect: 100-continue") != std::string::npos) {
+                send_all(fd, "HTTP/1.1 100 Continue\r\n\r\n");
+            }
+
+            buffer.erase(0, header_end + 4);
+            while (buffer.size() < content_length) {
+                if (!read_more(fd, buffer)) {
+                    ::close(fd);
+                    return;
+                }
+            }
+            request.body = buffer.substr(0, content_length);
+            buffer.erase(0, content_length);
+
+            ++m_requests;
+            if (!send_response(fd, m_handler(request))) {
+                break;
+            }
+        }
+        ::close(fd);
+    }
+};
+
+} // namespace testing
+} // namespace hyni
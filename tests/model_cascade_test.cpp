@@ -0,0 +1,119 @@
+#include "../src/model_cascade.h"
+#include "../src/chat_api.h"
+#include "../src/context_factory.h"
+#include "mock_http_server.h"
+#include <gtest/gtest.h>
+
+namespace hyni {
+namespace testing {
+
+namespace {
+
+std::string last_text(const nlohmann::json& body) {
+    const auto& content = body["messages"].back()["content"];
+    return content.is_string() ? content.get<std::string>() : content[0]["text"].get<std::string>();
+}
+
+// The small model is unsure about anything "hard"; gpt-4-turbo is down
+mock_response answer(const mock_request& request) {
+    auto body = nlohmann::json::parse(request.body);
+    const std::string model = body["model"];
+    if (model == "gpt-4-turbo") {
+        return {500, "application/json", R"({"error":{"message":"unavailable"}})"};
+    }
+    const bool hard = last_text(body).find("hard") != std::string::npos;
+    const std::string text = model == "gpt-4o-mini" && hard ? "I'm not sure about that." : model + " says 42";
+    nlohmann::json response = {{"choices", {{{"message", {{"role", "assistant"}, {"content", text}}}}}}};
+    return {200, "application/json", response.dump()};
+}
+
+} // anonymous namespace
+
+class ModelCascadeTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        auto registry = schema_registry::create().set_schema_directory("../schemas").build();
+        context_factory factory(registry);
+        auto schema = factory.create_context("openai")->get_schema();
+        schema["api"]["endpoint"] = m_server.url() + "/v1/chat/completions";
+        auto context = std::make_unique<general_context>(schema);
+        context->set_api_key("test-key");
+        m_api = std::make_shared<chat_api>(std::move(context));
+    }
+
+    mock_http_server m_server{answer};
+    std::shared_ptr<chat_api> m_api;
+};
+
+TEST_F(ModelCascadeTest, EscalatesOnlyWhenTheCheapAnswerIsRejected) {
+    model_cascade cascade(m_api, {{"gpt-4o-mini", 0.15, 0.6}, {"gpt-4o", 2.5, 10.0}},
+                          cascade_checks::no_refusal());
+    const std::string model_before = m_api->get_context().get_model();
+
+    auto easy = cascade.send_message("easy question");
+    EXPECT_TRUE(easy.accepted);
+    EXPECT_EQ(easy.model, "gpt-4o-mini");
+    EXPECT_EQ(easy.tier, 0u);
+    EXPECT_EQ(easy.text, "gpt-4o-mini says 42");
+    EXPECT_GT(easy.cost, 0.0);
+
+    auto hard = cascade.send_message("hard question");
+    EXPECT_TRUE(hard.accepted);
+    EXPECT_EQ(hard.model, "gpt-4o");
+    EXPECT_EQ(hard.tier, 1u);
+    EXPECT_GT(hard.cost, easy.cost);   // paid for both tiers
+    EXPECT_EQ(m_api->get_context().get_model(), model_before);
+
+    const auto& stats = cascade.get_stats();
+    ASSERT_EQ(stats.size(), 2u);
+    EXPECT_EQ(stats[0].requests, 2u);
+    EXPECT_EQ(stats[0].accepted, 1u);
+    EXPECT_EQ(stats[0].escalated, 1u);
+    EXPECT_DOUBLE_EQ(stats[0].hit_rate(), 0.5);
+    EXPECT_EQ(stats[1].requests, 1u);
+    EXPECT_EQ(stats[1].accepted, 1u);
+    EXPECT_GT(stats[1].average_latency_ms(), 0.0);
+    EXPECT_NE(cascade.report().find("gpt-4o-mini"), std::string::npos);
+
+    cascade.reset_stats();
+    EXPECT_EQ(cascade.get_stats()[0].requests, 0u);
+}
+
+TEST_F(ModelCascadeTest, SkipsFailingTiersAndReturnsLastAnswer) {
+    model_cascade cascade(m_api, {{"gpt-4-turbo"}, {"gpt-4o-mini"}}, cascade_checks::no_refusal());
+
+    // The failed tier counts as an error; the last tier's answer is returned even when rejected
+    auto result = cascade.send_message("hard question");
+    EXPECT_FALSE(result.accepted);
+    EXPECT_EQ(result.model, "gpt-4o-mini");
+    EXPECT_EQ(cascade.get_stats()[0].errors, 1u);
+    EXPECT_EQ(cascade.get_stats()[0].escalated, 1u);
+
+    model_cascade broken(m_api, {{"gpt-4o-mini"}, {"gpt-4-turbo"}}, cascade_checks::no_refusal());
+    EXPECT_THROW((void)broken.send_message("hard question"), std::runtime_error);
+
+    EXPECT_THROW(model_cascade(m_api, {}, nullptr), std::invalid_argument);
+}
+
+TEST(CascadeChecksTest, Checks) {
+    auto refusal = cascade_checks::no_refusal();
+    EXPECT_TRUE(refusal("The answer is 4."));
+    EXPECT_FALSE(refusal("I CANNOT help with that."));
+    EXPECT_FALSE(cascade_checks::no_refusal({"Maybe"})("maybe later"));
+
+    auto json = cascade_checks::valid_json();
+    EXPECT_TRUE(json(R"( {"label": "spam"} )"));
+    EXPECT_TRUE(json("```json\n[1, 2]\n```"));
+    EXPECT_FALSE(json("Sure! {\"label\": \"spam\"}"));
+
+    auto length = cascade_checks::min_length(5);
+    EXPECT_TRUE(length("  hello  "));
+    EXPECT_FALSE(length("  hi \n"));
+
+    auto both = cascade_checks::all_of({json, length});
+    EXPECT_TRUE(both(R"({"a": 1})"));
+    EXPECT_FALSE(both("{}"));
+}
+
+} // namespace testing
+} // namespace hyni
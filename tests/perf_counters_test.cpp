@@ -0,0 +1,74 @@
+#include "../src/perf_counters.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace hyni;
+
+TEST(PerfCountersTest, ReadNeverThrowsAndFallsBackGracefully) {
+    perf_counters counters;
+
+    counters.start();
+    volatile uint64_t sum = 0;
+    for (uint64_t i = 0; i < 100000; ++i) {
+        sum = sum + i;
+    }
+    perf_sample sample = counters.stop();
+
+    if (counters.available()) {
+        EXPECT_TRUE(counters.unavailable_reason().empty());
+        if (sample.has(perf_sample::INSTRUCTIONS)) {
+            EXPECT_GT(sample.instructions(), 100000u);
+        }
+    } else {
+        EXPECT_FALSE(counters.unavailable_reason().empty());
+        for (size_t i = 0; i < perf_sample::COUNTER_COUNT; ++i) {
+            EXPECT_FALSE(sample.valid[i]);
+            EXPECT_EQ(sample.values[i], 0u);
+        }
+        EXPECT_EQ(sample.ipc(), 0.0);
+    }
+}
+
+TEST(PerfCountersTest, SampleArithmetic) {
+    perf_sample a;
+    a.values = {1000, 2500, 10, 5};
+    a.valid = {true, true, true, false};
+
+    perf_sample b;
+    b.values = {400, 1000, 4, 0};
+    b.valid = {true, true, true, false};
+
+    perf_sample diff = a - b;
+    EXPECT_EQ(diff.cycles(), 600u);
+    EXPECT_EQ(diff.instructions(), 1500u);
+    EXPECT_EQ(diff.cache_misses(), 6u);
+    EXPECT_FALSE(diff.has(perf_sample::BRANCH_MISSES));
+    EXPECT_DOUBLE_EQ(diff.ipc(), 2.5);
+
+    diff += b;
+    EXPECT_EQ(diff.cycles(), 1000u);
+}
+
+TEST(PerfCountersTest, ScopedProbeRecordsPerThread) {
+    auto& registry = perf_probe_registry::instance();
+    registry.clear();
+
+    auto worker = [] {
+        for (int i = 0; i < 10; ++i) {
+            scoped_perf_probe probe("test/probe");
+        }
+    };
+    std::thread t1(worker);
+    std::thread t2(worker);
+    t1.join();
+    t2.join();
+
+    auto stats = registry.snapshot();
+    ASSERT_EQ(stats.size(), 1u);
+    EXPECT_EQ(stats[0].name, "test/probe");
+    EXPECT_EQ(stats[0].calls, 20u);
+    EXPECT_NE(registry.report().find("test/probe"), std::string::npos);
+
+    registry.clear();
+    EXPECT_TRUE(registry.snapshot().empty());
+}
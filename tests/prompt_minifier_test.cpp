@@ -0,0 +1,144 @@
+#include "../src/prompt_minifier.h"
+#include "../src/general_context.h"
+#include "../src/context_factory.h"
+#include <gtest/gtest.h>
+
+namespace hyni {
+namespace testing {
+
+TEST(PromptMinifierTest, NormalizesWhitespaceAndKeepsIndentation) {
+    prompt_minifier minifier;
+    auto result = minifier.minify("\n\nHello   world,\t\tthis  is   spaced.   \n\n\n\n"
+                                  "    indented  line\r\nnext\n\n");
+    EXPECT_EQ(result.text, "Hello world, this is spaced.\n\n    indented line\nnext");
+    EXPECT_LT(result.tokens_after, result.tokens_before);
+}
+
+TEST(PromptMinifierTest, CollapsesRepeatedLines) {
+    prompt_minifier minifier;
+    auto result = minifier.minify("Transcription: hello\nTranscription: hello\nTranscription:  hello\nbye\nhello");
+    EXPECT_EQ(result.text, "Transcription: hello\nbye\nhello");
+
+    minify_options keep;
+    keep.collapse_repeated_lines = false;
+    EXPECT_EQ(minifier.minify("a\na", keep).text, "a\na");
+}
+
+TEST(PromptMinifierTest, RemovesFillersOnlyWhenAsked) {
+    const std::string transcript = "So um, can you give me a time when you, uh, had to handle a a very difficult customer? "
+                                   "I I think that that was, um.";
+    prompt_minifier minifier;
+    EXPECT_EQ(minifier.minify(transcript).text, transcript);
+
+    minify_options options;
+    options.remove_fillers = true;
+    EXPECT_EQ(minifier.minify(transcript, options).text,
+              "So can you give me a time when you, had to handle a very difficult customer? "
+              "I think that that was.");
+
+    options.filler_words = {"like"};
+    EXPECT_EQ(minifier.minify("It was, like, Um fine", options).text, "It was, Um fine");
+}
+
+TEST(PromptMinifierTest, LeavesCodeFencesAlone) {
+    prompt_minifier minifier;
+    minify_options options;
+    options.remove_fillers = true;
+    const std::string code = "```python\ndef f(x):\n    return  x  # uh\n\n\n\n    pass\npass\npass\n```";
+    auto result = minifier.minify("Look  at  this:\n" + code + "\n\nok", options);
+    EXPECT_EQ(result.text, "Look at this:\n" + code + "\n\nok");
+}
+
+TEST(PromptMinifierTest, DropsBlocksSeenBefore) {
+    prompt_minifier minifier;
+    minify_options options;
+    options.min_block_chars = 40;
+    const std::string context_block = "Context: the meeting notes from Monday cover the budget and hiring plan.";
+
+    auto first = minifier.minify(context_block + "\n\nWhat did we decide about hiring?", options);
+    EXPECT_EQ(first.text, context_block + "\n\nWhat did we decide about hiring?");
+
+    // Pasted again with different spacing: normalized first, so still a duplicate
+    auto second = minifier.minify("Context:  the meeting notes from Monday cover the budget and hiring plan.\n\n"
+                                  "And the budget?\n\n" + context_block, options);
+    EXPECT_EQ(second.text, "And the budget?");
+    EXPECT_LT(second.tokens_after * 3, second.tokens_before);
+
+    // Short paragraphs repeat freely
+    EXPECT_EQ(minifier.minify("And the budget?", options).text, "And the budget?");
+
+    // A message that is only a repeated block is kept rather than emptied
+    EXPECT_EQ(minifier.minify(context_block, options).text, context_block);
+
+    // Tentative results are not remembered until committed
+    const std::string other_block = "Other: the offsite agenda lists travel, venue and the team dinner.";
+    auto tentative = minifier.minify_tentative(other_block + "\n\nok", options);
+    EXPECT_EQ(tentative.new_blocks.size(), 1u);
+    EXPECT_EQ(minifier.minify_tentative(other_block + "\n\nok", options).text, other_block + "\n\nok");
+    minifier.commit(tentative);
+    EXPECT_EQ(minifier.minify_tentative(other_block + "\n\nok", options).text, "ok");
+
+    minifier.reset();
+    EXPECT_EQ(minifier.minify(context_block, options).text, context_block);
+}
+
+TEST(PromptMinifierTest, EstimatesTokens) {
+    EXPECT_EQ(prompt_minifier::estimate_tokens(""), 0u);
+    EXPECT_EQ(prompt_minifier::estimate_tokens("hello world"), 4u);
+    EXPECT_EQ(prompt_minifier::estimate_tokens("a, b."), 4u);
+    EXPECT_EQ(prompt_minifier::estimate_tokens("a    b"), 3u);
+    EXPECT_EQ(prompt_minifier::estimate_tokens("\xC3\xBC\xC3\xBC"), 2u);   // two 2-byte characters
+}
+
+TEST(PromptMinifierTest, GeneralContextMinifiesMessages) {
+    auto registry = schema_registry::create().set_schema_directory("../schemas").build();
+    context_factory factory(registry);
+    auto schema = factory.create_context("openai")->get_schema();
+
+    context_config config;
+    config.enable_prompt_minification = true;
+    config.minification.remove_fillers = true;
+    config.minification.min_block_chars = 40;
+    general_context context(schema, config);
+
+    const std::string notes = "Notes: the quarterly numbers are attached below for reference.";
+    context.add_user_message(notes + "\n\n\n\nUm,   what   changed?");
+    context.add_assistant_message("Revenue grew.");
+    context.add_user_message(notes + "\n\nAnd costs?");
+
+    const auto& messages = context.get_messages();
+    ASSERT_EQ(messages.size(), 3u);
+    EXPECT_EQ(messages[0]["content"][0]["text"], notes + "\n\nwhat changed?");
+    EXPECT_EQ(messages[2]["content"][0]["text"], "And costs?");
+
+    auto stats = context.get_minification_stats();
+    EXPECT_EQ(stats.messages, 3u);
+    EXPECT_LT(stats.tokens_after, stats.tokens_before);
+    EXPECT_EQ(stats.last_tokens_after, prompt_minifier::estimate_tokens("And costs?"));
+    EXPECT_GT(stats.last_tokens_before, stats.last_tokens_after);
+
+    // A repeated block as the whole message is not reduced to an empty message
+    context.add_user_message(notes);
+    EXPECT_EQ(context.get_messages().back()["content"][0]["text"], notes);
+
+    // A message rejected by validation does not mark its blocks as sent
+    const std::string fresh = "Fresh: the vendor shortlist was narrowed to three suppliers.";
+    EXPECT_THROW(context.add_message("narrator", fresh + "\n\nHi"), validation_exception);
+    context.add_user_message(fresh + "\n\nHi");
+    EXPECT_EQ(context.get_messages().back()["content"][0]["text"], fresh + "\n\nHi");
+
+    // Once the first message is gone its block must be sent again
+    context.clear_user_messages();
+    EXPECT_EQ(context.get_minification_stats().messages, 0u);
+    context.add_user_message(notes);
+    EXPECT_EQ(context.get_messages()[0]["content"][0]["text"], notes);
+
+    // Off by default
+    general_context plain(schema);
+    plain.add_user_message("a   b");
+    EXPECT_EQ(plain.get_messages()[0]["content"][0]["text"], "a   b");
+    EXPECT_EQ(plain.get_minification_stats().messages, 0u);
+}
+
+} // namespace testing
+} // namespace hyni
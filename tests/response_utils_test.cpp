@@ -313,6 +313,67 @@ TEST_F(ResponseUtilsTest, MergeWithExistingSpace) {
     EXPECT_EQ(best_match, -1);
 }
 
+// Test cases for merge_strings_fuzzy
+TEST_F(ResponseUtilsTest, FuzzyMergeRevisedWordInOverlap) {
+    int best_match = -1;
+    auto result = response_utils::merge_strings_fuzzy(
+        "So can you give me a time when you have to handle a very difficult customer?",
+        "a very difficult custom or let's say a boss", best_match);
+    EXPECT_EQ(result, "So can you give me a time when you have to handle a very difficult custom or let's say a boss");
+    EXPECT_EQ(best_match, 12);
+}
+
+TEST_F(ResponseUtilsTest, FuzzyMergeRevisedWordMidOverlap) {
+    int best_match = -1;
+    auto result = response_utils::merge_strings_fuzzy(
+        "we should meet on tuesday at noon", "we should meet on thursday at noon to talk", best_match);
+    EXPECT_EQ(result, "we should meet on thursday at noon to talk");
+    EXPECT_EQ(best_match, 0);
+}
+
+TEST_F(ResponseUtilsTest, FuzzyMergeExactOverlap) {
+    int best_match = -1;
+    auto result = response_utils::merge_strings_fuzzy("the cat in the hat", "the hat is red", best_match);
+    EXPECT_EQ(result, "the cat in the hat is red");
+    EXPECT_EQ(best_match, 3);
+}
+
+TEST_F(ResponseUtilsTest, FuzzyMergeIgnoresCaseAndPunctuation) {
+    int best_match = -1;
+    auto result = response_utils::merge_strings_fuzzy("one two three four", "Three, four five", best_match);
+    EXPECT_EQ(result, "one two Three, four five");
+    EXPECT_EQ(best_match, 2);
+}
+
+TEST_F(ResponseUtilsTest, FuzzyMergeRejectsOverlapAboveThreshold) {
+    int best_match = -1;
+    // Two edits in five words
+    auto result = response_utils::merge_strings_fuzzy(
+        "alpha beta gamma delta epsilon", "zeta beta eta delta epsilon iota", best_match);
+    EXPECT_EQ(result, "alpha beta gamma delta epsilon zeta beta eta delta epsilon iota");
+    EXPECT_EQ(best_match, -1);
+
+    // Same overlap accepted with a looser threshold
+    result = response_utils::merge_strings_fuzzy(
+        "alpha beta gamma delta epsilon", "zeta beta eta delta epsilon iota", best_match, 8, 0.5);
+    EXPECT_EQ(result, "zeta beta eta delta epsilon iota");
+    EXPECT_EQ(best_match, 0);
+}
+
+TEST_F(ResponseUtilsTest, FuzzyMergeOnlyLooksBackWithinWindow) {
+    int best_match = -1;
+    auto result = response_utils::merge_strings_fuzzy(
+        "red green blue one two three four five six", "red green blue seven", best_match, 4);
+    EXPECT_EQ(result, "red green blue one two three four five six red green blue seven");
+    EXPECT_EQ(best_match, -1);
+
+    result = response_utils::merge_strings_fuzzy("", "world", best_match);
+    EXPECT_EQ(result, "world");
+    result = response_utils::merge_strings_fuzzy("hello ", "world", best_match);
+    EXPECT_EQ(result, "hello world");
+    EXPECT_EQ(best_match, -1);
+}
+
 // Performance tests
 TEST_F(ResponseUtilsTest, PerformanceSplitShortString) {
     const std::string input = "This is a test string with some words";
@@ -394,6 +455,23 @@ TEST_F(ResponseUtilsTest, PerformanceDifficultCustomerScenario) {
     EXPECT_GE(best_match, -1);
 }
 
+TEST_F(ResponseUtilsTest, PerformanceFuzzyMerge) {
+    const std::string a = "So can you give me a time when you have to handle a very difficult customer?";
+    const std::string b = "a very difficult custom or let's say a very difficult boss";
+    constexpr std::chrono::microseconds max_duration(50); // 50μs max
+    int best_match = -1;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    auto result = response_utils::merge_strings_fuzzy(a, b, best_match, 32);
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = duration_cast<std::chrono::microseconds>(end - start);
+
+    EXPECT_LT(duration.count(), max_duration.count())
+        << "merge_strings_fuzzy took " << duration.count() << "μs (max allowed: "
+        << max_duration.count() << "μs)";
+    EXPECT_EQ(best_match, 12);
+}
+
 // Test empty input
 TEST_F(ResponseUtilsTest, EmptyInput) {
     EXPECT_EQ(response_utils::response_utils::response_utils::base64_encode(nullptr, 0), "");
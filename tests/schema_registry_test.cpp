@@ -184,21 +184,207 @@ TEST_F(ContextFactoryTest, ClearCache) {
 // Test thread-local context
 TEST_F(ContextFactoryTest, ThreadLocalContext) {
     // Get thread-local context
-    auto& context1 = factory->get_thread_local_context("provider1");
-    auto& context2 = factory->get_thread_local_context("provider1");
+    auto context1 = factory->get_thread_local_context("provider1");
+    auto context2 = factory->get_thread_local_context("provider1");
 
     // Should be the same instance within the same thread
-    EXPECT_EQ(&context1, &context2);
+    EXPECT_EQ(context1, context2);
 
     // Test in another thread
-    std::thread t([this]() {
-        auto& context_thread = factory->get_thread_local_context("provider1");
-        // Address should be different from main thread's context
-        EXPECT_NE(&context_thread, &factory->get_thread_local_context("provider1"));
+    std::thread t([this, context1]() {
+        auto context_thread = factory->get_thread_local_context("provider1");
+        // Should be different from main thread's context
+        EXPECT_NE(context_thread, context1);
     });
     t.join();
 }
 
+// Test thread-local contexts are keyed by config as well as provider
+TEST_F(ContextFactoryTest, ThreadLocalContextPerConfig) {
+    context_config config_a;
+    config_a.default_max_tokens = 100;
+    context_config config_b;
+    config_b.default_max_tokens = 200;
+
+    auto a1 = factory->get_thread_local_context("provider1", config_a);
+    auto b = factory->get_thread_local_context("provider1", config_b);
+    auto a2 = factory->get_thread_local_context("provider1", config_a);
+
+    EXPECT_NE(a1, b);
+    EXPECT_EQ(a1, a2);
+    EXPECT_EQ(factory->thread_local_context_count(), 2u);
+
+    auto stats = factory->get_cache_stats();
+    EXPECT_EQ(stats.thread_context_hits, 1u);
+    EXPECT_EQ(stats.thread_context_misses, 2u);
+
+    factory->release_thread_local_contexts();
+    EXPECT_EQ(factory->thread_local_context_count(), 0u);
+}
+
+// Test per-thread capacity with LRU eviction
+TEST_F(ContextFactoryTest, ThreadLocalContextEviction) {
+    thread_cache_options options;
+    options.capacity = 2;
+    auto bounded = std::make_shared<context_factory>(registry, options);
+
+    auto p1 = bounded->get_thread_local_context("provider1");
+    auto p2 = bounded->get_thread_local_context("provider2");
+    bounded->get_thread_local_context("provider1");          // provider2 is now least recent
+    bounded->get_thread_local_context("custom_provider");    // evicts provider2
+
+    EXPECT_EQ(bounded->thread_local_context_count(), 2u);
+    EXPECT_EQ(p1, bounded->get_thread_local_context("provider1"));
+    // An evicted context stays usable while it is held
+    p2->set_parameter("temperature", 0.3);
+    EXPECT_TRUE(p2->has_parameter("temperature"));
+
+    auto stats = bounded->get_cache_stats();
+    EXPECT_EQ(stats.thread_context_evictions, 1u);
+
+    // provider2 has to be created again
+    bounded->get_thread_local_context("provider2");
+    EXPECT_EQ(bounded->get_cache_stats().thread_context_misses, 4u);
+
+    // Another factory's contexts do not count against this one's capacity
+    factory->get_thread_local_context("provider1");
+    EXPECT_EQ(bounded->thread_local_context_count(), 2u);
+    EXPECT_EQ(factory->thread_local_context_count(), 1u);
+    factory->release_thread_local_contexts();
+    bounded->release_thread_local_contexts();
+}
+
+// Test cached contexts are reset when handed out again
+TEST_F(ContextFactoryTest, ThreadLocalContextResetOnReuse) {
+    auto context = factory->get_thread_local_context("provider1");
+    context->set_parameter("temperature", 0.3);
+    EXPECT_TRUE(context->has_parameter("temperature"));
+
+    auto reused = factory->get_thread_local_context("provider1");
+    EXPECT_EQ(context, reused);
+    EXPECT_FALSE(reused->has_parameter("temperature"));
+
+    thread_cache_options options;
+    options.reset_on_reuse = false;
+    auto keeping = std::make_shared<context_factory>(registry, options);
+    keeping->get_thread_local_context("provider1")->set_parameter("temperature", 0.3);
+    EXPECT_TRUE(keeping->get_thread_local_context("provider1")->has_parameter("temperature"));
+
+    factory->release_thread_local_contexts();
+    keeping->release_thread_local_contexts();
+}
+
+// Test contexts of a destroyed factory are dropped instead of leaking
+TEST_F(ContextFactoryTest, ThreadLocalContextOutlivedFactory) {
+    {
+        auto temporary = std::make_shared<context_factory>(registry);
+        temporary->get_thread_local_context("provider1");
+        temporary->get_thread_local_context("provider2");
+        EXPECT_EQ(temporary->thread_local_context_count(), 2u);
+    }
+
+    // The next lookup on this thread prunes the dead factory's entries
+    factory->get_thread_local_context("provider1");
+    EXPECT_EQ(detail::thread_context_cache().size(), 1u);
+    factory->release_thread_local_contexts();
+}
+
+// Test schema inheritance through "extends"
+TEST_F(ContextFactoryTest, SchemaExtends) {
+    {
+        std::ofstream file("test_schemas/derived.json");
+        file << R"({ "extends": "provider1",
+                     "provider": { "name": "derived" },
+                     "api": { "endpoint": "https://derived.com/api" },
+                     "request_template": { "model": "derived-model" },
+                     "response_format": { "success": { "text_path": ["output"] } } })";
+    }
+    {
+        std::ofstream file("test_schemas/removes.json");
+        file << R"({ "extends": "derived", "provider": { "display_name": null } })";
+    }
+
+    auto derived = factory->create_context("derived");
+    EXPECT_EQ(derived->get_provider_name(), "derived");
+    EXPECT_EQ(derived->get_endpoint(), "https://derived.com/api");
+    // Inherited from the base, merged where both define an object
+    EXPECT_EQ(derived->get_schema()["provider"]["display_name"], "Test AI");
+    EXPECT_TRUE(derived->get_schema().contains("message_format"));
+    EXPECT_FALSE(derived->get_schema().contains("extends"));
+    // Arrays replace rather than merge
+    EXPECT_EQ(derived->get_schema()["response_format"]["success"]["text_path"],
+              nlohmann::json::array({"output"}));
+
+    // The base is parsed once and reused by further derived schemas
+    auto removes = factory->create_context("removes");
+    EXPECT_FALSE(removes->get_schema()["provider"].contains("display_name"));
+    EXPECT_EQ(removes->get_endpoint(), "https://derived.com/api");
+    EXPECT_EQ(factory->get_cache_stats().cache_size, 3u);
+
+    // Contexts share the cached schema instead of copying it
+    auto derived2 = factory->create_context("derived");
+    EXPECT_EQ(&derived->get_schema(), &derived2->get_schema());
+
+    // Loading without a factory resolves the same chain
+    general_context direct(std::string("test_schemas/removes.json"));
+    EXPECT_EQ(direct.get_schema(), removes->get_schema());
+}
+
+// Test cyclic inheritance is rejected
+TEST_F(ContextFactoryTest, SchemaExtendsCycle) {
+    std::ofstream("test_schemas/cycle_a.json") << R"({ "extends": "cycle_b" })";
+    std::ofstream("test_schemas/cycle_b.json") << R"({ "extends": "cycle_a" })";
+
+    EXPECT_THROW(factory->create_context("cycle_a"), schema_exception);
+    EXPECT_THROW(general_context(std::string("test_schemas/cycle_a.json")), schema_exception);
+}
+
+// Test the factory and direct loading share one resolver
+TEST_F(ContextFactoryTest, SchemaExtendsRegisteredBase) {
+    // custom_provider is registered from another directory
+    std::ofstream("test_schemas/derived_custom.json")
+        << R"({ "extends": "custom_provider", "api": { "endpoint": "https://custom.com/api" } })";
+
+    auto derived = factory->create_context("derived_custom");
+    EXPECT_EQ(derived->get_endpoint(), "https://custom.com/api");
+    EXPECT_EQ(derived->get_schema()["provider"]["display_name"], "Test AI");
+    EXPECT_EQ(derived->get_schema(),
+              general_context::load_schema_file("test_schemas/derived_custom.json", registry.get()));
+
+    // Without a registry the base is looked for next to the schema
+    EXPECT_THROW((void)general_context::load_schema_file("test_schemas/derived_custom.json"), schema_exception);
+
+    // Cycles are found by path, also through registered providers and the cache
+    std::ofstream("custom_schemas/provider3.json") << R"({ "extends": "../test_schemas/loop.json" })";
+    std::ofstream("test_schemas/loop.json") << R"({ "extends": "custom_provider" })";
+    factory->clear_cache();
+    EXPECT_THROW(factory->create_context("loop"), schema_exception);
+    EXPECT_THROW((void)general_context::load_schema_file("test_schemas/loop.json", registry.get()),
+                 schema_exception);
+}
+
+// Test the bundled OpenAI-compatible schemas resolve to complete schemas
+TEST_F(ContextFactoryTest, BundledSchemasExtendOpenAI) {
+    auto bundled = std::make_shared<context_factory>(
+        schema_registry::create().set_schema_directory("../schemas").build());
+
+    auto openai = bundled->create_context("openai");
+    for (const std::string provider : {"deepseek", "mistral"}) {
+        auto context = bundled->create_context(provider);
+        const auto& schema = context->get_schema();
+
+        EXPECT_EQ(context->get_provider_name(), provider);
+        EXPECT_EQ(schema["response_format"]["success"]["text_path"],
+                  openai->get_schema()["response_format"]["success"]["text_path"]);
+        EXPECT_EQ(schema["message_format"]["structure"]["content"], "<TEXT_CONTENT>");
+        EXPECT_FALSE(schema["message_format"]["content_types"].contains("image"));
+        EXPECT_FALSE(context->supports_multimodal());
+        EXPECT_FALSE(schema["request_template"].contains("response_format"));
+    }
+    // openai, deepseek, mistral
+    EXPECT_EQ(bundled->get_cache_stats().cache_size, 3u);
+}
+
 // Test multi-threaded access
 TEST_F(ContextFactoryTest, MultiThreadedAccess) {
     const int NUM_THREADS = 10;
@@ -209,7 +395,7 @@ TEST_F(ContextFactoryTest, MultiThreadedAccess) {
         threads.emplace_back([this, &success_count]() {
             try {
                 auto context = factory->create_context("provider1");
-                auto& tl_context = factory->get_thread_local_context("provider2");
+                auto tl_context = factory->get_thread_local_context("provider2");
                 success_count++;
             } catch (const std::exception& e) {
                 // Should not happen
@@ -233,19 +419,19 @@ TEST_F(ContextFactoryTest, ProviderContextHelper) {
     provider_context claude_ctx(factory, "provider1");
 
     // First access creates the context
-    auto& context1 = claude_ctx.get();
-    EXPECT_EQ(context1.get_provider_name(), "test");
+    auto context1 = claude_ctx.get();
+    EXPECT_EQ(context1->get_provider_name(), "test");
 
     // Second access reuses it
-    auto& context2 = claude_ctx.get();
-    EXPECT_EQ(&context1, &context2);
+    auto context2 = claude_ctx.get();
+    EXPECT_EQ(context1, context2);
 
     // Test reset
-    context1.add_user_message("Hello");
-    EXPECT_FALSE(context1.get_messages().empty());
+    context1->add_user_message("Hello");
+    EXPECT_FALSE(context1->get_messages().empty());
 
     claude_ctx.reset();
-    EXPECT_TRUE(context1.get_messages().empty());
+    EXPECT_TRUE(context1->get_messages().empty());
 }
 
 // Test null registry handling
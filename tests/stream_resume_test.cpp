@@ -0,0 +1,181 @@
+#include "../src/chat_api.h"
+#include "../src/context_factory.h"
+#include "mock_http_server.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <future>
+
+namespace hyni {
+namespace testing {
+
+namespace {
+
+std::string event(const std::string& text, bool claude) {
+    nlohmann::json data = claude ? nlohmann::json{{"content", {{{"type", "text"}, {"text", text}}}}}
+                                 : nlohmann::json{{"choices", {{{"message", {{"content", text}}}}}}};
+    return "data: " + data.dump() + "\n\n";
+}
+
+std::string text_of(const nlohmann::json& message) {
+    const auto& content = message["content"];
+    return content.is_string() ? content.get<std::string>() : content[0]["text"].get<std::string>();
+}
+
+// Streams parts, dropping the connection after all but the last attempt's
+mock_response stream_parts(const std::vector<std::string>& parts, bool claude, bool disconnect) {
+    mock_response response;
+    response.content_type = "text/event-stream";
+    for (const auto& part : parts) {
+        response.chunks.push_back({std::chrono::milliseconds(5), event(part, claude)});
+    }
+    if (!disconnect) {
+        response.chunks.push_back({std::chrono::milliseconds(0), "data: [DONE]\n\n"});
+    }
+    response.disconnect = disconnect;
+    return response;
+}
+
+} // anonymous namespace
+
+class StreamResumeTest : public ::testing::Test {
+protected:
+    std::shared_ptr<chat_api> make_api(const std::string& provider, const mock_http_server& server) {
+        auto registry = schema_registry::create().set_schema_directory("../schemas").build();
+        context_factory factory(registry);
+        auto schema = factory.create_context(provider)->get_schema();
+        schema["api"]["endpoint"] = server.url() + "/v1/stream";
+        auto context = std::make_unique<general_context>(schema);
+        context->set_api_key("test-key");
+        return std::make_shared<chat_api>(std::move(context));
+    }
+
+    // Streams message and returns what the consumer saw and the final response
+    std::pair<std::string, http_response> stream(chat_api& api, const std::string& message) {
+        std::string received;
+        size_t completions = 0;
+        std::promise<http_response> done;
+        api.send_message_stream(message, [&](const std::string& delta) { received += delta; },
+                                [&](const http_response& response) {
+                                    if (++completions == 1) {
+                                        done.set_value(response);
+                                    }
+                                });
+        auto response = done.get_future().get();
+        EXPECT_EQ(completions, 1u);
+        return {received, response};
+    }
+};
+
+TEST_F(StreamResumeTest, ClaudeContinuesFromAssistantPrefill) {
+    std::vector<nlohmann::json> requests;
+    mock_http_server server([&](const mock_request& request) {
+        requests.push_back(nlohmann::json::parse(request.body));
+        return requests.size() == 1 ? stream_parts({"The quick ", "brown "}, true, true)
+                                    : stream_parts({" fox jumps", " over the dog."}, true, false);
+    });
+    auto api = make_api("claude", server);
+    ASSERT_TRUE(api->get_context().supports_assistant_prefill());
+    api->set_stream_resume({1});
+
+    auto [received, response] = stream(*api, "Tell me a pangram");
+    EXPECT_TRUE(response.success) << response.error_message;
+    EXPECT_EQ(received, "The quick brown fox jumps over the dog.");
+
+    ASSERT_EQ(requests.size(), 2u);
+    const auto& messages = requests[1]["messages"];
+    ASSERT_EQ(messages.size(), requests[0]["messages"].size() + 1);
+    EXPECT_EQ(messages.back()["role"], "assistant");
+    EXPECT_EQ(text_of(messages.back()), "The quick brown");
+    EXPECT_EQ(requests[1]["stream"], true);
+}
+
+TEST_F(StreamResumeTest, OtherProvidersGetAContinuationPrompt) {
+    std::vector<nlohmann::json> requests;
+    mock_http_server server([&](const mock_request& request) {
+        requests.push_back(nlohmann::json::parse(request.body));
+        if (requests.size() == 1) {
+            return stream_parts({"Once upon a time ", "there was a dragon who"}, false, true);
+        }
+        // The model restates the end of what it had said
+        return stream_parts({"there was a dra", "gon who loved ", "cheese."}, false, false);
+    });
+    auto api = make_api("openai", server);
+    ASSERT_FALSE(api->get_context().supports_assistant_prefill());
+    stream_resume_options options;
+    options.max_resumes = 2;
+    options.continuation_prompt = "Continue.";
+    api->set_stream_resume(options);
+
+    auto [received, response] = stream(*api, "Tell me a story");
+    EXPECT_TRUE(response.success) << response.error_message;
+    EXPECT_EQ(received, "Once upon a time there was a dragon who loved cheese.");
+
+    ASSERT_EQ(requests.size(), 2u);
+    const auto& messages = requests[1]["messages"];
+    ASSERT_GE(messages.size(), 2u);
+    EXPECT_EQ(messages[messages.size() - 2]["role"], "assistant");
+    EXPECT_EQ(text_of(messages[messages.size() - 2]), "Once upon a time there was a dragon who");
+    EXPECT_EQ(messages.back()["role"], "user");
+    EXPECT_EQ(text_of(messages.back()), "Continue.");
+}
+
+TEST_F(StreamResumeTest, ContinuationUsesStateFromTheStreamStart) {
+    std::vector<nlohmann::json> requests;
+    std::promise<void> first_sent;
+    mock_http_server server([&](const mock_request& request) {
+        requests.push_back(nlohmann::json::parse(request.body));
+        if (requests.size() == 1) {
+            first_sent.set_value();
+            return stream_parts({"Once upon ", "a time"}, false, true);
+        }
+        return stream_parts({" there was a dragon."}, false, false);
+    });
+    auto api = make_api("openai", server);
+    stream_resume_options options;
+    options.max_resumes = 1;
+    options.continuation_prompt = "Continue.";
+    api->set_stream_resume(options);
+
+    std::string received;
+    std::promise<http_response> done;
+    api->send_message_stream("Tell me a story", [&](const std::string& delta) { received += delta; },
+                             [&](const http_response& response) { done.set_value(response); });
+
+    // The caller moves on while the stream runs; the continuation must not see it
+    first_sent.get_future().wait();
+    api->get_context().reset();
+    api->set_stream_resume({});
+
+    auto response = done.get_future().get();
+    EXPECT_TRUE(response.success) << response.error_message;
+    EXPECT_EQ(received, "Once upon a time there was a dragon.");
+    ASSERT_EQ(requests.size(), 2u);
+    const auto& messages = requests[1]["messages"];
+    ASSERT_EQ(messages.size(), requests[0]["messages"].size() + 2);
+    EXPECT_EQ(text_of(messages[0]), text_of(requests[0]["messages"][0]));
+    EXPECT_EQ(text_of(messages.back()), "Continue.");
+}
+
+TEST_F(StreamResumeTest, GivesUpAfterMaxResumes) {
+    std::atomic<int> requests{0};
+    mock_http_server server([&](const mock_request&) {
+        return stream_parts({"part " + std::to_string(++requests) + " "}, false, true);
+    });
+    auto api = make_api("openai", server);
+
+    // Off by default: the failure reaches the caller as before
+    auto [unresumed, failed] = stream(*api, "hello");
+    EXPECT_FALSE(failed.success);
+    EXPECT_EQ(unresumed, "part 1 ");
+    EXPECT_EQ(requests.load(), 1);
+
+    api->set_stream_resume({1});
+    auto [received, response] = stream(*api, "hello");
+    EXPECT_FALSE(response.success);
+    EXPECT_EQ(response.status_code, 0);
+    EXPECT_EQ(received, "part 2 part 3 ");
+    EXPECT_EQ(requests.load(), 3);
+}
+
+} // namespace testing
+} // namespace hyni
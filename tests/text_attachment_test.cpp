@@ -0,0 +1,164 @@
+#include "../src/text_attachment.h"
+#include "../src/chat_api.h"
+#include "../src/context_factory.h"
+#include "../src/json_serializer.h"
+#include "mock_http_server.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <unistd.h>
+
+namespace hyni {
+namespace testing {
+
+class TextAttachmentTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        m_path = std::filesystem::temp_directory_path() / ("hyni_attachment_" + std::to_string(::getpid()) + ".txt");
+
+        // Every kind of byte the escaper cares about
+        for (int i = 0; i < 2000; ++i) {
+            m_document += "line " + std::to_string(i) + ": \"quoted\" C:\\path\t caf\xC3\xA9 \x01\n";
+        }
+        std::ofstream(m_path, std::ios::binary) << m_document;
+
+        auto registry = schema_registry::create().set_schema_directory("../schemas").build();
+        context_factory factory(registry);
+        m_schema = factory.create_context("openai")->get_schema();
+    }
+
+    void TearDown() override {
+        std::error_code ec;
+        std::filesystem::remove(m_path, ec);
+    }
+
+    std::filesystem::path m_path;
+    std::string m_document;
+    nlohmann::json m_schema;
+};
+
+TEST_F(TextAttachmentTest, MappedFileSerializesLikeInlineText) {
+    auto attachment = text_attachment::map_file(m_path);
+    EXPECT_EQ(attachment->view(), m_document);
+    EXPECT_TRUE(attachment->is_valid_utf8());
+
+    general_context with_attachment(m_schema);
+    with_attachment.add_user_message("Summarize this log:");
+    with_attachment.add_user_attachment(attachment);
+
+    general_context inline_text(m_schema);
+    inline_text.add_user_message("Summarize this log:");
+    inline_text.add_user_message(m_document);
+
+    // Messages carry only the placeholder
+    const auto request = with_attachment.build_request();
+    EXPECT_LT(request.dump().size(), 1024u);
+
+    const auto expected = inline_text.build_request().dump();
+    const auto& attachments = with_attachment.get_attachments();
+    EXPECT_EQ(json_serializer::dump(request, json_serializer::utf8_mode::strict, &attachments), expected);
+    EXPECT_EQ(json_serializer::dump(request, json_serializer::utf8_mode::trusted, &attachments), expected);
+
+    EXPECT_EQ(with_attachment.estimate_request_tokens(), inline_text.estimate_request_tokens());
+    EXPECT_GT(attachment->estimated_tokens(), 2000u);
+}
+
+TEST_F(TextAttachmentTest, InvalidUtf8FollowsContextPolicy) {
+    auto attachment = text_attachment::from_string("bad \xC3( byte", "notes.txt");
+    EXPECT_FALSE(attachment->is_valid_utf8());
+
+    general_context repairing(m_schema);
+    repairing.add_user_attachment(attachment);
+    const auto& attachments = repairing.get_attachments();
+    const auto body =
+        json_serializer::dump(repairing.build_request(), json_serializer::utf8_mode::trusted, &attachments);
+    EXPECT_NE(body.find("bad \xEF\xBF\xBD( byte"), std::string::npos);
+    EXPECT_THROW((void)json_serializer::dump(repairing.build_request(), json_serializer::utf8_mode::strict,
+                                             &attachments),
+                 nlohmann::json::type_error);
+
+    context_config config;
+    config.utf8_handling = utf8_policy::validate;
+    general_context validating(m_schema, config);
+    EXPECT_THROW(validating.add_user_attachment(attachment), validation_exception);
+    EXPECT_THROW(validating.add_user_attachment(nullptr), validation_exception);
+}
+
+TEST_F(TextAttachmentTest, ContextKeepsItsAttachmentsAlive) {
+    std::weak_ptr<const text_attachment> weak;
+    {
+        auto owner = std::make_shared<std::string>("borrowed text");
+        auto attachment = text_attachment::from_view(*owner, owner, "borrowed");
+        weak = attachment;
+        EXPECT_TRUE(text_attachment::is_placeholder(attachment->placeholder()));
+
+        general_context context(m_schema);
+        context.add_user_attachment(attachment);
+        const auto placeholder = attachment->placeholder();
+        attachment.reset();
+        owner.reset();
+        ASSERT_EQ(context.get_attachments().count(placeholder), 1u);
+        EXPECT_EQ(context.get_attachments().at(placeholder)->view(), "borrowed text");
+
+        context.clear_user_messages();
+        EXPECT_TRUE(context.get_attachments().empty());
+        EXPECT_TRUE(weak.expired());
+    }
+    EXPECT_FALSE(text_attachment::is_placeholder("plain text"));
+    EXPECT_NE(text_attachment::from_string("a")->placeholder(), text_attachment::from_string("a")->placeholder());
+    EXPECT_THROW((void)text_attachment::map_file(m_path.string() + ".missing"), std::runtime_error);
+    EXPECT_THROW((void)text_attachment::read_file(m_path.string() + ".missing"), std::runtime_error);
+}
+
+TEST_F(TextAttachmentTest, ForeignPlaceholderIsNotExpanded) {
+    auto secret = text_attachment::from_string("another session's file", "secret.txt");
+    general_context owner(m_schema);
+    owner.add_user_attachment(secret);
+
+    // Text that mimics the placeholder stays text outside the owning context
+    general_context other(m_schema);
+    other.add_user_message(secret->placeholder());
+    other.set_parameter("user", secret->placeholder());
+    const auto request = other.build_request();
+    const auto body = json_serializer::dump(request, json_serializer::utf8_mode::strict, &other.get_attachments());
+    EXPECT_EQ(body.find("another session"), std::string::npos);
+    EXPECT_EQ(body, request.dump());
+
+    // Nor without any map
+    EXPECT_EQ(json_serializer::dump(owner.build_request()).find("another session"), std::string::npos);
+}
+
+TEST_F(TextAttachmentTest, ReadFileSnapshotsTheContents) {
+    auto attachment = text_attachment::read_file(m_path);
+    EXPECT_FALSE(attachment->is_mapped());
+    EXPECT_TRUE(text_attachment::map_file(m_path)->is_mapped());
+
+    // A live log that is truncated and rewritten after the snapshot
+    std::ofstream(m_path, std::ios::binary | std::ios::trunc) << "rotated";
+    EXPECT_EQ(attachment->view(), m_document);
+    EXPECT_TRUE(attachment->is_valid_utf8());
+}
+
+TEST_F(TextAttachmentTest, SentThroughChatApi) {
+    std::string received;
+    mock_http_server server([&](const mock_request& request) {
+        received = request.body;
+        return mock_response{200, "application/json",
+                             R"({"choices":[{"message":{"role":"assistant","content":"ok"}}]})"};
+    });
+    auto schema = m_schema;
+    schema["api"]["endpoint"] = server.url() + "/v1/chat/completions";
+    auto context = std::make_unique<general_context>(schema);
+    context->set_api_key("test-key");
+    context->add_user_attachment(text_attachment::map_file(m_path));
+    const auto unattached = text_attachment::from_string("not attached");
+    context->add_user_message(unattached->placeholder());
+    chat_api api(std::move(context));
+
+    EXPECT_EQ(api.send_message(), "ok");
+    auto body = nlohmann::json::parse(received);
+    EXPECT_EQ(body["messages"][0]["content"][0]["text"], m_document);
+    EXPECT_EQ(body["messages"][1]["content"][0]["text"], unattached->placeholder());
+}
+
+} // namespace testing
+} // namespace hyni
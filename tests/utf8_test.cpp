@@ -0,0 +1,187 @@
+#include "../src/utf8.h"
+#include "../src/json_serializer.h"
+#include "../src/general_context.h"
+#include "../src/context_factory.h"
+#include <gtest/gtest.h>
+#include <random>
+
+namespace hyni {
+namespace testing {
+
+namespace {
+
+const std::string R = std::string(utf8::REPLACEMENT);
+
+} // anonymous namespace
+
+TEST(Utf8Test, ValidatesLikeRfc3629) {
+    const std::vector<std::string> valid = {
+        "",
+        "plain ascii",
+        "caf\xC3\xA9 \xE6\x97\xA5\xE6\x9C\xAC \xF0\x9F\x98\x80",
+        "\xEF\xBF\xBF \xF4\x8F\xBF\xBF",   // U+FFFF, U+10FFFF
+        std::string(1000, 'a') + "\xE2\x82\xAC",
+    };
+    for (const auto& text : valid) {
+        EXPECT_TRUE(utf8::is_valid(text)) << text;
+        EXPECT_EQ(utf8::find_invalid(text), std::string::npos);
+    }
+
+    const std::vector<std::pair<std::string, size_t>> invalid = {
+        {"\xC3", 0},                         // truncated
+        {"ab\x80", 2},                       // stray continuation
+        {"\xC0\xAF", 0},                     // overlong
+        {"\xE0\x80\xAF", 0},                 // overlong
+        {"x\xED\xA0\x80", 1},                // surrogate
+        {"\xF4\x90\x80\x80", 0},             // above U+10FFFF
+        {"\xF5\x80\x80\x80", 0},
+        {"\xFF", 0},
+        {std::string(100, 'a') + "\xFF", 100},
+        {std::string(63, 'a') + "\xE2\x82", 63},  // split across 64-byte steps
+    };
+    for (const auto& [text, offset] : invalid) {
+        EXPECT_FALSE(utf8::is_valid(text)) << text;
+        EXPECT_EQ(utf8::find_invalid(text), offset) << text;
+    }
+}
+
+TEST(Utf8Test, AgreesWithNlohmannOnRandomBytes) {
+    std::mt19937 rng(3);
+    const std::vector<std::string> pieces = {"a", "hello ", "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80",
+                                             "\x80", "\xC3", "\xED\xA0\x80", "\xF4\x90", "\xFF"};
+    for (int round = 0; round < 500; ++round) {
+        std::string text;
+        const size_t count = rng() % 100;
+        for (size_t i = 0; i < count; ++i) {
+            // Mostly valid, so both outcomes are common
+            text += pieces[rng() % (rng() % 8 == 0 ? pieces.size() : 5)];
+        }
+        bool nlohmann_valid = true;
+        try {
+            (void)nlohmann::json(text).dump();
+        } catch (const nlohmann::json::type_error&) {
+            nlohmann_valid = false;
+        }
+        ASSERT_EQ(utf8::is_valid(text), nlohmann_valid) << text;
+
+        const auto repaired = utf8::repair(text);
+        ASSERT_TRUE(utf8::is_valid(repaired));
+        if (nlohmann_valid) {
+            ASSERT_EQ(repaired, text);
+        }
+    }
+}
+
+TEST(Utf8Test, RepairsMaximalSubparts) {
+    EXPECT_EQ(utf8::repair("ok"), "ok");
+    EXPECT_EQ(utf8::repair("a\xFF" "b"), "a" + R + "b");
+    // A truncated sequence is one replacement, not one per byte
+    EXPECT_EQ(utf8::repair("a\xE2\x82" "b"), "a" + R + "b");
+    EXPECT_EQ(utf8::repair("\xF0\x9F\x98"), R);
+    // Bytes that can never start a valid sequence are replaced one by one
+    EXPECT_EQ(utf8::repair("\xC0\xAF"), R + R);
+    EXPECT_EQ(utf8::repair("\xED\xA0\x80"), R + R + R);
+    EXPECT_EQ(utf8::repair("\x80\x80"), R + R);
+
+    std::string text = "caf\xC3\xA9";
+    EXPECT_FALSE(utf8::repair_in_place(text));
+    EXPECT_EQ(text, "caf\xC3\xA9");
+    text = std::string(80, 'x') + "\xC3";
+    EXPECT_TRUE(utf8::repair_in_place(text));
+    EXPECT_EQ(text, std::string(80, 'x') + R);
+}
+
+TEST(Utf8Test, StreamRepairerJoinsSplitCharacters) {
+    utf8_stream_repairer repairer;
+    // The euro sign arrives a byte at a time
+    EXPECT_EQ(repairer.feed("price: \xE2"), "price: ");
+    EXPECT_EQ(repairer.feed("\x82"), "");
+    EXPECT_EQ(repairer.feed("\xAC" "5"), "\xE2\x82\xAC" "5");
+    EXPECT_EQ(repairer.replacements(), 0u);
+
+    // A held back prefix that turns out to be invalid is replaced once
+    EXPECT_EQ(repairer.feed("\xF0\x9F"), "");
+    EXPECT_EQ(repairer.feed("x\xFF"), R + "x" + R);
+    EXPECT_EQ(repairer.replacements(), 2u);
+
+    EXPECT_EQ(repairer.feed("end \xC3"), "end ");
+    EXPECT_EQ(repairer.finish(), R);
+    EXPECT_EQ(repairer.finish(), "");
+}
+
+TEST(Utf8Test, SerializerRepairsOrTrusts) {
+    const std::string broken = std::string(70, 'a') + "\xFF\"";
+    const nlohmann::json payload = {{"text", broken}, {"k\xC3", 1}};
+
+    EXPECT_THROW((void)json_serializer::dump(payload), nlohmann::json::type_error);
+    const auto repaired = json_serializer::dump(payload, json_serializer::utf8_mode::repair);
+    EXPECT_EQ(repaired, nlohmann::json({{"text", utf8::repair(broken)}, {"k" + R, 1}}).dump());
+
+    // Trusted strings are escaped without looking at their UTF-8
+    std::string out;
+    json_serializer::escape_string("\xFF\n", out, json_serializer::utf8_mode::trusted);
+    EXPECT_EQ(out, "\"\xFF\\n\"");
+
+    // Errors match nlohmann's
+    for (const std::string& text : {std::string("\xC3"), std::string(100, 'a') + "\xE2\x28\xA1",
+                                    std::string("ab\xF0\x9F\x98")}) {
+        std::string ours;
+        std::string theirs;
+        try {
+            (void)json_serializer::dump(nlohmann::json(text));
+        } catch (const nlohmann::json::type_error& e) {
+            ours = e.what();
+        }
+        try {
+            (void)nlohmann::json(text).dump();
+        } catch (const nlohmann::json::type_error& e) {
+            theirs = e.what();
+        }
+        EXPECT_EQ(ours, theirs);
+    }
+}
+
+TEST(Utf8Test, GeneralContextAppliesPolicy) {
+    auto registry = schema_registry::create().set_schema_directory("../schemas").build();
+    context_factory factory(registry);
+    auto schema = factory.create_context("openai")->get_schema();
+
+    // Repair by default, so the request always serializes
+    general_context context(schema);
+    EXPECT_TRUE(context.validates_utf8());
+    context.set_system_message("sys\xC3");
+    context.add_user_message("pasted \xE2\x82 text");
+    context.set_parameter("stop", nlohmann::json::array({"\xFF"}));
+    EXPECT_EQ(context.get_messages()[0]["content"][0]["text"], "pasted " + R + " text");
+    const auto request = context.build_request();
+    EXPECT_EQ(json_serializer::dump(request, json_serializer::utf8_mode::trusted), request.dump());
+    EXPECT_EQ(request["stop"][0], R);
+
+    context_config strict;
+    strict.utf8_handling = utf8_policy::validate;
+    general_context validating(schema, strict);
+    try {
+        validating.add_user_message("abc\x80");
+        FAIL();
+    } catch (const validation_exception& e) {
+        EXPECT_NE(std::string(e.what()).find("byte 3"), std::string::npos) << e.what();
+    }
+    EXPECT_TRUE(validating.get_messages().empty());
+    EXPECT_THROW(validating.set_parameter("stop", nlohmann::json::array({"\xFF"})), validation_exception);
+    EXPECT_FALSE(validating.has_parameter("stop"));
+
+    context_config unchecked;
+    unchecked.utf8_handling = utf8_policy::none;
+    general_context raw(schema, unchecked);
+    EXPECT_FALSE(raw.validates_utf8());
+    raw.add_user_message("abc\x80");
+    EXPECT_EQ(raw.get_messages()[0]["content"][0]["text"], "abc\x80");
+}
+
+TEST(Utf8Test, ReportsSimdLevel) {
+    const std::string level = utf8::simd_level();
+    EXPECT_TRUE(level == "avx2" || level == "scalar") << level;
+}
+
+} // namespace testing
+} // namespace hyni
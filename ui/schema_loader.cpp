@@ -1,10 +1,10 @@
 #include "schema_loader.h"
 #include "provider_manager.h"
+#include "general_context.h"
 #include <QDir>
 #include <QFile>
 #include <QLoggingCategory>
 #include <nlohmann/json.hpp>
-#include <fstream>
 #include <memory>
 
 Q_LOGGING_CATEGORY(hyniSchemaLoader, "hyni.gui.schema_loader")
@@ -42,20 +42,12 @@ void SchemaLoader::run()
             try {
                 qCDebug(hyniSchemaLoader) << "Loading schema file:" << fileInfo.filePath();
 
-                // Use nlohmann::json to parse the file
-                std::ifstream file(fileInfo.filePath().toStdString());
-                if (!file.is_open()) {
-                    QString error = QString("Cannot open file: %1").arg(fileInfo.fileName());
-                    qCWarning(hyniSchemaLoader) << error;
-                    emit errorOccurred(error);
-                    continue;
-                }
-
+                // Resolves "extends" so derived schemas show their inherited settings
                 nlohmann::json schema;
                 try {
-                    file >> schema;
-                } catch (const nlohmann::json::parse_error &e) {
-                    QString error = QString("JSON parse error in %1: %2")
+                    schema = hyni::general_context::load_schema_file(fileInfo.filePath().toStdString());
+                } catch (const hyni::schema_exception &e) {
+                    QString error = QString("Schema error in %1: %2")
                     .arg(fileInfo.fileName())
                         .arg(e.what());
                     qCWarning(hyniSchemaLoader) << error;